@@ -0,0 +1,34 @@
+// Global bindless descriptor set, see src/bindless.h.
+#extension GL_EXT_nonuniform_qualifier : require
+
+#define BINDLESS_SET 0
+#define BINDLESS_BINDING_IMAGES 0
+#define BINDLESS_BINDING_BUFFERS 1
+#define BINDLESS_BINDING_SAMPLERS 2
+#define BINDLESS_BINDING_STORAGE_IMAGES 3
+
+#define BINDLESS_INVALID_HANDLE 0xffffffffu
+
+#define BINDLESS_SAMPLER_LINEAR_REPEAT 0
+#define BINDLESS_SAMPLER_LINEAR_CLAMP 1
+#define BINDLESS_SAMPLER_NEAREST_CLAMP 2
+
+layout(set = BINDLESS_SET, binding = BINDLESS_BINDING_IMAGES) uniform texture2D bindless_textures[];
+layout(set = BINDLESS_SET, binding = BINDLESS_BINDING_SAMPLERS) uniform sampler bindless_samplers[];
+
+// Opt-in: unformatted writes need shaderStorageImageWriteWithoutFormat.
+#ifdef BINDLESS_STORAGE_IMAGES
+layout(set = BINDLESS_SET, binding = BINDLESS_BINDING_STORAGE_IMAGES) writeonly uniform image2D bindless_storage_images[];
+#endif
+
+// Declares a typed view of the storage buffer array, e.g.
+//   struct Instance { vec4 rect; };
+//   BINDLESS_BUFFER(readonly, Instances, Instance, instances);
+//   ... instances[nonuniformEXT(handle)].items[gl_InstanceIndex]
+#define BINDLESS_BUFFER(qualifier, block, type, name) \
+  layout(std430, set = BINDLESS_SET, binding = BINDLESS_BINDING_BUFFERS) qualifier buffer block { type items[]; } name[]
+
+vec4 bindless_sample(uint texture_handle, uint sampler_handle, vec2 uv) {
+  return texture(sampler2D(bindless_textures[nonuniformEXT(texture_handle)],
+                           bindless_samplers[nonuniformEXT(sampler_handle)]), uv);
+}
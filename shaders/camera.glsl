@@ -0,0 +1,8 @@
+// Per-window camera block from the uniform ring, see CameraUniforms in src/render.h.
+#define UNIFORM_RING_SET 1
+
+layout(std140, set = UNIFORM_RING_SET, binding = 0) uniform Camera {
+  mat4 view_proj;
+  vec4 position;  // xy world position, z zoom
+  vec4 viewport;  // xy render size in pixels, zw reciprocal
+} camera;
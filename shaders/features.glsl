@@ -0,0 +1,8 @@
+// Pipeline feature switches, see ShaderFeatureBits in src/vk.h. Each is a
+// specialization constant, so a disabled feature is compiled out of the pipeline
+// instead of being branched on per vertex or fragment.
+layout(constant_id = 0) const bool FEATURE_INSTANCING = false;
+layout(constant_id = 1) const bool FEATURE_TEXTURING = false;
+layout(constant_id = 2) const bool FEATURE_ALPHA_TEST = false;
+
+#define ALPHA_TEST_CUTOFF 0.5
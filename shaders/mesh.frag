@@ -0,0 +1,30 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "bindless.glsl"
+#include "features.glsl"
+
+layout(location = 0) in vec3 in_normal;
+layout(location = 1) in vec2 in_uv;
+
+// Mirrors MeshPushConstants in src/mesh.h.
+layout(push_constant) uniform Push {
+  vec4 position_scale;
+  vec4 position_offset;
+  uint objects_handle;
+  uint texture_handle;
+} pc;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+  vec4 albedo = vec4(1.0);
+  if (FEATURE_TEXTURING) {
+    albedo = bindless_sample(pc.texture_handle, BINDLESS_SAMPLER_LINEAR_REPEAT, in_uv);
+  }
+  if (FEATURE_ALPHA_TEST && albedo.a < ALPHA_TEST_CUTOFF) discard;
+
+  const vec3 light_dir = normalize(vec3(0.4, -0.8, 0.6));
+  float diffuse = max(dot(normalize(in_normal), light_dir), 0.0);
+  out_color = vec4(albedo.rgb * (0.15 + 0.85 * diffuse), 1.0);
+}
@@ -0,0 +1,52 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "bindless.glsl"
+#include "camera.glsl"
+#include "features.glsl"
+
+// Quantized MeshVertex, see src/mesh_format.h.
+layout(location = 0) in vec4 in_position;
+layout(location = 1) in vec2 in_normal;
+layout(location = 2) in vec2 in_uv;
+
+// Mirrors GpuObject in src/gpu_scene.h.
+struct GpuObject {
+  vec4 sphere;
+  uint index_count;
+  uint first_index;
+  int vertex_offset;
+  uint user_data;
+};
+
+BINDLESS_BUFFER(readonly, Objects, GpuObject, objects);
+
+// Mirrors MeshPushConstants in src/mesh.h.
+layout(push_constant) uniform Push {
+  vec4 position_scale;
+  vec4 position_offset;
+  uint objects_handle;
+  uint texture_handle;
+} pc;
+
+layout(location = 0) out vec3 out_normal;
+layout(location = 1) out vec2 out_uv;
+
+vec3 octahedral_decode(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  float t = max(-n.z, 0.0);
+  n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+  return normalize(n);
+}
+
+void main() {
+  vec3 position = pc.position_offset.xyz + in_position.xyz * pc.position_scale.xyz;
+  if (FEATURE_INSTANCING) {
+    // gl_InstanceIndex is the object index written by the cull pass.
+    GpuObject object = objects[pc.objects_handle].items[gl_InstanceIndex];
+    position += object.sphere.xyz;
+  }
+  gl_Position = camera.view_proj * vec4(position, 1.0);
+  out_normal = octahedral_decode(in_normal);
+  out_uv = in_uv;
+}
@@ -0,0 +1,14 @@
+#version 450
+
+layout(location = 0) in vec2 in_cell;
+layout(location = 1) flat in uint in_glyph;
+layout(location = 2) flat in vec4 in_color;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+  // Bit 14 is the top-left font pixel, rows of three from the top.
+  uvec2 cell = min(uvec2(in_cell), uvec2(2u, 4u));
+  if (((in_glyph >> (14u - cell.y * 3u - cell.x)) & 1u) == 0u) discard;
+  out_color = vec4(in_color.rgb * in_color.a, in_color.a);  // premultiplied
+}
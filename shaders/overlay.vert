@@ -0,0 +1,39 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "bindless.glsl"
+
+// Mirrors OverlayInstance in src/overlay.h.
+struct OverlayInstance {
+  vec4 rect;  // pixels: x, y, width, height
+  uint glyph;  // 3x5 bitmap, see src/overlay.c
+  uint color;  // RGBA8
+  uint pad0;
+  uint pad1;
+};
+
+BINDLESS_BUFFER(readonly, OverlayInstances, OverlayInstance, overlay_instances);
+
+// Mirrors OverlayPushConstants in src/overlay.c.
+layout(push_constant) uniform Push {
+  uint instances_handle;
+  uint first_instance;
+  vec2 inv_extent;
+} pc;
+
+layout(location = 0) out vec2 out_cell;
+layout(location = 1) flat out uint out_glyph;
+layout(location = 2) flat out vec4 out_color;
+
+const vec2 corners[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(0.0, 1.0),
+                               vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(1.0, 1.0));
+
+void main() {
+  OverlayInstance instance = overlay_instances[pc.instances_handle].items[pc.first_instance + gl_InstanceIndex];
+  vec2 corner = corners[gl_VertexIndex];
+  vec2 pixel = instance.rect.xy + corner * instance.rect.zw;
+  gl_Position = vec4(pixel * pc.inv_extent * 2.0 - 1.0, 0.0, 1.0);
+  out_cell = corner * vec2(3.0, 5.0);
+  out_glyph = instance.glyph;
+  out_color = unpackUnorm4x8(instance.color);
+}
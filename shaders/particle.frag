@@ -0,0 +1,11 @@
+#version 450
+
+layout(location = 0) in vec2 in_uv;
+layout(location = 1) in vec4 in_color;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+  float alpha = in_color.a * clamp(1.0 - dot(in_uv, in_uv), 0.0, 1.0);
+  out_color = vec4(in_color.rgb * alpha, alpha);  // premultiplied
+}
@@ -0,0 +1,31 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "bindless.glsl"
+#include "camera.glsl"
+#include "particles.glsl"
+
+// Mirrors ParticleDrawPushConstants in src/particles.c.
+layout(push_constant) uniform Push {
+  uint positions;
+  uint velocities;
+  uint colors;
+  uint alive;
+} pc;
+
+layout(location = 0) out vec2 out_uv;
+layout(location = 1) out vec4 out_color;
+
+const vec2 corners[6] = vec2[](vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(-1.0, 1.0),
+                               vec2(-1.0, 1.0), vec2(1.0, -1.0), vec2(1.0, 1.0));
+
+void main() {
+  uint index = particle_indices[pc.alive].items[gl_InstanceIndex];
+  vec4 position = particle_positions[pc.positions].items[index];
+  float size = particle_velocities[pc.velocities].items[index].w;
+  vec2 corner = corners[gl_VertexIndex];
+  gl_Position = camera.view_proj * vec4(position.xy + corner * (0.5 * size), position.z, 1.0);
+  out_uv = corner;
+  out_color = unpackUnorm4x8(particle_colors[pc.colors].items[index]);
+  out_color.a *= clamp(position.w * 2.0, 0.0, 1.0);  // fade out over the last half second
+}
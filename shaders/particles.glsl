@@ -0,0 +1,33 @@
+// GPU particle state, see src/particles.h.
+#define PARTICLE_GROUP_SIZE 256
+
+// Mirrors ParticleCounters in src/particles.h.
+struct ParticleCounters {
+  int dead_count;
+  uint alive_count;  // particles in the update's input list
+  uint pad0;
+  uint pad1;
+  uvec3 update;  // VkDispatchIndirectCommand
+  uint pad2;
+  uint vertex_count;  // VkDrawIndirectCommand; instance_count is the output list
+  uint instance_count;
+  uint first_vertex;
+  uint first_instance;
+};
+
+// Mirrors GpuParticleEmitter in src/particles.c.
+struct GpuParticleEmitter {
+  vec4 position_spread;  // xyz position, w spread
+  vec4 velocity_spread;
+  vec4 color;
+  float lifetime;
+  float size;
+  uint first;
+  uint count;
+};
+
+BINDLESS_BUFFER(, ParticlePositions, vec4, particle_positions);  // xyz position, w life
+BINDLESS_BUFFER(, ParticleVelocities, vec4, particle_velocities);  // xyz velocity, w size
+BINDLESS_BUFFER(, ParticleColors, uint, particle_colors);  // RGBA8
+BINDLESS_BUFFER(, ParticleIndices, uint, particle_indices);  // alive and dead lists
+BINDLESS_BUFFER(coherent, ParticleCounterBlock, ParticleCounters, particle_counters);
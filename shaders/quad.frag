@@ -0,0 +1,26 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "bindless.glsl"
+
+// Mirrors QuadPushConstants in src/render_vulkan.c.
+layout(push_constant) uniform Push {
+  uint instances_handle;
+  uint first_instance;
+  uint texture_handle;
+} pc;
+
+layout(location = 0) in vec2 in_uv;
+layout(location = 1) in vec4 in_color;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+  // Untextured quads are flat color; the handle is the same for the whole draw.
+  vec4 texel = vec4(1.0);
+  if (pc.texture_handle != BINDLESS_INVALID_HANDLE) {
+    texel = bindless_sample(pc.texture_handle, BINDLESS_SAMPLER_LINEAR_CLAMP, in_uv);
+  }
+  vec4 color = texel * in_color;
+  out_color = vec4(color.rgb * color.a, color.a);  // premultiplied
+}
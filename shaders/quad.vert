@@ -0,0 +1,35 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "bindless.glsl"
+#include "camera.glsl"
+
+// Mirrors QuadInstance in src/render_vulkan.h.
+struct QuadInstance {
+  vec4 rect;  // world units: x, y of the top-left corner, width, height
+  vec4 uv;  // u0, v0, u1, v1
+  vec4 color;
+};
+
+BINDLESS_BUFFER(readonly, QuadInstances, QuadInstance, quad_instances);
+
+// Mirrors QuadPushConstants in src/render_vulkan.c.
+layout(push_constant) uniform Push {
+  uint instances_handle;
+  uint first_instance;
+  uint texture_handle;
+} pc;
+
+layout(location = 0) out vec2 out_uv;
+layout(location = 1) out vec4 out_color;
+
+const vec2 corners[6] = vec2[](vec2(0.0, 0.0), vec2(1.0, 0.0), vec2(0.0, 1.0),
+                               vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(1.0, 1.0));
+
+void main() {
+  QuadInstance quad = quad_instances[pc.instances_handle].items[pc.first_instance + gl_InstanceIndex];
+  vec2 corner = corners[gl_VertexIndex];
+  gl_Position = camera.view_proj * vec4(quad.rect.xy + corner * quad.rect.zw, 0.0, 1.0);
+  out_uv = mix(quad.uv.xy, quad.uv.zw, corner);
+  out_color = quad.color;
+}
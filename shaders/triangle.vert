@@ -0,0 +1,22 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+#include "camera.glsl"
+
+layout(location = 0) out vec3 fragColor;
+
+// World units, centered on the origin; fills the middle of an 800x600 view at zoom 1.
+vec2 positions[3] = vec2[](
+    vec2(0.0, -150.0),
+    vec2(200.0, 150.0),
+    vec2(-200.0, 150.0));
+
+vec3 colors[3] = vec3[](
+    vec3(1.0, 0.0, 0.0),
+    vec3(0.0, 1.0, 0.0),
+    vec3(0.0, 0.0, 1.0));
+
+void main() {
+  gl_Position = camera.view_proj * vec4(positions[gl_VertexIndex], 0.0, 1.0);
+  fragColor = colors[gl_VertexIndex];
+}
@@ -0,0 +1,445 @@
+#include "atlas.h"
+#include <math.h>
+#include <stb_image.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static VkDeviceSize level_bytes(uint32_t level) {
+  VkDeviceSize size = ATLAS_PAGE_SIZE >> level;
+  return size * size * 4;
+}
+
+static VkDeviceSize page_bytes(void) {
+  VkDeviceSize total = 0;
+  for (uint32_t level = 0; level < ATLAS_MIP_LEVELS; ++level) total += level_bytes(level);
+  return total;
+}
+
+// Makes room for count free rects; the list is left as it was on failure.
+static bool reserve_free_rects(AtlasPage* page, uint32_t count) {
+  if (count <= page->free_capacity) return true;
+  uint32_t capacity = MAX(MAX(page->free_capacity * 2, count), 64u);
+  AtlasRect* rects = realloc(page->free_rects, sizeof(AtlasRect) * capacity);
+  if (!rects) return false;
+  page->free_rects = rects;
+  page->free_capacity = capacity;
+  return true;
+}
+
+static bool push_free_rect(AtlasPage* page, AtlasRect rect) {
+  if (!reserve_free_rects(page, page->free_count + 1)) return false;
+  page->free_rects[page->free_count++] = rect;
+  return true;
+}
+
+static bool reset_free_rects(AtlasPage* page) {
+  page->free_count = 0;
+  return push_free_rect(page, (AtlasRect){0, 0, ATLAS_PAGE_SIZE, ATLAS_PAGE_SIZE});
+}
+
+static bool rects_intersect(AtlasRect a, AtlasRect b) {
+  return a.x < b.x + b.width && b.x < a.x + a.width && a.y < b.y + b.height && b.y < a.y + a.height;
+}
+
+static bool rect_contains(AtlasRect outer, AtlasRect inner) {
+  return inner.x >= outer.x && inner.y >= outer.y && inner.x + inner.width <= outer.x + outer.width &&
+         inner.y + inner.height <= outer.y + outer.height;
+}
+
+// Drops free rects that lie inside another one, keeping the list maximal.
+static void prune_free_rects(AtlasPage* page) {
+  for (uint32_t i = 0; i < page->free_count; ++i) {
+    for (uint32_t j = i + 1; j < page->free_count; ++j) {
+      if (rect_contains(page->free_rects[j], page->free_rects[i])) {
+        page->free_rects[i--] = page->free_rects[--page->free_count];
+        break;
+      }
+      if (rect_contains(page->free_rects[i], page->free_rects[j])) {
+        page->free_rects[j--] = page->free_rects[--page->free_count];
+      }
+    }
+  }
+}
+
+// MaxRects: every free rect overlapping the placed one is replaced by up to four
+// maximal rects around it. Room for those is reserved first, so on failure the page is
+// unchanged.
+static bool place_rect(AtlasPage* page, AtlasRect used) {
+  uint32_t overlaps = 0;
+  for (uint32_t i = 0; i < page->free_count; ++i) overlaps += rects_intersect(page->free_rects[i], used);
+  if (!reserve_free_rects(page, page->free_count + overlaps * 4)) return false;
+
+  uint32_t count = page->free_count;
+  for (uint32_t i = 0; i < count;) {
+    AtlasRect f = page->free_rects[i];
+    if (!rects_intersect(f, used)) {
+      i++;
+      continue;
+    }
+    page->free_rects[i] = page->free_rects[--count];
+    page->free_rects[count] = page->free_rects[--page->free_count];
+
+    if (used.x > f.x) push_free_rect(page, (AtlasRect){f.x, f.y, (uint16_t)(used.x - f.x), f.height});
+    if (used.x + used.width < f.x + f.width) {
+      push_free_rect(page, (AtlasRect){(uint16_t)(used.x + used.width), f.y,
+                                       (uint16_t)(f.x + f.width - used.x - used.width), f.height});
+    }
+    if (used.y > f.y) push_free_rect(page, (AtlasRect){f.x, f.y, f.width, (uint16_t)(used.y - f.y)});
+    if (used.y + used.height < f.y + f.height) {
+      push_free_rect(page, (AtlasRect){f.x, (uint16_t)(used.y + used.height), f.width,
+                                       (uint16_t)(f.y + f.height - used.y - used.height)});
+    }
+  }
+  prune_free_rects(page);
+  return true;
+}
+
+// Best short side fit. Returns the leftover short side, or UINT32_MAX if nothing fits.
+static uint32_t find_position(const AtlasPage* page, uint16_t width, uint16_t height, AtlasRect* out) {
+  uint32_t best_short = UINT32_MAX, best_long = UINT32_MAX;
+  for (uint32_t i = 0; i < page->free_count; ++i) {
+    AtlasRect f = page->free_rects[i];
+    if (f.width < width || f.height < height) continue;
+    uint32_t leftover_w = f.width - width, leftover_h = f.height - height;
+    uint32_t short_side = MIN(leftover_w, leftover_h), long_side = MAX(leftover_w, leftover_h);
+    if (short_side < best_short || (short_side == best_short && long_side < best_long)) {
+      best_short = short_side;
+      best_long = long_side;
+      *out = (AtlasRect){f.x, f.y, width, height};
+    }
+  }
+  return best_short;
+}
+
+static float linear_to_srgb(float c) {
+  return c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+}
+
+// Rebuilds the lower levels under rect; averaging happens in linear space.
+static void downsample_rect(Atlas* atlas, AtlasPage* page, AtlasRect rect) {
+  for (uint32_t level = 1; level < ATLAS_MIP_LEVELS; ++level) {
+    uint32_t size = ATLAS_PAGE_SIZE >> level;
+    uint32_t src_size = size * 2;
+    const uint8_t* src = page->pixels[level - 1];
+    uint8_t* dst = page->pixels[level];
+    for (uint32_t y = rect.y >> level; y < (uint32_t)(rect.y + rect.height) >> level; ++y) {
+      for (uint32_t x = rect.x >> level; x < (uint32_t)(rect.x + rect.width) >> level; ++x) {
+        const uint8_t* s[4] = {
+            &src[((y * 2) * src_size + x * 2) * 4], &src[((y * 2) * src_size + x * 2 + 1) * 4],
+            &src[((y * 2 + 1) * src_size + x * 2) * 4], &src[((y * 2 + 1) * src_size + x * 2 + 1) * 4]};
+        uint8_t* d = &dst[(y * size + x) * 4];
+        for (uint32_t c = 0; c < 3; ++c) {
+          float sum = 0.0f;
+          for (uint32_t i = 0; i < 4; ++i) sum += atlas->srgb_to_linear[s[i][c]];
+          d[c] = (uint8_t)lrintf(linear_to_srgb(sum * 0.25f) * 255.0f);
+        }
+        d[3] = (uint8_t)((s[0][3] + s[1][3] + s[2][3] + s[3][3] + 2) / 4);
+      }
+    }
+  }
+}
+
+static void mark_dirty(AtlasPage* page, AtlasRect rect) {
+  if (!page->has_dirty) {
+    page->dirty = rect;
+    page->has_dirty = true;
+    return;
+  }
+  uint16_t x0 = MIN(page->dirty.x, rect.x), y0 = MIN(page->dirty.y, rect.y);
+  uint16_t x1 = MAX(page->dirty.x + page->dirty.width, rect.x + rect.width);
+  uint16_t y1 = MAX(page->dirty.y + page->dirty.height, rect.y + rect.height);
+  page->dirty = (AtlasRect){x0, y0, (uint16_t)(x1 - x0), (uint16_t)(y1 - y0)};
+}
+
+static void destroy_staging(Atlas* atlas) {
+  for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+    vk_destroy_buffer(atlas->ctx, atlas->staging[i], atlas->staging_memory[i]);
+    atlas->staging[i] = VK_NULL_HANDLE;
+    atlas->staging_memory[i] = VK_NULL_HANDLE;
+    atlas->staging_data[i] = NULL;
+  }
+}
+
+VkResult atlas_init(Atlas* atlas, VkContext* ctx, uint32_t max_pages) {
+  memset(atlas, 0, sizeof(*atlas));
+  atlas->lock = mutex_create();
+  if (!atlas->lock) {
+    fprintf(stderr, "Failed to create texture atlas!\n");
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  atlas->ctx = ctx;
+  atlas->max_pages = MIN(max_pages, (uint32_t)ATLAS_MAX_PAGES);
+  for (uint32_t i = 0; i < 256; ++i) {
+    float c = (float)i / 255.0f;
+    atlas->srgb_to_linear[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+  }
+  return VK_SUCCESS;
+}
+
+void atlas_destroy(Atlas* atlas) {
+  VkContext* ctx = atlas->ctx;
+  if (!ctx) return;
+  for (uint32_t i = 0; i < atlas->page_count; ++i) {
+    AtlasPage* page = &atlas->pages[i];
+    if (page->texture.image != VK_NULL_HANDLE) texture_destroy(ctx, &page->texture);
+    free(page->pixels[0]);
+    free(page->free_rects);
+  }
+  destroy_staging(atlas);
+  mutex_destroy(atlas->lock);
+  memset(atlas, 0, sizeof(*atlas));
+}
+
+// CPU side of a new page; its texture waits for the next flush. Called with the lock held.
+static bool add_page(Atlas* atlas) {
+  if (atlas->page_count == atlas->max_pages) return false;
+  AtlasPage* page = &atlas->pages[atlas->page_count];
+  uint8_t* pixels = calloc(1, page_bytes());
+  if (!pixels || !reset_free_rects(page)) {
+    free(pixels);
+    return false;
+  }
+  VkDeviceSize offset = 0;
+  for (uint32_t level = 0; level < ATLAS_MIP_LEVELS; ++level) {
+    page->pixels[level] = pixels + offset;
+    offset += level_bytes(level);
+  }
+  atlas->page_count++;
+  return true;
+}
+
+uint32_t atlas_add_pixels(Atlas* atlas, const uint8_t* rgba, uint32_t width, uint32_t height) {
+  uint32_t padded_width = ALIGN_FORWARD(width + 2 * ATLAS_PADDING, ATLAS_PADDING);
+  uint32_t padded_height = ALIGN_FORWARD(height + 2 * ATLAS_PADDING, ATLAS_PADDING);
+  if (width == 0 || height == 0 || padded_width > ATLAS_PAGE_SIZE || padded_height > ATLAS_PAGE_SIZE) {
+    return ATLAS_INVALID_ID;
+  }
+
+  mutex_lock(atlas->lock);
+  uint32_t id = ATLAS_INVALID_ID;
+  AtlasRect rect;
+  uint32_t page_index = 0;
+  uint32_t best = UINT32_MAX;
+  for (uint32_t i = 0; i < atlas->page_count; ++i) {
+    AtlasRect candidate;
+    uint32_t score = find_position(&atlas->pages[i], (uint16_t)padded_width, (uint16_t)padded_height, &candidate);
+    if (score < best) {
+      best = score;
+      rect = candidate;
+      page_index = i;
+    }
+  }
+  if (best == UINT32_MAX) {
+    if (!add_page(atlas)) goto done;
+    page_index = atlas->page_count - 1;
+    find_position(&atlas->pages[page_index], (uint16_t)padded_width, (uint16_t)padded_height, &rect);
+  }
+
+  if (atlas->free_entry_count == 0 && atlas->next_entry == ATLAS_MAX_ENTRIES) goto done;
+  AtlasPage* page = &atlas->pages[page_index];
+  if (!place_rect(page, rect)) goto done;
+  id = atlas->free_entry_count > 0 ? atlas->free_entries[--atlas->free_entry_count] : atlas->next_entry++;
+  page->entry_count++;
+  atlas->entries[id] = (AtlasEntry){
+      .rect = rect, .width = (uint16_t)width, .height = (uint16_t)height, .page = (uint8_t)page_index, .used = true};
+
+  // Gutters repeat the edge texels so filtering at the border never reaches a neighbor.
+  uint8_t* dst = page->pixels[0];
+  for (uint32_t y = 0; y < rect.height; ++y) {
+    uint32_t sy = (uint32_t)CLAMP((int32_t)y - ATLAS_PADDING, 0, (int32_t)height - 1);
+    for (uint32_t x = 0; x < rect.width; ++x) {
+      uint32_t sx = (uint32_t)CLAMP((int32_t)x - ATLAS_PADDING, 0, (int32_t)width - 1);
+      memcpy(&dst[((rect.y + y) * ATLAS_PAGE_SIZE + rect.x + x) * 4], &rgba[(sy * width + sx) * 4], 4);
+    }
+  }
+  downsample_rect(atlas, page, rect);
+  mark_dirty(page, rect);
+
+done:
+  mutex_unlock(atlas->lock);
+  return id;
+}
+
+uint32_t atlas_add_image(Atlas* atlas, const char* path) {
+  int width, height, channels;
+  uint8_t* pixels = stbi_load(path, &width, &height, &channels, 4);
+  if (!pixels) {
+    fprintf(stderr, "Failed to load image '%s': %s\n", path, stbi_failure_reason());
+    return ATLAS_INVALID_ID;
+  }
+  uint32_t id = atlas_add_pixels(atlas, pixels, (uint32_t)width, (uint32_t)height);
+  if (id == ATLAS_INVALID_ID) fprintf(stderr, "Atlas is full, cannot add '%s'\n", path);
+  stbi_image_free(pixels);
+  return id;
+}
+
+void atlas_remove(Atlas* atlas, uint32_t id) {
+  if (id >= ATLAS_MAX_ENTRIES) return;
+  mutex_lock(atlas->lock);
+  AtlasEntry* entry = &atlas->entries[id];
+  if (entry->used) {
+    AtlasPage* page = &atlas->pages[entry->page];
+    entry->used = false;
+    atlas->free_entries[atlas->free_entry_count++] = id;
+    // Freed rects do not merge with their neighbors, so an empty page starts over. A
+    // rect that cannot be listed stays unused until then; an empty page keeps its list's
+    // first slot.
+    if (--page->entry_count == 0) {
+      reset_free_rects(page);
+    } else if (push_free_rect(page, entry->rect)) {
+      prune_free_rects(page);
+    }
+  }
+  mutex_unlock(atlas->lock);
+}
+
+bool atlas_get_region(Atlas* atlas, uint32_t id, AtlasRegion* region) {
+  if (id >= ATLAS_MAX_ENTRIES) return false;
+  mutex_lock(atlas->lock);
+  const AtlasEntry* entry = &atlas->entries[id];
+  bool used = entry->used && atlas->pages[entry->page].texture.image != VK_NULL_HANDLE;
+  if (used) {
+    float scale = 1.0f / ATLAS_PAGE_SIZE;
+    region->texture = atlas->pages[entry->page].texture.handle;
+    region->u0 = (float)(entry->rect.x + ATLAS_PADDING) * scale;
+    region->v0 = (float)(entry->rect.y + ATLAS_PADDING) * scale;
+    region->u1 = region->u0 + (float)entry->width * scale;
+    region->v1 = region->v0 + (float)entry->height * scale;
+  }
+  mutex_unlock(atlas->lock);
+  return used;
+}
+
+static VkImageMemoryBarrier page_barrier(const AtlasPage* page, VkImageLayout old_layout, VkImageLayout new_layout,
+                                         VkAccessFlags src_access, VkAccessFlags dst_access) {
+  return (VkImageMemoryBarrier){
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = src_access,
+      .dstAccessMask = dst_access,
+      .oldLayout = old_layout,
+      .newLayout = new_layout,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = page->texture.image,
+      .subresourceRange = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .levelCount = ATLAS_MIP_LEVELS, .layerCount = 1}};
+}
+
+// A new page uploads all of its levels at once. Without a texture the page stays
+// CPU-only, and the next sprite added to it retries.
+static void create_page_texture(Atlas* atlas, AtlasPage* page, VkCommandBuffer cmd) {
+  TextureDesc desc = {
+      .width = ATLAS_PAGE_SIZE,
+      .height = ATLAS_PAGE_SIZE,
+      .format = ATLAS_FORMAT,
+      .mip_levels = ATLAS_MIP_LEVELS,
+      .data = page->pixels[0],
+      .size = page_bytes()};
+  for (uint32_t level = 0; level < ATLAS_MIP_LEVELS; ++level) {
+    desc.level_offsets[level] = (VkDeviceSize)(page->pixels[level] - page->pixels[0]);
+  }
+  if (texture_create_recorded(atlas->ctx, &desc, cmd, &page->texture) != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create atlas page!\n");
+  }
+  page->has_dirty = false;
+}
+
+// One page worth of levels per frame in flight bounds a flush; only needed once a page
+// that already has a texture changes.
+static VkResult create_staging(Atlas* atlas) {
+  VkContext* ctx = atlas->ctx;
+  VkResult res = VK_SUCCESS;
+  for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT && res == VK_SUCCESS; ++i) {
+    res = vk_create_buffer(ctx, page_bytes(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                           &atlas->staging[i], &atlas->staging_memory[i]);
+    if (res == VK_SUCCESS) {
+      res = vkMapMemory(ctx->device, atlas->staging_memory[i], 0, page_bytes(), 0, (void**)&atlas->staging_data[i]);
+    }
+  }
+  if (res != VK_SUCCESS) destroy_staging(atlas);
+  return res;
+}
+
+void atlas_flush(Atlas* atlas, VkCommandBuffer cmd, uint32_t frame) {
+  mutex_lock(atlas->lock);
+
+  bool updates = false;
+  for (uint32_t i = 0; i < atlas->page_count; ++i) {
+    AtlasPage* page = &atlas->pages[i];
+    if (!page->has_dirty) continue;
+    if (page->texture.image == VK_NULL_HANDLE) {
+      create_page_texture(atlas, page, cmd);
+    } else {
+      updates = true;
+    }
+  }
+  if (updates && !atlas->staging_data[0] && create_staging(atlas) != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create atlas staging buffers!\n");
+    updates = false;
+  }
+  if (!updates) {
+    mutex_unlock(atlas->lock);
+    return;
+  }
+
+  // Stage the dirty rect of every level; pages that do not fit wait for the next frame.
+  uint8_t* staging = atlas->staging_data[frame];
+  VkDeviceSize offset = 0;
+  VkBufferImageCopy regions[ATLAS_MAX_PAGES][ATLAS_MIP_LEVELS];
+  uint32_t pages[ATLAS_MAX_PAGES];
+  uint32_t page_count = 0;
+  for (uint32_t i = 0; i < atlas->page_count; ++i) {
+    AtlasPage* page = &atlas->pages[i];
+    if (!page->has_dirty) continue;
+
+    VkDeviceSize needed = 0;
+    for (uint32_t level = 0; level < ATLAS_MIP_LEVELS; ++level) {
+      needed += (VkDeviceSize)(page->dirty.width >> level) * (page->dirty.height >> level) * 4;
+    }
+    if (offset + needed > page_bytes()) continue;
+
+    for (uint32_t level = 0; level < ATLAS_MIP_LEVELS; ++level) {
+      uint32_t x = page->dirty.x >> level, y = page->dirty.y >> level;
+      uint32_t width = page->dirty.width >> level, height = page->dirty.height >> level;
+      uint32_t size = ATLAS_PAGE_SIZE >> level;
+      regions[page_count][level] = (VkBufferImageCopy){
+          .bufferOffset = offset,
+          .imageSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .layerCount = 1},
+          .imageOffset = {(int32_t)x, (int32_t)y, 0},
+          .imageExtent = {width, height, 1}};
+      for (uint32_t row = 0; row < height; ++row) {
+        memcpy(staging + offset, &page->pixels[level][((y + row) * size + x) * 4], (size_t)width * 4);
+        offset += (VkDeviceSize)width * 4;
+      }
+    }
+    page->has_dirty = false;
+    pages[page_count++] = i;
+  }
+  mutex_unlock(atlas->lock);
+  if (page_count == 0) return;
+
+  // Barriers on the same queue also order against earlier frames still sampling the page.
+  VkImageMemoryBarrier barriers[ATLAS_MAX_PAGES];
+  for (uint32_t i = 0; i < page_count; ++i) {
+    barriers[i] = page_barrier(&atlas->pages[pages[i]], VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+                               VK_ACCESS_TRANSFER_WRITE_BIT);
+  }
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, page_count, barriers);
+
+  for (uint32_t i = 0; i < page_count; ++i) {
+    vkCmdCopyBufferToImage(cmd, atlas->staging[frame], atlas->pages[pages[i]].texture.image,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, ATLAS_MIP_LEVELS, regions[i]);
+  }
+
+  for (uint32_t i = 0; i < page_count; ++i) {
+    barriers[i] = page_barrier(&atlas->pages[pages[i]], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+                               VK_ACCESS_SHADER_READ_BIT);
+  }
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0,
+                       NULL, page_count, barriers);
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "texture.h"
+#include "thread.h"
+#include "vk.h"
+
+#define ATLAS_PAGE_SIZE 1024
+#define ATLAS_MAX_PAGES 4
+#define ATLAS_MAX_ENTRIES 4096
+#define ATLAS_MIP_LEVELS 4
+// Rects are aligned to and padded by one texel of the smallest mip, so no mip level
+// ever filters across two sprites.
+#define ATLAS_PADDING (1 << (ATLAS_MIP_LEVELS - 1))
+#define ATLAS_FORMAT VK_FORMAT_R8G8B8A8_SRGB
+#define ATLAS_INVALID_ID UINT32_MAX
+
+typedef struct {
+  uint16_t x;
+  uint16_t y;
+  uint16_t width;
+  uint16_t height;
+} AtlasRect;
+
+// Where a sprite lives, ready to fill a Quad's texture and uv fields.
+typedef struct {
+  uint32_t texture;
+  float u0;
+  float v0;
+  float u1;
+  float v1;
+} AtlasRegion;
+
+typedef struct {
+  Texture texture;  // created by the first atlas_flush after the page gets a sprite
+  uint8_t* pixels[ATLAS_MIP_LEVELS];  // CPU copy of every level, RGBA8, in one allocation
+  AtlasRect* free_rects;              // MaxRects free list
+  uint32_t free_count;
+  uint32_t free_capacity;
+  uint32_t entry_count;
+  AtlasRect dirty;
+  bool has_dirty;
+} AtlasPage;
+
+typedef struct {
+  AtlasRect rect;  // padded footprint in the page
+  uint16_t width;
+  uint16_t height;
+  uint8_t page;
+  bool used;
+} AtlasEntry;
+
+// A few fixed-size pages shared by all sprites, so sprites batch into few draws and
+// descriptor updates stay rare. Insertion and eviction are CPU-side and thread-safe;
+// dirty rects are uploaded by atlas_flush on the thread that records the frame. Pages
+// and staging are allocated on first use, so an atlas without sprites costs nothing.
+typedef struct {
+  VkContext* ctx;
+  AtlasPage pages[ATLAS_MAX_PAGES];
+  uint32_t page_count;
+  uint32_t max_pages;
+  AtlasEntry entries[ATLAS_MAX_ENTRIES];
+  uint32_t free_entries[ATLAS_MAX_ENTRIES];
+  uint32_t free_entry_count;
+  uint32_t next_entry;
+  VkBuffer staging[MAX_FRAMES_IN_FLIGHT];
+  VkDeviceMemory staging_memory[MAX_FRAMES_IN_FLIGHT];
+  uint8_t* staging_data[MAX_FRAMES_IN_FLIGHT];
+  float srgb_to_linear[256];
+  Mutex* lock;
+} Atlas;
+
+// Allocates no pages yet; up to max_pages are created as sprites need them.
+VkResult atlas_init(Atlas* atlas, VkContext* ctx, uint32_t max_pages);
+void atlas_destroy(Atlas* atlas);
+
+// Return an id, or ATLAS_INVALID_ID when the image does not fit in any page.
+uint32_t atlas_add_pixels(Atlas* atlas, const uint8_t* rgba, uint32_t width, uint32_t height);
+uint32_t atlas_add_image(Atlas* atlas, const char* path);
+void atlas_remove(Atlas* atlas, uint32_t id);
+// False for unknown ids, and until the flush that creates the sprite's page.
+bool atlas_get_region(Atlas* atlas, uint32_t id, AtlasRegion* region);
+
+// Records uploads of everything inserted since the last flush into cmd, creating the
+// textures of new pages; call where the Vulkan queue is owned.
+void atlas_flush(Atlas* atlas, VkCommandBuffer cmd, uint32_t frame);
@@ -1,5 +1,27 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+
+#define CLAMP(x, a, b) (((x) < (a)) ? (a) : ((b) < (x)) ? (b) \
+                                                        : (x))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#define COUNTOF(a) (sizeof(a) / sizeof(*(a)))
+#define ALIGN_FORWARD(x, align) (((x) + ((align) - 1)) & ~((align) - 1))
+
+// FNV-1a. Start from FNV_OFFSET and feed each field of a key in turn.
+#define FNV_OFFSET 0xcbf29ce484222325ull
+#define FNV_PRIME 0x100000001b3ull
+
+static inline uint64_t hash_bytes(uint64_t hash, const void* data, size_t size) {
+  const uint8_t* bytes = data;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ bytes[i]) * FNV_PRIME;
+  }
+  return hash;
+}
+
 #define FORMAT_CHECK(fmt_pos, args_pos) __attribute__((format(printf, fmt_pos, args_pos)))
 
 typedef enum {
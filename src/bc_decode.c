@@ -0,0 +1,146 @@
+#include "bc_decode.h"
+#include <string.h>
+
+static void decode_rgb565(uint16_t c, uint8_t out[3]) {
+  uint8_t r = (c >> 11) & 0x1f, g = (c >> 5) & 0x3f, b = c & 0x1f;
+  out[0] = (uint8_t)((r << 3) | (r >> 2));
+  out[1] = (uint8_t)((g << 2) | (g >> 4));
+  out[2] = (uint8_t)((b << 3) | (b >> 2));
+}
+
+// Writes 16 RGBA texels. BC1 blocks with c0 <= c1 use three colors plus black, which
+// is transparent only in the RGBA formats; BC2/BC3 color blocks always use four colors.
+static void decode_color_block(const uint8_t* block, uint8_t out[64], bool bc1, bool punchthrough) {
+  uint16_t c0 = (uint16_t)(block[0] | (block[1] << 8));
+  uint16_t c1 = (uint16_t)(block[2] | (block[3] << 8));
+  uint8_t palette[4][4];
+  decode_rgb565(c0, palette[0]);
+  decode_rgb565(c1, palette[1]);
+  palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+
+  bool three_color = bc1 && c0 <= c1;
+  for (int i = 0; i < 3; ++i) {
+    if (three_color) {
+      palette[2][i] = (uint8_t)((palette[0][i] + palette[1][i]) / 2);
+      palette[3][i] = 0;
+    } else {
+      palette[2][i] = (uint8_t)((2 * palette[0][i] + palette[1][i] + 1) / 3);
+      palette[3][i] = (uint8_t)((palette[0][i] + 2 * palette[1][i] + 1) / 3);
+    }
+  }
+  if (three_color && punchthrough) palette[3][3] = 0;
+
+  uint32_t indices = (uint32_t)block[4] | ((uint32_t)block[5] << 8) | ((uint32_t)block[6] << 16) | ((uint32_t)block[7] << 24);
+  for (int t = 0; t < 16; ++t) {
+    memcpy(&out[t * 4], palette[(indices >> (t * 2)) & 3], 4);
+  }
+}
+
+// BC4 block into one channel of 16 RGBA texels.
+static void decode_channel_block(const uint8_t* block, uint8_t* out) {
+  uint8_t palette[8];
+  palette[0] = block[0];
+  palette[1] = block[1];
+  if (palette[0] > palette[1]) {
+    for (int i = 1; i < 7; ++i) palette[i + 1] = (uint8_t)(((7 - i) * palette[0] + i * palette[1] + 3) / 7);
+  } else {
+    for (int i = 1; i < 5; ++i) palette[i + 1] = (uint8_t)(((5 - i) * palette[0] + i * palette[1] + 2) / 5);
+    palette[6] = 0;
+    palette[7] = 255;
+  }
+
+  uint64_t indices = 0;
+  for (int i = 0; i < 6; ++i) indices |= (uint64_t)block[2 + i] << (8 * i);
+  for (int t = 0; t < 16; ++t) {
+    out[t * 4] = palette[(indices >> (t * 3)) & 7];
+  }
+}
+
+// BC2 explicit 4-bit alpha.
+static void decode_explicit_alpha(const uint8_t* block, uint8_t* out) {
+  for (int t = 0; t < 16; ++t) {
+    uint8_t a = (block[t / 2] >> ((t & 1) * 4)) & 0xf;
+    out[t * 4] = (uint8_t)(a | (a << 4));
+  }
+}
+
+static void decode_block(VkFormat format, const uint8_t* block, uint8_t texels[64]) {
+  switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+      decode_color_block(block, texels, true, false);
+      break;
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+      decode_color_block(block, texels, true, true);
+      break;
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+      decode_color_block(block + 8, texels, false, false);
+      decode_explicit_alpha(block, texels + 3);
+      break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+      decode_color_block(block + 8, texels, false, false);
+      decode_channel_block(block, texels + 3);
+      break;
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+      memset(texels, 0, 64);
+      decode_channel_block(block, texels);
+      for (int t = 0; t < 16; ++t) texels[t * 4 + 3] = 255;
+      break;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+      memset(texels, 0, 64);
+      decode_channel_block(block, texels);
+      decode_channel_block(block + 8, texels + 1);
+      for (int t = 0; t < 16; ++t) texels[t * 4 + 3] = 255;
+      break;
+    default:
+      break;
+  }
+}
+
+VkFormat bc_decode_format(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+      return VK_FORMAT_R8G8B8A8_UNORM;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+      return VK_FORMAT_R8G8B8A8_SRGB;
+    default:
+      return VK_FORMAT_UNDEFINED;
+  }
+}
+
+bool bc_decode_image(VkFormat format, const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst) {
+  if (bc_decode_format(format) == VK_FORMAT_UNDEFINED) return false;
+
+  bool eight_byte_blocks = format == VK_FORMAT_BC4_UNORM_BLOCK || (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK &&
+                                                                   format <= VK_FORMAT_BC1_RGBA_SRGB_BLOCK);
+  uint32_t block_bytes = eight_byte_blocks ? 8 : 16;
+  uint32_t blocks_x = (width + 3) / 4;
+  uint32_t blocks_y = (height + 3) / 4;
+
+  uint8_t texels[64];
+  for (uint32_t by = 0; by < blocks_y; ++by) {
+    for (uint32_t bx = 0; bx < blocks_x; ++bx) {
+      decode_block(format, src, texels);
+      src += block_bytes;
+
+      // Edge blocks of non-multiple-of-4 levels are clipped.
+      for (uint32_t y = 0; y < 4 && by * 4 + y < height; ++y) {
+        for (uint32_t x = 0; x < 4 && bx * 4 + x < width; ++x) {
+          memcpy(&dst[((by * 4 + y) * width + bx * 4 + x) * 4], &texels[(y * 4 + x) * 4], 4);
+        }
+      }
+    }
+  }
+  return true;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+// CPU fallback for block-compressed formats the device cannot sample. Decodes to
+// RGBA8 (sRGB formats stay sRGB); BC6H, BC7 and ASTC are not handled.
+VkFormat bc_decode_format(VkFormat format);
+// dst must hold width * height * 4 bytes.
+bool bc_decode_image(VkFormat format, const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst);
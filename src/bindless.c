@@ -0,0 +1,279 @@
+#include "bindless.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "base.h"
+
+bool bindless_enable_features(const VkPhysicalDeviceVulkan12Features* supported, VkPhysicalDeviceVulkan12Features* enabled) {
+  bool ok = supported->descriptorIndexing &&
+            supported->runtimeDescriptorArray &&
+            supported->descriptorBindingPartiallyBound &&
+            supported->descriptorBindingUpdateUnusedWhilePending &&
+            supported->descriptorBindingSampledImageUpdateAfterBind &&
+            supported->descriptorBindingStorageBufferUpdateAfterBind &&
+            supported->descriptorBindingStorageImageUpdateAfterBind &&
+            supported->shaderSampledImageArrayNonUniformIndexing &&
+            supported->shaderStorageBufferArrayNonUniformIndexing &&
+            supported->shaderStorageImageArrayNonUniformIndexing;
+  if (!ok) return false;
+
+  enabled->descriptorIndexing = VK_TRUE;
+  enabled->runtimeDescriptorArray = VK_TRUE;
+  enabled->descriptorBindingPartiallyBound = VK_TRUE;
+  enabled->descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+  enabled->descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+  enabled->descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+  enabled->descriptorBindingStorageImageUpdateAfterBind = VK_TRUE;
+  enabled->shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+  enabled->shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+  enabled->shaderStorageImageArrayNonUniformIndexing = VK_TRUE;
+  return true;
+}
+
+static bool slots_init(BindlessSlots* slots, uint32_t capacity) {
+  memset(slots, 0, sizeof(*slots));
+  slots->free_list = malloc(sizeof(*slots->free_list) * capacity);
+  slots->capacity = capacity;
+  return slots->free_list != NULL;
+}
+
+static uint32_t slots_alloc(BindlessSlots* slots) {
+  if (slots->free_count > 0) return slots->free_list[--slots->free_count];
+  if (slots->next >= slots->capacity) return BINDLESS_INVALID_HANDLE;
+  return slots->next++;
+}
+
+static void slots_free(BindlessSlots* slots, uint32_t handle) {
+  if (handle >= slots->next) return;
+  slots->free_list[slots->free_count++] = handle;
+}
+
+static VkResult create_default_samplers(BindlessHeap* heap) {
+  struct {
+    VkFilter filter;
+    VkSamplerAddressMode address_mode;
+  } descs[COUNT_BINDLESS_DEFAULT_SAMPLERS] = {
+      [BINDLESS_SAMPLER_LINEAR_REPEAT] = {VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT},
+      [BINDLESS_SAMPLER_LINEAR_CLAMP] = {VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE},
+      [BINDLESS_SAMPLER_NEAREST_CLAMP] = {VK_FILTER_NEAREST, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE},
+  };
+
+  for (uint32_t i = 0; i < COUNT_BINDLESS_DEFAULT_SAMPLERS; ++i) {
+    VkSamplerCreateInfo sampler_info = {
+        .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter = descs[i].filter,
+        .minFilter = descs[i].filter,
+        .mipmapMode = descs[i].filter == VK_FILTER_LINEAR ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = descs[i].address_mode,
+        .addressModeV = descs[i].address_mode,
+        .addressModeW = descs[i].address_mode,
+        .maxLod = VK_LOD_CLAMP_NONE};
+    VK_RETURN(vkCreateSampler(heap->device, &sampler_info, NULL, &heap->default_samplers[i]));
+    if (bindless_add_sampler(heap, heap->default_samplers[i]) != i) return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  return VK_SUCCESS;
+}
+
+VkResult bindless_init(BindlessHeap* heap, VkPhysicalDevice physical_device, VkDevice device) {
+  memset(heap, 0, sizeof(*heap));
+  heap->device = device;
+
+  VkPhysicalDeviceVulkan12Properties props12 = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES};
+  VkPhysicalDeviceProperties2 props = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &props12};
+  vkGetPhysicalDeviceProperties2(physical_device, &props);
+
+  uint32_t max_images = MIN(BINDLESS_MAX_IMAGES, props12.maxPerStageDescriptorUpdateAfterBindSampledImages);
+  uint32_t max_buffers = MIN(BINDLESS_MAX_BUFFERS, props12.maxPerStageDescriptorUpdateAfterBindStorageBuffers);
+  uint32_t max_samplers = MIN(BINDLESS_MAX_SAMPLERS, props12.maxPerStageDescriptorUpdateAfterBindSamplers);
+  uint32_t max_storage_images = MIN(BINDLESS_MAX_STORAGE_IMAGES, props12.maxPerStageDescriptorUpdateAfterBindStorageImages);
+
+  if (!slots_init(&heap->images, max_images) || !slots_init(&heap->buffers, max_buffers) ||
+      !slots_init(&heap->samplers, max_samplers) || !slots_init(&heap->storage_images, max_storage_images)) {
+    bindless_destroy(heap);
+    return VK_ERROR_OUT_OF_HOST_MEMORY;
+  }
+  heap->lock = mutex_create();
+
+  VkDescriptorSetLayoutBinding bindings[] = {
+      {BINDLESS_BINDING_IMAGES, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, max_images, VK_SHADER_STAGE_ALL, NULL},
+      {BINDLESS_BINDING_BUFFERS, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, max_buffers, VK_SHADER_STAGE_ALL, NULL},
+      {BINDLESS_BINDING_SAMPLERS, VK_DESCRIPTOR_TYPE_SAMPLER, max_samplers, VK_SHADER_STAGE_ALL, NULL},
+      {BINDLESS_BINDING_STORAGE_IMAGES, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, max_storage_images, VK_SHADER_STAGE_ALL, NULL},
+  };
+  VkDescriptorBindingFlags binding_flag = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                          VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                          VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+  VkDescriptorBindingFlags binding_flags[] = {binding_flag, binding_flag, binding_flag, binding_flag};
+
+  VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+      .bindingCount = (uint32_t)COUNTOF(binding_flags),
+      .pBindingFlags = binding_flags};
+  VkDescriptorSetLayoutCreateInfo layout_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .pNext = &binding_flags_info,
+      .flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+      .bindingCount = (uint32_t)COUNTOF(bindings),
+      .pBindings = bindings};
+
+  VkResult res = vkCreateDescriptorSetLayout(device, &layout_info, NULL, &heap->layout);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create bindless descriptor set layout!\n");
+    goto fail;
+  }
+
+  VkDescriptorPoolSize pool_sizes[] = {
+      {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, max_images},
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, max_buffers},
+      {VK_DESCRIPTOR_TYPE_SAMPLER, max_samplers},
+      {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, max_storage_images},
+  };
+  VkDescriptorPoolCreateInfo pool_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+      .maxSets = 1,
+      .poolSizeCount = (uint32_t)COUNTOF(pool_sizes),
+      .pPoolSizes = pool_sizes};
+  res = vkCreateDescriptorPool(device, &pool_info, NULL, &heap->pool);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create bindless descriptor pool!\n");
+    goto fail;
+  }
+
+  VkDescriptorSetAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .descriptorPool = heap->pool,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &heap->layout};
+  res = vkAllocateDescriptorSets(device, &alloc_info, &heap->set);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to allocate bindless descriptor set!\n");
+    goto fail;
+  }
+
+  if ((res = create_default_samplers(heap)) != VK_SUCCESS) goto fail;
+
+  fprintf(stderr, "Bindless heap: %u images, %u buffers, %u samplers, %u storage images\n", max_images, max_buffers,
+          max_samplers, max_storage_images);
+  return VK_SUCCESS;
+
+fail:
+  bindless_destroy(heap);
+  return res;
+}
+
+void bindless_destroy(BindlessHeap* heap) {
+  if (heap->device == VK_NULL_HANDLE) return;
+  for (uint32_t i = 0; i < COUNT_BINDLESS_DEFAULT_SAMPLERS; ++i) {
+    if (heap->default_samplers[i] != VK_NULL_HANDLE) vkDestroySampler(heap->device, heap->default_samplers[i], NULL);
+  }
+  if (heap->pool != VK_NULL_HANDLE) vkDestroyDescriptorPool(heap->device, heap->pool, NULL);
+  if (heap->layout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(heap->device, heap->layout, NULL);
+  free(heap->images.free_list);
+  free(heap->buffers.free_list);
+  free(heap->samplers.free_list);
+  free(heap->storage_images.free_list);
+  mutex_destroy(heap->lock);
+  memset(heap, 0, sizeof(*heap));
+}
+
+static void write_descriptor(BindlessHeap* heap, uint32_t binding, uint32_t index, VkDescriptorType type,
+                             const VkDescriptorImageInfo* image_info, const VkDescriptorBufferInfo* buffer_info) {
+  VkWriteDescriptorSet write = {
+      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .dstSet = heap->set,
+      .dstBinding = binding,
+      .dstArrayElement = index,
+      .descriptorCount = 1,
+      .descriptorType = type,
+      .pImageInfo = image_info,
+      .pBufferInfo = buffer_info};
+  vkUpdateDescriptorSets(heap->device, 1, &write, 0, NULL);
+}
+
+uint32_t bindless_add_image(BindlessHeap* heap, VkImageView view, VkImageLayout layout) {
+  mutex_lock(heap->lock);
+  uint32_t handle = slots_alloc(&heap->images);
+  if (handle != BINDLESS_INVALID_HANDLE) {
+    VkDescriptorImageInfo image_info = {.imageView = view, .imageLayout = layout};
+    write_descriptor(heap, BINDLESS_BINDING_IMAGES, handle, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &image_info, NULL);
+  }
+  mutex_unlock(heap->lock);
+  return handle;
+}
+
+void bindless_update_image(BindlessHeap* heap, uint32_t handle, VkImageView view, VkImageLayout layout) {
+  if (handle == BINDLESS_INVALID_HANDLE) return;
+  mutex_lock(heap->lock);
+  VkDescriptorImageInfo image_info = {.imageView = view, .imageLayout = layout};
+  write_descriptor(heap, BINDLESS_BINDING_IMAGES, handle, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, &image_info, NULL);
+  mutex_unlock(heap->lock);
+}
+
+uint32_t bindless_add_buffer(BindlessHeap* heap, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+  mutex_lock(heap->lock);
+  uint32_t handle = slots_alloc(&heap->buffers);
+  if (handle != BINDLESS_INVALID_HANDLE) {
+    VkDescriptorBufferInfo buffer_info = {.buffer = buffer, .offset = offset, .range = range};
+    write_descriptor(heap, BINDLESS_BINDING_BUFFERS, handle, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NULL, &buffer_info);
+  }
+  mutex_unlock(heap->lock);
+  return handle;
+}
+
+uint32_t bindless_add_sampler(BindlessHeap* heap, VkSampler sampler) {
+  mutex_lock(heap->lock);
+  uint32_t handle = slots_alloc(&heap->samplers);
+  if (handle != BINDLESS_INVALID_HANDLE) {
+    VkDescriptorImageInfo image_info = {.sampler = sampler};
+    write_descriptor(heap, BINDLESS_BINDING_SAMPLERS, handle, VK_DESCRIPTOR_TYPE_SAMPLER, &image_info, NULL);
+  }
+  mutex_unlock(heap->lock);
+  return handle;
+}
+
+uint32_t bindless_add_storage_image(BindlessHeap* heap, VkImageView view) {
+  mutex_lock(heap->lock);
+  uint32_t handle = slots_alloc(&heap->storage_images);
+  if (handle != BINDLESS_INVALID_HANDLE) {
+    VkDescriptorImageInfo image_info = {.imageView = view, .imageLayout = VK_IMAGE_LAYOUT_GENERAL};
+    write_descriptor(heap, BINDLESS_BINDING_STORAGE_IMAGES, handle, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &image_info, NULL);
+  }
+  mutex_unlock(heap->lock);
+  return handle;
+}
+
+// Freed slots are left pointing at the old descriptor; PARTIALLY_BOUND lets shaders
+// never touch them and the next add overwrites them.
+void bindless_remove_image(BindlessHeap* heap, uint32_t handle) {
+  if (handle == BINDLESS_INVALID_HANDLE) return;
+  mutex_lock(heap->lock);
+  slots_free(&heap->images, handle);
+  mutex_unlock(heap->lock);
+}
+
+void bindless_remove_buffer(BindlessHeap* heap, uint32_t handle) {
+  if (handle == BINDLESS_INVALID_HANDLE) return;
+  mutex_lock(heap->lock);
+  slots_free(&heap->buffers, handle);
+  mutex_unlock(heap->lock);
+}
+
+void bindless_remove_sampler(BindlessHeap* heap, uint32_t handle) {
+  if (handle == BINDLESS_INVALID_HANDLE) return;
+  mutex_lock(heap->lock);
+  slots_free(&heap->samplers, handle);
+  mutex_unlock(heap->lock);
+}
+
+void bindless_remove_storage_image(BindlessHeap* heap, uint32_t handle) {
+  if (handle == BINDLESS_INVALID_HANDLE) return;
+  mutex_lock(heap->lock);
+  slots_free(&heap->storage_images, handle);
+  mutex_unlock(heap->lock);
+}
+
+void bindless_bind(BindlessHeap* heap, VkCommandBuffer cmd, VkPipelineBindPoint bind_point, VkPipelineLayout layout) {
+  if (heap->set == VK_NULL_HANDLE) return;
+  vkCmdBindDescriptorSets(cmd, bind_point, layout, 0, 1, &heap->set, 0, NULL);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "thread.h"
+
+#define BINDLESS_MAX_IMAGES 16384
+#define BINDLESS_MAX_BUFFERS 4096
+#define BINDLESS_MAX_SAMPLERS 64
+#define BINDLESS_MAX_STORAGE_IMAGES 1024
+#define BINDLESS_PUSH_CONSTANT_SIZE 128
+#define BINDLESS_INVALID_HANDLE UINT32_MAX
+
+// Must match shaders/bindless.glsl.
+enum {
+  BINDLESS_BINDING_IMAGES = 0,
+  BINDLESS_BINDING_BUFFERS = 1,
+  BINDLESS_BINDING_SAMPLERS = 2,
+  BINDLESS_BINDING_STORAGE_IMAGES = 3,
+};
+
+// Samplers every shader can rely on without registering its own.
+enum {
+  BINDLESS_SAMPLER_LINEAR_REPEAT = 0,
+  BINDLESS_SAMPLER_LINEAR_CLAMP,
+  BINDLESS_SAMPLER_NEAREST_CLAMP,
+  COUNT_BINDLESS_DEFAULT_SAMPLERS
+};
+
+typedef struct {
+  uint32_t* free_list;
+  uint32_t free_count;
+  uint32_t next;
+  uint32_t capacity;
+} BindlessSlots;
+
+// One global descriptor set holding every sampled image, storage buffer and sampler.
+// Shaders receive plain uint32 handles (indices) through push constants.
+typedef struct {
+  VkDevice device;
+  VkDescriptorSetLayout layout;
+  VkDescriptorPool pool;
+  VkDescriptorSet set;
+  BindlessSlots images;
+  BindlessSlots buffers;
+  BindlessSlots samplers;
+  BindlessSlots storage_images;
+  VkSampler default_samplers[COUNT_BINDLESS_DEFAULT_SAMPLERS];
+  Mutex* lock;
+} BindlessHeap;
+
+// Enables the descriptor indexing features bindless needs; false if the device lacks any.
+bool bindless_enable_features(const VkPhysicalDeviceVulkan12Features* supported, VkPhysicalDeviceVulkan12Features* enabled);
+
+VkResult bindless_init(BindlessHeap* heap, VkPhysicalDevice physical_device, VkDevice device);
+void bindless_destroy(BindlessHeap* heap);
+
+uint32_t bindless_add_image(BindlessHeap* heap, VkImageView view, VkImageLayout layout);
+void bindless_update_image(BindlessHeap* heap, uint32_t handle, VkImageView view, VkImageLayout layout);
+uint32_t bindless_add_buffer(BindlessHeap* heap, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range);
+uint32_t bindless_add_sampler(BindlessHeap* heap, VkSampler sampler);
+// Storage images are always in VK_IMAGE_LAYOUT_GENERAL.
+uint32_t bindless_add_storage_image(BindlessHeap* heap, VkImageView view);
+void bindless_remove_image(BindlessHeap* heap, uint32_t handle);
+void bindless_remove_buffer(BindlessHeap* heap, uint32_t handle);
+void bindless_remove_sampler(BindlessHeap* heap, uint32_t handle);
+void bindless_remove_storage_image(BindlessHeap* heap, uint32_t handle);
+
+void bindless_bind(BindlessHeap* heap, VkCommandBuffer cmd, VkPipelineBindPoint bind_point, VkPipelineLayout layout);
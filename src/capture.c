@@ -0,0 +1,227 @@
+#include "capture.h"
+#include <stb_image_write.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool format_layout(VkFormat format, bool* bgra) {
+  switch (format) {
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+      *bgra = true;
+      return true;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+      *bgra = false;
+      return true;
+    default:
+      return false;
+  }
+}
+
+static void destroy_slot_buffer(FrameCapture* capture, CaptureSlot* slot) {
+  if (slot->mapped) vkUnmapMemory(capture->ctx->device, slot->memory);
+  vk_destroy_buffer(capture->ctx, slot->buffer, slot->memory);
+  slot->buffer = VK_NULL_HANDLE;
+  slot->memory = VK_NULL_HANDLE;
+  slot->mapped = NULL;
+  slot->size = 0;
+}
+
+// Buffers only grow, so capturing the same target every frame allocates once per slot.
+static bool ensure_slot_buffer(FrameCapture* capture, CaptureSlot* slot, VkDeviceSize size) {
+  if (slot->size >= size) return true;
+  destroy_slot_buffer(capture, slot);
+  VkContext* ctx = capture->ctx;
+  if (vk_create_buffer(ctx, size, VK_BUFFER_USAGE_TRANSFER_DST_BIT, capture->memory_flags, &slot->buffer,
+                       &slot->memory) != VK_SUCCESS) {
+    return false;
+  }
+  if (vkMapMemory(ctx->device, slot->memory, 0, VK_WHOLE_SIZE, 0, &slot->mapped) != VK_SUCCESS) {
+    destroy_slot_buffer(capture, slot);
+    return false;
+  }
+  slot->size = size;
+  return true;
+}
+
+static void encode_slot(FrameCapture* capture, CaptureSlot* slot) {
+  VkDeviceSize bytes = (VkDeviceSize)slot->width * slot->height * 4;
+  if (!(capture->memory_flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)) {
+    VkMappedMemoryRange range = {
+        .sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+        .memory = slot->memory,
+        .offset = 0,
+        .size = VK_WHOLE_SIZE};
+    vkInvalidateMappedMemoryRanges(capture->ctx->device, 1, &range);
+  }
+
+  // Swapchain alpha is meaningless for an opaque surface, so files are always opaque RGBA.
+  uint8_t* pixels = malloc(bytes);
+  if (!pixels) return;
+  const uint8_t* src = slot->mapped;
+  for (VkDeviceSize i = 0; i < bytes; i += 4) {
+    pixels[i + 0] = src[i + (slot->bgra ? 2 : 0)];
+    pixels[i + 1] = src[i + 1];
+    pixels[i + 2] = src[i + (slot->bgra ? 0 : 2)];
+    pixels[i + 3] = 255;
+  }
+
+  bool ok = false;
+  if (slot->format == CAPTURE_FORMAT_PNG) {
+    ok = stbi_write_png(slot->path, (int)slot->width, (int)slot->height, 4, pixels, (int)slot->width * 4) != 0;
+  } else {
+    FILE* fp = fopen(slot->path, "wb");
+    if (fp) {
+      ok = fwrite(pixels, 1, bytes, fp) == bytes;
+      fclose(fp);
+    }
+  }
+  if (!ok) fprintf(stderr, "Failed to write capture '%s'\n", slot->path);
+  free(pixels);
+}
+
+static int worker_main(void* arg) {
+  FrameCapture* capture = arg;
+  for (;;) {
+    semaphore_wait(capture->jobs_ready);
+    mutex_lock(capture->lock);
+    if (capture->job_count == 0) {
+      bool shutdown = capture->shutdown;
+      mutex_unlock(capture->lock);
+      if (shutdown) break;
+      continue;
+    }
+    uint32_t index = capture->jobs[capture->job_head];
+    capture->job_head = (capture->job_head + 1) % CAPTURE_MAX_PENDING;
+    capture->job_count--;
+    mutex_unlock(capture->lock);
+
+    CaptureSlot* slot = &capture->slots[index];
+    encode_slot(capture, slot);
+    atomic_store_explicit(&slot->state, CAPTURE_SLOT_FREE, memory_order_release);
+  }
+  return 0;
+}
+
+VkResult capture_init(FrameCapture* capture, VkContext* ctx) {
+  memset(capture, 0, sizeof(*capture));
+  capture->ctx = ctx;
+
+  VkMemoryPropertyFlags cached = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+  capture->memory_flags = vk_find_memory_type(ctx, UINT32_MAX, cached) != UINT32_MAX
+                              ? cached
+                              : VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+  capture->lock = mutex_create();
+  capture->jobs_ready = semaphore_create(0);
+  if (!capture->lock || !capture->jobs_ready) {
+    capture_destroy(capture);
+    return VK_ERROR_OUT_OF_HOST_MEMORY;
+  }
+  capture->worker = thread_create(worker_main, capture, "capture");
+  return VK_SUCCESS;
+}
+
+static void image_barrier(VkCommandBuffer cmd, VkImage image, VkImageLayout old_layout, VkImageLayout new_layout,
+                          VkPipelineStageFlags src_stage, VkAccessFlags src_access, VkPipelineStageFlags dst_stage,
+                          VkAccessFlags dst_access) {
+  VkImageMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = src_access,
+      .dstAccessMask = dst_access,
+      .oldLayout = old_layout,
+      .newLayout = new_layout,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = image,
+      .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1}};
+  vkCmdPipelineBarrier(cmd, src_stage, dst_stage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+bool capture_record(FrameCapture* capture, VkCommandBuffer cmd, uint32_t frame, VkImage image, VkImageLayout layout,
+                    VkFormat format, VkExtent2D extent, CaptureFormat file_format, const char* path) {
+  bool bgra = false;
+  if (!capture->ctx || !format_layout(format, &bgra) || strlen(path) >= CAPTURE_MAX_PATH) return false;
+
+  CaptureSlot* slot = NULL;
+  for (uint32_t i = 0; i < CAPTURE_MAX_PENDING && !slot; ++i) {
+    if (atomic_load_explicit(&capture->slots[i].state, memory_order_acquire) == CAPTURE_SLOT_FREE) {
+      slot = &capture->slots[i];
+    }
+  }
+  if (!slot) {
+    fprintf(stderr, "Capture dropped, encoder is behind: '%s'\n", path);
+    return false;
+  }
+  if (!ensure_slot_buffer(capture, slot, (VkDeviceSize)extent.width * extent.height * 4)) return false;
+
+  // Whatever wrote the image last is waited for through ALL_COMMANDS, so callers only pass the layout.
+  image_barrier(cmd, image, layout, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_WRITE_BIT,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+  VkBufferImageCopy region = {
+      .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+      .imageExtent = {extent.width, extent.height, 1}};
+  vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot->buffer, 1, &region);
+  image_barrier(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, layout,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT);
+
+  VkBufferMemoryBarrier host_barrier = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_HOST_READ_BIT,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .buffer = slot->buffer,
+      .offset = 0,
+      .size = VK_WHOLE_SIZE};
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, NULL, 1, &host_barrier,
+                       0, NULL);
+
+  slot->frame = frame;
+  slot->width = extent.width;
+  slot->height = extent.height;
+  slot->bgra = bgra;
+  slot->format = file_format;
+  strcpy(slot->path, path);
+  atomic_store_explicit(&slot->state, CAPTURE_SLOT_RECORDED, memory_order_relaxed);
+  return true;
+}
+
+void capture_frame_complete(FrameCapture* capture, uint32_t frame) {
+  if (!capture->ctx) return;
+  for (uint32_t i = 0; i < CAPTURE_MAX_PENDING; ++i) {
+    CaptureSlot* slot = &capture->slots[i];
+    if (atomic_load_explicit(&slot->state, memory_order_relaxed) != CAPTURE_SLOT_RECORDED || slot->frame != frame) {
+      continue;
+    }
+    atomic_store_explicit(&slot->state, CAPTURE_SLOT_ENCODING, memory_order_relaxed);
+    mutex_lock(capture->lock);
+    capture->jobs[(capture->job_head + capture->job_count) % CAPTURE_MAX_PENDING] = i;
+    capture->job_count++;
+    mutex_unlock(capture->lock);
+    semaphore_post(capture->jobs_ready);
+  }
+}
+
+void capture_destroy(FrameCapture* capture) {
+  if (!capture->ctx) return;
+  if (capture->worker) {
+    for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; ++frame) {
+      capture_frame_complete(capture, frame);
+    }
+    mutex_lock(capture->lock);
+    capture->shutdown = true;
+    mutex_unlock(capture->lock);
+    semaphore_post(capture->jobs_ready);
+    thread_join(capture->worker);
+  }
+  for (uint32_t i = 0; i < CAPTURE_MAX_PENDING; ++i) {
+    destroy_slot_buffer(capture, &capture->slots[i]);
+  }
+  if (capture->jobs_ready) semaphore_destroy(capture->jobs_ready);
+  if (capture->lock) mutex_destroy(capture->lock);
+  memset(capture, 0, sizeof(*capture));
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "thread.h"
+#include "vk.h"
+
+#define CAPTURE_MAX_PENDING 8
+#define CAPTURE_MAX_PATH 256
+
+typedef enum {
+  CAPTURE_FORMAT_PNG = 0,
+  CAPTURE_FORMAT_RAW,  // tightly packed RGBA8 rows, top to bottom
+} CaptureFormat;
+
+typedef enum {
+  CAPTURE_SLOT_FREE = 0,
+  CAPTURE_SLOT_RECORDED,  // copy recorded into a frame that has not finished yet
+  CAPTURE_SLOT_ENCODING,
+} CaptureSlotState;
+
+typedef struct {
+  atomic_uint state;  // CaptureSlotState
+  VkBuffer buffer;
+  VkDeviceMemory memory;
+  VkDeviceSize size;
+  void* mapped;
+  uint32_t frame;
+  uint32_t width;
+  uint32_t height;
+  bool bgra;
+  CaptureFormat format;
+  char path[CAPTURE_MAX_PATH];
+} CaptureSlot;
+
+// Frame readback without stalls: the copy into a host-visible buffer is recorded in the
+// frame's own command buffer, the buffer is handed to an encoder thread once that frame's
+// fence has been waited on by the normal frame loop, and the slot returns to the pool when
+// the file is written. When every slot is busy a capture is dropped rather than waited for.
+typedef struct {
+  VkContext* ctx;
+  VkMemoryPropertyFlags memory_flags;  // host-cached when available, reads are much faster
+  CaptureSlot slots[CAPTURE_MAX_PENDING];
+
+  Mutex* lock;  // guards the job queue
+  uint32_t jobs[CAPTURE_MAX_PENDING];
+  uint32_t job_head;
+  uint32_t job_count;
+  bool shutdown;
+  Semaphore* jobs_ready;
+  Thread* worker;
+} FrameCapture;
+
+VkResult capture_init(FrameCapture* capture, VkContext* ctx);
+// Copies an 8-bit RGBA/BGRA image that is in `layout` and leaves it in that layout again.
+// Returns false if the format is unsupported or no slot is free.
+bool capture_record(FrameCapture* capture, VkCommandBuffer cmd, uint32_t frame, VkImage image, VkImageLayout layout,
+                    VkFormat format, VkExtent2D extent, CaptureFormat file_format, const char* path);
+// Call once the fence of this frame slot has signaled; queues its copies for encoding.
+void capture_frame_complete(FrameCapture* capture, uint32_t frame);
+// The device must be idle; pending captures are written before this returns.
+void capture_destroy(FrameCapture* capture);
@@ -0,0 +1,116 @@
+#include "compute.h"
+#include <stdio.h>
+#include <string.h>
+
+void async_compute_init(AsyncCompute* compute, VkContext* ctx) {
+  memset(compute, 0, sizeof(*compute));
+  compute->ctx = ctx;
+}
+
+bool async_compute_add_job(AsyncCompute* compute, const ComputeJob* job) {
+  if (compute->job_count >= COMPUTE_MAX_JOBS) {
+    fprintf(stderr, "Too many compute jobs!\n");
+    return false;
+  }
+  compute->jobs[compute->job_count++] = *job;
+  return true;
+}
+
+static void record_jobs(AsyncCompute* compute, VkCommandBuffer cmd) {
+  VkContext* ctx = compute->ctx;
+  bindless_bind(&ctx->bindless, cmd, VK_PIPELINE_BIND_POINT_COMPUTE, ctx->pipeline_layout);
+  for (uint32_t i = 0; i < compute->job_count; ++i) {
+    compute->jobs[i].record(cmd, compute->jobs[i].user_data);
+  }
+}
+
+VkPipelineStageFlags async_compute_submit(AsyncCompute* compute) {
+  VkContext* ctx = compute->ctx;
+  if (!ctx->has_async_compute || compute->job_count == 0) return 0;
+
+  VkPipelineStageFlags consumer_stages = 0;
+  bool after_previous_frame = false;
+  for (uint32_t i = 0; i < compute->job_count; ++i) {
+    consumer_stages |= compute->jobs[i].consumer_stages;
+    after_previous_frame |= compute->jobs[i].after_previous_frame;
+  }
+
+  // The graphics fence only covers this slot's last compute submit when graphics waited
+  // on it; jobs without consumers are not waited on, so wait for the timeline here.
+  VkCommandBuffer cmd = ctx->compute_command_buffers[ctx->current_frame];
+  uint64_t* submitted = &compute->submitted[ctx->current_frame];
+  VkResult res;
+  if (*submitted) {
+    VkSemaphoreWaitInfo wait_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+        .semaphoreCount = 1,
+        .pSemaphores = &ctx->compute_timeline,
+        .pValues = submitted};
+    res = vkWaitSemaphores(ctx->device, &wait_info, UINT64_MAX);
+    if (res != VK_SUCCESS) {
+      fprintf(stderr, "Failed to wait for compute work: %d\n", res);
+      return 0;
+    }
+    *submitted = 0;
+  }
+  vkResetCommandBuffer(cmd, 0);
+  VkCommandBufferBeginInfo begin_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+  res = vkBeginCommandBuffer(cmd, &begin_info);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "vkBeginCommandBuffer failed: %d\n", res);
+    return 0;
+  }
+  record_jobs(compute, cmd);
+  res = vkEndCommandBuffer(cmd);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "vkEndCommandBuffer failed: %d\n", res);
+    return 0;
+  }
+
+  uint64_t wait_value = ctx->frame_number - 1;
+  uint64_t signal_value = ctx->frame_number;
+  VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+  VkTimelineSemaphoreSubmitInfo timeline_info = {
+      .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+      .waitSemaphoreValueCount = after_previous_frame ? 1 : 0,
+      .pWaitSemaphoreValues = &wait_value,
+      .signalSemaphoreValueCount = 1,
+      .pSignalSemaphoreValues = &signal_value};
+  VkSubmitInfo submit_info = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .pNext = &timeline_info,
+      .waitSemaphoreCount = after_previous_frame ? 1 : 0,
+      .pWaitSemaphores = &ctx->graphics_timeline,
+      .pWaitDstStageMask = &wait_stage,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &cmd,
+      .signalSemaphoreCount = 1,
+      .pSignalSemaphores = &ctx->compute_timeline};
+  res = vkQueueSubmit(ctx->compute_queue, 1, &submit_info, VK_NULL_HANDLE);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to submit compute work: %d\n", res);
+    return 0;
+  }
+  *submitted = signal_value;
+  ctx->compute_submitted = signal_value;
+  return consumer_stages;
+}
+
+void async_compute_record_inline(AsyncCompute* compute, VkCommandBuffer cmd) {
+  if (compute->ctx->has_async_compute || compute->job_count == 0) return;
+
+  VkPipelineStageFlags consumer_stages = 0;
+  for (uint32_t i = 0; i < compute->job_count; ++i) consumer_stages |= compute->jobs[i].consumer_stages;
+  if (consumer_stages == 0) consumer_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+  // On a single queue the previous frame is already ordered by submission order.
+  record_jobs(compute, cmd);
+  VkMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT |
+                       VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT};
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, consumer_stages, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "vk.h"
+
+#define COMPUTE_MAX_JOBS 16
+
+typedef void (*ComputeJobFn)(VkCommandBuffer cmd, void* user_data);
+
+typedef struct {
+  ComputeJobFn record;
+  void* user_data;
+  // Graphics stages that read what the job writes; graphics waits for compute there.
+  VkPipelineStageFlags consumer_stages;
+  // Set when the job reads results of the previous graphics frame (e.g. ping-pong state).
+  bool after_previous_frame;
+} ComputeJob;
+
+// Per-frame compute work that runs on the dedicated compute queue when the device has
+// one, overlapping the graphics work that does not consume it. Ordering between the
+// queues uses the timeline semaphores in VkContext, signaled with ctx->frame_number.
+// Without async compute the same jobs are recorded at the start of the graphics
+// command buffer followed by a barrier, so callers do not need two code paths.
+typedef struct {
+  VkContext* ctx;
+  ComputeJob jobs[COMPUTE_MAX_JOBS];
+  uint32_t job_count;
+  // compute_timeline value of the last submit from each frame's command buffer, 0 if none.
+  uint64_t submitted[MAX_FRAMES_IN_FLIGHT];
+} AsyncCompute;
+
+void async_compute_init(AsyncCompute* compute, VkContext* ctx);
+bool async_compute_add_job(AsyncCompute* compute, const ComputeJob* job);
+
+// Records and submits this frame's jobs on the compute queue. Returns the stages the
+// graphics submit must wait on compute_timeline at, or 0 when nothing was submitted.
+VkPipelineStageFlags async_compute_submit(AsyncCompute* compute);
+// Records the jobs into the graphics command buffer when there is no compute queue.
+void async_compute_record_inline(AsyncCompute* compute, VkCommandBuffer cmd);
@@ -0,0 +1,98 @@
+#include "deletion_queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+VkResult deletion_queue_init(DeletionQueue* queue, VkDevice device, BindlessHeap* bindless,
+                             atomic_uint* live_allocations) {
+  memset(queue, 0, sizeof(*queue));
+  queue->device = device;
+  queue->bindless = bindless;
+  queue->live_allocations = live_allocations;
+  queue->items = malloc(sizeof(*queue->items) * DELETION_QUEUE_INITIAL_CAPACITY);
+  queue->lock = mutex_create();
+  if (!queue->items || !queue->lock) {
+    deletion_queue_destroy(queue);
+    return VK_ERROR_OUT_OF_HOST_MEMORY;
+  }
+  queue->capacity = DELETION_QUEUE_INITIAL_CAPACITY;
+  return VK_SUCCESS;
+}
+
+static void destroy(DeletionQueue* queue, const Deletion* deletion) {
+  VkDevice device = queue->device;
+  switch (deletion->type) {
+    case DELETE_BUFFER:
+      vkDestroyBuffer(device, deletion->buffer, NULL);
+      break;
+    case DELETE_IMAGE:
+      vkDestroyImage(device, deletion->image, NULL);
+      break;
+    case DELETE_IMAGE_VIEW:
+      vkDestroyImageView(device, deletion->image_view, NULL);
+      break;
+    case DELETE_MEMORY:
+      vkFreeMemory(device, deletion->memory, NULL);
+      if (queue->live_allocations) atomic_fetch_sub_explicit(queue->live_allocations, 1, memory_order_relaxed);
+      break;
+    case DELETE_PIPELINE:
+      vkDestroyPipeline(device, deletion->pipeline, NULL);
+      break;
+    case DELETE_FRAMEBUFFER:
+      vkDestroyFramebuffer(device, deletion->framebuffer, NULL);
+      break;
+    case DELETE_SAMPLER:
+      vkDestroySampler(device, deletion->sampler, NULL);
+      break;
+    case DELETE_BINDLESS_IMAGE:
+      bindless_remove_image(queue->bindless, deletion->bindless_handle);
+      break;
+    case DELETE_BINDLESS_BUFFER:
+      bindless_remove_buffer(queue->bindless, deletion->bindless_handle);
+      break;
+    case DELETE_CALLBACK:
+      deletion->callback.fn(deletion->callback.user_data);
+      break;
+  }
+}
+
+void deletion_queue_push(DeletionQueue* queue, const Deletion* deletion) {
+  mutex_lock(queue->lock);
+  if (queue->count == queue->capacity) {
+    Deletion* items = realloc(queue->items, sizeof(*items) * queue->capacity * 2);
+    if (!items) {
+      // Leaking is the only safe option left: the object may still be in use.
+      mutex_unlock(queue->lock);
+      fprintf(stderr, "Deletion queue out of memory, leaking object\n");
+      return;
+    }
+    queue->items = items;
+    queue->capacity *= 2;
+  }
+  queue->items[queue->count++] = *deletion;
+  mutex_unlock(queue->lock);
+}
+
+void deletion_queue_flush(DeletionQueue* queue, uint64_t completed_frame) {
+  if (!queue->lock) return;
+  mutex_lock(queue->lock);
+  // Entries are pushed in roughly increasing frame order, but not strictly (other threads),
+  // so survivors are compacted in place rather than assuming a sorted prefix.
+  uint32_t kept = 0;
+  for (uint32_t i = 0; i < queue->count; ++i) {
+    if (queue->items[i].frame <= completed_frame) {
+      destroy(queue, &queue->items[i]);
+    } else {
+      queue->items[kept++] = queue->items[i];
+    }
+  }
+  queue->count = kept;
+  mutex_unlock(queue->lock);
+}
+
+void deletion_queue_destroy(DeletionQueue* queue) {
+  if (queue->lock) deletion_queue_flush(queue, UINT64_MAX);
+  free(queue->items);
+  if (queue->lock) mutex_destroy(queue->lock);
+  memset(queue, 0, sizeof(*queue));
+}
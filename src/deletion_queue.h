@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "bindless.h"
+#include "thread.h"
+
+#define DELETION_QUEUE_INITIAL_CAPACITY 256
+
+typedef enum {
+  DELETE_BUFFER = 0,
+  DELETE_IMAGE,
+  DELETE_IMAGE_VIEW,
+  DELETE_MEMORY,
+  DELETE_PIPELINE,
+  DELETE_FRAMEBUFFER,
+  DELETE_SAMPLER,
+  DELETE_BINDLESS_IMAGE,
+  DELETE_BINDLESS_BUFFER,
+  DELETE_CALLBACK,
+} DeletionType;
+
+typedef void (*DeletionFn)(void* user_data);
+
+typedef struct {
+  DeletionType type;
+  uint64_t frame;  // last frame number that may use the object
+  union {
+    VkBuffer buffer;
+    VkImage image;
+    VkImageView image_view;
+    VkDeviceMemory memory;
+    VkPipeline pipeline;
+    VkFramebuffer framebuffer;
+    VkSampler sampler;
+    uint32_t bindless_handle;
+    struct {
+      DeletionFn fn;
+      void* user_data;
+    } callback;
+  };
+} Deletion;
+
+// Objects retired while frames in flight may still use them. Each entry carries the
+// frame that last used it and is destroyed by the first flush after that frame has
+// completed, so nothing mid-run has to wait for the device. Safe to push from any thread.
+typedef struct {
+  VkDevice device;
+  BindlessHeap* bindless;
+  atomic_uint* live_allocations;  // decremented for DELETE_MEMORY, see vk_free_memory
+  Deletion* items;
+  uint32_t count;
+  uint32_t capacity;
+  Mutex* lock;
+} DeletionQueue;
+
+VkResult deletion_queue_init(DeletionQueue* queue, VkDevice device, BindlessHeap* bindless,
+                             atomic_uint* live_allocations);
+void deletion_queue_push(DeletionQueue* queue, const Deletion* deletion);
+// Destroys everything whose frame is at most `completed_frame`, in push order.
+void deletion_queue_flush(DeletionQueue* queue, uint64_t completed_frame);
+// Destroys everything left; the device must be idle.
+void deletion_queue_destroy(DeletionQueue* queue);
@@ -0,0 +1,315 @@
+#include "descriptor_allocator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "base.h"
+
+VkResult descriptor_allocator_init(DescriptorAllocator* allocator, VkContext* ctx) {
+  memset(allocator, 0, sizeof(*allocator));
+  allocator->ctx = ctx;
+  allocator->destroyed_resources = atomic_load_explicit(&ctx->destroyed_resources, memory_order_relaxed);
+  allocator->cache = calloc(DESCRIPTOR_CACHE_SIZE, sizeof(*allocator->cache));
+  if (!allocator->cache) return VK_ERROR_OUT_OF_HOST_MEMORY;
+  return VK_SUCCESS;
+}
+
+static DescriptorLayoutPools* find_layout(DescriptorAllocator* allocator, VkDescriptorSetLayout layout) {
+  for (uint32_t i = 0; i < allocator->layout_count; ++i) {
+    if (allocator->layouts[i].layout == layout) return &allocator->layouts[i];
+  }
+  if (allocator->layout_count == DESCRIPTOR_ALLOCATOR_MAX_LAYOUTS) {
+    fprintf(stderr, "Too many descriptor set layouts (max %d)\n", DESCRIPTOR_ALLOCATOR_MAX_LAYOUTS);
+    return NULL;
+  }
+
+  DescriptorLayoutPools* pools = &allocator->layouts[allocator->layout_count];
+  memset(pools, 0, sizeof(*pools));
+  if (!layout_cache_pool_sizes(&allocator->ctx->layouts, layout, pools->sizes, &pools->size_count)) {
+    fprintf(stderr, "Descriptor set layout was not created by the layout cache\n");
+    return NULL;
+  }
+  pools->layout = layout;
+  allocator->layout_count++;
+  return pools;
+}
+
+static VkResult create_pool(DescriptorAllocator* allocator, const DescriptorLayoutPools* pools, VkDescriptorPool* pool) {
+  VkDescriptorPoolSize sizes[LAYOUT_CACHE_MAX_POOL_SIZES];
+  uint32_t size_count = pools->size_count;
+  for (uint32_t i = 0; i < size_count; ++i) {
+    sizes[i] = (VkDescriptorPoolSize){.type = pools->sizes[i].type,
+                                      .descriptorCount = pools->sizes[i].descriptorCount * DESCRIPTOR_POOL_SETS};
+  }
+  // A pool needs at least one size even when the layout has no bindings.
+  if (size_count == 0) sizes[size_count++] = (VkDescriptorPoolSize){VK_DESCRIPTOR_TYPE_SAMPLER, 1};
+
+  VkDescriptorPoolCreateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .maxSets = DESCRIPTOR_POOL_SETS,
+      .poolSizeCount = size_count,
+      .pPoolSizes = sizes};
+  return vkCreateDescriptorPool(allocator->ctx->device, &info, NULL, pool);
+}
+
+// Allocates every set of the block at once, so the next DESCRIPTOR_POOL_SETS transient
+// requests need no Vulkan call.
+static VkResult fill_block(DescriptorAllocator* allocator, const DescriptorLayoutPools* pools, DescriptorBlock* block) {
+  VkDescriptorSetLayout layouts[DESCRIPTOR_POOL_SETS];
+  for (uint32_t i = 0; i < DESCRIPTOR_POOL_SETS; ++i) {
+    layouts[i] = pools->layout;
+  }
+  VkDescriptorSetAllocateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .descriptorPool = block->pool,
+      .descriptorSetCount = DESCRIPTOR_POOL_SETS,
+      .pSetLayouts = layouts};
+  VK_RETURN(vkAllocateDescriptorSets(allocator->ctx->device, &info, block->sets));
+  block->allocated = DESCRIPTOR_POOL_SETS;
+  return VK_SUCCESS;
+}
+
+static VkDescriptorSet next_transient(DescriptorAllocator* allocator, DescriptorLayoutPools* pools) {
+  uint32_t frame = allocator->frame;
+  uint32_t* current = &pools->frame_block_current[frame];
+  // Fast path: a set left in the current block.
+  if (*current < pools->frame_block_count[frame]) {
+    DescriptorBlock* block = &pools->frame_blocks[frame][*current];
+    if (block->used < block->allocated) return block->sets[block->used++];
+    if (block->allocated == 0 && fill_block(allocator, pools, block) == VK_SUCCESS) return block->sets[block->used++];
+    (*current)++;
+    if (*current < pools->frame_block_count[frame]) return next_transient(allocator, pools);
+  }
+
+  // Every block of this frame is exhausted: grow the list by one pool.
+  uint32_t count = pools->frame_block_count[frame];
+  DescriptorBlock* blocks = realloc(pools->frame_blocks[frame], sizeof(*blocks) * (count + 1));
+  if (!blocks) return VK_NULL_HANDLE;
+  pools->frame_blocks[frame] = blocks;
+  DescriptorBlock* block = &blocks[count];
+  memset(block, 0, sizeof(*block));
+  if (create_pool(allocator, pools, &block->pool) != VK_SUCCESS) return VK_NULL_HANDLE;
+  pools->frame_block_count[frame] = count + 1;
+  *current = count;
+  if (fill_block(allocator, pools, block) != VK_SUCCESS) return VK_NULL_HANDLE;
+  return block->sets[block->used++];
+}
+
+// Checked before a set is taken, so write_set never has to drop writes.
+static bool writes_fit(uint32_t write_count) {
+  if (write_count <= DESCRIPTOR_MAX_WRITES) return true;
+  fprintf(stderr, "Too many descriptor writes (%u, max %d)\n", write_count, DESCRIPTOR_MAX_WRITES);
+  return false;
+}
+
+static void write_set(DescriptorAllocator* allocator, VkDescriptorSet set, const DescriptorWrite* writes,
+                      uint32_t write_count) {
+  VkWriteDescriptorSet vk_writes[DESCRIPTOR_MAX_WRITES];
+  for (uint32_t i = 0; i < write_count; ++i) {
+    bool image = writes[i].type == VK_DESCRIPTOR_TYPE_SAMPLER || writes[i].type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+                 writes[i].type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || writes[i].type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    vk_writes[i] = (VkWriteDescriptorSet){
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = set,
+        .dstBinding = writes[i].binding,
+        .descriptorCount = 1,
+        .descriptorType = writes[i].type,
+        .pImageInfo = image ? &writes[i].image : NULL,
+        .pBufferInfo = image ? NULL : &writes[i].buffer};
+  }
+  vkUpdateDescriptorSets(allocator->ctx->device, write_count, vk_writes, 0, NULL);
+}
+
+void descriptor_allocator_begin_frame(DescriptorAllocator* allocator, uint32_t frame) {
+  allocator->frame = frame;
+  for (uint32_t i = 0; i < allocator->layout_count; ++i) {
+    DescriptorLayoutPools* pools = &allocator->layouts[i];
+    for (uint32_t b = 0; b < pools->frame_block_count[frame]; ++b) {
+      DescriptorBlock* block = &pools->frame_blocks[frame][b];
+      // Untouched blocks keep their sets; reset only what was handed out.
+      if (block->used == 0) continue;
+      vkResetDescriptorPool(allocator->ctx->device, block->pool, 0);
+      block->allocated = 0;
+      block->used = 0;
+    }
+    pools->frame_block_current[frame] = 0;
+  }
+}
+
+VkDescriptorSet descriptor_allocator_transient(DescriptorAllocator* allocator, VkDescriptorSetLayout layout,
+                                               const DescriptorWrite* writes, uint32_t write_count) {
+  if (!writes_fit(write_count)) return VK_NULL_HANDLE;
+  DescriptorLayoutPools* pools = find_layout(allocator, layout);
+  if (!pools) return VK_NULL_HANDLE;
+  VkDescriptorSet set = next_transient(allocator, pools);
+  if (set == VK_NULL_HANDLE) {
+    fprintf(stderr, "Failed to allocate a transient descriptor set!\n");
+    return VK_NULL_HANDLE;
+  }
+  write_set(allocator, set, writes, write_count);
+  return set;
+}
+
+static VkDescriptorSet allocate_persistent(DescriptorAllocator* allocator, DescriptorLayoutPools* pools) {
+  if (pools->persistent_pool_count == 0 || pools->persistent_used == DESCRIPTOR_POOL_SETS) {
+    VkDescriptorPool* grown =
+        realloc(pools->persistent_pools, sizeof(*grown) * (pools->persistent_pool_count + 1));
+    if (!grown) return VK_NULL_HANDLE;
+    pools->persistent_pools = grown;
+    if (create_pool(allocator, pools, &grown[pools->persistent_pool_count]) != VK_SUCCESS) return VK_NULL_HANDLE;
+    pools->persistent_pool_count++;
+    pools->persistent_used = 0;
+  }
+
+  VkDescriptorSetAllocateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .descriptorPool = pools->persistent_pools[pools->persistent_pool_count - 1],
+      .descriptorSetCount = 1,
+      .pSetLayouts = &pools->layout};
+  VkDescriptorSet set;
+  if (vkAllocateDescriptorSets(allocator->ctx->device, &info, &set) != VK_SUCCESS) return VK_NULL_HANDLE;
+  pools->persistent_used++;
+  return set;
+}
+
+typedef struct {
+  VkDevice device;
+  uint32_t pool_count;
+  VkDescriptorPool pools[];
+} RetiredPools;
+
+static void destroy_retired_pools(void* user_data) {
+  RetiredPools* retired = user_data;
+  for (uint32_t i = 0; i < retired->pool_count; ++i) {
+    vkDestroyDescriptorPool(retired->device, retired->pools[i], NULL);
+  }
+  free(retired);
+}
+
+bool descriptor_allocator_reset_cache(DescriptorAllocator* allocator) {
+  VkContext* ctx = allocator->ctx;
+  unsigned destroyed = atomic_load_explicit(&ctx->destroyed_resources, memory_order_relaxed);
+  if (allocator->cached_count == 0) {
+    allocator->destroyed_resources = destroyed;
+    return true;
+  }
+
+  uint32_t pool_count = 0;
+  for (uint32_t i = 0; i < allocator->layout_count; ++i) pool_count += allocator->layouts[i].persistent_pool_count;
+  RetiredPools* retired = malloc(sizeof(*retired) + sizeof(*retired->pools) * pool_count);
+  if (!retired) return false;
+  *retired = (RetiredPools){.device = ctx->device};
+  for (uint32_t i = 0; i < allocator->layout_count; ++i) {
+    DescriptorLayoutPools* pools = &allocator->layouts[i];
+    for (uint32_t p = 0; p < pools->persistent_pool_count; ++p) {
+      retired->pools[retired->pool_count++] = pools->persistent_pools[p];
+    }
+    pools->persistent_pool_count = 0;
+    pools->persistent_used = 0;
+  }
+  // Frames already recorded may still bind the sets; the pools go once they complete.
+  vk_defer_call(ctx, destroy_retired_pools, retired);
+
+  for (uint32_t i = 0; i < DESCRIPTOR_CACHE_SIZE; ++i) free(allocator->cache[i].writes);
+  memset(allocator->cache, 0, sizeof(*allocator->cache) * DESCRIPTOR_CACHE_SIZE);
+  allocator->cached_count = 0;
+  allocator->destroyed_resources = destroyed;
+  return true;
+}
+
+// Field by field: the struct has padding.
+static bool writes_equal(const DescriptorWrite* a, const DescriptorWrite* b, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    if (a[i].binding != b[i].binding || a[i].type != b[i].type || a[i].buffer.buffer != b[i].buffer.buffer ||
+        a[i].buffer.offset != b[i].buffer.offset || a[i].buffer.range != b[i].buffer.range ||
+        a[i].image.sampler != b[i].image.sampler || a[i].image.imageView != b[i].image.imageView ||
+        a[i].image.imageLayout != b[i].image.imageLayout) {
+      return false;
+    }
+  }
+  return true;
+}
+
+VkDescriptorSet descriptor_allocator_cached(DescriptorAllocator* allocator, VkDescriptorSetLayout layout,
+                                            const DescriptorWrite* writes, uint32_t write_count) {
+  if (!allocator->cache || !writes_fit(write_count)) return VK_NULL_HANDLE;
+  // A destroyed buffer or view may have left its handle to a new object, and a set
+  // written with it would match that object's requests.
+  unsigned destroyed = atomic_load_explicit(&allocator->ctx->destroyed_resources, memory_order_relaxed);
+  if (destroyed != allocator->destroyed_resources && !descriptor_allocator_reset_cache(allocator)) {
+    fprintf(stderr, "Failed to reset the descriptor set cache!\n");
+    return VK_NULL_HANDLE;
+  }
+
+  uint64_t hash = hash_bytes(FNV_OFFSET, &layout, sizeof(layout));
+  for (uint32_t i = 0; i < write_count; ++i) {
+    // Field by field: the struct has padding.
+    const DescriptorWrite* w = &writes[i];
+    hash = hash_bytes(hash, &w->binding, sizeof(w->binding));
+    hash = hash_bytes(hash, &w->type, sizeof(w->type));
+    hash = hash_bytes(hash, &w->buffer.buffer, sizeof(w->buffer.buffer));
+    hash = hash_bytes(hash, &w->buffer.offset, sizeof(w->buffer.offset));
+    hash = hash_bytes(hash, &w->buffer.range, sizeof(w->buffer.range));
+    hash = hash_bytes(hash, &w->image.sampler, sizeof(w->image.sampler));
+    hash = hash_bytes(hash, &w->image.imageView, sizeof(w->image.imageView));
+    hash = hash_bytes(hash, &w->image.imageLayout, sizeof(w->image.imageLayout));
+  }
+  if (hash == 0) hash = 1;
+
+  uint32_t mask = DESCRIPTOR_CACHE_SIZE - 1;
+  uint32_t slot = (uint32_t)hash & mask;
+  while (allocator->cache[slot].hash != 0) {
+    const CachedDescriptorSet* cached = &allocator->cache[slot];
+    if (cached->hash == hash && cached->layout == layout && cached->write_count == write_count &&
+        writes_equal(cached->writes, writes, write_count)) {
+      return cached->set;
+    }
+    slot = (slot + 1) & mask;
+  }
+  // Keep probes short; past three quarters full, every set is evicted and the slot is
+  // found again in the empty table.
+  if (allocator->cached_count >= DESCRIPTOR_CACHE_SIZE / 4 * 3) {
+    if (!descriptor_allocator_reset_cache(allocator)) {
+      fprintf(stderr, "Descriptor set cache is full\n");
+      return VK_NULL_HANDLE;
+    }
+    slot = (uint32_t)hash & mask;
+  }
+
+  DescriptorWrite* key = malloc(sizeof(*key) * MAX(write_count, 1));
+  DescriptorLayoutPools* pools = key ? find_layout(allocator, layout) : NULL;
+  VkDescriptorSet set = pools ? allocate_persistent(allocator, pools) : VK_NULL_HANDLE;
+  if (set == VK_NULL_HANDLE) {
+    fprintf(stderr, "Failed to allocate a cached descriptor set!\n");
+    free(key);
+    return VK_NULL_HANDLE;
+  }
+  write_set(allocator, set, writes, write_count);
+  memcpy(key, writes, sizeof(*key) * write_count);
+  allocator->cache[slot] =
+      (CachedDescriptorSet){.hash = hash, .layout = layout, .writes = key, .write_count = write_count, .set = set};
+  allocator->cached_count++;
+  return set;
+}
+
+void descriptor_allocator_destroy(DescriptorAllocator* allocator) {
+  if (!allocator->ctx) return;
+  VkDevice device = allocator->ctx->device;
+  for (uint32_t i = 0; i < allocator->layout_count; ++i) {
+    DescriptorLayoutPools* pools = &allocator->layouts[i];
+    for (uint32_t frame = 0; frame < MAX_FRAMES_IN_FLIGHT; ++frame) {
+      for (uint32_t b = 0; b < pools->frame_block_count[frame]; ++b) {
+        vkDestroyDescriptorPool(device, pools->frame_blocks[frame][b].pool, NULL);
+      }
+      free(pools->frame_blocks[frame]);
+    }
+    for (uint32_t p = 0; p < pools->persistent_pool_count; ++p) {
+      vkDestroyDescriptorPool(device, pools->persistent_pools[p], NULL);
+    }
+    free(pools->persistent_pools);
+  }
+  if (allocator->cache) {
+    for (uint32_t i = 0; i < DESCRIPTOR_CACHE_SIZE; ++i) free(allocator->cache[i].writes);
+  }
+  free(allocator->cache);
+  memset(allocator, 0, sizeof(*allocator));
+}
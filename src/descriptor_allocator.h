@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "layout_cache.h"
+#include "vk.h"
+
+#define DESCRIPTOR_POOL_SETS 64  // sets per pool, allocated in one call after each reset
+#define DESCRIPTOR_ALLOCATOR_MAX_LAYOUTS 32
+#define DESCRIPTOR_CACHE_SIZE 1024  // power of two, open addressing
+#define DESCRIPTOR_MAX_WRITES 16
+
+// One descriptor (array element 0) of a binding; buffer or image info by type.
+typedef struct {
+  uint32_t binding;
+  VkDescriptorType type;
+  VkDescriptorBufferInfo buffer;
+  VkDescriptorImageInfo image;
+} DescriptorWrite;
+
+typedef struct {
+  VkDescriptorPool pool;
+  VkDescriptorSet sets[DESCRIPTOR_POOL_SETS];
+  uint32_t allocated;  // sets[0..allocated) are valid until the pool is reset
+  uint32_t used;
+} DescriptorBlock;
+
+typedef struct {
+  VkDescriptorSetLayout layout;
+  VkDescriptorPoolSize sizes[LAYOUT_CACHE_MAX_POOL_SIZES];
+  uint32_t size_count;
+  // Transient sets: pools per frame in flight, reset together when the frame comes round.
+  DescriptorBlock* frame_blocks[MAX_FRAMES_IN_FLIGHT];
+  uint32_t frame_block_count[MAX_FRAMES_IN_FLIGHT];
+  uint32_t frame_block_current[MAX_FRAMES_IN_FLIGHT];
+  // Long-lived sets: pools that are never reset, filled one set at a time.
+  VkDescriptorPool* persistent_pools;
+  uint32_t persistent_pool_count;
+  uint32_t persistent_used;  // sets taken from the last persistent pool
+} DescriptorLayoutPools;
+
+// Keeps the layout and writes it was built from: a hash match is only a hit when they compare equal.
+typedef struct {
+  uint64_t hash;  // 0 marks an empty slot
+  VkDescriptorSetLayout layout;
+  DescriptorWrite* writes;
+  uint32_t write_count;
+  VkDescriptorSet set;
+} CachedDescriptorSet;
+
+// Descriptor sets for the generated set layouts of LayoutCache (the bindless and
+// uniform ring sets are allocated once by their owners). Pools grow per layout and are
+// never freed individually. Transient sets come from the current frame's pools, which
+// descriptor_allocator_begin_frame resets with one vkResetDescriptorPool each; sets are
+// allocated a pool at a time, so handing one out is a cursor bump. Cached sets are
+// looked up by layout and contents, so equal requests share one set. The whole cache is
+// evicted when it fills up or when any buffer or image view is destroyed (see
+// VkContext::destroyed_resources), so callers request a cached set each frame they bind it
+// rather than keeping the handle. Render thread only.
+typedef struct {
+  VkContext* ctx;
+  uint32_t frame;
+  DescriptorLayoutPools layouts[DESCRIPTOR_ALLOCATOR_MAX_LAYOUTS];
+  uint32_t layout_count;
+  CachedDescriptorSet* cache;
+  uint32_t cached_count;
+  unsigned destroyed_resources;  // ctx->destroyed_resources when the cache was last reset
+} DescriptorAllocator;
+
+VkResult descriptor_allocator_init(DescriptorAllocator* allocator, VkContext* ctx);
+// Resets the frame's transient pools; its previous sets must no longer be in use on the GPU.
+void descriptor_allocator_begin_frame(DescriptorAllocator* allocator, uint32_t frame);
+// A set valid until this frame slot comes round again; VK_NULL_HANDLE on failure.
+VkDescriptorSet descriptor_allocator_transient(DescriptorAllocator* allocator, VkDescriptorSetLayout layout,
+                                               const DescriptorWrite* writes, uint32_t write_count);
+// A set shared by every request with equal contents, valid for the frame being recorded;
+// VK_NULL_HANDLE on failure. Both fail when write_count exceeds DESCRIPTOR_MAX_WRITES.
+VkDescriptorSet descriptor_allocator_cached(DescriptorAllocator* allocator, VkDescriptorSetLayout layout,
+                                            const DescriptorWrite* writes, uint32_t write_count);
+// Evicts every cached set; their pools are destroyed once the frames using them complete.
+// False when out of memory, leaving the cache as it was.
+bool descriptor_allocator_reset_cache(DescriptorAllocator* allocator);
+void descriptor_allocator_destroy(DescriptorAllocator* allocator);
@@ -0,0 +1,97 @@
+#include "dynamic_resolution.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SMOOTHING 0.1f    // weight of the newest sample in gpu_ms
+#define TARGET 0.9f       // fraction of the budget to settle at
+#define LOW_WATER 0.75f   // below this fraction of the budget there is room to scale up
+#define MAX_STEP 0.05f    // per frame, so resolution changes do not pump visibly
+
+VkResult dynamic_resolution_init(DynamicResolution* resolution, VkContext* ctx, float budget_ms) {
+  memset(resolution, 0, sizeof(*resolution));
+  resolution->ctx = ctx;
+  resolution->budget_ms = budget_ms;
+  resolution->scale = DYNAMIC_RESOLUTION_MAX_SCALE;
+
+  uint32_t family_count = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(ctx->physical_device, &family_count, NULL);
+  VkQueueFamilyProperties* families = malloc(sizeof(*families) * family_count);
+  if (!families) return VK_ERROR_OUT_OF_HOST_MEMORY;
+  vkGetPhysicalDeviceQueueFamilyProperties(ctx->physical_device, &family_count, families);
+  uint32_t valid_bits = families[ctx->graphics_family].timestampValidBits;
+  free(families);
+  if (valid_bits == 0) {
+    fprintf(stderr, "Warning: graphics queue has no timestamps, dynamic resolution disabled\n");
+    return VK_SUCCESS;
+  }
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(ctx->physical_device, &properties);
+  resolution->ns_per_tick = properties.limits.timestampPeriod;
+  resolution->timestamp_mask = valid_bits >= 64 ? UINT64_MAX : (1ull << valid_bits) - 1;
+
+  VkQueryPoolCreateInfo pool_info = {
+      .sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+      .queryType = VK_QUERY_TYPE_TIMESTAMP,
+      .queryCount = 2 * MAX_FRAMES_IN_FLIGHT};
+  VK_RETURN(vkCreateQueryPool(ctx->device, &pool_info, NULL, &resolution->query_pool));
+
+  resolution->enabled = true;
+  return VK_SUCCESS;
+}
+
+void dynamic_resolution_update(DynamicResolution* resolution, uint32_t frame) {
+  if (!resolution->enabled || !resolution->written[frame]) return;
+
+  uint64_t ticks[2];
+  VkResult res = vkGetQueryPoolResults(resolution->ctx->device, resolution->query_pool, frame * 2, 2, sizeof(ticks),
+                                       ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+  if (res != VK_SUCCESS) return;
+
+  uint64_t elapsed = (ticks[1] - ticks[0]) & resolution->timestamp_mask;
+  float ms = (float)((double)elapsed * resolution->ns_per_tick * 1e-6);
+  if (ms <= 0.0f) return;
+  resolution->gpu_ms = resolution->gpu_ms > 0.0f ? resolution->gpu_ms + (ms - resolution->gpu_ms) * SMOOTHING : ms;
+  if (resolution->fixed_scale > 0.0f) return;
+
+  // Hysteresis band: leave the scale alone while the frame fits without much slack.
+  float budget = resolution->budget_ms;
+  float gpu_ms = resolution->gpu_ms;
+  if (gpu_ms <= budget && gpu_ms >= budget * LOW_WATER) return;
+
+  // Cost follows the pixel count, which grows with the square of the scale.
+  float target = resolution->scale * sqrtf(budget * TARGET / gpu_ms);
+  float step = CLAMP(target - resolution->scale, -MAX_STEP, MAX_STEP);
+  resolution->scale = CLAMP(resolution->scale + step, DYNAMIC_RESOLUTION_MIN_SCALE, DYNAMIC_RESOLUTION_MAX_SCALE);
+}
+
+void dynamic_resolution_begin(DynamicResolution* resolution, VkCommandBuffer cmd, uint32_t frame) {
+  if (!resolution->enabled) return;
+  vkCmdResetQueryPool(cmd, resolution->query_pool, frame * 2, 2);
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, resolution->query_pool, frame * 2);
+}
+
+void dynamic_resolution_end(DynamicResolution* resolution, VkCommandBuffer cmd, uint32_t frame) {
+  if (!resolution->enabled) return;
+  vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, resolution->query_pool, frame * 2 + 1);
+  resolution->written[frame] = true;
+}
+
+VkExtent2D dynamic_resolution_extent(const DynamicResolution* resolution, VkExtent2D full) {
+  float scale = resolution->fixed_scale > 0.0f ? resolution->fixed_scale : resolution->scale;
+  VkExtent2D extent = {
+      .width = (uint32_t)((float)full.width * scale + 0.5f),
+      .height = (uint32_t)((float)full.height * scale + 0.5f)};
+  extent.width = CLAMP(extent.width, 1u, full.width);
+  extent.height = CLAMP(extent.height, 1u, full.height);
+  return extent;
+}
+
+void dynamic_resolution_destroy(DynamicResolution* resolution) {
+  VkContext* ctx = resolution->ctx;
+  if (!ctx) return;
+  if (resolution->query_pool != VK_NULL_HANDLE) vkDestroyQueryPool(ctx->device, resolution->query_pool, NULL);
+  memset(resolution, 0, sizeof(*resolution));
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "vk.h"
+
+#define DYNAMIC_RESOLUTION_MIN_SCALE 0.5f
+#define DYNAMIC_RESOLUTION_MAX_SCALE 1.0f
+// GPU time per frame the controller aims for: a 60 Hz frame with some slack.
+#define DYNAMIC_RESOLUTION_BUDGET_MS 14.0f
+
+// Picks the fraction of the output resolution the scene is rendered at. Timestamps around
+// each frame's command buffer are read back once its fence has signaled, and the scale moves
+// toward the value that would bring the smoothed GPU time back inside the budget.
+typedef struct {
+  VkContext* ctx;
+  bool enabled;  // false without graphics queue timestamps; the scale then stays at max
+  VkQueryPool query_pool;
+  bool written[MAX_FRAMES_IN_FLIGHT];
+  double ns_per_tick;
+  uint64_t timestamp_mask;
+
+  float budget_ms;
+  float gpu_ms;  // smoothed
+  float scale;
+  float fixed_scale;  // > 0 pins the scale, e.g. for reproducible tests; timings are still measured
+} DynamicResolution;
+
+VkResult dynamic_resolution_init(DynamicResolution* resolution, VkContext* ctx, float budget_ms);
+// Reads the timings of the last frame that used this frame slot; its fence must have signaled.
+void dynamic_resolution_update(DynamicResolution* resolution, uint32_t frame);
+// Bracket all GPU work of a frame.
+void dynamic_resolution_begin(DynamicResolution* resolution, VkCommandBuffer cmd, uint32_t frame);
+void dynamic_resolution_end(DynamicResolution* resolution, VkCommandBuffer cmd, uint32_t frame);
+VkExtent2D dynamic_resolution_extent(const DynamicResolution* resolution, VkExtent2D full);
+void dynamic_resolution_destroy(DynamicResolution* resolution);
@@ -0,0 +1,184 @@
+#include "gpu_scene.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Mirrors the push constant block in shaders/cull.comp.
+typedef struct {
+  float planes[6][4];
+  uint32_t object_count;
+  uint32_t objects;
+  uint32_t draws;
+  uint32_t count;
+} CullPushConstants;
+
+VkResult gpu_scene_init(GpuScene* scene, VkContext* ctx) {
+  memset(scene, 0, sizeof(*scene));
+  scene->ctx = ctx;
+  scene->index_type = VK_INDEX_TYPE_UINT32;
+  scene->draws = RG_INVALID_HANDLE;
+  scene->counts = RG_INVALID_HANDLE;
+  scene->object_handle = BINDLESS_INVALID_HANDLE;
+  scene->output = GPU_SCENE_INVALID_OUTPUT;
+  for (uint32_t i = 0; i < GPU_SCENE_OUTPUTS; ++i) {
+    scene->draw_handles[i] = BINDLESS_INVALID_HANDLE;
+    scene->count_handles[i] = BINDLESS_INVALID_HANDLE;
+  }
+
+  if (!ctx->has_bindless || !ctx->has_draw_indirect_count || !ctx->has_draw_indirect_first_instance) {
+    fprintf(stderr, "Warning: GPU-driven draws need bindless, drawIndirectCount and firstInstance, disabled\n");
+    return VK_SUCCESS;
+  }
+
+  VkResult res = vk_create_compute_pipeline(ctx, "shaders/cull.comp.spv", ctx->pipeline_layout, &scene->cull_pipeline);
+  if (res != VK_SUCCESS) goto fail;
+
+  VkMemoryPropertyFlags host_visible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  VkDeviceSize object_bytes = sizeof(GpuObject) * GPU_SCENE_MAX_OBJECTS;
+  res = vk_create_buffer(ctx, object_bytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, host_visible,
+                         &scene->object_buffer, &scene->object_memory);
+  if (res != VK_SUCCESS) goto fail;
+  if ((res = vkMapMemory(ctx->device, scene->object_memory, 0, object_bytes, 0, (void**)&scene->objects)) != VK_SUCCESS) goto fail;
+  scene->object_handle = bindless_add_buffer(&ctx->bindless, scene->object_buffer, 0, object_bytes);
+
+  VkDeviceSize draw_bytes = sizeof(VkDrawIndexedIndirectCommand) * GPU_SCENE_MAX_OBJECTS;
+  scene->view_count = CLAMP(ctx->window_count, 1, GPU_SCENE_MAX_VIEWS);
+  for (uint32_t i = 0; i < GPU_SCENE_OUTPUTS; ++i) {
+    if (i % GPU_SCENE_MAX_VIEWS >= scene->view_count) continue;
+    res = vk_create_buffer(ctx, draw_bytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &scene->draw_buffers[i], &scene->draw_memory[i]);
+    if (res != VK_SUCCESS) goto fail;
+    res = vk_create_buffer(ctx, sizeof(uint32_t),
+                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &scene->count_buffers[i], &scene->count_memory[i]);
+    if (res != VK_SUCCESS) goto fail;
+    scene->draw_handles[i] = bindless_add_buffer(&ctx->bindless, scene->draw_buffers[i], 0, draw_bytes);
+    scene->count_handles[i] = bindless_add_buffer(&ctx->bindless, scene->count_buffers[i], 0, sizeof(uint32_t));
+  }
+
+  scene->enabled = true;
+  return VK_SUCCESS;
+
+fail:
+  gpu_scene_destroy(scene);
+  fprintf(stderr, "Warning: GPU-driven draws disabled\n");
+  return res;
+}
+
+uint32_t gpu_scene_add_object(GpuScene* scene, const GpuObject* object) {
+  if (!scene->enabled || scene->object_count >= GPU_SCENE_MAX_OBJECTS) return UINT32_MAX;
+  // Slots past object_count are never read by frames already in flight.
+  scene->objects[scene->object_count] = *object;
+  return scene->object_count++;
+}
+
+void gpu_scene_set_index_buffer(GpuScene* scene, VkBuffer index_buffer, VkIndexType index_type) {
+  scene->index_buffer = index_buffer;
+  scene->index_type = index_type;
+}
+
+static void reset_pass(RenderGraph* graph, VkCommandBuffer cmd, void* user_data) {
+  GpuScene* scene = user_data;
+  if (scene->output == GPU_SCENE_INVALID_OUTPUT) return;
+  vkCmdFillBuffer(cmd, render_graph_get_buffer(graph, scene->counts), 0, sizeof(uint32_t), 0);
+}
+
+static void cull_pass(RenderGraph* graph, VkCommandBuffer cmd, void* user_data) {
+  GpuScene* scene = user_data;
+  if (scene->object_count == 0 || scene->output == GPU_SCENE_INVALID_OUTPUT) return;
+
+  CullPushConstants push = {
+      .object_count = scene->object_count,
+      .objects = scene->object_handle,
+      .draws = scene->draw_handles[scene->output],
+      .count = scene->count_handles[scene->output]};
+  memcpy(push.planes, scene->frustum_planes, sizeof(push.planes));
+
+  VkContext* ctx = scene->ctx;
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, scene->cull_pipeline);
+  bindless_bind(&ctx->bindless, cmd, VK_PIPELINE_BIND_POINT_COMPUTE, ctx->pipeline_layout);
+  vkCmdPushConstants(cmd, ctx->pipeline_layout, VK_SHADER_STAGE_ALL, 0, sizeof(push), &push);
+  vk_cmd_dispatch_threads(cmd, scene->object_count, 1, 1, GPU_SCENE_CULL_GROUP_SIZE, 1, 1);
+}
+
+void gpu_scene_add_passes(GpuScene* scene, RenderGraph* graph) {
+  if (!scene->enabled) return;
+
+  // Each view of each frame in flight has its own output buffers, so nothing from older
+  // frames or earlier views is still reading them when the graph starts.
+  RenderGraphImportDesc import = {0};
+  scene->draws = render_graph_import_buffer(graph, "gpu_draws", &import);
+  scene->counts = render_graph_import_buffer(graph, "gpu_draw_count", &import);
+
+  uint32_t reset = render_graph_add_pass(graph, "cull_reset", reset_pass, scene);
+  render_graph_write(graph, reset, scene->counts, RG_ACCESS_TRANSFER_WRITE);
+
+  uint32_t cull = render_graph_add_pass(graph, "cull", cull_pass, scene);
+  render_graph_write(graph, cull, scene->counts, RG_ACCESS_STORAGE_WRITE_COMPUTE);
+  render_graph_write(graph, cull, scene->draws, RG_ACCESS_STORAGE_WRITE_COMPUTE);
+}
+
+void gpu_scene_declare_draw(GpuScene* scene, RenderGraph* graph, uint32_t draw_pass) {
+  if (!scene->enabled) return;
+  render_graph_read(graph, draw_pass, scene->counts, RG_ACCESS_INDIRECT_READ);
+  render_graph_read(graph, draw_pass, scene->draws, RG_ACCESS_INDIRECT_READ);
+}
+
+// Gribb/Hartmann plane extraction from a column-major matrix with Vulkan's [0, w] depth.
+static void extract_frustum_planes(const float m[16], float planes[6][4]) {
+  for (int i = 0; i < 4; ++i) {
+    float r0 = m[i * 4 + 0], r1 = m[i * 4 + 1], r2 = m[i * 4 + 2], r3 = m[i * 4 + 3];
+    planes[0][i] = r3 + r0;
+    planes[1][i] = r3 - r0;
+    planes[2][i] = r3 + r1;
+    planes[3][i] = r3 - r1;
+    planes[4][i] = r2;
+    planes[5][i] = r3 - r2;
+  }
+  for (int p = 0; p < 6; ++p) {
+    float len = sqrtf(planes[p][0] * planes[p][0] + planes[p][1] * planes[p][1] + planes[p][2] * planes[p][2]);
+    if (len <= 0.0f) continue;
+    for (int i = 0; i < 4; ++i) planes[p][i] /= len;
+  }
+}
+
+void gpu_scene_begin_frame(GpuScene* scene, RenderGraph* graph, uint32_t frame, uint32_t view,
+                           const float view_proj[16]) {
+  if (!scene->enabled) return;
+  if (view >= scene->view_count) {
+    scene->output = GPU_SCENE_INVALID_OUTPUT;
+    return;
+  }
+  uint32_t output = frame * GPU_SCENE_MAX_VIEWS + view;
+  scene->output = output;
+  extract_frustum_planes(view_proj, scene->frustum_planes);
+  render_graph_bind_buffer(graph, scene->draws, scene->draw_buffers[output], 0, VK_WHOLE_SIZE);
+  render_graph_bind_buffer(graph, scene->counts, scene->count_buffers[output], 0, VK_WHOLE_SIZE);
+}
+
+// The caller binds the pipeline; shaders find their object through gl_InstanceIndex.
+void gpu_scene_draw(GpuScene* scene, VkCommandBuffer cmd) {
+  if (!scene->enabled || scene->index_buffer == VK_NULL_HANDLE || scene->object_count == 0 ||
+      scene->output == GPU_SCENE_INVALID_OUTPUT) {
+    return;
+  }
+  uint32_t output = scene->output;
+  vkCmdBindIndexBuffer(cmd, scene->index_buffer, 0, scene->index_type);
+  vkCmdDrawIndexedIndirectCount(cmd, scene->draw_buffers[output], 0, scene->count_buffers[output], 0,
+                                scene->object_count, sizeof(VkDrawIndexedIndirectCommand));
+}
+
+void gpu_scene_destroy(GpuScene* scene) {
+  VkContext* ctx = scene->ctx;
+  if (!ctx) return;
+  for (uint32_t i = 0; i < GPU_SCENE_OUTPUTS; ++i) {
+    bindless_remove_buffer(&ctx->bindless, scene->draw_handles[i]);
+    bindless_remove_buffer(&ctx->bindless, scene->count_handles[i]);
+    vk_destroy_buffer(ctx, scene->draw_buffers[i], scene->draw_memory[i]);
+    vk_destroy_buffer(ctx, scene->count_buffers[i], scene->count_memory[i]);
+  }
+  bindless_remove_buffer(&ctx->bindless, scene->object_handle);
+  vk_destroy_buffer(ctx, scene->object_buffer, scene->object_memory);
+  if (scene->cull_pipeline != VK_NULL_HANDLE) vkDestroyPipeline(ctx->device, scene->cull_pipeline, NULL);
+  memset(scene, 0, sizeof(*scene));
+}
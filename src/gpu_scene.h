@@ -0,0 +1,71 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "render_graph.h"
+#include "vk.h"
+
+#define GPU_SCENE_MAX_OBJECTS 65536
+#define GPU_SCENE_CULL_GROUP_SIZE 64
+#define GPU_SCENE_MAX_VIEWS VK_MAX_WINDOWS
+#define GPU_SCENE_OUTPUTS (MAX_FRAMES_IN_FLIGHT * GPU_SCENE_MAX_VIEWS)
+#define GPU_SCENE_INVALID_OUTPUT UINT32_MAX
+
+// Mirrors GpuObject in shaders/cull.comp (std430).
+typedef struct {
+  float center[3];
+  float radius;
+  uint32_t index_count;
+  uint32_t first_index;
+  int32_t vertex_offset;
+  uint32_t user_data;
+} GpuObject;
+
+// GPU-driven draw path: a compute pass culls every object's bounding sphere against
+// the view frustum and appends VkDrawIndexedIndirectCommands plus a draw count, which
+// the graphics pass consumes with one vkCmdDrawIndexedIndirectCount. The CPU cost per
+// frame does not depend on the number of objects. Every view of every frame in flight
+// culls into its own outputs, so views recorded back to back do not wait on each other.
+typedef struct {
+  VkContext* ctx;
+  bool enabled;
+  VkPipeline cull_pipeline;
+
+  VkBuffer object_buffer;
+  VkDeviceMemory object_memory;
+  GpuObject* objects;
+  uint32_t object_count;
+  uint32_t object_handle;
+
+  // Indexed by frame * GPU_SCENE_MAX_VIEWS + view; views below view_count only.
+  VkBuffer draw_buffers[GPU_SCENE_OUTPUTS];
+  VkDeviceMemory draw_memory[GPU_SCENE_OUTPUTS];
+  uint32_t draw_handles[GPU_SCENE_OUTPUTS];
+  VkBuffer count_buffers[GPU_SCENE_OUTPUTS];
+  VkDeviceMemory count_memory[GPU_SCENE_OUTPUTS];
+  uint32_t count_handles[GPU_SCENE_OUTPUTS];
+  uint32_t view_count;  // ctx->window_count at init
+  uint32_t output;  // of the view being recorded, GPU_SCENE_INVALID_OUTPUT if it has none
+
+  float frustum_planes[6][4];
+  RenderGraphHandle draws;
+  RenderGraphHandle counts;
+
+  VkBuffer index_buffer;
+  VkIndexType index_type;
+} GpuScene;
+
+VkResult gpu_scene_init(GpuScene* scene, VkContext* ctx);
+uint32_t gpu_scene_add_object(GpuScene* scene, const GpuObject* object);
+void gpu_scene_set_index_buffer(GpuScene* scene, VkBuffer index_buffer, VkIndexType index_type);
+
+// Adds the reset and cull passes; they must come before the pass that calls gpu_scene_draw,
+// which then declares its indirect reads with gpu_scene_declare_draw.
+void gpu_scene_add_passes(GpuScene* scene, RenderGraph* graph);
+void gpu_scene_declare_draw(GpuScene* scene, RenderGraph* graph, uint32_t draw_pass);
+// Binds the outputs of this frame and view; views past the windows at init draw nothing.
+void gpu_scene_begin_frame(GpuScene* scene, RenderGraph* graph, uint32_t frame, uint32_t view,
+                           const float view_proj[16]);
+void gpu_scene_draw(GpuScene* scene, VkCommandBuffer cmd);
+void gpu_scene_destroy(GpuScene* scene);
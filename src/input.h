@@ -13,6 +13,7 @@ typedef enum {
   KEY_S,
   KEY_D,
   KEY_ESCAPE,
+  KEY_F3,
   COUNT_KEYS
 } KeyCode;
 
@@ -23,11 +24,21 @@ typedef enum {
   COUNTS_MOUSE_BUTTONS
 } MouseButton;
 
+// Everything input_update samples, so a frame's input can be saved and restored.
+typedef struct {
+  uint32_t keys;  // bit per KeyCode
+  uint32_t mouse_buttons;  // bit per MouseButton
+  int32_t mouse_x, mouse_y;
+} InputState;
+
 Input* input_create(void* window_handle);
 void input_update(Input* input);
 bool input_is_key_down(Input* input, KeyCode key);
 bool input_is_mouse_button_down(Input* input, MouseButton button);
 void input_get_mouse_position(Input* input, int* x, int* y);
+void input_get_state(Input* input, InputState* state);
+// Replaces the sampled state, e.g. with a recorded frame instead of calling input_update.
+void input_set_state(Input* input, const InputState* state);
 void input_destroy(Input* input);
 
 #endif
@@ -0,0 +1,117 @@
+#include "input_record.h"
+#include <string.h>
+
+enum {
+  CHANGED_KEYS = 1 << 0,
+  CHANGED_MOUSE_BUTTONS = 1 << 1,
+  CHANGED_MOUSE_POSITION = 1 << 2,
+};
+
+static bool write_u32(FILE* fp, uint32_t value) {
+  uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+  return fwrite(bytes, 1, 4, fp) == 4;
+}
+
+static bool read_u32(FILE* fp, uint32_t* value) {
+  uint8_t bytes[4];
+  if (fread(bytes, 1, 4, fp) != 4) return false;
+  *value = (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+  return true;
+}
+
+bool input_record_open(InputRecorder* recorder, const char* path, InputRecordMode mode) {
+  memset(recorder, 0, sizeof(*recorder));
+  if (mode == INPUT_RECORD_OFF) return true;
+
+  recorder->file = fopen(path, mode == INPUT_RECORD_WRITE ? "wb" : "rb");
+  if (!recorder->file) {
+    fprintf(stderr, "Failed to open input recording '%s'\n", path);
+    return false;
+  }
+  recorder->mode = mode;
+
+  bool ok;
+  if (mode == INPUT_RECORD_WRITE) {
+    ok = write_u32(recorder->file, INPUT_RECORD_MAGIC) && write_u32(recorder->file, INPUT_RECORD_VERSION);
+  } else {
+    uint32_t magic = 0, version = 0;
+    ok = read_u32(recorder->file, &magic) && read_u32(recorder->file, &version) && magic == INPUT_RECORD_MAGIC &&
+         version == INPUT_RECORD_VERSION;
+  }
+  if (!ok) {
+    fprintf(stderr, "Invalid input recording '%s'\n", path);
+    input_record_close(recorder);
+    return false;
+  }
+  return true;
+}
+
+static bool write_frame(InputRecorder* recorder, Input* input, float dt) {
+  FILE* fp = recorder->file;
+  InputState state;
+  input_get_state(input, &state);
+  InputState* last = &recorder->last;
+
+  uint8_t changed = 0;
+  if (recorder->frames == 0 || state.keys != last->keys) changed |= CHANGED_KEYS;
+  if (recorder->frames == 0 || state.mouse_buttons != last->mouse_buttons) changed |= CHANGED_MOUSE_BUTTONS;
+  if (recorder->frames == 0 || state.mouse_x != last->mouse_x || state.mouse_y != last->mouse_y) {
+    changed |= CHANGED_MOUSE_POSITION;
+  }
+
+  uint32_t dt_bits;
+  memcpy(&dt_bits, &dt, sizeof(dt_bits));
+  bool ok = fwrite(&changed, 1, 1, fp) == 1 && write_u32(fp, dt_bits);
+  if (changed & CHANGED_KEYS) ok = ok && write_u32(fp, state.keys);
+  if (changed & CHANGED_MOUSE_BUTTONS) ok = ok && write_u32(fp, state.mouse_buttons);
+  if (changed & CHANGED_MOUSE_POSITION) {
+    ok = ok && write_u32(fp, (uint32_t)state.mouse_x) && write_u32(fp, (uint32_t)state.mouse_y);
+  }
+  *last = state;
+  return ok;
+}
+
+static bool read_frame(InputRecorder* recorder, Input* input, float* dt) {
+  FILE* fp = recorder->file;
+  InputState* state = &recorder->last;
+
+  uint8_t changed;
+  uint32_t dt_bits;
+  if (fread(&changed, 1, 1, fp) != 1 || !read_u32(fp, &dt_bits)) return false;
+  bool ok = true;
+  if (changed & CHANGED_KEYS) ok = ok && read_u32(fp, &state->keys);
+  if (changed & CHANGED_MOUSE_BUTTONS) ok = ok && read_u32(fp, &state->mouse_buttons);
+  if (changed & CHANGED_MOUSE_POSITION) {
+    uint32_t x = 0, y = 0;
+    ok = ok && read_u32(fp, &x) && read_u32(fp, &y);
+    state->mouse_x = (int32_t)x;
+    state->mouse_y = (int32_t)y;
+  }
+  if (!ok) {
+    fprintf(stderr, "Input recording truncated at frame %llu\n", (unsigned long long)recorder->frames);
+    return false;
+  }
+  memcpy(dt, &dt_bits, sizeof(*dt));
+  input_set_state(input, state);
+  return true;
+}
+
+bool input_record_frame(InputRecorder* recorder, Input* input, float* dt) {
+  if (recorder->mode == INPUT_RECORD_WRITE) {
+    // A failed write stops recording but never the session being recorded.
+    if (!write_frame(recorder, input, *dt)) {
+      fprintf(stderr, "Failed to write input recording, recording stopped\n");
+      input_record_close(recorder);
+      return true;
+    }
+  } else if (recorder->mode == INPUT_RECORD_REPLAY) {
+    if (!read_frame(recorder, input, dt)) return false;
+  }
+  recorder->frames++;
+  return true;
+}
+
+void input_record_close(InputRecorder* recorder) {
+  if (recorder->file) fclose(recorder->file);
+  memset(recorder, 0, sizeof(*recorder));
+}
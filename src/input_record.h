@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "input.h"
+
+#define INPUT_RECORD_MAGIC 0x52504e49u  // "INPR"
+#define INPUT_RECORD_VERSION 1
+
+typedef enum {
+  INPUT_RECORD_OFF = 0,
+  INPUT_RECORD_WRITE,
+  INPUT_RECORD_REPLAY,
+} InputRecordMode;
+
+// Per-frame input and delta time, written as it is sampled or read back in place of
+// input_update, so a session replays bit-for-bit independent of the wall clock.
+//
+// File: u32 magic, u32 version, then one record per frame: a u8 mask of the fields that
+// changed since the previous frame, the f32 delta time, and each changed field
+// (u32 keys, u32 mouse buttons, i32 mouse x and y). All values are little-endian.
+typedef struct {
+  FILE* file;
+  InputRecordMode mode;
+  InputState last;
+  uint64_t frames;
+} InputRecorder;
+
+bool input_record_open(InputRecorder* recorder, const char* path, InputRecordMode mode);
+// Call once per frame. WRITE appends the state input_update just sampled and `*dt`
+// (a write error ends the recording);
+// REPLAY loads the next frame into `input` and `*dt`, and returns false when the
+// recording has ended. OFF leaves both untouched.
+bool input_record_frame(InputRecorder* recorder, Input* input, float* dt);
+void input_record_close(InputRecorder* recorder);
@@ -26,6 +26,7 @@ void input_update(Input* input) {
   input->keys[KEY_S] = SC(SDL_SCANCODE_S);
   input->keys[KEY_D] = SC(SDL_SCANCODE_D);
   input->keys[KEY_ESCAPE] = SC(SDL_SCANCODE_ESCAPE);
+  input->keys[KEY_F3] = SC(SDL_SCANCODE_F3);
 #undef SC
 
   float x = 0, y = 0;
@@ -50,6 +51,29 @@ void input_get_mouse_position(Input* in, int* x, int* y) {
   if (y) *y = in->mouse_y;
 }
 
+void input_get_state(Input* in, InputState* state) {
+  memset(state, 0, sizeof(*state));
+  for (int k = 0; k < COUNT_KEYS; ++k) {
+    if (in->keys[k]) state->keys |= 1u << k;
+  }
+  for (int b = 0; b < COUNTS_MOUSE_BUTTONS; ++b) {
+    if (in->mouse_buttons[b]) state->mouse_buttons |= 1u << b;
+  }
+  state->mouse_x = in->mouse_x;
+  state->mouse_y = in->mouse_y;
+}
+
+void input_set_state(Input* in, const InputState* state) {
+  for (int k = 0; k < COUNT_KEYS; ++k) {
+    in->keys[k] = (state->keys >> k) & 1u;
+  }
+  for (int b = 0; b < COUNTS_MOUSE_BUTTONS; ++b) {
+    in->mouse_buttons[b] = (state->mouse_buttons >> b) & 1u;
+  }
+  in->mouse_x = state->mouse_x;
+  in->mouse_y = state->mouse_y;
+}
+
 void input_destroy(Input* in) {
   free(in);
 }
@@ -0,0 +1,269 @@
+#include "layout_cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "base.h"
+#include "vk.h"
+
+#define BINDLESS_SET 0  // see bindless_bind
+
+VkResult layout_cache_init(LayoutCache* cache, VkDevice device, VkPipelineLayout shared_layout,
+                           VkDescriptorSetLayout bindless_layout, VkDescriptorSetLayout uniform_layout) {
+  memset(cache, 0, sizeof(*cache));
+  cache->device = device;
+  cache->shared_layout = shared_layout;
+  cache->bindless_layout = bindless_layout;
+  cache->uniform_layout = uniform_layout;
+  cache->shaders = calloc(LAYOUT_CACHE_MAX_SHADERS, sizeof(*cache->shaders));
+  cache->lock = mutex_create();
+  if (!cache->shaders || !cache->lock) {
+    layout_cache_destroy(cache);
+    return VK_ERROR_OUT_OF_HOST_MEMORY;
+  }
+  return VK_SUCCESS;
+}
+
+bool layout_cache_reflect(LayoutCache* cache, const uint32_t* words, size_t word_count, SpirvReflection* reflection) {
+  uint64_t hash = hash_bytes(FNV_OFFSET, words, word_count * sizeof(*words));
+  mutex_lock(cache->lock);
+  for (uint32_t i = 0; i < cache->shader_count; ++i) {
+    const CachedReflection* cached = &cache->shaders[i];
+    if (cached->hash == hash && cached->word_count == word_count &&
+        memcmp(cached->words, words, word_count * sizeof(*words)) == 0) {
+      *reflection = cached->reflection;
+      mutex_unlock(cache->lock);
+      return true;
+    }
+  }
+  mutex_unlock(cache->lock);
+
+  // Parsed unlocked; two workers racing on the same module just both insert it.
+  if (!spirv_reflect(words, word_count, reflection)) return false;
+  uint32_t* copy = malloc(word_count * sizeof(*words));
+  if (!copy) return true;
+  memcpy(copy, words, word_count * sizeof(*words));
+  mutex_lock(cache->lock);
+  if (cache->shader_count < LAYOUT_CACHE_MAX_SHADERS) {
+    cache->shaders[cache->shader_count++] =
+        (CachedReflection){.hash = hash, .words = copy, .word_count = word_count, .reflection = *reflection};
+    copy = NULL;
+  }
+  mutex_unlock(cache->lock);
+  free(copy);
+  return true;
+}
+
+static int bindless_type(uint32_t binding) {
+  switch (binding) {
+    case BINDLESS_BINDING_IMAGES: return VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    case BINDLESS_BINDING_BUFFERS: return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    case BINDLESS_BINDING_SAMPLERS: return VK_DESCRIPTOR_TYPE_SAMPLER;
+    case BINDLESS_BINDING_STORAGE_IMAGES: return VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    default: return -1;
+  }
+}
+
+// Whether a binding is served by one of the renderer's own set layouts.
+static bool is_bindless(const LayoutCache* cache, const SpirvBinding* binding) {
+  return cache->bindless_layout != VK_NULL_HANDLE && binding->set == BINDLESS_SET &&
+         bindless_type(binding->binding) == (int)binding->type;
+}
+
+static bool is_uniform_ring(const LayoutCache* cache, const SpirvBinding* binding) {
+  return cache->uniform_layout != VK_NULL_HANDLE && binding->set == UNIFORM_RING_SET && binding->binding == 0 &&
+         binding->type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+}
+
+// Unions the stages' bindings, sorted by set and binding. Fails on conflicting types.
+static bool merge_bindings(const SpirvReflection* stages, uint32_t stage_count, SpirvBinding* merged,
+                           uint32_t* merged_count, uint32_t* push_size) {
+  *merged_count = 0;
+  *push_size = 0;
+  for (uint32_t s = 0; s < stage_count; ++s) {
+    *push_size = MAX(*push_size, stages[s].push_constant_size);
+    for (uint32_t b = 0; b < stages[s].binding_count; ++b) {
+      const SpirvBinding* binding = &stages[s].bindings[b];
+      uint32_t i = 0;
+      while (i < *merged_count && (merged[i].set < binding->set ||
+                                   (merged[i].set == binding->set && merged[i].binding < binding->binding))) {
+        i++;
+      }
+      if (i < *merged_count && merged[i].set == binding->set && merged[i].binding == binding->binding) {
+        if (merged[i].type != binding->type) {
+          fprintf(stderr, "Stages disagree on set %u binding %u\n", binding->set, binding->binding);
+          return false;
+        }
+        merged[i].count = MAX(merged[i].count, binding->count);
+        continue;
+      }
+      if (*merged_count == LAYOUT_CACHE_MAX_BINDINGS) return false;
+      memmove(&merged[i + 1], &merged[i], sizeof(*merged) * (*merged_count - i));
+      merged[i] = *binding;
+      (*merged_count)++;
+    }
+  }
+  return true;
+}
+
+// Called with the lock held.
+static VkResult get_set_layout(LayoutCache* cache, const SpirvBinding* bindings, uint32_t count,
+                               VkDescriptorSetLayout* layout) {
+  VkDescriptorSetLayoutBinding vk_bindings[LAYOUT_CACHE_MAX_BINDINGS];
+  uint32_t key[LAYOUT_CACHE_MAX_BINDINGS * 3];
+  for (uint32_t i = 0; i < count; ++i) {
+    if (bindings[i].count == 0) {
+      fprintf(stderr, "Runtime-sized arrays are only supported in the bindless set (set %u binding %u)\n",
+              bindings[i].set, bindings[i].binding);
+      return VK_ERROR_INITIALIZATION_FAILED;
+    }
+    // Every stage sees every binding, so equal interfaces give equal layouts.
+    vk_bindings[i] = (VkDescriptorSetLayoutBinding){
+        .binding = bindings[i].binding,
+        .descriptorType = bindings[i].type,
+        .descriptorCount = bindings[i].count,
+        .stageFlags = VK_SHADER_STAGE_ALL};
+    key[i * 3] = bindings[i].binding;
+    key[i * 3 + 1] = bindings[i].type;
+    key[i * 3 + 2] = bindings[i].count;
+  }
+  uint32_t key_size = count * 3 * sizeof(*key);
+  uint64_t hash = hash_bytes(FNV_OFFSET, key, key_size);
+
+  for (uint32_t i = 0; i < cache->set_layout_count; ++i) {
+    const CachedSetLayout* cached = &cache->set_layouts[i];
+    if (cached->hash == hash && cached->key_size == key_size && memcmp(cached->key, key, key_size) == 0) {
+      *layout = cached->layout;
+      return VK_SUCCESS;
+    }
+  }
+  if (cache->set_layout_count == LAYOUT_CACHE_MAX_SET_LAYOUTS) return VK_ERROR_TOO_MANY_OBJECTS;
+
+  VkDescriptorSetLayoutCreateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .bindingCount = count,
+      .pBindings = vk_bindings};
+  VK_RETURN(vkCreateDescriptorSetLayout(cache->device, &info, NULL, layout));
+
+  CachedSetLayout* cached = &cache->set_layouts[cache->set_layout_count++];
+  *cached = (CachedSetLayout){.hash = hash, .key_size = key_size, .layout = *layout};
+  memcpy(cached->key, key, key_size);
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t s = 0;
+    while (s < cached->size_count && cached->sizes[s].type != bindings[i].type) s++;
+    if (s == cached->size_count) {
+      if (s == LAYOUT_CACHE_MAX_POOL_SIZES) continue;
+      cached->sizes[cached->size_count++] = (VkDescriptorPoolSize){.type = bindings[i].type};
+    }
+    cached->sizes[s].descriptorCount += bindings[i].count;
+  }
+  return VK_SUCCESS;
+}
+
+// Called with the lock held.
+static VkResult build_layout(LayoutCache* cache, const SpirvBinding* bindings, uint32_t count, uint32_t push_size,
+                             VkPipelineLayout* layout) {
+  VkDescriptorSetLayout set_layouts[LAYOUT_CACHE_MAX_SETS];
+  uint32_t set_count = count > 0 ? bindings[count - 1].set + 1 : 0;
+  if (set_count > LAYOUT_CACHE_MAX_SETS) {
+    fprintf(stderr, "Shader uses set %u, at most %d sets are supported\n", set_count - 1, LAYOUT_CACHE_MAX_SETS);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  uint32_t first = 0;
+  for (uint32_t set = 0; set < set_count; ++set) {
+    uint32_t end = first;
+    bool bindless = true, uniform_ring = true;
+    while (end < count && bindings[end].set == set) {
+      bindless = bindless && is_bindless(cache, &bindings[end]);
+      uniform_ring = uniform_ring && is_uniform_ring(cache, &bindings[end]);
+      end++;
+    }
+    // Sets that match the renderer's own keep its layouts, so they stay bind-compatible.
+    if (end > first && bindless) {
+      set_layouts[set] = cache->bindless_layout;
+    } else if (end > first && uniform_ring) {
+      set_layouts[set] = cache->uniform_layout;
+    } else {
+      VK_RETURN(get_set_layout(cache, &bindings[first], end - first, &set_layouts[set]));
+    }
+    first = end;
+  }
+
+  uint32_t push_range = ALIGN_FORWARD(push_size, 4u);
+  uint64_t hash = hash_bytes(FNV_OFFSET, set_layouts, sizeof(*set_layouts) * set_count);
+  hash = hash_bytes(hash, &push_range, sizeof(push_range));
+  for (uint32_t i = 0; i < cache->pipeline_layout_count; ++i) {
+    const CachedPipelineLayout* cached = &cache->pipeline_layouts[i];
+    if (cached->hash == hash && cached->set_count == set_count && cached->push_range == push_range &&
+        memcmp(cached->set_layouts, set_layouts, sizeof(*set_layouts) * set_count) == 0) {
+      *layout = cached->layout;
+      return VK_SUCCESS;
+    }
+  }
+  if (cache->pipeline_layout_count == LAYOUT_CACHE_MAX_PIPELINE_LAYOUTS) return VK_ERROR_TOO_MANY_OBJECTS;
+
+  VkPushConstantRange range = {.stageFlags = VK_SHADER_STAGE_ALL, .offset = 0, .size = push_range};
+  VkPipelineLayoutCreateInfo info = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount = set_count,
+      .pSetLayouts = set_layouts,
+      .pushConstantRangeCount = push_range > 0 ? 1 : 0,
+      .pPushConstantRanges = &range};
+  VK_RETURN(vkCreatePipelineLayout(cache->device, &info, NULL, layout));
+  CachedPipelineLayout* cached = &cache->pipeline_layouts[cache->pipeline_layout_count++];
+  *cached = (CachedPipelineLayout){.hash = hash, .set_count = set_count, .push_range = push_range, .layout = *layout};
+  memcpy(cached->set_layouts, set_layouts, sizeof(*set_layouts) * set_count);
+  return VK_SUCCESS;
+}
+
+VkResult layout_cache_get(LayoutCache* cache, const SpirvReflection* stages, uint32_t stage_count,
+                          VkPipelineLayout* layout) {
+  SpirvBinding bindings[LAYOUT_CACHE_MAX_BINDINGS];
+  uint32_t count, push_size;
+  if (stage_count > 2 || !merge_bindings(stages, stage_count, bindings, &count, &push_size)) {
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  bool shared = push_size <= BINDLESS_PUSH_CONSTANT_SIZE;
+  for (uint32_t i = 0; i < count && shared; ++i) {
+    shared = is_bindless(cache, &bindings[i]) || is_uniform_ring(cache, &bindings[i]);
+  }
+  if (shared) {
+    *layout = cache->shared_layout;
+    return VK_SUCCESS;
+  }
+
+  mutex_lock(cache->lock);
+  VkResult res = build_layout(cache, bindings, count, push_size, layout);
+  mutex_unlock(cache->lock);
+  if (res != VK_SUCCESS) fprintf(stderr, "Failed to create a reflected pipeline layout!\n");
+  return res;
+}
+
+bool layout_cache_pool_sizes(LayoutCache* cache, VkDescriptorSetLayout layout, VkDescriptorPoolSize* sizes,
+                             uint32_t* size_count) {
+  bool found = false;
+  mutex_lock(cache->lock);
+  for (uint32_t i = 0; i < cache->set_layout_count && !found; ++i) {
+    const CachedSetLayout* cached = &cache->set_layouts[i];
+    if (cached->layout != layout) continue;
+    memcpy(sizes, cached->sizes, sizeof(*sizes) * cached->size_count);
+    *size_count = cached->size_count;
+    found = true;
+  }
+  mutex_unlock(cache->lock);
+  return found;
+}
+
+void layout_cache_destroy(LayoutCache* cache) {
+  for (uint32_t i = 0; i < cache->pipeline_layout_count; ++i) {
+    vkDestroyPipelineLayout(cache->device, cache->pipeline_layouts[i].layout, NULL);
+  }
+  for (uint32_t i = 0; i < cache->set_layout_count; ++i) {
+    vkDestroyDescriptorSetLayout(cache->device, cache->set_layouts[i].layout, NULL);
+  }
+  for (uint32_t i = 0; i < cache->shader_count; ++i) free(cache->shaders[i].words);
+  free(cache->shaders);
+  if (cache->lock) mutex_destroy(cache->lock);
+  memset(cache, 0, sizeof(*cache));
+}
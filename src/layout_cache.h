@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "spirv_reflect.h"
+#include "thread.h"
+
+#define LAYOUT_CACHE_MAX_SHADERS 128
+#define LAYOUT_CACHE_MAX_SET_LAYOUTS 64
+#define LAYOUT_CACHE_MAX_PIPELINE_LAYOUTS 64
+#define LAYOUT_CACHE_MAX_SETS 4
+#define LAYOUT_CACHE_MAX_POOL_SIZES 11  // one per core descriptor type
+#define LAYOUT_CACHE_MAX_BINDINGS (SPIRV_MAX_BINDINGS * 2)  // both stages' bindings merged
+
+// Every entry keeps what its hash was computed from, and a lookup compares it on a hash
+// match, so a collision cannot return another shader's layout.
+typedef struct {
+  uint64_t hash;  // of the SPIR-V words
+  uint32_t* words;
+  size_t word_count;
+  SpirvReflection reflection;
+} CachedReflection;
+
+typedef struct {
+  uint64_t hash;
+  uint32_t key[LAYOUT_CACHE_MAX_BINDINGS * 3];  // binding, type, count of each binding
+  uint32_t key_size;  // bytes
+  VkDescriptorSetLayout layout;
+  // Descriptors one set of this layout needs, per type, for sizing pools.
+  VkDescriptorPoolSize sizes[LAYOUT_CACHE_MAX_POOL_SIZES];
+  uint32_t size_count;
+} CachedSetLayout;
+
+typedef struct {
+  uint64_t hash;
+  VkDescriptorSetLayout set_layouts[LAYOUT_CACHE_MAX_SETS];
+  uint32_t set_count;
+  uint32_t push_range;
+  VkPipelineLayout layout;
+} CachedPipelineLayout;
+
+// Pipeline layouts built from SPIR-V reflection. Shaders that stay within the renderer's
+// conventions (bindless set 0, uniform ring set 1, one push constant block of at most
+// BINDLESS_PUSH_CONSTANT_SIZE) all get the shared layout, so switching between them
+// keeps every set bound. Anything else gets generated set and pipeline layouts, declared
+// for every stage and deduplicated by content, so shaders with equal interfaces still
+// share one layout. Reflection results are cached by a hash of the module words. Safe
+// to call from the pipeline manager's workers.
+typedef struct {
+  VkDevice device;
+  VkPipelineLayout shared_layout;
+  VkDescriptorSetLayout bindless_layout;  // VK_NULL_HANDLE without bindless
+  VkDescriptorSetLayout uniform_layout;
+  CachedReflection* shaders;
+  uint32_t shader_count;
+  CachedSetLayout set_layouts[LAYOUT_CACHE_MAX_SET_LAYOUTS];
+  uint32_t set_layout_count;
+  CachedPipelineLayout pipeline_layouts[LAYOUT_CACHE_MAX_PIPELINE_LAYOUTS];
+  uint32_t pipeline_layout_count;
+  Mutex* lock;
+} LayoutCache;
+
+VkResult layout_cache_init(LayoutCache* cache, VkDevice device, VkPipelineLayout shared_layout,
+                           VkDescriptorSetLayout bindless_layout, VkDescriptorSetLayout uniform_layout);
+// Reflects the module, or returns the cached result for identical words.
+bool layout_cache_reflect(LayoutCache* cache, const uint32_t* words, size_t word_count, SpirvReflection* reflection);
+// The pipeline layout for one or two stages; owned by the cache.
+VkResult layout_cache_get(LayoutCache* cache, const SpirvReflection* stages, uint32_t stage_count,
+                          VkPipelineLayout* layout);
+// Descriptor counts per type for one set of a generated set layout; false for layouts
+// the cache did not create (bindless and uniform ring sets are allocated by their owners).
+bool layout_cache_pool_sizes(LayoutCache* cache, VkDescriptorSetLayout layout, VkDescriptorPoolSize* sizes,
+                             uint32_t* size_count);
+void layout_cache_destroy(LayoutCache* cache);
@@ -1,34 +1,308 @@
+#include <math.h>
+#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include "input.h"
+#include "input_record.h"
 #include "render.h"
+#include "render_null.h"
+#include "render_vulkan.h"
 #include "window.h"
 
 #define WIDTH 800
 #define HEIGHT 600
+#define CAMERA_SPEED 400.0f  // world units per second at zoom 1
+#define BENCH_WARMUP_FRAMES 30  // pipeline compiles and first uploads, excluded from timings
+#define SPRITE_SIZE 32
+#define SPRITE_SPACING 40.0f
 
-int main(void) {
-  Window* window = window_create(&(WindowDesc){
-      .width = WIDTH,
-      .height = HEIGHT,
-      .title = "Vulkan",
-      .resizable = false,
-  });
+// `--bench FRAMES OUT` renders a fixed number of frames without live input at full resolution,
+// then writes the last frame to OUT.png and the measurements to OUT.txt (see `make test`).
+typedef struct {
+  uint64_t frames;
+  const char* out;
+} Bench;
+
+typedef struct {
+  float frame_ms;
+  float gpu_ms;
+  uint32_t memory_allocations;
+  uint32_t memory_allocations_live;
+  uint64_t memory_bytes;
+} BenchStats;
+
+// `--windows N` opens N windows driven by the same device, e.g. one per monitor.
+static uint32_t parse_window_count(int argc, char** argv) {
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (strcmp(argv[i], "--windows") == 0) {
+      return (uint32_t)CLAMP(atoi(argv[i + 1]), 1, VK_MAX_WINDOWS);
+    }
+  }
+  return 1;
+}
+
+// `--capture DIR` writes every frame of the first window to DIR/frame_NNNNNN.png.
+static const char* parse_capture_dir(int argc, char** argv) {
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (strcmp(argv[i], "--capture") == 0) return argv[i + 1];
+  }
+  return NULL;
+}
+
+// `--null-backend` renders through the null backend instead of Vulkan: no device is
+// created and frames are only recorded into memory, so with --bench the frame time is
+// the engine's own CPU cost. No image is written.
+static bool parse_null_backend(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--null-backend") == 0) return true;
+  }
+  return false;
+}
+
+// `--any-device` accepts integrated, virtual and CPU Vulkan devices when there is no
+// discrete GPU, so `make test` can render on lavapipe.
+static bool parse_any_device(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "--any-device") == 0) return true;
+  }
+  return false;
+}
+
+// `--particles RATE` adds a fountain at the origin spawning RATE GPU particles per second.
+static float parse_particle_rate(int argc, char** argv) {
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (strcmp(argv[i], "--particles") == 0) return MAX(strtof(argv[i + 1], NULL), 0.0f);
+  }
+  return 0.0f;
+}
+
+// `--sprites COUNT` draws a grid of COUNT sprites around the origin, alternating between
+// two layers, all from one generated image in the backend's sprite atlas.
+static uint32_t parse_sprite_count(int argc, char** argv) {
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (strcmp(argv[i], "--sprites") == 0) return (uint32_t)CLAMP(atoi(argv[i + 1]), 0, MAX_QUADS_PER_FRAME);
+  }
+  return 0;
+}
+
+static Bench parse_bench(int argc, char** argv) {
+  for (int i = 1; i + 2 < argc; ++i) {
+    if (strcmp(argv[i], "--bench") == 0) return (Bench){.frames = strtoull(argv[i + 1], NULL, 10), .out = argv[i + 2]};
+  }
+  return (Bench){0};
+}
+
+// `--camera X Y ZOOM` sets the starting camera, so tests can frame fixed scenes.
+static Camera parse_camera(int argc, char** argv) {
+  for (int i = 1; i + 3 < argc; ++i) {
+    if (strcmp(argv[i], "--camera") == 0) {
+      float zoom = strtof(argv[i + 3], NULL);
+      return (Camera){.x = strtof(argv[i + 1], NULL), .y = strtof(argv[i + 2], NULL), .zoom = zoom > 0.0f ? zoom : 1.0f};
+    }
+  }
+  return (Camera){.zoom = 1.0f};
+}
+
+// `--record FILE` saves every frame's input and delta time; `--replay FILE` plays them
+// back instead of live input and exits when the recording ends.
+static InputRecordMode parse_input_record(int argc, char** argv, const char** path) {
+  for (int i = 1; i + 1 < argc; ++i) {
+    if (strcmp(argv[i], "--record") == 0 || strcmp(argv[i], "--replay") == 0) {
+      *path = argv[i + 1];
+      return strcmp(argv[i], "--record") == 0 ? INPUT_RECORD_WRITE : INPUT_RECORD_REPLAY;
+    }
+  }
+  return INPUT_RECORD_OFF;
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// A soft-edged ring, so filtering and the atlas gutters are visible.
+static uint32_t add_ring_sprite(RenderContext* render) {
+  uint8_t pixels[SPRITE_SIZE * SPRITE_SIZE * 4];
+  for (uint32_t y = 0; y < SPRITE_SIZE; ++y) {
+    for (uint32_t x = 0; x < SPRITE_SIZE; ++x) {
+      float dx = (float)x + 0.5f - SPRITE_SIZE * 0.5f, dy = (float)y + 0.5f - SPRITE_SIZE * 0.5f;
+      float distance = sqrtf(dx * dx + dy * dy) / (SPRITE_SIZE * 0.5f);
+      float alpha = CLAMP(1.0f - fabsf(distance - 0.7f) * 5.0f, 0.0f, 1.0f);
+      uint8_t* pixel = &pixels[(y * SPRITE_SIZE + x) * 4];
+      pixel[0] = (uint8_t)(255.0f * (float)x / SPRITE_SIZE);
+      pixel[1] = (uint8_t)(255.0f * (float)y / SPRITE_SIZE);
+      pixel[2] = 255;
+      pixel[3] = (uint8_t)(255.0f * alpha);
+    }
+  }
+  return render_add_sprite(render, pixels, SPRITE_SIZE, SPRITE_SIZE);
+}
+
+static void draw_sprites(RenderContext* render, uint32_t sprite, uint32_t count) {
+  Quad quad = {.width = SPRITE_SIZE, .height = SPRITE_SIZE, .color = {1.0f, 1.0f, 1.0f, 1.0f}};
+  if (!render_sprite_quad(render, sprite, &quad)) return;
+  uint32_t columns = (uint32_t)ceilf(sqrtf((float)count));
+  for (uint32_t i = 0; i < count; ++i) {
+    quad.x = ((float)(i % columns) - (float)columns * 0.5f) * SPRITE_SPACING;
+    quad.y = ((float)(i / columns) - (float)columns * 0.5f) * SPRITE_SPACING;
+    quad.layer = i & 1;
+    render_draw_quad(render, &quad);
+  }
+}
+
+// WASD pans the camera; y grows downward like the Vulkan clip space.
+static void update_camera(Input* input, Camera* camera, float dt) {
+  float step = CAMERA_SPEED * dt / camera->zoom;
+  if (input_is_key_down(input, KEY_W)) camera->y -= step;
+  if (input_is_key_down(input, KEY_S)) camera->y += step;
+  if (input_is_key_down(input, KEY_A)) camera->x -= step;
+  if (input_is_key_down(input, KEY_D)) camera->x += step;
+}
+
+static bool write_bench_stats(const Bench* bench, const BenchStats* stats) {
+  char path[CAPTURE_MAX_PATH];
+  snprintf(path, sizeof(path), "%s.txt", bench->out);
+  FILE* fp = fopen(path, "w");
+  if (!fp) {
+    fprintf(stderr, "Failed to write '%s'\n", path);
+    return false;
+  }
+  fprintf(fp, "frame_ms %.4f\n", stats->frame_ms);
+  fprintf(fp, "gpu_ms %.4f\n", stats->gpu_ms);
+  fprintf(fp, "memory_allocations %u\n", stats->memory_allocations);
+  fprintf(fp, "memory_allocations_live %u\n", stats->memory_allocations_live);
+  fprintf(fp, "memory_bytes %llu\n", (unsigned long long)stats->memory_bytes);
+  fclose(fp);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  uint32_t window_count = parse_window_count(argc, argv);
+  const char* capture_dir = parse_capture_dir(argc, argv);
+  Bench bench = parse_bench(argc, argv);
+  bool null_backend = parse_null_backend(argc, argv);
+  float particle_rate = parse_particle_rate(argc, argv);
+  uint32_t sprite_count = parse_sprite_count(argc, argv);
+  const char* record_path = NULL;
+  InputRecordMode record_mode = parse_input_record(argc, argv, &record_path);
+  Window* windows[VK_MAX_WINDOWS] = {0};
+  for (uint32_t i = 0; i < window_count; ++i) {
+    windows[i] = window_create(&(WindowDesc){
+        .width = WIDTH,
+        .height = HEIGHT,
+        .title = "Vulkan",
+        .resizable = false,
+    });
+  }
+  Window* window = windows[0];
   Input* input = input_create(window_get_handle(window));
+  InputRecorder recorder;
+  if (!input_record_open(&recorder, record_path, record_mode)) return 1;
 
-  VkContext* ctx = malloc(sizeof(*ctx));
-  vk_init(window, ctx);
+  VkContext* ctx = NULL;
+  VulkanRenderer vulkan;
+  NullRenderer null_renderer;
+  RenderBackend* backend = &null_renderer.base;
+  if (null_backend) {
+    null_renderer_init(&null_renderer, WIDTH, HEIGHT, window_count);
+  } else {
+    ctx = malloc(sizeof(*ctx));
+    if (vk_init(window, parse_any_device(argc, argv), ctx) != VK_SUCCESS) return 1;
+    for (uint32_t i = 1; i < window_count; ++i) {
+      vk_add_window(ctx, windows[i]);
+    }
+    if (vulkan_renderer_init(&vulkan, ctx) != VK_SUCCESS) return 1;
+    backend = &vulkan.base;
+  }
 
   RenderContext render;
-  render_init(&render, ctx);
+  if (!render_init(&render, backend)) return 1;
+  uint32_t sprite = sprite_count ? add_ring_sprite(&render) : RENDER_INVALID_SPRITE;
+  if (sprite_count && sprite == RENDER_INVALID_SPRITE) fprintf(stderr, "No room for sprites\n");
+
+  Camera camera = parse_camera(argc, argv);
+  double last_time = now_seconds();
+  uint64_t frame = 0;
+  double bench_start = 0.0;
+  bool overlay = false;
+  bool overlay_key = false;
+  if (bench.frames) render_set_resolution_scale(&render, 1.0f);
 
+  // Events are polled for the whole process, so closing any window lands here.
   while (!window_should_close(window)) {
+    if (bench.frames && frame == bench.frames) break;
     window_poll_events(window);
-    input_update(input);
+    if (record_mode != INPUT_RECORD_REPLAY) input_update(input);
+
+    double time = now_seconds();
+    float dt = (float)(time - last_time);
+    if (!input_record_frame(&recorder, input, &dt)) break;
+    // A replay drives the camera even in bench mode, that is what it is for.
+    if (!bench.frames || record_mode == INPUT_RECORD_REPLAY) update_camera(input, &camera, dt);
+    last_time = time;
+    // F3 toggles the performance overlay.
+    bool key = input_is_key_down(input, KEY_F3);
+    if (key && !overlay_key) {
+      overlay = !overlay;
+      render_set_overlay(&render, overlay);
+    }
+    overlay_key = key;
+    if (frame == BENCH_WARMUP_FRAMES) bench_start = time;
+    render_set_camera(&render, &camera);
+    render_set_time_step(&render, dt);
+    if (particle_rate > 0.0f) {
+      render_emit_particles(&render, &(ParticleEmitter){
+          .position_spread = 4.0f,
+          .velocity = {0.0f, -300.0f, 0.0f},
+          .velocity_spread = 80.0f,
+          .color = {1.0f, 0.6f, 0.2f, 1.0f},
+          .rate = particle_rate,
+          .lifetime = 2.0f,
+          .size = 4.0f});
+    }
+    if (sprite != RENDER_INVALID_SPRITE) draw_sprites(&render, sprite, sprite_count);
+    if (bench.frames && frame + 1 == bench.frames) {
+      CaptureRequest request = {.format = CAPTURE_FORMAT_PNG};
+      snprintf(request.path, sizeof(request.path), "%s.png", bench.out);
+      render_capture(&render, &request);
+    } else if (capture_dir) {
+      CaptureRequest request = {.format = CAPTURE_FORMAT_PNG};
+      snprintf(request.path, sizeof(request.path), "%s/frame_%06llu.png", capture_dir, (unsigned long long)frame);
+      render_capture(&render, &request);
+    }
     render_game(&render);
+    frame++;
   }
 
-  vk_cleanup(ctx);
+  BenchStats stats = {0};
+  if (ctx) {
+    stats.memory_allocations = atomic_load(&ctx->memory_allocations);
+    stats.memory_allocations_live = atomic_load(&ctx->memory_allocations_live);
+    stats.memory_bytes = atomic_load(&ctx->memory_allocated_bytes);
+  }
+  if (frame > BENCH_WARMUP_FRAMES) {
+    stats.frame_ms = (float)((now_seconds() - bench_start) * 1000.0 / (double)(frame - BENCH_WARMUP_FRAMES));
+  }
+
+  // Shutting down drains the frames in flight and writes pending captures.
+  render_shutdown(&render);
+  int status = 0;
+  if (bench.frames) {
+    stats.gpu_ms = render.gpu_ms;
+    if (frame <= BENCH_WARMUP_FRAMES) {
+      fprintf(stderr, "Bench needs more than %d frames\n", BENCH_WARMUP_FRAMES);
+      status = 1;
+    } else if (!write_bench_stats(&bench, &stats)) {
+      status = 1;
+    }
+  }
+  if (ctx) vk_cleanup(ctx);
+  input_record_close(&recorder);
   input_destroy(input);
-  window_destroy(window);
-  return 0;
+  for (uint32_t i = 0; i < window_count; ++i) {
+    window_destroy(windows[i]);
+  }
+  return status;
 }
@@ -0,0 +1,99 @@
+#include "mesh.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+VkResult mesh_load(VkContext* ctx, const char* path, Mesh* mesh) {
+  memset(mesh, 0, sizeof(*mesh));
+
+  FILE* file = fopen(path, "rb");
+  if (!file) {
+    fprintf(stderr, "Failed to open mesh '%s'\n", path);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  VkResult res = VK_ERROR_INITIALIZATION_FAILED;
+  void* vertices = NULL;
+  void* indices = NULL;
+  MeshFileHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != MESH_FILE_MAGIC ||
+      header.version != MESH_FILE_VERSION || (header.index_size != 2 && header.index_size != 4) ||
+      header.vertex_count == 0 || header.index_count == 0 || header.index_count % 3 != 0) {
+    fprintf(stderr, "Invalid mesh file '%s'\n", path);
+    goto done;
+  }
+
+  size_t vertex_bytes = sizeof(MeshVertex) * header.vertex_count;
+  size_t index_bytes = (size_t)header.index_size * header.index_count;
+  vertices = malloc(vertex_bytes);
+  indices = malloc(index_bytes);
+  if (fread(vertices, vertex_bytes, 1, file) != 1 || fread(indices, index_bytes, 1, file) != 1) {
+    fprintf(stderr, "Truncated mesh file '%s'\n", path);
+    goto done;
+  }
+
+  res = vk_create_buffer_with_data(ctx, vertices, vertex_bytes, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                   &mesh->vertex_buffer, &mesh->vertex_memory);
+  if (res != VK_SUCCESS) goto done;
+  res = vk_create_buffer_with_data(ctx, indices, index_bytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                                   &mesh->index_buffer, &mesh->index_memory);
+  if (res != VK_SUCCESS) {
+    mesh_destroy(ctx, mesh);
+    goto done;
+  }
+
+  mesh->index_type = header.index_size == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+  mesh->vertex_count = header.vertex_count;
+  mesh->index_count = header.index_count;
+  mesh->radius = header.radius;
+  memcpy(mesh->position_scale, header.position_scale, sizeof(mesh->position_scale));
+  memcpy(mesh->position_offset, header.position_offset, sizeof(mesh->position_offset));
+
+done:
+  free(vertices);
+  free(indices);
+  fclose(file);
+  return res;
+}
+
+void mesh_destroy(VkContext* ctx, Mesh* mesh) {
+  vk_destroy_buffer(ctx, mesh->vertex_buffer, mesh->vertex_memory);
+  vk_destroy_buffer(ctx, mesh->index_buffer, mesh->index_memory);
+  memset(mesh, 0, sizeof(*mesh));
+}
+
+static const VkVertexInputBindingDescription mesh_binding = {
+    .binding = 0,
+    .stride = sizeof(MeshVertex),
+    .inputRate = VK_VERTEX_INPUT_RATE_VERTEX};
+// The fixed-function fetch expands the normalized formats, so the shader sees floats.
+static const VkVertexInputAttributeDescription mesh_attributes[] = {
+    {.location = 0, .binding = 0, .format = VK_FORMAT_R16G16B16A16_UNORM, .offset = offsetof(MeshVertex, position)},
+    {.location = 1, .binding = 0, .format = VK_FORMAT_R16G16_SNORM, .offset = offsetof(MeshVertex, normal)},
+    {.location = 2, .binding = 0, .format = VK_FORMAT_R16G16_SFLOAT, .offset = offsetof(MeshVertex, uv)},
+};
+
+void mesh_pipeline_desc(GraphicsPipelineDesc* desc, uint32_t features) {
+  *desc = (GraphicsPipelineDesc){
+      .vert_path = "shaders/mesh.vert.spv",
+      .frag_path = "shaders/mesh.frag.spv",
+      .vertex_bindings = &mesh_binding,
+      .vertex_binding_count = 1,
+      .vertex_attributes = mesh_attributes,
+      .vertex_attribute_count = (uint32_t)COUNTOF(mesh_attributes),
+      .cull_mode = VK_CULL_MODE_BACK_BIT,
+      // Meshes are authored counter-clockwise; the y-down view flips them on screen.
+      .front_face = VK_FRONT_FACE_CLOCKWISE,
+      .features = features};
+}
+
+void mesh_bind(VkContext* ctx, VkCommandBuffer cmd, const Mesh* mesh, uint32_t objects, uint32_t texture) {
+  MeshPushConstants push = {.objects = objects, .texture = texture};
+  memcpy(push.position_scale, mesh->position_scale, sizeof(mesh->position_scale));
+  memcpy(push.position_offset, mesh->position_offset, sizeof(mesh->position_offset));
+
+  VkDeviceSize offset = 0;
+  vkCmdBindVertexBuffers(cmd, 0, 1, &mesh->vertex_buffer, &offset);
+  vkCmdPushConstants(cmd, ctx->pipeline_layout, VK_SHADER_STAGE_ALL, 0, sizeof(push), &push);
+}
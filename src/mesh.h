@@ -0,0 +1,39 @@
+#pragma once
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "mesh_format.h"
+#include "vk.h"
+
+typedef struct {
+  VkBuffer vertex_buffer;
+  VkDeviceMemory vertex_memory;
+  VkBuffer index_buffer;
+  VkDeviceMemory index_memory;
+  VkIndexType index_type;
+  uint32_t vertex_count;
+  uint32_t index_count;
+  float radius;
+  float position_scale[3];
+  float position_offset[3];
+} Mesh;
+
+// Mirrors the push constant block in shaders/mesh.vert and mesh.frag.
+typedef struct {
+  float position_scale[4];
+  float position_offset[4];
+  uint32_t objects;
+  uint32_t texture;  // bindless image, read with SHADER_FEATURE_TEXTURING
+} MeshPushConstants;
+
+// Loads a file produced by tools/mesh_convert into device-local buffers.
+VkResult mesh_load(VkContext* ctx, const char* path, Mesh* mesh);
+void mesh_destroy(VkContext* ctx, Mesh* mesh);
+
+// Pipeline state for the mesh vertex layout with the given ShaderFeatureBits; build it
+// with vk_create_graphics_pipeline or request it from a PipelineManager. Without
+// SHADER_FEATURE_INSTANCING meshes are drawn at the origin and objects is never read.
+void mesh_pipeline_desc(GraphicsPipelineDesc* desc, uint32_t features);
+// Binds the vertex buffer and the dequantization constants; the camera block must already
+// be bound from the uniform ring and the indexed draw is up to the caller.
+void mesh_bind(VkContext* ctx, VkCommandBuffer cmd, const Mesh* mesh, uint32_t objects, uint32_t texture);
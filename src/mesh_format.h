@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+
+// Binary mesh files written by tools/mesh_convert and read by mesh_load:
+//   MeshFileHeader, vertex_count * MeshVertex, index_count * index_size bytes.
+// Triangles are already reordered for the post-transform vertex cache and for
+// overdraw, and vertices are stored in first-use order, so nothing is processed
+// at load time.
+#define MESH_FILE_MAGIC 0x4853454Du  // "MESH"
+#define MESH_FILE_VERSION 2
+
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t vertex_count;
+  uint32_t index_count;
+  uint32_t index_size;  // 2 or 4
+  // Bounding sphere of the decoded positions; the mesh is centered on it.
+  float radius;
+  // position = position_offset + unorm16 / 65535 * position_scale; the vertex fetch does
+  // the division, see MeshVertex.position.
+  float position_scale[3];
+  float position_offset[3];
+} MeshFileHeader;
+
+// 16 bytes instead of 32 for float position/normal/uv.
+typedef struct {
+  uint16_t position[4];  // R16G16B16A16_UNORM within the bounding box, w unused
+  int16_t normal[2];     // R16G16_SNORM octahedral encoding
+  uint16_t uv[2];        // R16G16_SFLOAT
+} MeshVertex;
@@ -0,0 +1,196 @@
+#include "overlay.h"
+#include <stdio.h>
+#include <string.h>
+
+#define GLYPH_WIDTH 3
+#define GLYPH_HEIGHT 5
+#define SOLID_GLYPH 0x7fffu
+#define MARGIN 8.0f
+#define GRAPH_HEIGHT 48.0f
+
+// Mirrors the push constant block in shaders/overlay.vert.
+typedef struct {
+  uint32_t instances;
+  uint32_t first_instance;
+  float inv_extent[2];
+} OverlayPushConstants;
+
+// 3x5 font for ' '..'_', rows of three bits from the top, bit 14 top-left. Lowercase is
+// drawn as uppercase.
+static const uint16_t font[64] = {
+    0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x52a5, 0x0000, 0x0000,  // ' '..'''
+    0x2922, 0x224a, 0x0000, 0x05d0, 0x0000, 0x01c0, 0x0002, 0x12a4,  // '('..'/'
+    0x7b6f, 0x2c97, 0x73e7, 0x73cf, 0x5bc9, 0x79cf, 0x79ef, 0x7249,  // '0'..'7'
+    0x7bef, 0x7bcf, 0x0410, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // '8'..'?'
+    0x0000, 0x2bed, 0x6bae, 0x3923, 0x6b6e, 0x79a7, 0x79a4, 0x396b,  // '@'..'G'
+    0x5bed, 0x7497, 0x126a, 0x5bad, 0x4927, 0x5fed, 0x6b6d, 0x2b6a,  // 'H'..'O'
+    0x6ba4, 0x2b73, 0x6bad, 0x388e, 0x7492, 0x5b6f, 0x5b6a, 0x5bfd,  // 'P'..'W'
+    0x5aad, 0x5a92, 0x72a7, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,  // 'X'..'_'
+};
+
+typedef struct {
+  OverlayInstance* instances;
+  uint32_t count;
+} Batch;
+
+static uint32_t pack_color(uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+  return (uint32_t)r | (uint32_t)g << 8 | (uint32_t)b << 16 | (uint32_t)a << 24;
+}
+
+static void push_rect(Batch* batch, float x, float y, float width, float height, uint32_t glyph, uint32_t color) {
+  if (batch->count >= OVERLAY_MAX_INSTANCES) return;
+  batch->instances[batch->count++] = (OverlayInstance){
+      .rect = {x, y, width, height},
+      .glyph = glyph,
+      .color = color};
+}
+
+static void push_text(Batch* batch, float x, float y, uint32_t color, const char* text) {
+  const float scale = OVERLAY_GLYPH_SCALE;
+  for (const char* c = text; *c; ++c, x += (GLYPH_WIDTH + 1) * scale) {
+    int ch = *c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c;
+    if (ch < ' ' || ch > '_' || font[ch - ' '] == 0) continue;
+    push_rect(batch, x, y, GLYPH_WIDTH * scale, GLYPH_HEIGHT * scale, font[ch - ' '], color);
+  }
+}
+
+static VkResult create_render_pass(Overlay* overlay) {
+  VkContext* ctx = overlay->ctx;
+  VkAttachmentDescription color_attachment = {
+      .format = ctx->swapchain_image_format,
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .loadOp = VK_ATTACHMENT_LOAD_OP_LOAD,
+      .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+      .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+      .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+      .initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+      .finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  VkAttachmentReference color_attachment_ref = {
+      .attachment = 0,
+      .layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  VkSubpassDescription subpass = {
+      .pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS,
+      .colorAttachmentCount = 1,
+      .pColorAttachments = &color_attachment_ref};
+  VkRenderPassCreateInfo render_pass_info = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+      .attachmentCount = 1,
+      .pAttachments = &color_attachment,
+      .subpassCount = 1,
+      .pSubpasses = &subpass};
+  return vkCreateRenderPass(ctx->device, &render_pass_info, NULL, &overlay->render_pass);
+}
+
+VkResult overlay_init(Overlay* overlay, VkContext* ctx, PipelineManager* pipelines) {
+  memset(overlay, 0, sizeof(*overlay));
+  overlay->ctx = ctx;
+  overlay->pipelines = pipelines;
+  overlay->pipeline = PIPELINE_INVALID_HANDLE;
+
+  if (!ctx->has_bindless) {
+    fprintf(stderr, "Warning: the overlay needs bindless, disabled\n");
+    return VK_SUCCESS;
+  }
+  VkResult res = create_render_pass(overlay);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create overlay render pass!\n");
+    return res;
+  }
+
+  // The swapchain framebuffers were made for ctx->render_pass; this pass only differs in
+  // its load op, so it is compatible with them.
+  overlay->pipeline = pipeline_manager_request(pipelines, &(GraphicsPipelineDesc){
+      .vert_path = "shaders/overlay.vert.spv",
+      .frag_path = "shaders/overlay.frag.spv",
+      .cull_mode = VK_CULL_MODE_NONE,
+      .front_face = VK_FRONT_FACE_CLOCKWISE,
+      .blend = true,
+      .render_pass = overlay->render_pass});
+  return VK_SUCCESS;
+}
+
+void overlay_add_frame_time(Overlay* overlay, float ms) {
+  overlay->history[overlay->history_head] = ms;
+  overlay->history_head = (overlay->history_head + 1) % OVERLAY_HISTORY;
+}
+
+static void build(Overlay* overlay, Batch* batch, const OverlayStats* stats) {
+  const float line_height = (GLYPH_HEIGHT + 2) * OVERLAY_GLYPH_SCALE;
+  const float bar_width = 2.0f;
+  const float width = OVERLAY_HISTORY * bar_width;
+  const uint32_t white = pack_color(255, 255, 255, 255);
+
+  char lines[5][64];
+  snprintf(lines[0], sizeof(lines[0]), "CPU %6.2f MS", stats->cpu_ms);
+  snprintf(lines[1], sizeof(lines[1]), "GPU %6.2f MS", stats->gpu_ms);
+  snprintf(lines[2], sizeof(lines[2]), "DRAWS %u OBJECTS %u", stats->draws, stats->objects);
+  snprintf(lines[3], sizeof(lines[3]), "MEM %u LIVE %.1f MB ALLOCATED", stats->memory_allocations,
+           (double)stats->memory_bytes / (1024.0 * 1024.0));
+  snprintf(lines[4], sizeof(lines[4]), "VRAM %.0f / %.0f MB", (double)stats->heap_usage / (1024.0 * 1024.0),
+           (double)stats->heap_budget / (1024.0 * 1024.0));
+
+  float text_height = COUNTOF(lines) * line_height;
+  push_rect(batch, MARGIN, MARGIN, width + 2 * MARGIN, text_height + GRAPH_HEIGHT + 3 * MARGIN, SOLID_GLYPH,
+            pack_color(0, 0, 0, 160));
+  float y = 2 * MARGIN;
+  for (uint32_t i = 0; i < COUNTOF(lines); ++i, y += line_height) {
+    push_text(batch, 2 * MARGIN, y, white, lines[i]);
+  }
+
+  // Oldest sample on the left; green within a 60 Hz frame, yellow within 30 Hz, red above.
+  float graph_bottom = y + MARGIN + GRAPH_HEIGHT;
+  for (uint32_t i = 0; i < OVERLAY_HISTORY; ++i) {
+    float ms = overlay->history[(overlay->history_head + i) % OVERLAY_HISTORY];
+    float height = MIN(ms / OVERLAY_GRAPH_MAX_MS, 1.0f) * GRAPH_HEIGHT;
+    if (height <= 0.0f) continue;
+    uint32_t color = ms <= 16.7f ? pack_color(64, 220, 96, 255)
+                     : ms <= 33.3f ? pack_color(240, 200, 64, 255)
+                                   : pack_color(240, 64, 64, 255);
+    push_rect(batch, 2 * MARGIN + i * bar_width, graph_bottom - height, bar_width, height, SOLID_GLYPH, color);
+  }
+  float budget_y = graph_bottom - 16.7f / OVERLAY_GRAPH_MAX_MS * GRAPH_HEIGHT;
+  push_rect(batch, 2 * MARGIN, budget_y, width, 1.0f, SOLID_GLYPH, pack_color(255, 255, 255, 96));
+}
+
+void overlay_draw(Overlay* overlay, VkCommandBuffer cmd, VkFramebuffer framebuffer, VkExtent2D extent,
+                  const OverlayStats* stats) {
+  VkContext* ctx = overlay->ctx;
+  VkPipeline pipeline = pipeline_manager_get(overlay->pipelines, overlay->pipeline, VK_NULL_HANDLE);
+  if (pipeline == VK_NULL_HANDLE) return;
+
+  // Instances are indexed from the start of the ring buffer, so the batch is aligned to one.
+  uint32_t offset;
+  uint8_t* data = uniform_ring_alloc(&ctx->uniforms, sizeof(OverlayInstance) * (OVERLAY_MAX_INSTANCES + 1), &offset);
+  if (!data) return;
+  uint32_t skip = (uint32_t)(ALIGN_FORWARD(offset, sizeof(OverlayInstance)) - offset);
+  Batch batch = {.instances = (OverlayInstance*)(data + skip)};
+  build(overlay, &batch, stats);
+
+  VkRenderPassBeginInfo render_pass_info = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+      .renderPass = overlay->render_pass,
+      .framebuffer = framebuffer,
+      .renderArea = {.offset = {0, 0}, .extent = extent}};
+  vkCmdBeginRenderPass(cmd, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+
+  VkViewport viewport = {0.0f, 0.0f, (float)extent.width, (float)extent.height, 0.0f, 1.0f};
+  vkCmdSetViewport(cmd, 0, 1, &viewport);
+  VkRect2D scissor = {{0, 0}, extent};
+  vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+  OverlayPushConstants push = {
+      .instances = ctx->uniforms.storage_handle,
+      .first_instance = (offset + skip) / (uint32_t)sizeof(OverlayInstance),
+      .inv_extent = {1.0f / (float)extent.width, 1.0f / (float)extent.height}};
+  vkCmdPushConstants(cmd, ctx->pipeline_layout, VK_SHADER_STAGE_ALL, 0, sizeof(push), &push);
+  vkCmdDraw(cmd, 6, batch.count, 0, 0);
+  vkCmdEndRenderPass(cmd);
+}
+
+void overlay_destroy(Overlay* overlay) {
+  VkContext* ctx = overlay->ctx;
+  if (!ctx) return;
+  if (overlay->render_pass != VK_NULL_HANDLE) vkDestroyRenderPass(ctx->device, overlay->render_pass, NULL);
+  memset(overlay, 0, sizeof(*overlay));
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "pipeline_manager.h"
+#include "vk.h"
+
+#define OVERLAY_MAX_INSTANCES 1024
+#define OVERLAY_HISTORY 128    // frame times in the graph
+#define OVERLAY_GLYPH_SCALE 3  // screen pixels per font pixel
+#define OVERLAY_GRAPH_MAX_MS 33.3f
+
+// One untextured rect, for text glyphs and graph bars alike. Mirrors shaders/overlay.vert.
+typedef struct {
+  float rect[4];
+  uint32_t glyph;
+  uint32_t color;
+  uint32_t pad[2];
+} OverlayInstance;
+
+typedef struct {
+  float cpu_ms;
+  float gpu_ms;
+  uint32_t draws;
+  uint32_t objects;
+  uint32_t memory_allocations;  // live
+  uint64_t memory_bytes;  // allocated since start
+  uint64_t heap_usage;  // device-local heaps
+  uint64_t heap_budget;
+} OverlayStats;
+
+// Performance HUD drawn over the backbuffer. The font is a 3x5 bitmap stored in each
+// instance, so all text, the graph and the panel go out as a single instanced draw from
+// the uniform ring, with no texture or vertex buffer.
+typedef struct {
+  VkContext* ctx;
+  PipelineManager* pipelines;
+  uint32_t pipeline;
+  VkRenderPass render_pass;  // loads the backbuffer instead of clearing it
+  float history[OVERLAY_HISTORY];
+  uint32_t history_head;
+} Overlay;
+
+VkResult overlay_init(Overlay* overlay, VkContext* ctx, PipelineManager* pipelines);
+void overlay_add_frame_time(Overlay* overlay, float ms);
+// Builds the HUD for a window and draws it into its framebuffer, which must be in
+// COLOR_ATTACHMENT_OPTIMAL. Does nothing until the pipeline has been built.
+void overlay_draw(Overlay* overlay, VkCommandBuffer cmd, VkFramebuffer framebuffer, VkExtent2D extent,
+                  const OverlayStats* stats);
+void overlay_destroy(Overlay* overlay);
@@ -0,0 +1,285 @@
+#include "particles.h"
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Mirrors GpuParticleEmitter in shaders/particles.glsl (std430).
+typedef struct {
+  float position_spread[4];
+  float velocity_spread[4];
+  float color[4];
+  float lifetime;
+  float size;
+  uint32_t first;  // first spawn thread of this emitter
+  uint32_t count;
+} GpuParticleEmitter;
+
+// Mirrors the push constant block in shaders/particle_emit.comp.
+typedef struct {
+  uint32_t positions;
+  uint32_t velocities;
+  uint32_t colors;
+  uint32_t dead;
+  uint32_t alive;
+  uint32_t counters;
+  uint32_t emitters;
+  uint32_t first_emitter;
+  uint32_t emitter_count;
+  uint32_t spawn_count;
+  uint32_t seed;
+} ParticleEmitPushConstants;
+
+// Mirrors the push constant block in shaders/particle_update.comp.
+typedef struct {
+  float gravity_dt[4];
+  uint32_t positions;
+  uint32_t velocities;
+  uint32_t dead;
+  uint32_t alive_in;
+  uint32_t alive_out;
+  uint32_t counters;
+} ParticleUpdatePushConstants;
+
+// Mirrors the push constant block in shaders/particle.vert.
+typedef struct {
+  uint32_t positions;
+  uint32_t velocities;
+  uint32_t colors;
+  uint32_t alive;
+} ParticleDrawPushConstants;
+
+static void simulate(VkCommandBuffer cmd, void* user_data);
+
+VkResult particles_init(ParticleSystem* system, VkContext* ctx, PipelineManager* pipelines, AsyncCompute* compute) {
+  memset(system, 0, sizeof(*system));
+  system->ctx = ctx;
+  system->pipelines = pipelines;
+  system->pipeline = PIPELINE_INVALID_HANDLE;
+  for (uint32_t i = 0; i < PARTICLE_BUFFER_COUNT; ++i) {
+    system->handles[i] = BINDLESS_INVALID_HANDLE;
+  }
+
+  if (!ctx->has_bindless) {
+    fprintf(stderr, "Warning: GPU particles need bindless, disabled\n");
+    return VK_SUCCESS;
+  }
+  VkResult res;
+  if ((res = vk_create_compute_pipeline(ctx, "shaders/particle_emit.comp.spv", ctx->pipeline_layout,
+                                        &system->emit_pipeline)) != VK_SUCCESS ||
+      (res = vk_create_compute_pipeline(ctx, "shaders/particle_prepare.comp.spv", ctx->pipeline_layout,
+                                        &system->prepare_pipeline)) != VK_SUCCESS ||
+      (res = vk_create_compute_pipeline(ctx, "shaders/particle_update.comp.spv", ctx->pipeline_layout,
+                                        &system->update_pipeline)) != VK_SUCCESS) {
+    particles_destroy(system);
+    fprintf(stderr, "Warning: GPU particles disabled\n");
+    return res;
+  }
+  system->pipeline = pipeline_manager_request(pipelines, &(GraphicsPipelineDesc){
+      .vert_path = "shaders/particle.vert.spv",
+      .frag_path = "shaders/particle.frag.spv",
+      .cull_mode = VK_CULL_MODE_NONE,
+      .front_face = VK_FRONT_FACE_CLOCKWISE,
+      .blend = true});
+
+  // The update reads the alive list the previous frame drew, and rewrites particle state
+  // its vertex shader read.
+  async_compute_add_job(compute, &(ComputeJob){
+      .record = simulate,
+      .user_data = system,
+      .consumer_stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+      .after_previous_frame = true});
+  system->enabled = true;
+  return VK_SUCCESS;
+}
+
+// Every slot starts on the dead list. Blocks on one upload, once.
+static VkResult allocate_buffers(ParticleSystem* system) {
+  VkContext* ctx = system->ctx;
+  VkBufferUsageFlags storage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+  const VkDeviceSize sizes[PARTICLE_BUFFER_COUNT] = {
+      [PARTICLE_BUFFER_POSITIONS] = sizeof(float) * 4 * PARTICLES_MAX,
+      [PARTICLE_BUFFER_VELOCITIES] = sizeof(float) * 4 * PARTICLES_MAX,
+      [PARTICLE_BUFFER_COLORS] = sizeof(uint32_t) * PARTICLES_MAX,
+      [PARTICLE_BUFFER_ALIVE_0] = sizeof(uint32_t) * PARTICLES_MAX,
+      [PARTICLE_BUFFER_ALIVE_1] = sizeof(uint32_t) * PARTICLES_MAX,
+      [PARTICLE_BUFFER_DEAD] = sizeof(uint32_t) * PARTICLES_MAX,
+      [PARTICLE_BUFFER_COUNTERS] = sizeof(ParticleCounters),
+      [PARTICLE_BUFFER_EMITTERS] = sizeof(GpuParticleEmitter) * RENDER_MAX_EMITTERS * MAX_FRAMES_IN_FLIGHT};
+
+  VkResult res = VK_SUCCESS;
+  for (uint32_t i = PARTICLE_BUFFER_POSITIONS; i <= PARTICLE_BUFFER_ALIVE_1 && res == VK_SUCCESS; ++i) {
+    res = vk_create_buffer(ctx, sizes[i], storage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &system->buffers[i],
+                           &system->memory[i]);
+  }
+  if (res != VK_SUCCESS) return res;
+
+  // Emitters are rewritten every frame, so they stay in host-visible memory.
+  VkMemoryPropertyFlags host_visible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  VK_RETURN(vk_create_buffer(ctx, sizes[PARTICLE_BUFFER_EMITTERS], storage, host_visible,
+                             &system->buffers[PARTICLE_BUFFER_EMITTERS], &system->memory[PARTICLE_BUFFER_EMITTERS]));
+  VK_RETURN(vkMapMemory(ctx->device, system->memory[PARTICLE_BUFFER_EMITTERS], 0, sizes[PARTICLE_BUFFER_EMITTERS], 0,
+                        &system->emitter_data));
+
+  uint32_t* dead = malloc(sizes[PARTICLE_BUFFER_DEAD]);
+  if (!dead) return VK_ERROR_OUT_OF_HOST_MEMORY;
+  for (uint32_t i = 0; i < PARTICLES_MAX; ++i) {
+    dead[i] = PARTICLES_MAX - 1 - i;
+  }
+  res = vk_create_buffer_with_data(ctx, dead, sizes[PARTICLE_BUFFER_DEAD], storage,
+                                   &system->buffers[PARTICLE_BUFFER_DEAD], &system->memory[PARTICLE_BUFFER_DEAD]);
+  free(dead);
+  if (res != VK_SUCCESS) return res;
+
+  ParticleCounters counters = {
+      .dead_count = (int32_t)PARTICLES_MAX,
+      .update = {.x = 0, .y = 1, .z = 1},
+      .draw = {.vertexCount = 6}};
+  VK_RETURN(vk_create_buffer_with_data(ctx, &counters, sizeof(counters), storage | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                                       &system->buffers[PARTICLE_BUFFER_COUNTERS],
+                                       &system->memory[PARTICLE_BUFFER_COUNTERS]));
+
+  for (uint32_t i = 0; i < PARTICLE_BUFFER_COUNT; ++i) {
+    system->handles[i] = bindless_add_buffer(&ctx->bindless, system->buffers[i], 0, sizes[i]);
+  }
+  system->allocated = true;
+  return VK_SUCCESS;
+}
+
+void particles_begin_frame(ParticleSystem* system, const ParticleEmitter* emitters, uint32_t emitter_count, float dt) {
+  system->spawn_count = 0;
+  system->emitter_count = 0;
+  system->dt = CLAMP(dt, 0.0f, PARTICLES_MAX_DT);
+  system->seed++;
+  if (!system->enabled) return;
+  if (!system->allocated && emitter_count > 0 && allocate_buffers(system) != VK_SUCCESS) {
+    fprintf(stderr, "Failed to allocate particle buffers, GPU particles disabled\n");
+    particles_destroy(system);
+    return;
+  }
+  if (!system->allocated) return;
+  system->output ^= 1;
+  emitter_count = MIN(emitter_count, RENDER_MAX_EMITTERS);
+  if (emitter_count == 0) return;
+
+  // The fence wait in acquire covers the last compute job that read this slot.
+  system->first_emitter = system->ctx->current_frame * RENDER_MAX_EMITTERS;
+  GpuParticleEmitter* gpu = (GpuParticleEmitter*)system->emitter_data + system->first_emitter;
+  for (uint32_t i = 0; i < emitter_count; ++i) {
+    const ParticleEmitter* emitter = &emitters[i];
+    float spawn = system->carry[i] + MAX(emitter->rate, 0.0f) * system->dt;
+    uint32_t count = (uint32_t)MIN(floorf(spawn), (float)(PARTICLES_MAX - system->spawn_count));
+    system->carry[i] = spawn - (float)count;
+    gpu[i] = (GpuParticleEmitter){
+        .position_spread = {emitter->position[0], emitter->position[1], emitter->position[2], emitter->position_spread},
+        .velocity_spread = {emitter->velocity[0], emitter->velocity[1], emitter->velocity[2], emitter->velocity_spread},
+        .lifetime = emitter->lifetime,
+        .size = emitter->size,
+        .first = system->spawn_count,
+        .count = count};
+    memcpy(gpu[i].color, emitter->color, sizeof(gpu[i].color));
+    system->spawn_count += count;
+  }
+  system->emitter_count = emitter_count;
+}
+
+static void compute_barrier(VkCommandBuffer cmd, VkPipelineStageFlags dst_stages, VkAccessFlags dst_access) {
+  VkMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+      .dstAccessMask = dst_access};
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, dst_stages, 0, 1, &barrier, 0, NULL, 0, NULL);
+}
+
+// Emit into the input list, turn its count into the update's dispatch size, then update
+// and compact into the output list.
+static void simulate(VkCommandBuffer cmd, void* user_data) {
+  ParticleSystem* system = user_data;
+  VkContext* ctx = system->ctx;
+  if (!system->allocated) return;
+  const uint32_t* handles = system->handles;
+  uint32_t alive_in = handles[PARTICLE_BUFFER_ALIVE_0 + (system->output ^ 1)];
+  uint32_t alive_out = handles[PARTICLE_BUFFER_ALIVE_0 + system->output];
+
+  // On the graphics queue nothing else orders the previous frame's update and draw
+  // before this frame's writes; on the compute queue the timeline wait does.
+  if (!ctx->has_async_compute) {
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT};
+    vkCmdPipelineBarrier(cmd,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT |
+                             VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL);
+  }
+
+  if (system->spawn_count > 0) {
+    ParticleEmitPushConstants push = {
+        .positions = handles[PARTICLE_BUFFER_POSITIONS],
+        .velocities = handles[PARTICLE_BUFFER_VELOCITIES],
+        .colors = handles[PARTICLE_BUFFER_COLORS],
+        .dead = handles[PARTICLE_BUFFER_DEAD],
+        .alive = alive_in,
+        .counters = handles[PARTICLE_BUFFER_COUNTERS],
+        .emitters = handles[PARTICLE_BUFFER_EMITTERS],
+        .first_emitter = system->first_emitter,
+        .emitter_count = system->emitter_count,
+        .spawn_count = system->spawn_count,
+        .seed = system->seed};
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, system->emit_pipeline);
+    vkCmdPushConstants(cmd, ctx->pipeline_layout, VK_SHADER_STAGE_ALL, 0, sizeof(push), &push);
+    vk_cmd_dispatch_threads(cmd, system->spawn_count, 1, 1, PARTICLES_GROUP_SIZE, 1, 1);
+    compute_barrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+  }
+
+  ParticleUpdatePushConstants push = {
+      .gravity_dt = {0.0f, PARTICLES_GRAVITY, 0.0f, system->dt},
+      .positions = handles[PARTICLE_BUFFER_POSITIONS],
+      .velocities = handles[PARTICLE_BUFFER_VELOCITIES],
+      .dead = handles[PARTICLE_BUFFER_DEAD],
+      .alive_in = alive_in,
+      .alive_out = alive_out,
+      .counters = handles[PARTICLE_BUFFER_COUNTERS]};
+  vkCmdPushConstants(cmd, ctx->pipeline_layout, VK_SHADER_STAGE_ALL, 0, sizeof(push), &push);
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, system->prepare_pipeline);
+  vkCmdDispatch(cmd, 1, 1, 1);
+  compute_barrier(cmd, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                  VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, system->update_pipeline);
+  vkCmdDispatchIndirect(cmd, system->buffers[PARTICLE_BUFFER_COUNTERS], offsetof(ParticleCounters, update));
+}
+
+bool particles_draw(ParticleSystem* system, VkCommandBuffer cmd, uint32_t camera_offset) {
+  if (!system->allocated || camera_offset == UNIFORM_RING_INVALID_OFFSET) return false;
+  VkPipeline pipeline = pipeline_manager_get(system->pipelines, system->pipeline, VK_NULL_HANDLE);
+  if (pipeline == VK_NULL_HANDLE) return false;
+
+  VkContext* ctx = system->ctx;
+  ParticleDrawPushConstants push = {
+      .positions = system->handles[PARTICLE_BUFFER_POSITIONS],
+      .velocities = system->handles[PARTICLE_BUFFER_VELOCITIES],
+      .colors = system->handles[PARTICLE_BUFFER_COLORS],
+      .alive = system->handles[PARTICLE_BUFFER_ALIVE_0 + system->output]};
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+  uniform_ring_bind(&ctx->uniforms, cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->pipeline_layout, camera_offset);
+  vkCmdPushConstants(cmd, ctx->pipeline_layout, VK_SHADER_STAGE_ALL, 0, sizeof(push), &push);
+  vkCmdDrawIndirect(cmd, system->buffers[PARTICLE_BUFFER_COUNTERS], offsetof(ParticleCounters, draw), 1,
+                    sizeof(VkDrawIndirectCommand));
+  return true;
+}
+
+void particles_destroy(ParticleSystem* system) {
+  VkContext* ctx = system->ctx;
+  if (!ctx) return;
+  for (uint32_t i = 0; i < PARTICLE_BUFFER_COUNT; ++i) {
+    bindless_remove_buffer(&ctx->bindless, system->handles[i]);
+    vk_destroy_buffer(ctx, system->buffers[i], system->memory[i]);
+  }
+  if (system->emit_pipeline != VK_NULL_HANDLE) vkDestroyPipeline(ctx->device, system->emit_pipeline, NULL);
+  if (system->prepare_pipeline != VK_NULL_HANDLE) vkDestroyPipeline(ctx->device, system->prepare_pipeline, NULL);
+  if (system->update_pipeline != VK_NULL_HANDLE) vkDestroyPipeline(ctx->device, system->update_pipeline, NULL);
+  memset(system, 0, sizeof(*system));
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "compute.h"
+#include "pipeline_manager.h"
+#include "render_backend.h"
+#include "vk.h"
+
+#define PARTICLES_MAX (1u << 20)
+#define PARTICLES_GROUP_SIZE 256  // PARTICLE_GROUP_SIZE in shaders/particles.glsl
+#define PARTICLES_MAX_DT (1.0f / 15.0f)  // longer steps are clamped so bursts stay bounded
+#define PARTICLES_GRAVITY 200.0f  // world units per second squared, y down
+
+enum {
+  PARTICLE_BUFFER_POSITIONS = 0,  // vec4: xyz position, w remaining life
+  PARTICLE_BUFFER_VELOCITIES,  // vec4: xyz velocity, w size
+  PARTICLE_BUFFER_COLORS,  // RGBA8
+  PARTICLE_BUFFER_ALIVE_0,  // indices of live particles, ping-ponged between frames
+  PARTICLE_BUFFER_ALIVE_1,
+  PARTICLE_BUFFER_DEAD,  // stack of free indices
+  PARTICLE_BUFFER_COUNTERS,  // ParticleCounters
+  PARTICLE_BUFFER_EMITTERS,  // RENDER_MAX_EMITTERS per frame in flight, host visible
+  PARTICLE_BUFFER_COUNT
+};
+
+// Mirrors ParticleCounters in shaders/particles.glsl (std430).
+typedef struct {
+  int32_t dead_count;
+  uint32_t alive_count;  // particles in the update's input list
+  uint32_t pad[2];
+  VkDispatchIndirectCommand update;
+  uint32_t pad1;
+  VkDrawIndirectCommand draw;  // instanceCount is the update's output list
+} ParticleCounters;
+
+// GPU particles. State lives in device-local structure-of-arrays storage buffers, so the
+// CPU cost per frame depends on the number of emitters only. Each frame an async compute
+// job spawns from the emitters into free slots, then updates every live particle and
+// compacts the survivors into the other alive list, whose count is the instance count of
+// an indirect draw of one quad per particle. Buffers are allocated when the first
+// emitter appears, so scenes without particles pay nothing.
+typedef struct {
+  VkContext* ctx;
+  PipelineManager* pipelines;
+  bool enabled;  // pipelines built; needs bindless
+  bool allocated;
+  VkPipeline emit_pipeline;
+  VkPipeline prepare_pipeline;
+  VkPipeline update_pipeline;
+  uint32_t pipeline;  // PipelineManager handle of the quad pipeline
+
+  VkBuffer buffers[PARTICLE_BUFFER_COUNT];
+  VkDeviceMemory memory[PARTICLE_BUFFER_COUNT];
+  uint32_t handles[PARTICLE_BUFFER_COUNT];
+  void* emitter_data;  // mapped PARTICLE_BUFFER_EMITTERS
+
+  // This frame's work, set by particles_begin_frame for the compute job.
+  uint32_t output;  // 0 or 1: the alive list the update writes and the draw reads
+  float dt;
+  uint32_t seed;
+  uint32_t first_emitter;  // this frame's slot in PARTICLE_BUFFER_EMITTERS
+  uint32_t emitter_count;
+  uint32_t spawn_count;
+  float carry[RENDER_MAX_EMITTERS];  // fractional spawns owed per emitter slot
+} ParticleSystem;
+
+VkResult particles_init(ParticleSystem* system, VkContext* ctx, PipelineManager* pipelines, AsyncCompute* compute);
+// Call after the frame slot's fence wait and before the compute jobs are recorded.
+void particles_begin_frame(ParticleSystem* system, const ParticleEmitter* emitters, uint32_t emitter_count, float dt);
+// Inside a pass of the main render pass; camera_offset is the view's CameraUniforms.
+// Returns false when nothing was drawn.
+bool particles_draw(ParticleSystem* system, VkCommandBuffer cmd, uint32_t camera_offset);
+void particles_destroy(ParticleSystem* system);
@@ -0,0 +1,386 @@
+#include "pipeline_manager.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "base.h"
+
+static VkRenderPass desc_render_pass(VkContext* ctx, const GraphicsPipelineDesc* desc) {
+  return desc->render_pass != VK_NULL_HANDLE ? desc->render_pass : ctx->render_pass;
+}
+
+static bool vertex_input_equal(const GraphicsPipelineDesc* a, const GraphicsPipelineDesc* b) {
+  return a->vertex_binding_count == b->vertex_binding_count && a->vertex_attribute_count == b->vertex_attribute_count &&
+         (a->vertex_binding_count == 0 ||
+          memcmp(a->vertex_bindings, b->vertex_bindings, sizeof(*a->vertex_bindings) * a->vertex_binding_count) == 0) &&
+         (a->vertex_attribute_count == 0 ||
+          memcmp(a->vertex_attributes, b->vertex_attributes, sizeof(*a->vertex_attributes) * a->vertex_attribute_count) == 0);
+}
+
+// Everything hash_desc reads.
+static bool desc_equal(VkContext* ctx, const GraphicsPipelineDesc* a, const GraphicsPipelineDesc* b) {
+  return strcmp(a->vert_path, b->vert_path) == 0 && strcmp(a->frag_path, b->frag_path) == 0 &&
+         vertex_input_equal(a, b) && a->cull_mode == b->cull_mode && a->front_face == b->front_face &&
+         a->blend == b->blend && a->depth_test == b->depth_test && a->depth_write == b->depth_write &&
+         a->features == b->features && desc_render_pass(ctx, a) == desc_render_pass(ctx, b);
+}
+
+static uint64_t hash_desc(VkContext* ctx, const GraphicsPipelineDesc* desc) {
+  uint64_t hash = FNV_OFFSET;
+  hash = hash_bytes(hash, desc->vert_path, strlen(desc->vert_path) + 1);
+  hash = hash_bytes(hash, desc->frag_path, strlen(desc->frag_path) + 1);
+  hash = hash_bytes(hash, &desc->vertex_binding_count, sizeof(desc->vertex_binding_count));
+  hash = hash_bytes(hash, desc->vertex_bindings, sizeof(*desc->vertex_bindings) * desc->vertex_binding_count);
+  hash = hash_bytes(hash, &desc->vertex_attribute_count, sizeof(desc->vertex_attribute_count));
+  hash = hash_bytes(hash, desc->vertex_attributes, sizeof(*desc->vertex_attributes) * desc->vertex_attribute_count);
+
+  uint32_t state[] = {desc->cull_mode, desc->front_face, desc->blend, desc->depth_test, desc->depth_write, desc->features};
+  hash = hash_bytes(hash, state, sizeof(state));
+  VkRenderPass render_pass = desc_render_pass(ctx, desc);
+  return hash_bytes(hash, &render_pass, sizeof(render_pass));
+}
+
+static bool copy_desc(PipelineEntry* entry, const GraphicsPipelineDesc* desc) {
+  if (strlen(desc->vert_path) >= PIPELINE_MANAGER_MAX_PATH || strlen(desc->frag_path) >= PIPELINE_MANAGER_MAX_PATH ||
+      desc->vertex_binding_count > PIPELINE_MANAGER_MAX_BINDINGS ||
+      desc->vertex_attribute_count > PIPELINE_MANAGER_MAX_ATTRIBUTES) {
+    return false;
+  }
+  entry->desc = *desc;
+  strcpy(entry->vert_path, desc->vert_path);
+  strcpy(entry->frag_path, desc->frag_path);
+  if (desc->vertex_binding_count) {
+    memcpy(entry->bindings, desc->vertex_bindings, sizeof(*desc->vertex_bindings) * desc->vertex_binding_count);
+  }
+  if (desc->vertex_attribute_count) {
+    memcpy(entry->attributes, desc->vertex_attributes, sizeof(*desc->vertex_attributes) * desc->vertex_attribute_count);
+  }
+  entry->desc.vert_path = entry->vert_path;
+  entry->desc.frag_path = entry->frag_path;
+  entry->desc.vertex_bindings = entry->bindings;
+  entry->desc.vertex_attributes = entry->attributes;
+  return true;
+}
+
+static uint64_t hash_shader_pair(const GraphicsPipelineDesc* desc) {
+  uint64_t hash = hash_bytes(FNV_OFFSET, desc->vert_path, strlen(desc->vert_path) + 1);
+  return hash_bytes(hash, desc->frag_path, strlen(desc->frag_path) + 1);
+}
+
+// Hashes only the state the part is compiled from, so pipelines that differ elsewhere
+// share it. The shader parts also depend on the layout of the whole pipeline.
+static uint64_t hash_part(VkContext* ctx, const GraphicsPipelineDesc* desc, PipelinePart part,
+                          VkPipelineLayout layout) {
+  VkRenderPass render_pass = desc_render_pass(ctx, desc);
+  uint64_t hash = hash_bytes(FNV_OFFSET, &part, sizeof(part));
+  switch (part) {
+    case PIPELINE_PART_VERTEX_INPUT:
+      hash = hash_bytes(hash, &desc->vertex_binding_count, sizeof(desc->vertex_binding_count));
+      hash = hash_bytes(hash, desc->vertex_bindings, sizeof(*desc->vertex_bindings) * desc->vertex_binding_count);
+      hash = hash_bytes(hash, &desc->vertex_attribute_count, sizeof(desc->vertex_attribute_count));
+      hash = hash_bytes(hash, desc->vertex_attributes, sizeof(*desc->vertex_attributes) * desc->vertex_attribute_count);
+      break;
+    case PIPELINE_PART_PRE_RASTERIZATION: {
+      uint32_t state[] = {desc->cull_mode, desc->front_face, desc->features};
+      hash = hash_bytes(hash, desc->vert_path, strlen(desc->vert_path) + 1);
+      hash = hash_bytes(hash, state, sizeof(state));
+      hash = hash_bytes(hash, &layout, sizeof(layout));
+      hash = hash_bytes(hash, &render_pass, sizeof(render_pass));
+      break;
+    }
+    case PIPELINE_PART_FRAGMENT: {
+      uint32_t state[] = {desc->depth_test, desc->depth_write, desc->features};
+      hash = hash_bytes(hash, desc->frag_path, strlen(desc->frag_path) + 1);
+      hash = hash_bytes(hash, state, sizeof(state));
+      hash = hash_bytes(hash, &layout, sizeof(layout));
+      hash = hash_bytes(hash, &render_pass, sizeof(render_pass));
+      break;
+    }
+    default: {
+      uint32_t blend = desc->blend;
+      hash = hash_bytes(hash, &blend, sizeof(blend));
+      hash = hash_bytes(hash, &render_pass, sizeof(render_pass));
+      break;
+    }
+  }
+  return hash ? hash : 1;
+}
+
+// Everything hash_part reads for this part.
+static bool part_equal(VkContext* ctx, const CachedPipelinePart* cached, const GraphicsPipelineDesc* desc,
+                       PipelinePart part, VkPipelineLayout layout) {
+  const GraphicsPipelineDesc* other = cached->desc;
+  bool render_pass = desc_render_pass(ctx, other) == desc_render_pass(ctx, desc);
+  switch (part) {
+    case PIPELINE_PART_VERTEX_INPUT:
+      return vertex_input_equal(other, desc);
+    case PIPELINE_PART_PRE_RASTERIZATION:
+      return strcmp(other->vert_path, desc->vert_path) == 0 && other->cull_mode == desc->cull_mode &&
+             other->front_face == desc->front_face && other->features == desc->features && cached->layout == layout &&
+             render_pass;
+    case PIPELINE_PART_FRAGMENT:
+      return strcmp(other->frag_path, desc->frag_path) == 0 && other->depth_test == desc->depth_test &&
+             other->depth_write == desc->depth_write && other->features == desc->features && cached->layout == layout &&
+             render_pass;
+    default:
+      return other->blend == desc->blend && render_pass;
+  }
+}
+
+// Part and layout lookups; the caller holds parts_lock. Return the matching slot, or the
+// empty slot to fill, or NULL when the table is full.
+static CachedPipelinePart* find_part(PipelineManager* manager, const GraphicsPipelineDesc* desc, PipelinePart part_index,
+                                     VkPipelineLayout layout, uint64_t key) {
+  uint32_t mask = PIPELINE_MANAGER_MAX_PARTS - 1;
+  uint32_t index = (uint32_t)key & mask;
+  for (uint32_t probe = 0; probe < PIPELINE_MANAGER_MAX_PARTS; ++probe, index = (index + 1) & mask) {
+    CachedPipelinePart* part = &manager->parts[index];
+    if (part->key == 0) return part;
+    if (part->key == key && part_equal(manager->ctx, part, desc, part_index, layout)) return part;
+  }
+  return NULL;
+}
+
+static CachedShaderLayout* find_layout(PipelineManager* manager, const GraphicsPipelineDesc* desc, uint64_t key) {
+  uint32_t mask = PIPELINE_MANAGER_MAX_PIPELINES - 1;
+  uint32_t index = (uint32_t)key & mask;
+  for (uint32_t probe = 0; probe < PIPELINE_MANAGER_MAX_PIPELINES; ++probe, index = (index + 1) & mask) {
+    CachedShaderLayout* layout = &manager->layouts[index];
+    if (layout->key == 0) return layout;
+    if (layout->key == key && strcmp(layout->desc->vert_path, desc->vert_path) == 0 &&
+        strcmp(layout->desc->frag_path, desc->frag_path) == 0) {
+      return layout;
+    }
+  }
+  return NULL;
+}
+
+// Fills the entry's layout and parts from the cache alone; false if any is missing.
+static bool find_cached_parts(PipelineManager* manager, PipelineEntry* entry) {
+  bool found = true;
+  mutex_lock(manager->parts_lock);
+  CachedShaderLayout* layout = find_layout(manager, &entry->desc, hash_shader_pair(&entry->desc));
+  if (!layout || layout->key == 0) {
+    found = false;
+  } else {
+    entry->layout = layout->layout;
+  }
+  for (uint32_t i = 0; found && i < PIPELINE_PART_COUNT; ++i) {
+    CachedPipelinePart* part =
+        find_part(manager, &entry->desc, i, entry->layout, hash_part(manager->ctx, &entry->desc, i, entry->layout));
+    found = part && part->key != 0;
+    if (found) entry->parts[i] = part->library;
+  }
+  mutex_unlock(manager->parts_lock);
+  return found;
+}
+
+// Compiles the parts the cache does not have yet. Two workers may compile the same part;
+// the second copy is dropped.
+static bool build_parts(PipelineManager* manager, PipelineEntry* entry) {
+  VkContext* ctx = manager->ctx;
+  uint64_t pair = hash_shader_pair(&entry->desc);
+  mutex_lock(manager->parts_lock);
+  CachedShaderLayout* cached_layout = find_layout(manager, &entry->desc, pair);
+  bool have_layout = cached_layout && cached_layout->key != 0;
+  if (have_layout) entry->layout = cached_layout->layout;
+  mutex_unlock(manager->parts_lock);
+  if (!have_layout) {
+    const char* paths[] = {entry->desc.vert_path, entry->desc.frag_path};
+    if (vk_reflect_pipeline_layout(ctx, paths, 2, &entry->layout) != VK_SUCCESS) return false;
+    mutex_lock(manager->parts_lock);
+    cached_layout = find_layout(manager, &entry->desc, pair);
+    if (cached_layout && cached_layout->key == 0) {
+      *cached_layout = (CachedShaderLayout){.key = pair, .layout = entry->layout, .desc = &entry->desc};
+    }
+    mutex_unlock(manager->parts_lock);
+  }
+
+  for (uint32_t i = 0; i < PIPELINE_PART_COUNT; ++i) {
+    uint64_t key = hash_part(ctx, &entry->desc, i, entry->layout);
+    mutex_lock(manager->parts_lock);
+    CachedPipelinePart* part = find_part(manager, &entry->desc, i, entry->layout, key);
+    entry->parts[i] = part && part->key != 0 ? part->library : VK_NULL_HANDLE;
+    mutex_unlock(manager->parts_lock);
+    if (entry->parts[i] != VK_NULL_HANDLE) continue;
+
+    VkPipeline library;
+    if (vk_create_pipeline_part(ctx, &entry->desc, i, entry->layout, &library) != VK_SUCCESS) return false;
+    mutex_lock(manager->parts_lock);
+    part = find_part(manager, &entry->desc, i, entry->layout, key);
+    if (part && part->key == 0) {
+      *part = (CachedPipelinePart){.key = key, .library = library, .layout = entry->layout, .desc = &entry->desc};
+    }
+    entry->parts[i] = part ? part->library : VK_NULL_HANDLE;
+    mutex_unlock(manager->parts_lock);
+    if (entry->parts[i] != library) vkDestroyPipeline(ctx->device, library, NULL);
+    if (entry->parts[i] == VK_NULL_HANDLE) return false;
+  }
+  return true;
+}
+
+static void push_job(PipelineManager* manager, uint32_t index) {
+  mutex_lock(manager->lock);
+  manager->jobs[(manager->job_head + manager->job_count) % PIPELINE_MANAGER_MAX_PIPELINES] = index;
+  manager->job_count++;
+  mutex_unlock(manager->lock);
+  semaphore_post(manager->jobs_ready);
+}
+
+// A queued entry is fast-linked from library parts when it can be and queued again for
+// the optimized link, so new pipelines get on screen before older ones are optimized.
+// Without pipeline libraries, or if the parts fail, it is built in one piece.
+static int worker_main(void* arg) {
+  PipelineManager* manager = arg;
+  VkContext* ctx = manager->ctx;
+  for (;;) {
+    semaphore_wait(manager->jobs_ready);
+    mutex_lock(manager->lock);
+    if (manager->shutdown) {
+      mutex_unlock(manager->lock);
+      break;
+    }
+    uint32_t index = manager->jobs[manager->job_head];
+    manager->job_head = (manager->job_head + 1) % PIPELINE_MANAGER_MAX_PIPELINES;
+    manager->job_count--;
+    mutex_unlock(manager->lock);
+
+    PipelineEntry* entry = &manager->entries[index];
+    unsigned state = atomic_load_explicit(&entry->state, memory_order_relaxed);
+    if (state == PIPELINE_QUEUED && ctx->has_pipeline_library && build_parts(manager, entry) &&
+        vk_link_graphics_pipeline(ctx, entry->parts, entry->layout, false, &entry->linked) == VK_SUCCESS) {
+      atomic_store_explicit(&entry->state, PIPELINE_LINKED, memory_order_release);
+      push_job(manager, index);
+      continue;
+    }
+
+    VkResult res;
+    if (state == PIPELINE_LINKED) {
+      // On failure the fast-linked pipeline simply stays in use.
+      res = vk_link_graphics_pipeline(ctx, entry->parts, entry->layout, true, &entry->pipeline);
+      if (res != VK_SUCCESS) continue;
+    } else {
+      res = vk_create_graphics_pipeline(ctx, &entry->desc, &entry->pipeline);
+      if (res != VK_SUCCESS) {
+        fprintf(stderr, "Failed to build pipeline '%s' + '%s'\n", entry->vert_path, entry->frag_path);
+      }
+    }
+    atomic_store_explicit(&entry->state, res == VK_SUCCESS ? PIPELINE_READY : PIPELINE_FAILED, memory_order_release);
+  }
+  return 0;
+}
+
+VkResult pipeline_manager_init(PipelineManager* manager, VkContext* ctx) {
+  memset(manager, 0, sizeof(*manager));
+  manager->ctx = ctx;
+  manager->entries = calloc(PIPELINE_MANAGER_MAX_PIPELINES, sizeof(*manager->entries));
+  manager->lock = mutex_create();
+  manager->jobs_ready = semaphore_create(0);
+  manager->parts_lock = mutex_create();
+  manager->parts = calloc(PIPELINE_MANAGER_MAX_PARTS, sizeof(*manager->parts));
+  manager->layouts = calloc(PIPELINE_MANAGER_MAX_PIPELINES, sizeof(*manager->layouts));
+  if (!manager->entries || !manager->lock || !manager->jobs_ready || !manager->parts_lock || !manager->parts ||
+      !manager->layouts) {
+    pipeline_manager_destroy(manager);
+    return VK_ERROR_OUT_OF_HOST_MEMORY;
+  }
+  for (uint32_t i = 0; i < PIPELINE_MANAGER_WORKERS; ++i) {
+    manager->workers[i] = thread_create(worker_main, manager, "pipelines");
+  }
+  return VK_SUCCESS;
+}
+
+uint32_t pipeline_manager_request(PipelineManager* manager, const GraphicsPipelineDesc* desc) {
+  uint64_t key = hash_desc(manager->ctx, desc);
+  uint32_t mask = PIPELINE_MANAGER_MAX_PIPELINES - 1;
+
+  mutex_lock(manager->lock);
+  uint32_t index = (uint32_t)key & mask;
+  for (uint32_t probe = 0; probe < PIPELINE_MANAGER_MAX_PIPELINES; ++probe, index = (index + 1) & mask) {
+    PipelineEntry* entry = &manager->entries[index];
+    unsigned state = atomic_load_explicit(&entry->state, memory_order_relaxed);
+    if (state != PIPELINE_EMPTY && entry->key == key && desc_equal(manager->ctx, &entry->desc, desc)) {
+      mutex_unlock(manager->lock);
+      return index;
+    }
+    if (state != PIPELINE_EMPTY) continue;
+
+    if (!copy_desc(entry, desc)) break;
+    entry->key = key;
+    atomic_store_explicit(&entry->state, PIPELINE_QUEUED, memory_order_relaxed);
+    manager->entry_count++;
+    mutex_unlock(manager->lock);
+
+    // No worker sees the entry before it is queued. Linking cached parts is cheap enough
+    // to do here, so the pipeline can be drawn with this frame.
+    VkContext* ctx = manager->ctx;
+    if (ctx->has_pipeline_library && find_cached_parts(manager, entry) &&
+        vk_link_graphics_pipeline(ctx, entry->parts, entry->layout, false, &entry->linked) == VK_SUCCESS) {
+      atomic_store_explicit(&entry->state, PIPELINE_LINKED, memory_order_release);
+    }
+    push_job(manager, index);
+    return index;
+  }
+  mutex_unlock(manager->lock);
+  fprintf(stderr, "Pipeline manager: cannot add '%s' + '%s'\n", desc->vert_path, desc->frag_path);
+  return PIPELINE_INVALID_HANDLE;
+}
+
+void pipeline_manager_prewarm(PipelineManager* manager, const GraphicsPipelineDesc* descs, uint32_t count) {
+  for (uint32_t i = 0; i < count; ++i) {
+    pipeline_manager_request(manager, &descs[i]);
+  }
+}
+
+VkPipeline pipeline_manager_get(PipelineManager* manager, uint32_t handle, VkPipeline fallback) {
+  if (handle == PIPELINE_INVALID_HANDLE) return fallback;
+  PipelineEntry* entry = &manager->entries[handle];
+  unsigned state = atomic_load_explicit(&entry->state, memory_order_acquire);
+  if (state == PIPELINE_LINKED) return entry->linked;
+  if (state != PIPELINE_READY) return fallback;
+  // Retired here rather than by the worker: frame_number belongs to the render thread, and
+  // every frame that was handed the fast-linked pipeline is this one or an earlier one.
+  if (entry->linked != VK_NULL_HANDLE) {
+    vk_defer_destroy_pipeline(manager->ctx, entry->linked);
+    entry->linked = VK_NULL_HANDLE;
+  }
+  return entry->pipeline;
+}
+
+// Queued pipelines that no worker has started are dropped.
+void pipeline_manager_destroy(PipelineManager* manager) {
+  if (!manager->ctx) return;
+  if (manager->lock) {
+    mutex_lock(manager->lock);
+    manager->shutdown = true;
+    mutex_unlock(manager->lock);
+  }
+  for (uint32_t i = 0; i < PIPELINE_MANAGER_WORKERS; ++i) {
+    if (manager->workers[i]) semaphore_post(manager->jobs_ready);
+  }
+  for (uint32_t i = 0; i < PIPELINE_MANAGER_WORKERS; ++i) {
+    if (manager->workers[i]) thread_join(manager->workers[i]);
+  }
+
+  if (manager->entries) {
+    for (uint32_t i = 0; i < PIPELINE_MANAGER_MAX_PIPELINES; ++i) {
+      PipelineEntry* entry = &manager->entries[i];
+      if (atomic_load(&entry->state) == PIPELINE_READY) {
+        vkDestroyPipeline(manager->ctx->device, entry->pipeline, NULL);
+      }
+      // Still set when get never ran after READY; retired ones are in the deletion queue.
+      if (entry->linked != VK_NULL_HANDLE) vkDestroyPipeline(manager->ctx->device, entry->linked, NULL);
+    }
+  }
+  if (manager->parts) {
+    for (uint32_t i = 0; i < PIPELINE_MANAGER_MAX_PARTS; ++i) {
+      if (manager->parts[i].key != 0) vkDestroyPipeline(manager->ctx->device, manager->parts[i].library, NULL);
+    }
+  }
+  free(manager->parts);
+  free(manager->layouts);
+  if (manager->parts_lock) mutex_destroy(manager->parts_lock);
+  free(manager->entries);
+  if (manager->jobs_ready) semaphore_destroy(manager->jobs_ready);
+  if (manager->lock) mutex_destroy(manager->lock);
+  memset(manager, 0, sizeof(*manager));
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "thread.h"
+#include "vk.h"
+
+#define PIPELINE_MANAGER_MAX_PIPELINES 256  // power of two, open addressing
+#define PIPELINE_MANAGER_WORKERS 2
+#define PIPELINE_MANAGER_MAX_PATH 128
+#define PIPELINE_MANAGER_MAX_BINDINGS 4
+#define PIPELINE_MANAGER_MAX_ATTRIBUTES 16
+#define PIPELINE_MANAGER_MAX_PARTS 512  // power of two, open addressing
+#define PIPELINE_INVALID_HANDLE UINT32_MAX
+
+typedef enum {
+  PIPELINE_EMPTY = 0,
+  PIPELINE_QUEUED,
+  PIPELINE_LINKED,  // usable; the optimized link is still queued
+  PIPELINE_READY,
+  PIPELINE_FAILED,
+} PipelineState;
+
+typedef struct {
+  uint64_t key;
+  atomic_uint state;  // PipelineState; LINKED publishes linked, READY pipeline
+  VkPipeline pipeline;
+  // Fast-linked from library parts; the first get after READY hands it to the deletion
+  // queue, since recorded frames may still use it.
+  VkPipeline linked;
+  VkPipelineLayout layout;
+  VkPipeline parts[PIPELINE_PART_COUNT];  // owned by the part cache
+  // Owned copy of the description, so requests can pass stack data.
+  GraphicsPipelineDesc desc;
+  char vert_path[PIPELINE_MANAGER_MAX_PATH];
+  char frag_path[PIPELINE_MANAGER_MAX_PATH];
+  VkVertexInputBindingDescription bindings[PIPELINE_MANAGER_MAX_BINDINGS];
+  VkVertexInputAttributeDescription attributes[PIPELINE_MANAGER_MAX_ATTRIBUTES];
+} PipelineEntry;
+
+// Cache hits compare the description of the entry that built the part or layout, so a
+// hash collision cannot hand out the wrong one. Entries are never removed.
+typedef struct {
+  uint64_t key;  // 0 marks an empty slot
+  VkPipeline library;
+  VkPipelineLayout layout;  // the part was compiled against
+  const GraphicsPipelineDesc* desc;
+} CachedPipelinePart;
+
+typedef struct {
+  uint64_t key;  // of the shader pair
+  VkPipelineLayout layout;
+  const GraphicsPipelineDesc* desc;
+} CachedShaderLayout;
+
+// Graphics pipelines keyed by a hash of everything that goes into them: shaders, vertex
+// layout, raster/blend/depth state, shader features and the render pass (which fixes the
+// target formats).
+// Requests never compile on the calling thread; worker threads build queued pipelines
+// through ctx->pipeline_cache, and draws use a fallback until theirs is ready.
+// With pipeline libraries, workers compile the four parts of a pipeline separately and
+// cache them by the state each part reads, so a new combination of known parts is only a
+// fast link; request does that link itself when every part is already cached. The
+// link-time optimized pipeline is then built in the background and replaces it.
+typedef struct {
+  VkContext* ctx;
+  PipelineEntry* entries;
+  uint32_t entry_count;
+
+  Mutex* lock;  // guards inserts and the job queue
+  uint32_t jobs[PIPELINE_MANAGER_MAX_PIPELINES];
+  uint32_t job_head;
+  uint32_t job_count;
+  bool shutdown;
+  Semaphore* jobs_ready;
+  Thread* workers[PIPELINE_MANAGER_WORKERS];
+
+  Mutex* parts_lock;  // guards parts and layouts
+  CachedPipelinePart* parts;
+  CachedShaderLayout* layouts;  // PIPELINE_MANAGER_MAX_PIPELINES slots
+} PipelineManager;
+
+VkResult pipeline_manager_init(PipelineManager* manager, VkContext* ctx);
+// Returns the same handle for equal descriptions, compared in full; new ones are queued for a worker, or
+// fast-linked right away when all their library parts are cached.
+uint32_t pipeline_manager_request(PipelineManager* manager, const GraphicsPipelineDesc* desc);
+// Queues variants known ahead of time, e.g. every material at load.
+void pipeline_manager_prewarm(PipelineManager* manager, const GraphicsPipelineDesc* descs, uint32_t count);
+// Never blocks: returns fallback until the pipeline has been built or linked, or if it
+// failed. A fast-linked pipeline is returned until the optimized one is ready, then
+// retired. Render thread only.
+VkPipeline pipeline_manager_get(PipelineManager* manager, uint32_t handle, VkPipeline fallback);
+void pipeline_manager_destroy(PipelineManager* manager);
@@ -1,128 +1,282 @@
 #include "render.h"
 #include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "base.h"
+#include "dynamic_resolution.h"
 
-static VkResult record_command_buffer(VkContext* ctx, VkCommandBuffer cmd, uint32_t image_index);
+static int render_thread_main(void* arg);
 
-void render_init(RenderContext* render, VkContext* ctx) {
-  render->ctx = ctx;
+// Flags are raised before the ring is checked again, and cleared by the other side
+// after it moves the ring, so a post cannot fall between the check and the wait.
+static FramePacket* wait_for_free_packet(RenderContext* render) {
+  FramePacket* packet;
+  while (!(packet = spsc_ring_acquire_write(&render->packets))) {
+    atomic_store_explicit(&render->main_parked, true, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if ((packet = spsc_ring_acquire_write(&render->packets))) break;
+    semaphore_wait(render->free_packets);
+  }
+  return packet;
+}
+
+static FramePacket* wait_for_ready_packet(RenderContext* render) {
+  FramePacket* packet;
+  while (!(packet = spsc_ring_acquire_read(&render->packets))) {
+    atomic_store_explicit(&render->render_parked, true, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    if ((packet = spsc_ring_acquire_read(&render->packets))) break;
+    semaphore_wait(render->ready_packets);
+  }
+  return packet;
 }
 
-void render_draw_quad(RenderContext* render) {
+// Called after moving the ring; posts only when the other side may be parked.
+static void wake(atomic_bool* parked, Semaphore* sem) {
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_exchange_explicit(parked, false, memory_order_relaxed)) semaphore_post(sem);
 }
 
-void acquire(VkContext* ctx) {
-  uint32_t current_frame = ctx->current_frame;
-  VkFence* fence = &ctx->in_flight_fences[current_frame];
+static void begin_packet(RenderContext* render) {
+  // Blocks while the render thread is still on the packet RENDER_PIPELINE_DEPTH - 1 frames back.
+  FramePacket* packet = wait_for_free_packet(render);
+  Camera camera = render->current ? render->current->camera : (Camera){.zoom = 1.0f};
+  float resolution_scale = render->current ? render->current->resolution_scale : 0.0f;
+  bool overlay = render->current ? render->current->overlay : false;
+
+  packet->frame_index = render->frame_index;
+  packet->shutdown = false;
+  packet->camera = camera;
+  packet->resolution_scale = resolution_scale;
+  packet->overlay = overlay;
+  packet->dt = 0.0f;
+  packet->capture.requested = false;
+  packet->emitter_count = 0;
+  packet->quad_count = 0;
+  render->current = packet;
+}
 
-  vkWaitForFences(ctx->device, 1, fence, VK_TRUE, UINT64_MAX);
-  vkResetFences(ctx->device, 1, fence);
+static void publish_packet(RenderContext* render) {
+  spsc_ring_commit_write(&render->packets);
+  wake(&render->render_parked, render->ready_packets);
+  render->frame_index++;
+}
 
-  vkAcquireNextImageKHR(ctx->device, ctx->swapchain, UINT64_MAX, ctx->image_available_semaphores[current_frame],
-                        VK_NULL_HANDLE, &ctx->image_index);
+static void destroy_queue(RenderContext* render) {
+  spsc_ring_destroy(&render->packets);
+  semaphore_destroy(render->free_packets);
+  semaphore_destroy(render->ready_packets);
+  render->current = NULL;
 }
 
-void submit(VkContext* ctx) {
-  uint32_t current_frame = ctx->current_frame;
-  uint32_t image_index = ctx->image_index;
+bool render_init(RenderContext* render, RenderBackend* backend) {
+  memset(render, 0, sizeof(*render));
+  render->backend = backend;
+  atomic_init(&render->main_parked, false);
+  atomic_init(&render->render_parked, false);
 
-  VkPipelineStageFlags wait_stages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-  VkSubmitInfo submit_info = {
-      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-      .waitSemaphoreCount = 1,
-      .pWaitSemaphores = &ctx->image_available_semaphores[current_frame],
-      .pWaitDstStageMask = wait_stages,
-      .commandBufferCount = 1,
-      .pCommandBuffers = &ctx->command_buffers[current_frame],
-      .signalSemaphoreCount = 1,
-      .pSignalSemaphores = &ctx->render_finished_semaphores[image_index]};
+  if (!spsc_ring_init(&render->packets, sizeof(FramePacket), RENDER_PIPELINE_DEPTH)) {
+    fprintf(stderr, "Failed to allocate frame packets!\n");
+    return false;
+  }
+  render->free_packets = semaphore_create(0);
+  render->ready_packets = semaphore_create(0);
+  if (!render->free_packets || !render->ready_packets) {
+    fprintf(stderr, "Failed to create render semaphores!\n");
+    destroy_queue(render);
+    return false;
+  }
+  begin_packet(render);
 
-  vkQueueSubmit(ctx->graphics_queue, 1, &submit_info, ctx->in_flight_fences[current_frame]);
+  render->thread = thread_create(render_thread_main, render, "render");
+  if (!render->thread) {
+    destroy_queue(render);
+    return false;
+  }
+  return true;
 }
 
-void present(VkContext* ctx) {
-  uint32_t image_index = ctx->image_index;
-  VkPresentInfoKHR present_info = {
-      .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
-      .waitSemaphoreCount = 1,
-      .pWaitSemaphores = &ctx->render_finished_semaphores[image_index],
-      .swapchainCount = 1,
-      .pSwapchains = &ctx->swapchain,
-      .pImageIndices = &ctx->image_index};
-  vkQueuePresentKHR(ctx->present_queue, &present_info);
+void render_set_camera(RenderContext* render, const Camera* camera) {
+  render->current->camera = *camera;
+}
 
-  ctx->current_frame = (ctx->current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+void render_set_overlay(RenderContext* render, bool visible) {
+  render->current->overlay = visible;
 }
 
-void render_game(RenderContext* render) {
-  VkContext* ctx = render->ctx;
+void render_set_resolution_scale(RenderContext* render, float scale) {
+  render->current->resolution_scale = scale > 0.0f ? CLAMP(scale, DYNAMIC_RESOLUTION_MIN_SCALE, 1.0f) : 0.0f;
+}
+
+void render_draw_quad(RenderContext* render, const Quad* quad) {
+  FramePacket* packet = render->current;
+  if (packet->quad_count >= MAX_QUADS_PER_FRAME) return;
+  packet->quads[packet->quad_count++] = *quad;
+}
+
+uint32_t render_add_sprite(RenderContext* render, const uint8_t* rgba, uint32_t width, uint32_t height) {
+  return render->backend->add_sprite(render->backend, rgba, width, height);
+}
+
+void render_remove_sprite(RenderContext* render, uint32_t sprite) {
+  render->backend->remove_sprite(render->backend, sprite);
+}
+
+bool render_sprite_quad(RenderContext* render, uint32_t sprite, Quad* quad) {
+  return render->backend->get_sprite(render->backend, sprite, quad);
+}
+
+void render_emit_particles(RenderContext* render, const ParticleEmitter* emitter) {
+  FramePacket* packet = render->current;
+  if (packet->emitter_count >= RENDER_MAX_EMITTERS) return;
+  packet->emitters[packet->emitter_count++] = *emitter;
+}
 
-  acquire(ctx);
+void render_set_time_step(RenderContext* render, float dt) {
+  render->current->dt = dt;
+}
+
+void render_capture(RenderContext* render, const CaptureRequest* request) {
+  render->current->capture = *request;
+  render->current->capture.requested = true;
+}
+
+// Orthographic view centered on the camera, one world unit per pixel at zoom 1.
+// Column-major, Vulkan clip space (y down, depth 0..1 over z in [-1000, 1000]).
+static void camera_view_proj(const Camera* camera, uint32_t width, uint32_t height, float out[16]) {
+  float sx = 2.0f * camera->zoom / (float)width;
+  float sy = 2.0f * camera->zoom / (float)height;
+  memset(out, 0, sizeof(float) * 16);
+  out[0] = sx;
+  out[5] = sy;
+  out[10] = 1.0f / 2000.0f;
+  out[12] = -camera->x * sx;
+  out[13] = -camera->y * sy;
+  out[14] = 0.5f;
+  out[15] = 1.0f;
+}
+
+static double now_seconds(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
 
-  record_command_buffer(ctx, ctx->command_buffers[ctx->current_frame], ctx->image_index);
-  submit(ctx);
-  present(ctx);
+// Layers draw back to front, and within a layer quads that share a texture batch together.
+static uint64_t quad_key(const Quad* quad) {
+  return (uint64_t)quad->layer << 32 | quad->texture;
 }
 
-static VkResult record_command_buffer(VkContext* ctx, VkCommandBuffer cmd, uint32_t image_index) {
-  // Make sure the command buffer is back to INITIAL state before re-recording
-  VkResult res = vkResetCommandBuffer(cmd, 0);
-  if (res != VK_SUCCESS) {
-    fprintf(stderr, "vkResetCommandBuffer failed: %d\n", res);
-    return res;
+// Stable LSD radix sort of the packet's quads by (layer, texture), one byte per pass;
+// passes where every key has the same byte are skipped, so a few layers and small handles
+// cost a few passes. Keeping submission order within a key keeps the game's layering
+// between quads that share a texture.
+static void sort_quads(RenderContext* render, const FramePacket* packet) {
+  uint32_t count = packet->quad_count;
+  uint32_t* order = render->quad_order;
+  uint32_t* scratch = render->quad_scratch;
+  for (uint32_t i = 0; i < count; ++i) {
+    order[i] = i;
+  }
+  for (uint32_t shift = 0; shift < 64; shift += 8) {
+    uint32_t histogram[257] = {0};
+    for (uint32_t i = 0; i < count; ++i) {
+      histogram[((quad_key(&packet->quads[i]) >> shift) & 0xff) + 1]++;
+    }
+    if (count == 0 || histogram[((quad_key(&packet->quads[0]) >> shift) & 0xff) + 1] == count) continue;
+    for (uint32_t i = 1; i < 257; ++i) {
+      histogram[i] += histogram[i - 1];
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      uint32_t index = order[i];
+      scratch[histogram[(quad_key(&packet->quads[index]) >> shift) & 0xff]++] = index;
+    }
+    uint32_t* swap = order;
+    order = scratch;
+    scratch = swap;
+  }
+  for (uint32_t i = 0; i < count; ++i) {
+    render->quads[i] = packet->quads[order[i]];
   }
+}
 
-  VkCommandBufferBeginInfo begin_info = {
-      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
-      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
-      .pInheritanceInfo = NULL};
-  res = vkBeginCommandBuffer(cmd, &begin_info);
-  if (res != VK_SUCCESS) {
-    fprintf(stderr, "vkBeginCommandBuffer failed: %d\n", res);
-    return res;
+static uint32_t batch_quads(RenderContext* render, uint32_t count) {
+  uint32_t batch_count = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (batch_count > 0 && render->batches[batch_count - 1].texture == render->quads[i].texture) {
+      render->batches[batch_count - 1].count++;
+    } else {
+      render->batches[batch_count++] = (QuadBatch){.texture = render->quads[i].texture, .first = i, .count = 1};
+    }
   }
+  return batch_count;
+}
+
+static void render_frame(RenderContext* render, const FramePacket* packet) {
+  RenderBackend* backend = render->backend;
 
-  VkClearValue clear_color = {.color = {{0.0f, 0.0f, 0.0f, 1.0f}}};
-
-  VkRenderPassBeginInfo render_pass_info = {
-      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-      .renderPass = ctx->render_pass,
-      .framebuffer = ctx->swapchain_framebuffers[image_index],
-      .renderArea = {
-          .offset = {0, 0},
-          .extent = ctx->swapchain_extent},
-      .clearValueCount = 1,
-      .pClearValues = &clear_color};
-
-  vkCmdBeginRenderPass(cmd, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
-
-  // Graphics pipeline must match the render pass and subpass index.
-  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->graphics_pipeline);
-
-  // If your pipeline declared viewport/scissor as dynamic, set them here:
-  VkViewport viewport = {
-      .x = 0.0f,
-      .y = 0.0f,
-      .width = (float)ctx->swapchain_extent.width,
-      .height = (float)ctx->swapchain_extent.height,
-      .minDepth = 0.0f,
-      .maxDepth = 1.0f};
-  vkCmdSetViewport(cmd, 0, 1, &viewport);
-
-  VkRect2D scissor = {
-      .offset = {0, 0},
-      .extent = ctx->swapchain_extent};
-  vkCmdSetScissor(cmd, 0, 1, &scissor);
-
-  // Draw a fullscreen-ish triangle (pipeline with no vertex buffers / no vertex input)
-  vkCmdDraw(cmd, 3, 1, 0, 0);
-
-  vkCmdEndRenderPass(cmd);
-
-  res = vkEndCommandBuffer(cmd);
-  if (res != VK_SUCCESS) {
-    fprintf(stderr, "vkEndCommandBuffer failed: %d\n", res);
-    return res;
+  double time = now_seconds();
+  if (render->last_frame_time > 0.0) {
+    render->cpu_ms = (float)((time - render->last_frame_time) * 1000.0);
   }
+  render->last_frame_time = time;
+
+  uint32_t view_count = backend->begin_frame(backend, render->views, RENDER_MAX_VIEWS);
+  // Every view shows the same camera, projected for its own extent.
+  for (uint32_t i = 0; i < view_count; ++i) {
+    RenderView* view = &render->views[i];
+    camera_view_proj(&packet->camera, view->width, view->height, view->view_proj);
+  }
+  sort_quads(render, packet);
+
+  RenderFrame frame = {
+      .frame_index = packet->frame_index,
+      .camera = packet->camera,
+      .resolution_scale = packet->resolution_scale,
+      .overlay = packet->overlay,
+      .cpu_ms = render->cpu_ms,
+      .dt = packet->dt,
+      .capture = packet->capture,
+      .views = render->views,
+      .view_count = view_count,
+      .quads = render->quads,
+      .quad_count = packet->quad_count,
+      .batches = render->batches,
+      .batch_count = batch_quads(render, packet->quad_count),
+      .emitters = packet->emitters,
+      .emitter_count = packet->emitter_count};
+  backend->end_frame(backend, &frame);
+}
+
+// Makes every frame call into the backend after render_init. The main thread produces
+// packets and only calls the backend's sprite hooks.
+static int render_thread_main(void* arg) {
+  RenderContext* render = arg;
+  for (;;) {
+    FramePacket* packet = wait_for_ready_packet(render);
+    bool shutdown = packet->shutdown;
+    if (!shutdown) render_frame(render, packet);
+    spsc_ring_release_read(&render->packets);
+    wake(&render->main_parked, render->free_packets);
+    if (shutdown) break;
+  }
+  render->backend->wait_idle(render->backend);
+  return 0;
+}
+
+void render_game(RenderContext* render) {
+  publish_packet(render);
+  begin_packet(render);
+}
+
+void render_shutdown(RenderContext* render) {
+  if (!render->thread) return;
+  render->current->shutdown = true;
+  publish_packet(render);
+  thread_join(render->thread);
+  render->thread = NULL;
 
-  return VK_SUCCESS;
+  render->gpu_ms = render->backend->gpu_ms;
+  render->backend->destroy(render->backend);
+  destroy_queue(render);
 }
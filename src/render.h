@@ -1,13 +1,81 @@
 #pragma once
 
-#include <vulkan/vulkan.h>
-#include "vk.h"
-#include "window.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "render_backend.h"
+#include "spsc_ring.h"
+#include "thread.h"
 
+// Frame packets in the ring (a power of two). The render thread holds the one it draws
+// and the main thread the one it fills, so with 2 the game runs at most one frame ahead.
+#define RENDER_PIPELINE_DEPTH 2
+#define MAX_QUADS_PER_FRAME 4096
+
+// Everything the render thread needs to draw one frame. Filled by the main thread.
+typedef struct {
+  uint64_t frame_index;
+  bool shutdown;
+  Camera camera;
+  float resolution_scale;  // > 0 overrides dynamic resolution
+  bool overlay;
+  float dt;
+  CaptureRequest capture;
+  uint32_t emitter_count;
+  ParticleEmitter emitters[RENDER_MAX_EMITTERS];
+  uint32_t quad_count;
+  Quad quads[MAX_QUADS_PER_FRAME];
+} FramePacket;
+
+// The backend-independent half of the renderer: the main thread fills packets, and the
+// render thread turns each one into a RenderFrame (camera projection per view, quads
+// sorted by layer and batched by texture) for the backend to record.
 typedef struct {
-  VkContext* ctx;
+  RenderBackend* backend;
+  double last_frame_time;  // render thread clock, for the overlay's CPU frame time
+  float cpu_ms;
+  float gpu_ms;  // the backend's at shutdown, for reporting
+
+  // Render thread scratch for building frames.
+  RenderView views[RENDER_MAX_VIEWS];
+  uint32_t quad_order[MAX_QUADS_PER_FRAME];
+  uint32_t quad_scratch[MAX_QUADS_PER_FRAME];
+  Quad quads[MAX_QUADS_PER_FRAME];
+  QuadBatch batches[MAX_QUADS_PER_FRAME];
+
+  Thread* thread;
+  // Both threads go through the ring's atomics; a side only parks on its semaphore when
+  // the ring is full (main thread) or empty (render thread), after raising its flag.
+  SpscRing packets;
+  Semaphore* free_packets;
+  Semaphore* ready_packets;
+  atomic_bool main_parked;
+  atomic_bool render_parked;
+  FramePacket* current;
+  uint64_t frame_index;
 } RenderContext;
 
-void render_init(RenderContext* render, VkContext* ctx);
-void render_draw_quad(RenderContext* render);
+// The backend must stay alive until render_shutdown, which destroys it. Returns false,
+// leaving the backend to the caller, when the render thread could not be started; no
+// other render_ call is valid then.
+bool render_init(RenderContext* render, RenderBackend* backend);
+void render_set_camera(RenderContext* render, const Camera* camera);
+void render_set_overlay(RenderContext* render, bool visible);
+// Pins the scene resolution to a fraction of the window; 0 hands it back to the controller.
+void render_set_resolution_scale(RenderContext* render, float scale);
+void render_draw_quad(RenderContext* render, const Quad* quad);
+// Copies an RGBA8 image into the backend's sprite storage and returns its id, or
+// RENDER_INVALID_SPRITE when it is full.
+uint32_t render_add_sprite(RenderContext* render, const uint8_t* rgba, uint32_t width, uint32_t height);
+void render_remove_sprite(RenderContext* render, uint32_t sprite);
+// Sets quad's texture and uv for the sprite; false until its first upload has been
+// recorded, so a sprite added this frame can be drawn from a later one.
+bool render_sprite_quad(RenderContext* render, uint32_t sprite, Quad* quad);
+// Spawns particles from this emitter during the frame; submit it again every frame.
+void render_emit_particles(RenderContext* render, const ParticleEmitter* emitter);
+// Game time advanced by this frame, for simulations on the render side.
+void render_set_time_step(RenderContext* render, float dt);
+// Writes the current frame to `path` once the GPU has finished it, without stalling.
+void render_capture(RenderContext* render, const CaptureRequest* request);
 void render_game(RenderContext* render);
+void render_shutdown(RenderContext* render);
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "capture.h"
+
+#define RENDER_MAX_VIEWS 4  // VK_MAX_WINDOWS for the Vulkan backend
+#define RENDER_MAX_EMITTERS 64
+#define RENDER_INVALID_SPRITE UINT32_MAX
+
+typedef struct {
+  float x, y;
+  float zoom;
+} Camera;
+
+// Asks the render thread to write one image of this frame to disk.
+typedef struct {
+  bool requested;
+  bool scene;  // the offscreen scene at render resolution instead of the window's backbuffer
+  uint32_t window;
+  CaptureFormat format;
+  char path[CAPTURE_MAX_PATH];
+} CaptureRequest;
+
+// A sprite in world units. Layers are drawn in increasing order; within a layer quads are
+// grouped by texture, keeping submission order only among quads that share one.
+typedef struct {
+  float x, y;  // top-left corner
+  float width, height;
+  float u0, v0, u1, v1;
+  float color[4];
+  uint32_t texture;  // bindless image handle, e.g. AtlasRegion.texture; UINT32_MAX for flat color
+  uint32_t layer;
+} Quad;
+
+// A particle source. Emitters are submitted every frame like quads; an emitter's spawn
+// rate carries fractions over from the previous frame at the same submission index.
+typedef struct {
+  float position[3];
+  float position_spread;  // spawn offset in [-spread, spread] per axis
+  float velocity[3];
+  float velocity_spread;
+  float color[4];
+  float rate;  // particles per second
+  float lifetime;  // seconds
+  float size;  // world units
+} ParticleEmitter;
+
+// One window's worth of the frame. The backend reports the extent, the frontend projects
+// the camera for it.
+typedef struct {
+  uint32_t width, height;
+  float view_proj[16];
+} RenderView;
+
+// Quads that share a texture and are consecutive in RenderFrame.quads: one instanced draw.
+typedef struct {
+  uint32_t texture;
+  uint32_t first;
+  uint32_t count;
+} QuadBatch;
+
+// Everything a backend needs to record one frame, generated by the frontend from a packet.
+// Pointers stay valid until end_frame returns.
+typedef struct {
+  uint64_t frame_index;
+  Camera camera;
+  float resolution_scale;  // > 0 overrides dynamic resolution
+  bool overlay;
+  float cpu_ms;  // previous frame on the render thread
+  float dt;  // game time step, seconds
+  CaptureRequest capture;
+  const RenderView* views;
+  uint32_t view_count;
+  const Quad* quads;  // sorted by layer, then texture; submission order kept within both
+  uint32_t quad_count;
+  const QuadBatch* batches;
+  uint32_t batch_count;
+  const ParticleEmitter* emitters;
+  uint32_t emitter_count;
+} RenderFrame;
+
+// What render.c drives. Backends embed this as their first member and are called only
+// from the render thread, except destroy, which runs after it has exited, and the sprite
+// hooks, which the game thread calls while frames are being recorded.
+typedef struct RenderBackend RenderBackend;
+struct RenderBackend {
+  const char* name;
+  // Waits for a free frame slot and fills the extent of each view; returns the view count.
+  uint32_t (*begin_frame)(RenderBackend* backend, RenderView* views, uint32_t max_views);
+  // Records and submits the frame begun by begin_frame.
+  void (*end_frame)(RenderBackend* backend, const RenderFrame* frame);
+  // After the last frame, before the render thread exits.
+  void (*wait_idle)(RenderBackend* backend);
+  void (*destroy)(RenderBackend* backend);
+  // Sprite images for Quad.texture; RENDER_INVALID_SPRITE when there is no room. The
+  // sprite hooks must be thread-safe: the game thread calls them while the render thread
+  // records frames that sample the same sprites.
+  uint32_t (*add_sprite)(RenderBackend* backend, const uint8_t* rgba, uint32_t width, uint32_t height);
+  void (*remove_sprite)(RenderBackend* backend, uint32_t sprite);
+  // Points quad's texture and uv at the sprite; false until the sprite can be sampled.
+  bool (*get_sprite)(RenderBackend* backend, uint32_t sprite, Quad* quad);
+  float gpu_ms;  // smoothed GPU frame time, 0 without a GPU
+};
@@ -0,0 +1,578 @@
+#include "render_graph.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MAX_BATCH_BARRIERS (RG_MAX_RESOURCES + RG_MAX_PASS_ACCESSES)
+
+typedef struct {
+  VkPipelineStageFlags2 stage;
+  VkAccessFlags2 access;
+  VkImageLayout layout;
+  VkImageUsageFlags image_usage;
+} AccessInfo;
+
+// Only stage/access bits that also exist in the legacy enums are used, so the
+// fallback path for devices without synchronization2 can truncate them.
+static const AccessInfo access_infos[COUNT_RG_ACCESSES] = {
+    [RG_ACCESS_COLOR_ATTACHMENT_WRITE] = {
+        VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT},
+    [RG_ACCESS_DEPTH_ATTACHMENT_WRITE] = {
+        VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+        VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT},
+    [RG_ACCESS_SAMPLED_FRAGMENT] = {
+        VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT},
+    [RG_ACCESS_SAMPLED_COMPUTE] = {
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT},
+    [RG_ACCESS_STORAGE_READ_VERTEX] = {
+        VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT},
+    [RG_ACCESS_STORAGE_READ_COMPUTE] = {
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT,
+        VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT},
+    [RG_ACCESS_STORAGE_WRITE_COMPUTE] = {
+        VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT},
+    [RG_ACCESS_INDIRECT_READ] = {
+        VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT, VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED, 0},
+    [RG_ACCESS_TRANSFER_READ] = {
+        VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_READ_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT},
+    [RG_ACCESS_TRANSFER_WRITE] = {
+        VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT},
+    [RG_ACCESS_PRESENT] = {
+        VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, 0,
+        VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 0},
+};
+
+typedef struct {
+  VkImageLayout layout;
+  VkPipelineStageFlags2 write_stage;
+  VkAccessFlags2 write_access;
+  VkPipelineStageFlags2 read_stages;  // stages already synchronized with the last write
+} ResourceState;
+
+static bool is_depth_format(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+      return true;
+    default:
+      return false;
+  }
+}
+
+static VkImageAspectFlags aspect_for_format(VkFormat format) {
+  if (!is_depth_format(format)) return VK_IMAGE_ASPECT_COLOR_BIT;
+  VkImageAspectFlags aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+  if (format != VK_FORMAT_D16_UNORM && format != VK_FORMAT_D32_SFLOAT) aspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+  return aspect;
+}
+
+void render_graph_init(RenderGraph* graph, VkContext* ctx) {
+  memset(graph, 0, sizeof(*graph));
+  graph->ctx = ctx;
+}
+
+static RenderGraphHandle add_resource(RenderGraph* graph, const char* name, RenderGraphResourceType type) {
+  if (graph->resource_count >= RG_MAX_RESOURCES) {
+    fprintf(stderr, "Render graph: too many resources (%s)\n", name);
+    return RG_INVALID_HANDLE;
+  }
+  RenderGraphHandle handle = graph->resource_count++;
+  RenderGraphResource* res = &graph->resources[handle];
+  memset(res, 0, sizeof(*res));
+  res->name = name;
+  res->type = type;
+  res->first_pass = UINT32_MAX;
+  res->last_pass = 0;
+  return handle;
+}
+
+RenderGraphHandle render_graph_create_image(RenderGraph* graph, const char* name, const RenderGraphImageDesc* desc) {
+  RenderGraphHandle handle = add_resource(graph, name, RG_RESOURCE_IMAGE);
+  if (handle != RG_INVALID_HANDLE) graph->resources[handle].desc = *desc;
+  return handle;
+}
+
+RenderGraphHandle render_graph_import_image(RenderGraph* graph, const char* name, const RenderGraphImportDesc* import) {
+  RenderGraphHandle handle = add_resource(graph, name, RG_RESOURCE_IMAGE);
+  if (handle == RG_INVALID_HANDLE) return handle;
+  graph->resources[handle].imported = true;
+  graph->resources[handle].import = *import;
+  return handle;
+}
+
+RenderGraphHandle render_graph_import_buffer(RenderGraph* graph, const char* name, const RenderGraphImportDesc* import) {
+  RenderGraphHandle handle = add_resource(graph, name, RG_RESOURCE_BUFFER);
+  if (handle == RG_INVALID_HANDLE) return handle;
+  graph->resources[handle].imported = true;
+  graph->resources[handle].import = *import;
+  return handle;
+}
+
+uint32_t render_graph_add_pass(RenderGraph* graph, const char* name, RenderGraphExecuteFn execute, void* user_data) {
+  if (graph->pass_count >= RG_MAX_PASSES) {
+    fprintf(stderr, "Render graph: too many passes (%s)\n", name);
+    return RG_INVALID_HANDLE;
+  }
+  uint32_t index = graph->pass_count++;
+  RenderGraphPass* pass = &graph->passes[index];
+  memset(pass, 0, sizeof(*pass));
+  pass->name = name;
+  pass->execute = execute;
+  pass->user_data = user_data;
+  return index;
+}
+
+static void add_use(RenderGraph* graph, uint32_t pass_index, RenderGraphHandle resource, RenderGraphAccess access, bool write) {
+  if (pass_index >= graph->pass_count || resource >= graph->resource_count) return;
+  RenderGraphPass* pass = &graph->passes[pass_index];
+  if (pass->use_count >= RG_MAX_PASS_ACCESSES) {
+    fprintf(stderr, "Render graph: pass '%s' declares too many accesses\n", pass->name);
+    return;
+  }
+  pass->uses[pass->use_count++] = (RenderGraphUse){.resource = resource, .access = access, .write = write};
+}
+
+void render_graph_read(RenderGraph* graph, uint32_t pass, RenderGraphHandle resource, RenderGraphAccess access) {
+  add_use(graph, pass, resource, access, false);
+}
+
+void render_graph_write(RenderGraph* graph, uint32_t pass, RenderGraphHandle resource, RenderGraphAccess access) {
+  add_use(graph, pass, resource, access, true);
+}
+
+void render_graph_set_side_effects(RenderGraph* graph, uint32_t pass) {
+  if (pass < graph->pass_count) graph->passes[pass].side_effects = true;
+}
+
+// Walks passes back to front: a pass survives if it has side effects, writes an
+// imported resource, or writes something a surviving pass reads.
+static void cull_passes(RenderGraph* graph) {
+  bool needed[RG_MAX_RESOURCES] = {0};
+  for (uint32_t r = 0; r < graph->resource_count; ++r) {
+    needed[r] = graph->resources[r].imported;
+  }
+
+  for (uint32_t p = graph->pass_count; p-- > 0;) {
+    RenderGraphPass* pass = &graph->passes[p];
+    bool keep = pass->side_effects;
+    for (uint32_t u = 0; u < pass->use_count && !keep; ++u) {
+      if (pass->uses[u].write && needed[pass->uses[u].resource]) keep = true;
+    }
+    pass->culled = !keep;
+    if (!keep) continue;
+    for (uint32_t u = 0; u < pass->use_count; ++u) {
+      if (!pass->uses[u].write) needed[pass->uses[u].resource] = true;
+    }
+  }
+}
+
+static void compute_lifetimes(RenderGraph* graph) {
+  for (uint32_t r = 0; r < graph->resource_count; ++r) {
+    RenderGraphResource* res = &graph->resources[r];
+    res->first_pass = UINT32_MAX;
+    res->last_pass = 0;
+    res->first_src_stage = 0;
+    res->first_src_access = 0;
+  }
+  graph->unaliased_bytes = 0;
+
+  for (uint32_t p = 0; p < graph->pass_count; ++p) {
+    RenderGraphPass* pass = &graph->passes[p];
+    if (pass->culled) continue;
+    for (uint32_t u = 0; u < pass->use_count; ++u) {
+      RenderGraphResource* res = &graph->resources[pass->uses[u].resource];
+      if (res->first_pass == UINT32_MAX) res->first_pass = p;
+      res->last_pass = p;
+      res->desc.usage |= access_infos[pass->uses[u].access].image_usage;
+    }
+  }
+}
+
+static bool lifetimes_overlap(const RenderGraphResource* a, const RenderGraphResource* b) {
+  return a->first_pass <= b->last_pass && b->first_pass <= a->last_pass;
+}
+
+static bool ranges_overlap(const RenderGraphResource* a, const RenderGraphResource* b) {
+  return a->memory_offset < b->memory_offset + b->memory_size && b->memory_offset < a->memory_offset + a->memory_size;
+}
+
+static bool is_live_transient(const RenderGraphResource* res) {
+  return !res->imported && res->type == RG_RESOURCE_IMAGE && res->first_pass != UINT32_MAX;
+}
+
+// Stage/access of the last pass that touched a resource, used as the source scope of
+// the first use of whatever occupies its memory next.
+static void last_use_scope(RenderGraph* graph, const RenderGraphResource* res, RenderGraphHandle handle,
+                           VkPipelineStageFlags2* stage, VkAccessFlags2* access) {
+  const RenderGraphPass* pass = &graph->passes[res->last_pass];
+  for (uint32_t u = 0; u < pass->use_count; ++u) {
+    if (pass->uses[u].resource != handle) continue;
+    const AccessInfo* info = &access_infos[pass->uses[u].access];
+    *stage |= info->stage;
+    if (pass->uses[u].write) *access |= info->access;
+  }
+}
+
+static VkResult allocate_transients(RenderGraph* graph) {
+  VkContext* ctx = graph->ctx;
+  VkMemoryRequirements reqs[RG_MAX_RESOURCES] = {0};
+  uint32_t order[RG_MAX_RESOURCES];
+  uint32_t order_count = 0;
+  uint32_t type_bits = UINT32_MAX;
+
+  for (uint32_t r = 0; r < graph->resource_count; ++r) {
+    RenderGraphResource* res = &graph->resources[r];
+    if (!is_live_transient(res)) continue;
+
+    VkImageCreateInfo image_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType = VK_IMAGE_TYPE_2D,
+        .format = res->desc.format,
+        .extent = {res->desc.extent.width, res->desc.extent.height, 1},
+        .mipLevels = 1,
+        .arrayLayers = 1,
+        .samples = VK_SAMPLE_COUNT_1_BIT,
+        .tiling = VK_IMAGE_TILING_OPTIMAL,
+        .usage = res->desc.usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+    VkResult result = vkCreateImage(ctx->device, &image_info, NULL, &res->image);
+    if (result != VK_SUCCESS) {
+      fprintf(stderr, "Render graph: failed to create image '%s'\n", res->name);
+      return result;
+    }
+    vkGetImageMemoryRequirements(ctx->device, res->image, &reqs[r]);
+    res->memory_size = reqs[r].size;
+    type_bits &= reqs[r].memoryTypeBits;
+    graph->unaliased_bytes += reqs[r].size;
+    order[order_count++] = r;
+  }
+  if (order_count == 0) return VK_SUCCESS;
+
+  // Largest first, then first-fit into the lowest offset that doesn't collide with
+  // any placed resource whose lifetime overlaps.
+  for (uint32_t i = 1; i < order_count; ++i) {
+    uint32_t key = order[i];
+    uint32_t j = i;
+    while (j > 0 && reqs[order[j - 1]].size < reqs[key].size) {
+      order[j] = order[j - 1];
+      j--;
+    }
+    order[j] = key;
+  }
+
+  VkDeviceSize heap_size = 0;
+  for (uint32_t i = 0; i < order_count; ++i) {
+    RenderGraphResource* res = &graph->resources[order[i]];
+    res->memory_offset = 0;
+    bool moved = true;
+    while (moved) {
+      moved = false;
+      for (uint32_t k = 0; k < i; ++k) {
+        RenderGraphResource* other = &graph->resources[order[k]];
+        if (lifetimes_overlap(res, other) && ranges_overlap(res, other)) {
+          res->memory_offset = ALIGN_FORWARD(other->memory_offset + other->memory_size, reqs[order[i]].alignment);
+          moved = true;
+        }
+      }
+    }
+    if (res->memory_offset + res->memory_size > heap_size) heap_size = res->memory_offset + res->memory_size;
+  }
+
+  // The memory is reused by every execute, and frames in flight share it, so a first use
+  // also waits for the previous execute's last use of each overlapping image.
+  for (uint32_t i = 0; i < order_count; ++i) {
+    RenderGraphResource* res = &graph->resources[order[i]];
+    for (uint32_t k = 0; k < order_count; ++k) {
+      RenderGraphResource* other = &graph->resources[order[k]];
+      if (ranges_overlap(res, other)) {
+        last_use_scope(graph, other, order[k], &res->first_src_stage, &res->first_src_access);
+      }
+    }
+  }
+
+  uint32_t memory_type = vk_find_memory_type(ctx, type_bits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (memory_type == UINT32_MAX) {
+    fprintf(stderr, "Render graph: no memory type fits all transient images\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  VkMemoryAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = heap_size,
+      .memoryTypeIndex = memory_type};
+  VK_RETURN(vk_allocate_memory(ctx, &alloc_info, &graph->transient_memory));
+  graph->transient_bytes = heap_size;
+
+  for (uint32_t i = 0; i < order_count; ++i) {
+    RenderGraphResource* res = &graph->resources[order[i]];
+    VK_RETURN(vkBindImageMemory(ctx->device, res->image, graph->transient_memory, res->memory_offset));
+
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = res->image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = res->desc.format,
+        .subresourceRange = {aspect_for_format(res->desc.format), 0, 1, 0, 1}};
+    VK_RETURN(vkCreateImageView(ctx->device, &view_info, NULL, &res->view));
+  }
+
+  fprintf(stderr, "Render graph: %u transient images, %llu KiB (%llu KiB without aliasing)\n", order_count,
+          (unsigned long long)(graph->transient_bytes / 1024), (unsigned long long)(graph->unaliased_bytes / 1024));
+  return VK_SUCCESS;
+}
+
+static void push_barrier(RenderGraph* graph, ResourceState* state, RenderGraphHandle handle,
+                         RenderGraphAccess access, bool write) {
+  const RenderGraphResource* res = &graph->resources[handle];
+  const AccessInfo* info = &access_infos[access];
+  bool is_image = res->type == RG_RESOURCE_IMAGE;
+  VkImageLayout new_layout = is_image ? info->layout : VK_IMAGE_LAYOUT_UNDEFINED;
+  bool layout_change = is_image && state->layout != new_layout;
+
+  RenderGraphBarrier barrier = {
+      .resource = handle,
+      .dst_stage = info->stage,
+      .dst_access = info->access,
+      .old_layout = state->layout,
+      .new_layout = new_layout};
+  bool needed = false;
+
+  if (write || layout_change) {
+    // Layout transitions are writes too, so they wait for earlier readers as well.
+    needed = layout_change || state->write_stage || state->read_stages;
+    barrier.src_stage = state->write_stage | state->read_stages;
+    barrier.src_access = state->write_access;
+    state->write_stage = info->stage;
+    state->write_access = write ? info->access : state->write_access;
+    state->read_stages = write ? 0 : info->stage;
+  } else if (state->write_stage && (info->stage & ~state->read_stages)) {
+    needed = true;
+    barrier.src_stage = state->write_stage;
+    barrier.src_access = state->write_access;
+    state->read_stages |= info->stage;
+  } else {
+    state->read_stages |= info->stage;
+  }
+  state->layout = new_layout;
+
+  if (!needed || graph->barrier_count >= RG_MAX_BARRIERS) return;
+  graph->barriers[graph->barrier_count++] = barrier;
+}
+
+static void compute_barriers(RenderGraph* graph) {
+  ResourceState states[RG_MAX_RESOURCES] = {0};
+  for (uint32_t r = 0; r < graph->resource_count; ++r) {
+    RenderGraphResource* res = &graph->resources[r];
+    if (res->imported) {
+      states[r].layout = res->import.initial_layout;
+      states[r].write_stage = res->import.initial_stage;
+      states[r].write_access = res->import.initial_access;
+    } else {
+      states[r].layout = VK_IMAGE_LAYOUT_UNDEFINED;
+      states[r].write_stage = res->first_src_stage;
+      states[r].write_access = res->first_src_access;
+    }
+  }
+
+  graph->barrier_count = 0;
+  for (uint32_t p = 0; p < graph->pass_count; ++p) {
+    RenderGraphPass* pass = &graph->passes[p];
+    pass->first_barrier = graph->barrier_count;
+    if (!pass->culled) {
+      for (uint32_t u = 0; u < pass->use_count; ++u) {
+        push_barrier(graph, &states[pass->uses[u].resource], pass->uses[u].resource, pass->uses[u].access, pass->uses[u].write);
+      }
+    }
+    pass->barrier_count = graph->barrier_count - pass->first_barrier;
+  }
+
+  graph->final_barrier_first = graph->barrier_count;
+  for (uint32_t r = 0; r < graph->resource_count; ++r) {
+    RenderGraphResource* res = &graph->resources[r];
+    if (res->imported && res->import.has_final_access) {
+      push_barrier(graph, &states[r], r, res->import.final_access, false);
+    }
+  }
+  graph->final_barrier_count = graph->barrier_count - graph->final_barrier_first;
+}
+
+VkResult render_graph_compile(RenderGraph* graph) {
+  cull_passes(graph);
+  compute_lifetimes(graph);
+
+  VkResult res = allocate_transients(graph);
+  if (res != VK_SUCCESS) {
+    render_graph_destroy(graph);
+    return res;
+  }
+  compute_barriers(graph);
+
+  for (uint32_t p = 0; p < graph->pass_count; ++p) {
+    if (graph->passes[p].culled) fprintf(stderr, "Render graph: culled pass '%s'\n", graph->passes[p].name);
+  }
+  graph->compiled = true;
+  return VK_SUCCESS;
+}
+
+void render_graph_bind_image(RenderGraph* graph, RenderGraphHandle handle, VkImage image, VkImageView view) {
+  graph->resources[handle].image = image;
+  graph->resources[handle].view = view;
+}
+
+void render_graph_bind_buffer(RenderGraph* graph, RenderGraphHandle handle, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size) {
+  graph->resources[handle].buffer = buffer;
+  graph->resources[handle].buffer_offset = offset;
+  graph->resources[handle].buffer_size = size;
+}
+
+VkImage render_graph_get_image(RenderGraph* graph, RenderGraphHandle handle) {
+  return graph->resources[handle].image;
+}
+
+VkImageView render_graph_get_image_view(RenderGraph* graph, RenderGraphHandle handle) {
+  return graph->resources[handle].view;
+}
+
+VkBuffer render_graph_get_buffer(RenderGraph* graph, RenderGraphHandle handle) {
+  return graph->resources[handle].buffer;
+}
+
+static VkImageSubresourceRange full_range(const RenderGraphResource* res) {
+  VkImageAspectFlags aspect = res->imported ? VK_IMAGE_ASPECT_COLOR_BIT : aspect_for_format(res->desc.format);
+  return (VkImageSubresourceRange){aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+}
+
+static void emit_barriers_sync2(RenderGraph* graph, VkCommandBuffer cmd, uint32_t first, uint32_t count) {
+  VkImageMemoryBarrier2 image_barriers[MAX_BATCH_BARRIERS];
+  VkBufferMemoryBarrier2 buffer_barriers[MAX_BATCH_BARRIERS];
+  uint32_t image_count = 0, buffer_count = 0;
+
+  for (uint32_t i = first; i < first + count; ++i) {
+    const RenderGraphBarrier* b = &graph->barriers[i];
+    const RenderGraphResource* res = &graph->resources[b->resource];
+    if (res->type == RG_RESOURCE_IMAGE) {
+      image_barriers[image_count++] = (VkImageMemoryBarrier2){
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2,
+          .srcStageMask = b->src_stage,
+          .srcAccessMask = b->src_access,
+          .dstStageMask = b->dst_stage,
+          .dstAccessMask = b->dst_access,
+          .oldLayout = b->old_layout,
+          .newLayout = b->new_layout,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = res->image,
+          .subresourceRange = full_range(res)};
+    } else {
+      buffer_barriers[buffer_count++] = (VkBufferMemoryBarrier2){
+          .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+          .srcStageMask = b->src_stage,
+          .srcAccessMask = b->src_access,
+          .dstStageMask = b->dst_stage,
+          .dstAccessMask = b->dst_access,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .buffer = res->buffer,
+          .offset = res->buffer_offset,
+          .size = res->buffer_size ? res->buffer_size : VK_WHOLE_SIZE};
+    }
+  }
+
+  VkDependencyInfo dependency_info = {
+      .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+      .bufferMemoryBarrierCount = buffer_count,
+      .pBufferMemoryBarriers = buffer_barriers,
+      .imageMemoryBarrierCount = image_count,
+      .pImageMemoryBarriers = image_barriers};
+  graph->ctx->cmd_pipeline_barrier2(cmd, &dependency_info);
+}
+
+static void emit_barriers_legacy(RenderGraph* graph, VkCommandBuffer cmd, uint32_t first, uint32_t count) {
+  VkImageMemoryBarrier image_barriers[MAX_BATCH_BARRIERS];
+  VkBufferMemoryBarrier buffer_barriers[MAX_BATCH_BARRIERS];
+  uint32_t image_count = 0, buffer_count = 0;
+  VkPipelineStageFlags src_stages = 0, dst_stages = 0;
+
+  for (uint32_t i = first; i < first + count; ++i) {
+    const RenderGraphBarrier* b = &graph->barriers[i];
+    const RenderGraphResource* res = &graph->resources[b->resource];
+    src_stages |= (VkPipelineStageFlags)b->src_stage;
+    dst_stages |= (VkPipelineStageFlags)b->dst_stage;
+    if (res->type == RG_RESOURCE_IMAGE) {
+      image_barriers[image_count++] = (VkImageMemoryBarrier){
+          .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+          .srcAccessMask = (VkAccessFlags)b->src_access,
+          .dstAccessMask = (VkAccessFlags)b->dst_access,
+          .oldLayout = b->old_layout,
+          .newLayout = b->new_layout,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = res->image,
+          .subresourceRange = full_range(res)};
+    } else {
+      buffer_barriers[buffer_count++] = (VkBufferMemoryBarrier){
+          .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+          .srcAccessMask = (VkAccessFlags)b->src_access,
+          .dstAccessMask = (VkAccessFlags)b->dst_access,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .buffer = res->buffer,
+          .offset = res->buffer_offset,
+          .size = res->buffer_size ? res->buffer_size : VK_WHOLE_SIZE};
+    }
+  }
+
+  if (!src_stages) src_stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+  if (!dst_stages) dst_stages = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+  vkCmdPipelineBarrier(cmd, src_stages, dst_stages, 0, 0, NULL, buffer_count, buffer_barriers, image_count, image_barriers);
+}
+
+static void emit_barriers(RenderGraph* graph, VkCommandBuffer cmd, uint32_t first, uint32_t count) {
+  if (count == 0) return;
+  if (graph->ctx->has_synchronization2) {
+    emit_barriers_sync2(graph, cmd, first, count);
+  } else {
+    emit_barriers_legacy(graph, cmd, first, count);
+  }
+}
+
+void render_graph_execute(RenderGraph* graph, VkCommandBuffer cmd) {
+  if (!graph->compiled) return;
+  for (uint32_t p = 0; p < graph->pass_count; ++p) {
+    RenderGraphPass* pass = &graph->passes[p];
+    if (pass->culled) continue;
+    emit_barriers(graph, cmd, pass->first_barrier, pass->barrier_count);
+    pass->execute(graph, cmd, pass->user_data);
+  }
+  emit_barriers(graph, cmd, graph->final_barrier_first, graph->final_barrier_count);
+}
+
+void render_graph_destroy(RenderGraph* graph) {
+  VkDevice device = graph->ctx->device;
+  for (uint32_t r = 0; r < graph->resource_count; ++r) {
+    RenderGraphResource* res = &graph->resources[r];
+    if (res->imported) continue;
+    if (res->view != VK_NULL_HANDLE) vkDestroyImageView(device, res->view, NULL);
+    if (res->image != VK_NULL_HANDLE) vkDestroyImage(device, res->image, NULL);
+    res->view = VK_NULL_HANDLE;
+    res->image = VK_NULL_HANDLE;
+  }
+  atomic_fetch_add_explicit(&graph->ctx->destroyed_resources, 1, memory_order_relaxed);
+  if (graph->transient_memory != VK_NULL_HANDLE) {
+    vk_free_memory(graph->ctx, graph->transient_memory);
+    graph->transient_memory = VK_NULL_HANDLE;
+  }
+  graph->compiled = false;
+}
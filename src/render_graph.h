@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "vk.h"
+
+#define RG_MAX_PASSES 32
+#define RG_MAX_RESOURCES 32
+#define RG_MAX_PASS_ACCESSES 8
+#define RG_MAX_BARRIERS (RG_MAX_PASSES * RG_MAX_PASS_ACCESSES)
+#define RG_INVALID_HANDLE UINT32_MAX
+
+typedef uint32_t RenderGraphHandle;
+
+typedef enum {
+  RG_ACCESS_COLOR_ATTACHMENT_WRITE = 0,
+  RG_ACCESS_DEPTH_ATTACHMENT_WRITE,
+  RG_ACCESS_SAMPLED_FRAGMENT,
+  RG_ACCESS_SAMPLED_COMPUTE,
+  RG_ACCESS_STORAGE_READ_VERTEX,
+  RG_ACCESS_STORAGE_READ_COMPUTE,
+  RG_ACCESS_STORAGE_WRITE_COMPUTE,
+  RG_ACCESS_INDIRECT_READ,
+  RG_ACCESS_TRANSFER_READ,
+  RG_ACCESS_TRANSFER_WRITE,
+  RG_ACCESS_PRESENT,
+  COUNT_RG_ACCESSES
+} RenderGraphAccess;
+
+typedef enum {
+  RG_RESOURCE_IMAGE = 0,
+  RG_RESOURCE_BUFFER,
+} RenderGraphResourceType;
+
+typedef struct {
+  VkFormat format;
+  VkExtent2D extent;
+  VkImageUsageFlags usage;  // added to the usage derived from the declared accesses
+} RenderGraphImageDesc;
+
+// State an imported resource is in when the graph starts and the access it must be left in.
+typedef struct {
+  VkPipelineStageFlags2 initial_stage;
+  VkAccessFlags2 initial_access;
+  VkImageLayout initial_layout;
+  bool has_final_access;
+  RenderGraphAccess final_access;
+} RenderGraphImportDesc;
+
+typedef struct {
+  const char* name;
+  RenderGraphResourceType type;
+  bool imported;
+  RenderGraphImportDesc import;
+  RenderGraphImageDesc desc;
+
+  VkImage image;
+  VkImageView view;
+  VkBuffer buffer;
+  VkDeviceSize buffer_offset;
+  VkDeviceSize buffer_size;
+
+  // Filled by render_graph_compile.
+  uint32_t first_pass;
+  uint32_t last_pass;
+  VkDeviceSize memory_offset;
+  VkDeviceSize memory_size;
+  // Last uses of every transient sharing this memory, itself included: earlier in the
+  // same execute when aliased, otherwise in the previous execute (the previous view or
+  // frame, on the same queue). The first use waits on them.
+  VkPipelineStageFlags2 first_src_stage;
+  VkAccessFlags2 first_src_access;
+} RenderGraphResource;
+
+typedef struct RenderGraph RenderGraph;
+typedef void (*RenderGraphExecuteFn)(RenderGraph* graph, VkCommandBuffer cmd, void* user_data);
+
+typedef struct {
+  RenderGraphHandle resource;
+  RenderGraphAccess access;
+  bool write;
+} RenderGraphUse;
+
+typedef struct {
+  const char* name;
+  RenderGraphExecuteFn execute;
+  void* user_data;
+  bool side_effects;
+  bool culled;
+  RenderGraphUse uses[RG_MAX_PASS_ACCESSES];
+  uint32_t use_count;
+  uint32_t first_barrier;
+  uint32_t barrier_count;
+} RenderGraphPass;
+
+typedef struct {
+  RenderGraphHandle resource;
+  VkPipelineStageFlags2 src_stage;
+  VkAccessFlags2 src_access;
+  VkPipelineStageFlags2 dst_stage;
+  VkAccessFlags2 dst_access;
+  VkImageLayout old_layout;
+  VkImageLayout new_layout;
+} RenderGraphBarrier;
+
+struct RenderGraph {
+  VkContext* ctx;
+  RenderGraphPass passes[RG_MAX_PASSES];
+  uint32_t pass_count;
+  RenderGraphResource resources[RG_MAX_RESOURCES];
+  uint32_t resource_count;
+
+  RenderGraphBarrier barriers[RG_MAX_BARRIERS];
+  uint32_t barrier_count;
+  uint32_t final_barrier_first;
+  uint32_t final_barrier_count;
+
+  VkDeviceMemory transient_memory;
+  VkDeviceSize transient_bytes;
+  VkDeviceSize unaliased_bytes;
+  bool compiled;
+};
+
+void render_graph_init(RenderGraph* graph, VkContext* ctx);
+RenderGraphHandle render_graph_create_image(RenderGraph* graph, const char* name, const RenderGraphImageDesc* desc);
+RenderGraphHandle render_graph_import_image(RenderGraph* graph, const char* name, const RenderGraphImportDesc* import);
+RenderGraphHandle render_graph_import_buffer(RenderGraph* graph, const char* name, const RenderGraphImportDesc* import);
+
+uint32_t render_graph_add_pass(RenderGraph* graph, const char* name, RenderGraphExecuteFn execute, void* user_data);
+void render_graph_read(RenderGraph* graph, uint32_t pass, RenderGraphHandle resource, RenderGraphAccess access);
+void render_graph_write(RenderGraph* graph, uint32_t pass, RenderGraphHandle resource, RenderGraphAccess access);
+// Keeps a pass alive even if nothing reads what it writes (readbacks, timestamp queries...).
+void render_graph_set_side_effects(RenderGraph* graph, uint32_t pass);
+
+// Culls unused passes, allocates and aliases transient images and precomputes all barriers.
+VkResult render_graph_compile(RenderGraph* graph);
+
+// Imported resources must be bound before every execute.
+void render_graph_bind_image(RenderGraph* graph, RenderGraphHandle handle, VkImage image, VkImageView view);
+void render_graph_bind_buffer(RenderGraph* graph, RenderGraphHandle handle, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size);
+VkImage render_graph_get_image(RenderGraph* graph, RenderGraphHandle handle);
+VkImageView render_graph_get_image_view(RenderGraph* graph, RenderGraphHandle handle);
+VkBuffer render_graph_get_buffer(RenderGraph* graph, RenderGraphHandle handle);
+
+void render_graph_execute(RenderGraph* graph, VkCommandBuffer cmd);
+void render_graph_destroy(RenderGraph* graph);
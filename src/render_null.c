@@ -0,0 +1,120 @@
+#include "render_null.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "base.h"
+
+// Appends a command and its payload; on allocation failure the command is dropped.
+static void record(NullRenderer* renderer, NullCommand command, const void* payload) {
+  size_t needed = renderer->size + sizeof(command) + command.size;
+  if (needed > renderer->capacity) {
+    size_t capacity = MAX(renderer->capacity * 2, needed);
+    uint8_t* commands = realloc(renderer->commands, capacity);
+    if (!commands) return;
+    renderer->commands = commands;
+    renderer->capacity = capacity;
+  }
+  memcpy(renderer->commands + renderer->size, &command, sizeof(command));
+  if (command.size) memcpy(renderer->commands + renderer->size + sizeof(command), payload, command.size);
+  renderer->size = needed;
+}
+
+static uint32_t null_begin_frame(RenderBackend* backend, RenderView* views, uint32_t max_views) {
+  NullRenderer* renderer = (NullRenderer*)backend;
+  uint32_t count = MIN(renderer->view_count, max_views);
+  for (uint32_t i = 0; i < count; ++i) {
+    views[i].width = renderer->width;
+    views[i].height = renderer->height;
+  }
+  renderer->size = 0;
+  renderer->draw_count = 0;
+  return count;
+}
+
+// Records what the Vulkan backend draws for each view, in the same order: the scene, one
+// instanced draw per quad batch, particles, then the overlay.
+static void null_end_frame(RenderBackend* backend, const RenderFrame* frame) {
+  NullRenderer* renderer = (NullRenderer*)backend;
+  for (uint32_t i = 0; i < frame->view_count; ++i) {
+    record(renderer, (NullCommand){.type = NULL_COMMAND_BEGIN_VIEW, .size = sizeof(RenderView)}, &frame->views[i]);
+    record(renderer, (NullCommand){.type = NULL_COMMAND_DRAW_SCENE}, NULL);
+    renderer->draw_count++;
+    for (uint32_t b = 0; b < frame->batch_count; ++b) {
+      const QuadBatch* batch = &frame->batches[b];
+      NullCommand command = {.type = NULL_COMMAND_DRAW_QUADS,
+                             .texture = batch->texture,
+                             .count = batch->count,
+                             .size = batch->count * (uint32_t)sizeof(Quad)};
+      record(renderer, command, &frame->quads[batch->first]);
+      renderer->draw_count++;
+    }
+    if (frame->emitter_count) {
+      NullCommand command = {.type = NULL_COMMAND_DRAW_PARTICLES,
+                             .count = frame->emitter_count,
+                             .size = frame->emitter_count * (uint32_t)sizeof(ParticleEmitter)};
+      record(renderer, command, frame->emitters);
+      renderer->draw_count++;
+    }
+    if (frame->overlay) {
+      record(renderer, (NullCommand){.type = NULL_COMMAND_DRAW_OVERLAY}, NULL);
+      renderer->draw_count++;
+    }
+    if (frame->capture.requested && frame->capture.window == i) {
+      record(renderer, (NullCommand){.type = NULL_COMMAND_CAPTURE}, NULL);
+    }
+  }
+  renderer->bytes_recorded += renderer->size;
+  renderer->frames++;
+}
+
+static void null_wait_idle(RenderBackend* backend) {
+  (void)backend;
+}
+
+static void null_destroy(RenderBackend* backend) {
+  NullRenderer* renderer = (NullRenderer*)backend;
+  if (renderer->frames) {
+    fprintf(stderr, "Null backend: %llu frames, %.1f KiB recorded per frame\n", (unsigned long long)renderer->frames,
+            (double)renderer->bytes_recorded / (double)renderer->frames / 1024.0);
+  }
+  free(renderer->commands);
+  renderer->commands = NULL;
+  renderer->size = renderer->capacity = 0;
+}
+
+static uint32_t null_add_sprite(RenderBackend* backend, const uint8_t* rgba, uint32_t width, uint32_t height) {
+  (void)rgba;
+  NullRenderer* renderer = (NullRenderer*)backend;
+  if (width == 0 || height == 0) return RENDER_INVALID_SPRITE;
+  return atomic_fetch_add(&renderer->sprite_count, 1);
+}
+
+static void null_remove_sprite(RenderBackend* backend, uint32_t sprite) {
+  (void)backend;
+  (void)sprite;
+}
+
+static bool null_get_sprite(RenderBackend* backend, uint32_t sprite, Quad* quad) {
+  NullRenderer* renderer = (NullRenderer*)backend;
+  if (sprite >= atomic_load(&renderer->sprite_count)) return false;
+  quad->texture = sprite;
+  quad->u0 = quad->v0 = 0.0f;
+  quad->u1 = quad->v1 = 1.0f;
+  return true;
+}
+
+void null_renderer_init(NullRenderer* renderer, uint32_t width, uint32_t height, uint32_t view_count) {
+  memset(renderer, 0, sizeof(*renderer));
+  renderer->base = (RenderBackend){
+      .name = "null",
+      .begin_frame = null_begin_frame,
+      .end_frame = null_end_frame,
+      .wait_idle = null_wait_idle,
+      .destroy = null_destroy,
+      .add_sprite = null_add_sprite,
+      .remove_sprite = null_remove_sprite,
+      .get_sprite = null_get_sprite};
+  renderer->width = width;
+  renderer->height = height;
+  renderer->view_count = MIN(view_count, RENDER_MAX_VIEWS);
+}
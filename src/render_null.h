@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "render_backend.h"
+
+typedef enum {
+  NULL_COMMAND_BEGIN_VIEW = 0,  // followed by the view's RenderView
+  NULL_COMMAND_DRAW_SCENE,
+  NULL_COMMAND_DRAW_QUADS,  // followed by count Quads, the instance data a GPU would read
+  NULL_COMMAND_DRAW_PARTICLES,  // followed by count ParticleEmitters
+  NULL_COMMAND_DRAW_OVERLAY,
+  NULL_COMMAND_CAPTURE,
+} NullCommandType;
+
+typedef struct {
+  uint32_t type;  // NullCommandType
+  uint32_t texture;
+  uint32_t count;
+  uint32_t size;  // bytes of payload after this header
+} NullCommand;
+
+// A backend with no device: frames are recorded into a command buffer in memory and
+// dropped, so the frontend's packet handling, sorting and batching can be timed without
+// driver or GPU cost. The buffer grows to the largest frame and is then reused.
+typedef struct {
+  RenderBackend base;
+  uint32_t width, height;
+  uint32_t view_count;
+  uint8_t* commands;
+  size_t size;
+  size_t capacity;
+  uint32_t draw_count;  // last frame
+  uint64_t frames;
+  uint64_t bytes_recorded;  // over all frames
+  atomic_uint sprite_count;  // each sprite's id doubles as its texture handle
+} NullRenderer;
+
+// Reports view_count views (at most RENDER_MAX_VIEWS) of width x height.
+void null_renderer_init(NullRenderer* renderer, uint32_t width, uint32_t height, uint32_t view_count);
@@ -0,0 +1,548 @@
+#include "render_vulkan.h"
+#include <stdio.h>
+#include <string.h>
+
+static VkResult record_command_buffer(VulkanRenderer* renderer, VkCommandBuffer cmd, const RenderFrame* frame);
+static void main_pass(RenderGraph* graph, VkCommandBuffer cmd, void* user_data);
+static void upscale_pass(RenderGraph* graph, VkCommandBuffer cmd, void* user_data);
+static void overlay_pass(RenderGraph* graph, VkCommandBuffer cmd, void* user_data);
+static void acquire(VkContext* ctx);
+static void submit(VkContext* ctx, VkPipelineStageFlags compute_wait_stages);
+static void present(VkContext* ctx);
+
+// The mesh path draws through the GPU scene, so it needs it enabled.
+static void load_scene_mesh(VulkanRenderer* renderer) {
+  VkContext* ctx = renderer->ctx;
+  GpuScene* scene = &renderer->gpu_scene;
+  if (!scene->enabled) return;
+  if (mesh_load(ctx, RENDER_SCENE_MESH, &renderer->mesh) != VK_SUCCESS) return;
+  // The scene mesh is untextured and always drawn through the culled instance list.
+  GraphicsPipelineDesc desc;
+  mesh_pipeline_desc(&desc, SHADER_FEATURE_INSTANCING);
+  renderer->mesh_pipeline = pipeline_manager_request(&renderer->pipelines, &desc);
+
+  Mesh* mesh = &renderer->mesh;
+  gpu_scene_set_index_buffer(scene, mesh->index_buffer, mesh->index_type);
+  gpu_scene_add_object(scene, &(GpuObject){.radius = mesh->radius, .index_count = mesh->index_count});
+
+  // The texture streams in on the loader thread and may be trimmed or evicted under
+  // memory pressure; the mesh is drawn untextured whenever it is not resident.
+  FILE* texture = fopen(RENDER_SCENE_TEXTURE, "rb");
+  if (!texture) return;
+  fclose(texture);
+  renderer->scene_texture = residency_add_texture(&renderer->residency, RENDER_SCENE_TEXTURE);
+  mesh_pipeline_desc(&desc, SHADER_FEATURE_INSTANCING | SHADER_FEATURE_TEXTURING);
+  renderer->mesh_textured_pipeline = pipeline_manager_request(&renderer->pipelines, &desc);
+}
+
+static VkResult build_render_graph(VulkanRenderer* renderer) {
+  VkContext* ctx = renderer->ctx;
+  RenderGraph* graph = &renderer->graph;
+  render_graph_init(graph, ctx);
+
+  // Acquired images start undefined; the acquire semaphore is waited on at color output.
+  RenderGraphImportDesc backbuffer_import = {
+      .initial_stage = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+      .initial_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+      .has_final_access = true,
+      .final_access = RG_ACCESS_PRESENT};
+  renderer->backbuffer = render_graph_import_image(graph, "backbuffer", &backbuffer_import);
+
+  VkExtent2D scene_extent = {0};
+  for (uint32_t i = 0; i < ctx->window_count; ++i) {
+    scene_extent.width = MAX(scene_extent.width, ctx->windows[i].extent.width);
+    scene_extent.height = MAX(scene_extent.height, ctx->windows[i].extent.height);
+  }
+  // Same format as the swapchain so the main renderer pass can draw into it.
+  RenderGraphImageDesc scene_desc = {.format = ctx->swapchain_image_format, .extent = scene_extent};
+  renderer->scene = render_graph_create_image(graph, "scene", &scene_desc);
+
+  gpu_scene_add_passes(&renderer->gpu_scene, graph);
+
+  uint32_t pass = render_graph_add_pass(graph, "main", main_pass, renderer);
+  render_graph_write(graph, pass, renderer->scene, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+  gpu_scene_declare_draw(&renderer->gpu_scene, graph, pass);
+
+  uint32_t upscale = render_graph_add_pass(graph, "upscale", upscale_pass, renderer);
+  render_graph_read(graph, upscale, renderer->scene, RG_ACCESS_TRANSFER_READ);
+  render_graph_write(graph, upscale, renderer->backbuffer, RG_ACCESS_TRANSFER_WRITE);
+
+  uint32_t overlay = render_graph_add_pass(graph, "overlay", overlay_pass, renderer);
+  render_graph_write(graph, overlay, renderer->backbuffer, RG_ACCESS_COLOR_ATTACHMENT_WRITE);
+
+  VK_RETURN(render_graph_compile(graph));
+
+  VkImageView scene_view = render_graph_get_image_view(graph, renderer->scene);
+  VkFramebufferCreateInfo framebuffer_info = {
+      .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+      .renderPass = ctx->render_pass,
+      .attachmentCount = 1,
+      .pAttachments = &scene_view,
+      .width = scene_extent.width,
+      .height = scene_extent.height,
+      .layers = 1};
+  return vkCreateFramebuffer(ctx->device, &framebuffer_info, NULL, &renderer->scene_framebuffer);
+}
+
+static uint32_t vulkan_begin_frame(RenderBackend* backend, RenderView* views, uint32_t max_views) {
+  VulkanRenderer* renderer = (VulkanRenderer*)backend;
+  VkContext* ctx = renderer->ctx;
+  acquire(ctx);
+  // The fence wait in acquire covers every copy recorded into this frame slot last time.
+  capture_frame_complete(&renderer->capture, ctx->current_frame);
+  vk_collect_garbage(ctx);
+  residency_update(&renderer->residency);
+
+  uint32_t count = MIN(ctx->window_count, max_views);
+  for (uint32_t i = 0; i < count; ++i) {
+    views[i].width = ctx->windows[i].extent.width;
+    views[i].height = ctx->windows[i].extent.height;
+  }
+  return count;
+}
+
+static void vulkan_end_frame(RenderBackend* backend, const RenderFrame* frame) {
+  VulkanRenderer* renderer = (VulkanRenderer*)backend;
+  VkContext* ctx = renderer->ctx;
+  if (frame->cpu_ms > 0.0f) overlay_add_frame_time(&renderer->overlay, frame->cpu_ms);
+  renderer->cpu_ms = frame->cpu_ms;
+  renderer->overlay_visible = frame->overlay;
+  renderer->resolution.fixed_scale = frame->resolution_scale;
+  dynamic_resolution_update(&renderer->resolution, ctx->current_frame);
+  uniform_ring_begin_frame(&ctx->uniforms, ctx->current_frame);
+  descriptor_allocator_begin_frame(&renderer->descriptors, ctx->current_frame);
+  particles_begin_frame(&renderer->particles, frame->emitters, frame->emitter_count, frame->dt);
+
+  VkPipelineStageFlags compute_wait_stages = async_compute_submit(&renderer->compute);
+  record_command_buffer(renderer, ctx->command_buffers[ctx->current_frame], frame);
+  submit(ctx, compute_wait_stages);
+  present(ctx);
+  renderer->base.gpu_ms = renderer->resolution.gpu_ms;
+}
+
+static void vulkan_wait_idle(RenderBackend* backend) {
+  VulkanRenderer* renderer = (VulkanRenderer*)backend;
+  vkDeviceWaitIdle(renderer->ctx->device);
+}
+
+static void vulkan_destroy(RenderBackend* backend) {
+  VulkanRenderer* renderer = (VulkanRenderer*)backend;
+  VkContext* ctx = renderer->ctx;
+  capture_destroy(&renderer->capture);
+  if (renderer->scene_framebuffer != VK_NULL_HANDLE) vkDestroyFramebuffer(ctx->device, renderer->scene_framebuffer, NULL);
+  render_graph_destroy(&renderer->graph);
+  dynamic_resolution_destroy(&renderer->resolution);
+  gpu_scene_destroy(&renderer->gpu_scene);
+  particles_destroy(&renderer->particles);
+  overlay_destroy(&renderer->overlay);
+  residency_destroy(&renderer->residency);
+  descriptor_allocator_destroy(&renderer->descriptors);
+  pipeline_manager_destroy(&renderer->pipelines);
+  mesh_destroy(ctx, &renderer->mesh);
+  atlas_destroy(&renderer->atlas);
+}
+
+static uint32_t vulkan_add_sprite(RenderBackend* backend, const uint8_t* rgba, uint32_t width, uint32_t height) {
+  VulkanRenderer* renderer = (VulkanRenderer*)backend;
+  return atlas_add_pixels(&renderer->atlas, rgba, width, height);
+}
+
+static void vulkan_remove_sprite(RenderBackend* backend, uint32_t sprite) {
+  VulkanRenderer* renderer = (VulkanRenderer*)backend;
+  atlas_remove(&renderer->atlas, sprite);
+}
+
+static bool vulkan_get_sprite(RenderBackend* backend, uint32_t sprite, Quad* quad) {
+  VulkanRenderer* renderer = (VulkanRenderer*)backend;
+  AtlasRegion region;
+  if (!atlas_get_region(&renderer->atlas, sprite, &region)) return false;
+  quad->texture = region.texture;
+  quad->u0 = region.u0;
+  quad->v0 = region.v0;
+  quad->u1 = region.u1;
+  quad->v1 = region.v1;
+  return true;
+}
+
+VkResult vulkan_renderer_init(VulkanRenderer* renderer, VkContext* ctx) {
+  memset(renderer, 0, sizeof(*renderer));
+  renderer->base = (RenderBackend){
+      .name = "vulkan",
+      .begin_frame = vulkan_begin_frame,
+      .end_frame = vulkan_end_frame,
+      .wait_idle = vulkan_wait_idle,
+      .destroy = vulkan_destroy,
+      .add_sprite = vulkan_add_sprite,
+      .remove_sprite = vulkan_remove_sprite,
+      .get_sprite = vulkan_get_sprite};
+  renderer->ctx = ctx;
+
+  renderer->mesh_pipeline = PIPELINE_INVALID_HANDLE;
+  renderer->quad_pipeline = PIPELINE_INVALID_HANDLE;
+  renderer->mesh_textured_pipeline = PIPELINE_INVALID_HANDLE;
+  renderer->scene_texture = RESIDENCY_INVALID_ID;
+  pipeline_manager_init(&renderer->pipelines, ctx);
+  // Quad instances are read through the uniform ring's bindless storage view.
+  if (ctx->has_bindless) {
+    renderer->quad_pipeline = pipeline_manager_request(&renderer->pipelines, &(GraphicsPipelineDesc){
+        .vert_path = "shaders/quad.vert.spv",
+        .frag_path = "shaders/quad.frag.spv",
+        .cull_mode = VK_CULL_MODE_NONE,
+        .front_face = VK_FRONT_FACE_CLOCKWISE,
+        .blend = true});
+  }
+  async_compute_init(&renderer->compute, ctx);
+  gpu_scene_init(&renderer->gpu_scene, ctx);
+  particles_init(&renderer->particles, ctx, &renderer->pipelines, &renderer->compute);
+  residency_init(&renderer->residency, ctx);
+  load_scene_mesh(renderer);
+  VkResult res = atlas_init(&renderer->atlas, ctx, RENDER_ATLAS_PAGES);
+  if (res != VK_SUCCESS) return res;
+  dynamic_resolution_init(&renderer->resolution, ctx, DYNAMIC_RESOLUTION_BUDGET_MS);
+  capture_init(&renderer->capture, ctx);
+  descriptor_allocator_init(&renderer->descriptors, ctx);
+  overlay_init(&renderer->overlay, ctx, &renderer->pipelines);
+  res = build_render_graph(renderer);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to build render graph!\n");
+  }
+  return res;
+}
+
+static void acquire(VkContext* ctx) {
+  uint32_t current_frame = ctx->current_frame;
+  VkFence* fence = &ctx->in_flight_fences[current_frame];
+
+  vkWaitForFences(ctx->device, 1, fence, VK_TRUE, UINT64_MAX);
+  vkResetFences(ctx->device, 1, fence);
+  ctx->frame_number++;
+
+  for (uint32_t i = 0; i < ctx->window_count; ++i) {
+    VkSwapchainContext* window = &ctx->windows[i];
+    vkAcquireNextImageKHR(ctx->device, window->swapchain, UINT64_MAX, window->image_available_semaphores[current_frame],
+                          VK_NULL_HANDLE, &window->image_index);
+  }
+}
+
+// One submit for every window: waits on all their acquires and signals all their presents.
+static void submit(VkContext* ctx, VkPipelineStageFlags compute_wait_stages) {
+  uint32_t current_frame = ctx->current_frame;
+
+  VkSemaphore wait_semaphores[VK_MAX_WINDOWS + 1];
+  VkPipelineStageFlags wait_stages[VK_MAX_WINDOWS + 1];
+  VkSemaphore signal_semaphores[VK_MAX_WINDOWS + 1];
+  // Binary semaphores ignore their entries in the value arrays.
+  uint64_t wait_values[VK_MAX_WINDOWS + 1] = {0};
+  uint64_t signal_values[VK_MAX_WINDOWS + 1] = {0};
+  uint32_t wait_count = 0;
+  uint32_t signal_count = 0;
+
+  for (uint32_t i = 0; i < ctx->window_count; ++i) {
+    VkSwapchainContext* window = &ctx->windows[i];
+    wait_stages[wait_count] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    wait_semaphores[wait_count++] = window->image_available_semaphores[current_frame];
+    signal_semaphores[signal_count++] = window->render_finished_semaphores[window->image_index];
+  }
+  if (compute_wait_stages) {
+    wait_stages[wait_count] = compute_wait_stages;
+    wait_values[wait_count] = ctx->frame_number;
+    wait_semaphores[wait_count++] = ctx->compute_timeline;
+  }
+  if (ctx->has_timeline_semaphore) {
+    signal_values[signal_count] = ctx->frame_number;
+    signal_semaphores[signal_count++] = ctx->graphics_timeline;
+  }
+
+  VkTimelineSemaphoreSubmitInfo timeline_info = {
+      .sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO,
+      .waitSemaphoreValueCount = wait_count,
+      .pWaitSemaphoreValues = wait_values,
+      .signalSemaphoreValueCount = signal_count,
+      .pSignalSemaphoreValues = signal_values};
+  VkSubmitInfo submit_info = {
+      .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+      .pNext = ctx->has_timeline_semaphore ? &timeline_info : NULL,
+      .waitSemaphoreCount = wait_count,
+      .pWaitSemaphores = wait_semaphores,
+      .pWaitDstStageMask = wait_stages,
+      .commandBufferCount = 1,
+      .pCommandBuffers = &ctx->command_buffers[current_frame],
+      .signalSemaphoreCount = signal_count,
+      .pSignalSemaphores = signal_semaphores};
+
+  vkQueueSubmit(ctx->graphics_queue, 1, &submit_info, ctx->in_flight_fences[current_frame]);
+}
+
+// Presents every window with a single vkQueuePresentKHR so they flip together.
+static void present(VkContext* ctx) {
+  VkSemaphore wait_semaphores[VK_MAX_WINDOWS];
+  VkSwapchainKHR swapchains[VK_MAX_WINDOWS];
+  uint32_t image_indices[VK_MAX_WINDOWS];
+  for (uint32_t i = 0; i < ctx->window_count; ++i) {
+    VkSwapchainContext* window = &ctx->windows[i];
+    wait_semaphores[i] = window->render_finished_semaphores[window->image_index];
+    swapchains[i] = window->swapchain;
+    image_indices[i] = window->image_index;
+  }
+
+  VkPresentInfoKHR present_info = {
+      .sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
+      .waitSemaphoreCount = ctx->window_count,
+      .pWaitSemaphores = wait_semaphores,
+      .swapchainCount = ctx->window_count,
+      .pSwapchains = swapchains,
+      .pImageIndices = image_indices};
+  vkQueuePresentKHR(ctx->present_queue, &present_info);
+
+  ctx->current_frame = (ctx->current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
+}
+
+// Mirrors the push constant block in shaders/quad.vert and quad.frag.
+typedef struct {
+  uint32_t instances;
+  uint32_t first_instance;
+  uint32_t texture;
+} QuadPushConstants;
+
+// Copies the frame's sorted quads into the uniform ring once; every view draws from it.
+static void write_quads(VulkanRenderer* renderer, const RenderFrame* frame) {
+  renderer->quad_first = UINT32_MAX;
+  if (frame->quad_count == 0 || renderer->quad_pipeline == PIPELINE_INVALID_HANDLE) return;
+  // Instances are indexed from the start of the ring buffer, so the block is aligned to one.
+  uint32_t offset;
+  uint8_t* data = uniform_ring_alloc(&renderer->ctx->uniforms, sizeof(QuadInstance) * (frame->quad_count + 1), &offset);
+  if (!data) return;
+  // 48 bytes is not a power of two, so no ALIGN_FORWARD here.
+  uint32_t skip = (uint32_t)((sizeof(QuadInstance) - offset % sizeof(QuadInstance)) % sizeof(QuadInstance));
+  QuadInstance* instances = (QuadInstance*)(data + skip);
+  for (uint32_t i = 0; i < frame->quad_count; ++i) {
+    const Quad* quad = &frame->quads[i];
+    instances[i] = (QuadInstance){
+        .rect = {quad->x, quad->y, quad->width, quad->height},
+        .uv = {quad->u0, quad->v0, quad->u1, quad->v1},
+        .color = {quad->color[0], quad->color[1], quad->color[2], quad->color[3]}};
+  }
+  renderer->quad_first = (offset + skip) / (uint32_t)sizeof(QuadInstance);
+}
+
+// One instanced draw per batch, in the frontend's (layer, texture) order.
+static void draw_quads(VulkanRenderer* renderer, VkCommandBuffer cmd) {
+  VkContext* ctx = renderer->ctx;
+  const RenderFrame* frame = renderer->frame;
+  VkPipeline pipeline = pipeline_manager_get(&renderer->pipelines, renderer->quad_pipeline, VK_NULL_HANDLE);
+  if (pipeline == VK_NULL_HANDLE || renderer->quad_first == UINT32_MAX ||
+      renderer->camera_offset == UNIFORM_RING_INVALID_OFFSET) {
+    return;
+  }
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+  uniform_ring_bind(&ctx->uniforms, cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->pipeline_layout, renderer->camera_offset);
+  for (uint32_t b = 0; b < frame->batch_count; ++b) {
+    const QuadBatch* batch = &frame->batches[b];
+    QuadPushConstants push = {
+        .instances = ctx->uniforms.storage_handle,
+        .first_instance = renderer->quad_first + batch->first,
+        .texture = batch->texture};
+    vkCmdPushConstants(cmd, ctx->pipeline_layout, VK_SHADER_STAGE_ALL, 0, sizeof(push), &push);
+    vkCmdDraw(cmd, 6, batch->count, 0, 0);
+    renderer->draw_count++;
+  }
+}
+
+static void main_pass(RenderGraph* graph, VkCommandBuffer cmd, void* user_data) {
+  VulkanRenderer* renderer = user_data;
+  VkContext* ctx = renderer->ctx;
+
+  VkClearValue clear_color = {.color = {{0.0f, 0.0f, 0.0f, 1.0f}}};
+
+  VkRenderPassBeginInfo render_pass_info = {
+      .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+      .renderPass = ctx->render_pass,
+      .framebuffer = renderer->scene_framebuffer,
+      .renderArea = {
+          .offset = {0, 0},
+          .extent = renderer->render_extent},
+      .clearValueCount = 1,
+      .pClearValues = &clear_color};
+
+  vkCmdBeginRenderPass(cmd, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+
+  // Graphics pipeline must match the renderer pass and subpass index.
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->graphics_pipeline);
+
+  // If your pipeline declared viewport/scissor as dynamic, set them here:
+  VkViewport viewport = {
+      .x = 0.0f,
+      .y = 0.0f,
+      .width = (float)renderer->render_extent.width,
+      .height = (float)renderer->render_extent.height,
+      .minDepth = 0.0f,
+      .maxDepth = 1.0f};
+  vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+  VkRect2D scissor = {
+      .offset = {0, 0},
+      .extent = renderer->render_extent};
+  vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+  // The world-space triangle at the origin (no vertex buffers / no vertex input), seen
+  // through this window's camera.
+  if (renderer->camera_offset != UNIFORM_RING_INVALID_OFFSET) {
+    uniform_ring_bind(&ctx->uniforms, cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->pipeline_layout, renderer->camera_offset);
+    vkCmdDraw(cmd, 3, 1, 0, 0);
+    renderer->draw_count++;
+  }
+
+  // The mesh pipelines build on a worker; the mesh is simply skipped until one is ready,
+  // and drawn untextured until both the textured pipeline and the texture are.
+  uint32_t texture = residency_use(&renderer->residency, renderer->scene_texture, BINDLESS_INVALID_HANDLE);
+  VkPipeline mesh_pipeline = VK_NULL_HANDLE;
+  if (texture != BINDLESS_INVALID_HANDLE) {
+    mesh_pipeline = pipeline_manager_get(&renderer->pipelines, renderer->mesh_textured_pipeline, VK_NULL_HANDLE);
+  }
+  if (mesh_pipeline == VK_NULL_HANDLE) {
+    mesh_pipeline = pipeline_manager_get(&renderer->pipelines, renderer->mesh_pipeline, VK_NULL_HANDLE);
+  }
+  if (mesh_pipeline != VK_NULL_HANDLE && renderer->camera_offset != UNIFORM_RING_INVALID_OFFSET) {
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mesh_pipeline);
+    uniform_ring_bind(&ctx->uniforms, cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->pipeline_layout, renderer->camera_offset);
+    mesh_bind(ctx, cmd, &renderer->mesh, renderer->gpu_scene.object_handle, texture);
+    gpu_scene_draw(&renderer->gpu_scene, cmd);
+    renderer->draw_count++;
+  }
+
+  draw_quads(renderer, cmd);
+
+  // Drawn last for blending; skipped until the first emitter allocates the buffers.
+  if (particles_draw(&renderer->particles, cmd, renderer->camera_offset)) renderer->draw_count++;
+
+  vkCmdEndRenderPass(cmd);
+}
+
+static void upscale_pass(RenderGraph* graph, VkCommandBuffer cmd, void* user_data) {
+  VulkanRenderer* renderer = user_data;
+  VkExtent2D src = renderer->render_extent;
+  VkExtent2D dst = renderer->window->extent;
+
+  VkImageBlit region = {
+      .srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+      .srcOffsets = {{0, 0, 0}, {(int32_t)src.width, (int32_t)src.height, 1}},
+      .dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+      .dstOffsets = {{0, 0, 0}, {(int32_t)dst.width, (int32_t)dst.height, 1}}};
+  vkCmdBlitImage(cmd, render_graph_get_image(graph, renderer->scene), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                 render_graph_get_image(graph, renderer->backbuffer), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                 1, &region, VK_FILTER_LINEAR);
+}
+
+static void overlay_pass(RenderGraph* graph, VkCommandBuffer cmd, void* user_data) {
+  VulkanRenderer* renderer = user_data;
+  if (!renderer->overlay_visible) return;
+  VkContext* ctx = renderer->ctx;
+  VkSwapchainContext* window = renderer->window;
+  OverlayStats stats = {
+      .cpu_ms = renderer->cpu_ms,
+      .gpu_ms = renderer->resolution.gpu_ms,
+      .draws = renderer->draw_count,
+      .objects = renderer->gpu_scene.object_count,
+      .memory_allocations = atomic_load_explicit(&ctx->memory_allocations_live, memory_order_relaxed),
+      .memory_bytes = atomic_load_explicit(&ctx->memory_allocated_bytes, memory_order_relaxed)};
+  const ResidencyManager* residency = &renderer->residency;
+  for (uint32_t i = 0; i < residency->heap_count; ++i) {
+    if (!(residency->device_heaps & (1u << i))) continue;
+    stats.heap_usage += residency->heaps[i].usage;
+    stats.heap_budget += residency->heaps[i].budget;
+  }
+  overlay_draw(&renderer->overlay, cmd, window->framebuffers[window->image_index], window->extent, &stats);
+}
+
+static void write_camera_uniforms(VulkanRenderer* renderer, const Camera* camera, const RenderView* view) {
+  CameraUniforms* uniforms = uniform_ring_alloc(&renderer->ctx->uniforms, sizeof(*uniforms), &renderer->camera_offset);
+  if (!uniforms) return;
+  VkExtent2D extent = renderer->render_extent;
+  memcpy(uniforms->view_proj, view->view_proj, sizeof(uniforms->view_proj));
+  uniforms->position[0] = camera->x;
+  uniforms->position[1] = camera->y;
+  uniforms->position[2] = camera->zoom;
+  uniforms->position[3] = 0.0f;
+  uniforms->viewport[0] = (float)extent.width;
+  uniforms->viewport[1] = (float)extent.height;
+  uniforms->viewport[2] = 1.0f / (float)extent.width;
+  uniforms->viewport[3] = 1.0f / (float)extent.height;
+}
+
+// Runs after the graph, so the backbuffer is ready to present and the scene was last
+// read by the upscale blit. The copy is transfer work too, so the next view's first write
+// to the scene, which waits on that blit's stage, also waits on it. Surfaces whose images cannot be copied from fall back to the
+// scene, without the overlay and at render resolution.
+static void record_capture(VulkanRenderer* renderer, VkCommandBuffer cmd, const CaptureRequest* request) {
+  VkContext* ctx = renderer->ctx;
+  VkSwapchainContext* window = renderer->window;
+  static bool warned = false;
+  if (!request->scene && !window->readable && !warned) {
+    fprintf(stderr, "Warning: swapchain images cannot be copied from, capturing the scene instead\n");
+    warned = true;
+  }
+  if (request->scene || !window->readable) {
+    capture_record(&renderer->capture, cmd, ctx->current_frame, render_graph_get_image(&renderer->graph, renderer->scene),
+                   VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, ctx->swapchain_image_format, renderer->render_extent,
+                   request->format, request->path);
+  } else {
+    capture_record(&renderer->capture, cmd, ctx->current_frame, window->images[window->image_index],
+                   VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, ctx->swapchain_image_format, window->extent, request->format,
+                   request->path);
+  }
+}
+
+static VkResult record_command_buffer(VulkanRenderer* renderer, VkCommandBuffer cmd, const RenderFrame* frame) {
+  VkContext* ctx = renderer->ctx;
+
+  // Make sure the command buffer is back to INITIAL state before re-recording
+  VkResult res = vkResetCommandBuffer(cmd, 0);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "vkResetCommandBuffer failed: %d\n", res);
+    return res;
+  }
+
+  VkCommandBufferBeginInfo begin_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+      .pInheritanceInfo = NULL};
+  res = vkBeginCommandBuffer(cmd, &begin_info);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "vkBeginCommandBuffer failed: %d\n", res);
+    return res;
+  }
+
+  renderer->draw_count = 0;
+  dynamic_resolution_begin(&renderer->resolution, cmd, ctx->current_frame);
+  bindless_bind(&ctx->bindless, cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, ctx->pipeline_layout);
+  async_compute_record_inline(&renderer->compute, cmd);
+  atlas_flush(&renderer->atlas, cmd, ctx->current_frame);
+  residency_flush(&renderer->residency, cmd);
+  renderer->frame = frame;
+  write_quads(renderer, frame);
+
+  // Views are the windows, in order, each running the whole graph. They cull into their
+  // own GPU scene outputs, and the graph's first use of the scene target waits only for
+  // the previous view's last use of it, so one view's culling overlaps the last one's draws.
+  for (uint32_t i = 0; i < frame->view_count; ++i) {
+    VkSwapchainContext* window = &ctx->windows[i];
+    const RenderView* view = &frame->views[i];
+    renderer->window = window;
+    renderer->render_extent = dynamic_resolution_extent(&renderer->resolution, window->extent);
+    write_camera_uniforms(renderer, &frame->camera, view);
+    gpu_scene_begin_frame(&renderer->gpu_scene, &renderer->graph, ctx->current_frame, i, view->view_proj);
+    render_graph_bind_image(&renderer->graph, renderer->backbuffer, window->images[window->image_index],
+                            window->image_views[window->image_index]);
+    render_graph_execute(&renderer->graph, cmd);
+    if (frame->capture.requested && frame->capture.window == i) record_capture(renderer, cmd, &frame->capture);
+  }
+  dynamic_resolution_end(&renderer->resolution, cmd, ctx->current_frame);
+
+  res = vkEndCommandBuffer(cmd);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "vkEndCommandBuffer failed: %d\n", res);
+    return res;
+  }
+
+  return VK_SUCCESS;
+}
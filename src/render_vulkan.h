@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include "atlas.h"
+#include "capture.h"
+#include "compute.h"
+#include "descriptor_allocator.h"
+#include "dynamic_resolution.h"
+#include "gpu_scene.h"
+#include "mesh.h"
+#include "overlay.h"
+#include "particles.h"
+#include "pipeline_manager.h"
+#include "render_backend.h"
+#include "render_graph.h"
+#include "residency.h"
+#include "vk.h"
+
+#define RENDER_SCENE_MESH "assets/scene.mesh"
+#define RENDER_SCENE_TEXTURE "assets/scene.ktx2"  // optional, streamed through the residency manager
+#define RENDER_ATLAS_PAGES 2
+
+// Mirrors the Camera block in shaders/camera.glsl (std140).
+typedef struct {
+  float view_proj[16];
+  float position[4];
+  float viewport[4];
+} CameraUniforms;
+
+// Mirrors QuadInstance in shaders/quad.vert.
+typedef struct {
+  float rect[4];
+  float uv[4];
+  float color[4];
+} QuadInstance;
+
+// The Vulkan backend: one view per window of the context, rendered through the render
+// graph. Quad batches are drawn over the scene, one instanced draw each.
+typedef struct {
+  RenderBackend base;
+  VkContext* ctx;
+  RenderGraph graph;
+  RenderGraphHandle backbuffer;
+  // Offscreen target sized for the largest window; each frame renders into its top-left
+  // render_extent and the upscale pass stretches that over the backbuffer.
+  RenderGraphHandle scene;
+  VkFramebuffer scene_framebuffer;
+  VkExtent2D render_extent;
+  DynamicResolution resolution;
+  GpuScene gpu_scene;
+  Mesh mesh;
+  PipelineManager pipelines;
+  uint32_t mesh_pipeline;  // PipelineManager handle
+  uint32_t mesh_textured_pipeline;  // PipelineManager handle, requested with the scene texture
+  uint32_t scene_texture;  // ResidencyManager id, RESIDENCY_INVALID_ID without the file
+  uint32_t quad_pipeline;  // PipelineManager handle
+  const RenderFrame* frame;  // being recorded
+  uint32_t quad_first;  // this frame's first QuadInstance in the uniform ring, UINT32_MAX if none
+  uint32_t camera_offset;  // this window's CameraUniforms in ctx->uniforms
+  VkSwapchainContext* window;  // window the graph is currently executing for
+  AsyncCompute compute;
+  ParticleSystem particles;
+  // Backs the sprite hooks: filled by the game thread, pages created and uploaded by
+  // atlas_flush while recording.
+  Atlas atlas;
+  // Streamed textures and buffers kept inside the memory budget; the render thread drives it.
+  ResidencyManager residency;
+  // Sets for reflected layouts outside the bindless conventions; render thread only.
+  DescriptorAllocator descriptors;
+  FrameCapture capture;
+  Overlay overlay;
+  bool overlay_visible;
+  float cpu_ms;
+  uint32_t draw_count;  // draw calls recorded so far this frame
+} VulkanRenderer;
+
+// Takes over every Vulkan call on ctx after vk_init; ctx must outlive the renderer.
+VkResult vulkan_renderer_init(VulkanRenderer* renderer, VkContext* ctx);
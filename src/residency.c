@@ -0,0 +1,385 @@
+#include "residency.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Without VK_EXT_memory_budget, the share of a device-local heap this manager may fill.
+#define FALLBACK_BUDGET_SHARE 0.5
+
+static VkDeviceSize texture_bytes(const Texture* texture) {
+  VkDeviceSize bytes = 0;
+  for (uint32_t level = 0; level < texture->mip_levels; ++level) {
+    bytes += texture_level_size(texture->format, MAX(texture->width >> level, 1u), MAX(texture->height >> level, 1u));
+  }
+  return bytes;
+}
+
+static void query_budget(ResidencyManager* residency) {
+  VkContext* ctx = residency->ctx;
+  VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT};
+  VkPhysicalDeviceMemoryProperties2 properties = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+      .pNext = ctx->has_memory_budget ? &budget : NULL};
+  vkGetPhysicalDeviceMemoryProperties2(ctx->physical_device, &properties);
+
+  const VkPhysicalDeviceMemoryProperties* memory = &properties.memoryProperties;
+  residency->heap_count = memory->memoryHeapCount;
+  residency->device_heaps = 0;
+  for (uint32_t i = 0; i < memory->memoryHeapCount; ++i) {
+    if (memory->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) residency->device_heaps |= 1u << i;
+    if (ctx->has_memory_budget) {
+      residency->heaps[i].budget = budget.heapBudget[i];
+      residency->heaps[i].usage = budget.heapUsage[i];
+    } else {
+      residency->heaps[i].budget = (VkDeviceSize)((double)memory->memoryHeaps[i].size * FALLBACK_BUDGET_SHARE);
+      residency->heaps[i].usage = residency->resident_bytes;
+    }
+  }
+}
+
+// Highest usage/budget ratio over the device-local heaps.
+static float heap_pressure(const ResidencyManager* residency) {
+  float ratio = 0.0f;
+  for (uint32_t i = 0; i < residency->heap_count; ++i) {
+    const HeapBudget* heap = &residency->heaps[i];
+    if (!(residency->device_heaps & (1u << i)) || heap->budget == 0) continue;
+    ratio = MAX(ratio, (float)((double)heap->usage / (double)heap->budget));
+  }
+  return ratio;
+}
+
+// Frames up to frame_number - MAX_FRAMES_IN_FLIGHT have passed their fence wait.
+static bool frame_in_flight(const ResidencyManager* residency, uint64_t frame) {
+  return frame + MAX_FRAMES_IN_FLIGHT >= residency->ctx->frame_number;
+}
+
+// Budget accounting drops the copy right away; the memory follows when the deletion
+// queue reaches the current frame.
+static void free_copy(ResidencyManager* residency, ResidentAsset* asset, ResidentCopy* copy) {
+  VkContext* ctx = residency->ctx;
+  if (asset->type == RESIDENT_TEXTURE) {
+    texture_destroy_deferred(ctx, &copy->texture);
+  } else {
+    vk_defer_remove_bindless_buffer(ctx, copy->handle);
+    vk_defer_destroy_buffer(ctx, copy->buffer, copy->memory);
+  }
+  residency->resident_bytes -= copy->bytes;
+  memset(copy, 0, sizeof(*copy));
+  copy->handle = BINDLESS_INVALID_HANDLE;
+  copy->texture.handle = BINDLESS_INVALID_HANDLE;
+}
+
+static void unload(ResidencyManager* residency, ResidentAsset* asset) {
+  if (!asset->resident) return;
+  free_copy(residency, asset, &asset->copy);
+  asset->resident = false;
+  asset->released = residency->ctx->frame_number;
+}
+
+static uint8_t* read_file(const char* path, size_t* size) {
+  FILE* fp = fopen(path, "rb");
+  if (!fp) return NULL;
+  fseek(fp, 0, SEEK_END);
+  long length = ftell(fp);
+  rewind(fp);
+  uint8_t* data = length > 0 ? malloc((size_t)length) : NULL;
+  if (data && fread(data, 1, (size_t)length, fp) != (size_t)length) {
+    free(data);
+    data = NULL;
+  }
+  fclose(fp);
+  *size = (size_t)length;
+  return data;
+}
+
+// Loader thread: file IO and CPU decoding, nothing that needs the device.
+static void read_load(VkContext* ctx, PendingLoad* load) {
+  if (load->type == RESIDENT_TEXTURE) {
+    load->result = texture_read_ktx2(ctx, load->path, load->first_level, &load->desc, &load->data);
+    return;
+  }
+  load->data = read_file(load->path, &load->size);
+  load->result = load->data ? VK_SUCCESS : VK_ERROR_INITIALIZATION_FAILED;
+  if (!load->data) fprintf(stderr, "Failed to open buffer '%s'\n", load->path);
+}
+
+static int loader_main(void* arg) {
+  ResidencyManager* residency = arg;
+  for (;;) {
+    semaphore_wait(residency->loads_queued);
+    mutex_lock(residency->lock);
+    if (residency->shutdown) {
+      mutex_unlock(residency->lock);
+      return 0;
+    }
+    PendingLoad* load = NULL;
+    for (uint32_t i = 0; i < RESIDENCY_MAX_PENDING_LOADS && !load; ++i) {
+      if (residency->loads[i].state == LOAD_QUEUED) load = &residency->loads[i];
+    }
+    if (load) load->state = LOAD_READING;
+    mutex_unlock(residency->lock);
+    if (!load) continue;
+
+    read_load(residency->ctx, load);
+    mutex_lock(residency->lock);
+    load->state = LOAD_READ;
+    mutex_unlock(residency->lock);
+  }
+}
+
+static bool queue_load(ResidencyManager* residency, uint32_t id, uint32_t first_level) {
+  ResidentAsset* asset = &residency->assets[id];
+  mutex_lock(residency->lock);
+  PendingLoad* load = NULL;
+  for (uint32_t i = 0; i < RESIDENCY_MAX_PENDING_LOADS && !load; ++i) {
+    if (residency->loads[i].state == LOAD_FREE) load = &residency->loads[i];
+  }
+  if (load) {
+    memset(load, 0, sizeof(*load));
+    load->state = LOAD_QUEUED;
+    load->asset = id;
+    load->type = asset->type;
+    load->first_level = first_level;
+    strcpy(load->path, asset->path);
+    asset->loading = true;
+  }
+  mutex_unlock(residency->lock);
+  if (load) semaphore_post(residency->loads_queued);
+  return load != NULL;
+}
+
+static bool has_free_load(ResidencyManager* residency) {
+  mutex_lock(residency->lock);
+  bool found = false;
+  for (uint32_t i = 0; i < RESIDENCY_MAX_PENDING_LOADS && !found; ++i) {
+    found = residency->loads[i].state == LOAD_FREE;
+  }
+  mutex_unlock(residency->lock);
+  return found;
+}
+
+static VkResult upload_copy(ResidencyManager* residency, const ResidentAsset* asset, const PendingLoad* load,
+                            VkCommandBuffer cmd, ResidentCopy* copy) {
+  VkContext* ctx = residency->ctx;
+  memset(copy, 0, sizeof(*copy));
+  if (asset->type == RESIDENT_TEXTURE) {
+    VK_RETURN(texture_create_recorded(ctx, &load->desc, cmd, &copy->texture));
+    copy->handle = copy->texture.handle;
+    copy->bytes = texture_bytes(&copy->texture);
+    return VK_SUCCESS;
+  }
+  VK_RETURN(vk_create_buffer_recorded(ctx, load->data, load->size, asset->usage | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                      cmd, &copy->buffer, &copy->memory));
+  copy->handle = bindless_add_buffer(&ctx->bindless, copy->buffer, 0, load->size);
+  copy->bytes = load->size;
+  return VK_SUCCESS;
+}
+
+VkResult residency_init(ResidencyManager* residency, VkContext* ctx) {
+  memset(residency, 0, sizeof(*residency));
+  residency->ctx = ctx;
+  residency->assets = calloc(RESIDENCY_MAX_ASSETS, sizeof(*residency->assets));
+  residency->lock = mutex_create();
+  residency->loads_queued = semaphore_create(0);
+  if (!residency->assets || !residency->lock || !residency->loads_queued) {
+    residency_destroy(residency);
+    return VK_ERROR_OUT_OF_HOST_MEMORY;
+  }
+  residency->loader = thread_create(loader_main, residency, "residency");
+  if (!residency->loader) {
+    residency_destroy(residency);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+  query_budget(residency);
+  return VK_SUCCESS;
+}
+
+static uint32_t add_asset(ResidencyManager* residency, ResidentType type, const char* path, VkBufferUsageFlags usage) {
+  if (!residency->assets || strlen(path) >= RESIDENCY_MAX_PATH) return RESIDENCY_INVALID_ID;
+  uint32_t id = 0;
+  while (id < residency->asset_count && residency->assets[id].used) id++;
+  if (id == RESIDENCY_MAX_ASSETS) return RESIDENCY_INVALID_ID;
+
+  ResidentAsset* asset = &residency->assets[id];
+  memset(asset, 0, sizeof(*asset));
+  asset->type = type;
+  asset->usage = usage;
+  asset->last_used = residency->ctx->frame_number;
+  asset->wanted = true;
+  strcpy(asset->path, path);
+  asset->used = true;
+  residency->asset_count = MAX(residency->asset_count, id + 1);
+  return id;
+}
+
+uint32_t residency_add_texture(ResidencyManager* residency, const char* path) {
+  return add_asset(residency, RESIDENT_TEXTURE, path, 0);
+}
+
+uint32_t residency_add_buffer(ResidencyManager* residency, const char* path, VkBufferUsageFlags usage) {
+  return add_asset(residency, RESIDENT_BUFFER, path, usage);
+}
+
+uint32_t residency_use(ResidencyManager* residency, uint32_t id, uint32_t fallback) {
+  if (id >= residency->asset_count || !residency->assets[id].used) return fallback;
+  ResidentAsset* asset = &residency->assets[id];
+  asset->last_used = residency->ctx->frame_number;
+  if (!asset->resident || asset->first_level > 0) asset->wanted = true;
+  return asset->resident ? asset->copy.handle : fallback;
+}
+
+void residency_remove(ResidencyManager* residency, uint32_t id) {
+  if (id >= residency->asset_count || !residency->assets[id].used) return;
+  ResidentAsset* asset = &residency->assets[id];
+  if (asset->loading) {
+    // The loader may be reading it; residency_flush drops orphaned results.
+    mutex_lock(residency->lock);
+    for (uint32_t i = 0; i < RESIDENCY_MAX_PENDING_LOADS; ++i) {
+      if (residency->loads[i].state != LOAD_FREE && residency->loads[i].asset == id) {
+        residency->loads[i].asset = RESIDENCY_INVALID_ID;
+      }
+    }
+    mutex_unlock(residency->lock);
+  }
+  unload(residency, asset);
+  memset(asset, 0, sizeof(*asset));
+}
+
+// Least recently used asset that no frame in flight reads.
+static ResidentAsset* find_victim(ResidencyManager* residency) {
+  ResidentAsset* victim = NULL;
+  for (uint32_t i = 0; i < residency->asset_count; ++i) {
+    ResidentAsset* asset = &residency->assets[i];
+    if (!asset->used || !asset->resident || asset->loading || frame_in_flight(residency, asset->last_used)) continue;
+    if (!victim || asset->last_used < victim->last_used) victim = asset;
+  }
+  return victim;
+}
+
+static bool can_shrink(const ResidencyManager* residency, const ResidentAsset* asset) {
+  bool idle = asset->last_used + RESIDENCY_EVICT_IDLE_FRAMES < residency->ctx->frame_number;
+  return asset->type == RESIDENT_TEXTURE && !idle && !asset->mips_generated && asset->copy.texture.mip_levels > 1;
+}
+
+// Evicts the asset, and queues a copy without its top mip unless it has been idle for
+// long or cannot shrink further. The smaller copy is uploaded once this one's memory is
+// released.
+static void trim(ResidencyManager* residency, ResidentAsset* asset) {
+  bool shrink = can_shrink(residency, asset);
+  unload(residency, asset);
+  if (!shrink) return;
+  asset->first_level++;
+  queue_load(residency, (uint32_t)(asset - residency->assets), asset->first_level);
+}
+
+// Most recently used asset that wants a load; reloads only when `reload` is set.
+static ResidentAsset* next_wanted(ResidencyManager* residency, bool reload) {
+  ResidentAsset* next = NULL;
+  for (uint32_t i = 0; i < residency->asset_count; ++i) {
+    ResidentAsset* asset = &residency->assets[i];
+    if (!asset->used || !asset->wanted || asset->loading || asset->failed) continue;
+    if (asset->loaded && !reload) continue;
+    if (!next || asset->last_used > next->last_used) next = asset;
+  }
+  return next;
+}
+
+void residency_update(ResidencyManager* residency) {
+  if (!residency->assets) return;
+  // The deletion queue was flushed just before this call; copies freed up to here are gone.
+  residency->collected_frame = vk_completed_frame(residency->ctx);
+  query_budget(residency);
+  float ratio = heap_pressure(residency);
+  if (ratio > RESIDENCY_HIGH_WATER) residency->pressure = true;
+  if (ratio < RESIDENCY_LOW_WATER) residency->pressure = false;
+
+  if (residency->pressure) {
+    for (uint32_t n = 0; n < RESIDENCY_MAX_TRIMS_PER_FRAME; ++n) {
+      ResidentAsset* victim = find_victim(residency);
+      if (!victim) break;
+      // A shrinking trim needs a load slot; never evict what it could only have trimmed.
+      if (can_shrink(residency, victim) && !has_free_load(residency)) break;
+      trim(residency, victim);
+    }
+  }
+
+  // First loads go ahead regardless of pressure, like a synchronous load would. Reloads to
+  // full size wait for the low-water mark, so they never push straight back into pressure.
+  bool reload = ratio < RESIDENCY_LOW_WATER;
+  for (ResidentAsset* next; (next = next_wanted(residency, reload)) != NULL;) {
+    if (!queue_load(residency, (uint32_t)(next - residency->assets), 0)) break;
+    next->wanted = false;
+  }
+}
+
+static void finish_load(ResidencyManager* residency, PendingLoad* load, VkCommandBuffer cmd) {
+  if (load->asset == RESIDENCY_INVALID_ID) return;
+  ResidentAsset* asset = &residency->assets[load->asset];
+  asset->loading = false;
+  // A full reload that arrives after pressure returned would only be trimmed again.
+  if (load->result == VK_SUCCESS && asset->loaded && residency->pressure && load->first_level == 0) {
+    asset->wanted = true;
+    return;
+  }
+
+  ResidentCopy copy;
+  VkResult res = load->result;
+  if (res == VK_SUCCESS) res = upload_copy(residency, asset, load, cmd, &copy);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to load '%s'\n", asset->path);
+    asset->failed = true;
+    return;
+  }
+  if (asset->resident) free_copy(residency, asset, &asset->copy);
+  residency->resident_bytes += copy.bytes;
+  asset->copy = copy;
+  asset->resident = true;
+  asset->loaded = true;
+  asset->first_level = load->first_level;
+  if (asset->type == RESIDENT_TEXTURE) asset->mips_generated = load->desc.generate_mips;
+}
+
+void residency_flush(ResidencyManager* residency, VkCommandBuffer cmd) {
+  if (!residency->assets) return;
+  uint32_t uploads = 0;
+  for (uint32_t i = 0; i < RESIDENCY_MAX_PENDING_LOADS && uploads < RESIDENCY_MAX_LOADS_PER_FRAME; ++i) {
+    PendingLoad* load = &residency->loads[i];
+    mutex_lock(residency->lock);
+    bool ready = load->state == LOAD_READ;
+    mutex_unlock(residency->lock);
+    if (!ready) continue;
+    // Until the memory of the copy it replaces is released, uploading would raise the peak.
+    if (load->asset != RESIDENCY_INVALID_ID && residency->assets[load->asset].released > residency->collected_frame) {
+      continue;
+    }
+
+    finish_load(residency, load, cmd);
+    if (load->asset != RESIDENCY_INVALID_ID) uploads++;
+    free(load->data);
+    mutex_lock(residency->lock);
+    load->state = LOAD_FREE;
+    mutex_unlock(residency->lock);
+  }
+}
+
+void residency_destroy(ResidencyManager* residency) {
+  if (!residency->ctx) return;
+  if (residency->loader) {
+    mutex_lock(residency->lock);
+    residency->shutdown = true;
+    mutex_unlock(residency->lock);
+    semaphore_post(residency->loads_queued);
+    thread_join(residency->loader);
+  }
+  for (uint32_t i = 0; i < RESIDENCY_MAX_PENDING_LOADS; ++i) {
+    free(residency->loads[i].data);
+  }
+  for (uint32_t i = 0; i < residency->asset_count; ++i) {
+    residency_remove(residency, i);
+  }
+  if (residency->loads_queued) semaphore_destroy(residency->loads_queued);
+  if (residency->lock) mutex_destroy(residency->lock);
+  free(residency->assets);
+  memset(residency, 0, sizeof(*residency));
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "texture.h"
+#include "thread.h"
+#include "vk.h"
+
+#define RESIDENCY_MAX_ASSETS 1024
+#define RESIDENCY_MAX_PATH 128
+#define RESIDENCY_INVALID_ID UINT32_MAX
+// Fractions of a heap's budget: above HIGH assets are trimmed, below LOW they come back.
+#define RESIDENCY_HIGH_WATER 0.90f
+#define RESIDENCY_LOW_WATER 0.75f
+#define RESIDENCY_EVICT_IDLE_FRAMES 600  // unused this long: evicted instead of trimmed
+#define RESIDENCY_MAX_LOADS_PER_FRAME 1  // uploads recorded per frame
+#define RESIDENCY_MAX_TRIMS_PER_FRAME 4
+#define RESIDENCY_MAX_PENDING_LOADS 16  // queued, being read, or waiting for upload
+
+typedef enum {
+  RESIDENT_TEXTURE = 0,
+  RESIDENT_BUFFER,
+} ResidentType;
+
+// One loaded version of an asset.
+typedef struct {
+  Texture texture;
+  VkBuffer buffer;
+  VkDeviceMemory memory;
+  uint32_t handle;  // bindless
+  VkDeviceSize bytes;
+} ResidentCopy;
+
+typedef struct {
+  ResidentType type;
+  bool used;  // slot taken
+  bool resident;
+  bool loaded;  // resident at least once; until then loads ignore the watermarks
+  bool loading;  // a PendingLoad exists for it
+  bool failed;  // the file could not be loaded; not retried
+  bool mips_generated;  // the file stores only the base level, so it cannot be trimmed
+  bool wanted;  // asked for while evicted or trimmed; reloaded when memory allows
+  char path[RESIDENCY_MAX_PATH];
+  VkBufferUsageFlags usage;
+  uint32_t first_level;  // texture mips dropped from the top
+  uint64_t last_used;  // ctx->frame_number
+  uint64_t released;  // frame the last copy was freed in; the next upload waits for its memory
+  ResidentCopy copy;
+} ResidentAsset;
+
+typedef enum {
+  LOAD_FREE = 0,
+  LOAD_QUEUED,
+  LOAD_READING,  // owned by the loader thread
+  LOAD_READ,  // data ready for residency_flush
+} PendingLoadState;
+
+// A file read on the loader thread and uploaded by residency_flush.
+typedef struct {
+  PendingLoadState state;
+  uint32_t asset;  // RESIDENCY_INVALID_ID once the asset is removed
+  ResidentType type;
+  char path[RESIDENCY_MAX_PATH];
+  uint32_t first_level;
+  VkResult result;
+  TextureDesc desc;  // textures
+  void* data;  // file contents or decoded texels
+  size_t size;
+} PendingLoad;
+
+typedef struct {
+  VkDeviceSize budget;
+  VkDeviceSize usage;
+} HeapBudget;
+
+// Keeps file-backed textures and buffers within the device-local memory budget. Each
+// frame it reads the per-heap budget (VK_EXT_memory_budget; without it, a share of the
+// heap size against what this manager holds), and above the high-water mark it drops the
+// top mips of least recently used textures, then evicts assets idle for
+// RESIDENCY_EVICT_IDLE_FRAMES. Asking for a trimmed or evicted asset queues a full reload
+// once usage is below the low-water mark.
+//
+// Files are read and decoded on a loader thread; residency_flush records the uploads into
+// the frame's command buffer, so the render thread never waits on the queue. A trim frees
+// the current copy before the smaller one is loaded, and the upload waits until that
+// memory is released, so trimming never raises peak usage; the asset reads as `fallback`
+// in between. Only assets unused by every frame in flight are trimmed or evicted, and
+// replaced copies go to the context's deletion queue. Handles change on every load, so
+// callers ask residency_use each frame. Render-thread only, apart from the loader.
+typedef struct {
+  VkContext* ctx;
+  ResidentAsset* assets;
+  uint32_t asset_count;
+  VkDeviceSize resident_bytes;
+  HeapBudget heaps[VK_MAX_MEMORY_HEAPS];
+  uint32_t heap_count;
+  uint32_t device_heaps;  // bit per device-local heap
+  bool pressure;
+  uint64_t collected_frame;  // deletion queue flushed up to here, see residency_update
+
+  Mutex* lock;  // guards the state of loads
+  PendingLoad loads[RESIDENCY_MAX_PENDING_LOADS];
+  Semaphore* loads_queued;
+  Thread* loader;
+  bool shutdown;
+} ResidencyManager;
+
+VkResult residency_init(ResidencyManager* residency, VkContext* ctx);
+// Tracks a KTX2 texture or a raw buffer file and queues its first load, which is not held
+// back by memory pressure. RESIDENCY_INVALID_ID when the manager is full.
+uint32_t residency_add_texture(ResidencyManager* residency, const char* path);
+uint32_t residency_add_buffer(ResidencyManager* residency, const char* path, VkBufferUsageFlags usage);
+// Marks the asset used by the frame being recorded and returns its bindless handle (image
+// or buffer), or `fallback` while it is not resident.
+uint32_t residency_use(ResidencyManager* residency, uint32_t id, uint32_t fallback);
+// Stops tracking the asset; its memory is freed once frames in flight are done with it.
+void residency_remove(ResidencyManager* residency, uint32_t id);
+// Call once per frame after the frame's fence wait and vk_collect_garbage, before recording.
+void residency_update(ResidencyManager* residency);
+// Records the uploads of loaded files into the frame's command buffer, before any use.
+void residency_flush(ResidencyManager* residency, VkCommandBuffer cmd);
+void residency_destroy(ResidencyManager* residency);
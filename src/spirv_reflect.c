@@ -0,0 +1,342 @@
+#include "spirv_reflect.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SPIRV_MAGIC 0x07230203u
+#define SPIRV_HEADER_WORDS 5
+
+// The subset of the SPIR-V grammar reflection looks at.
+enum {
+  OP_ENTRY_POINT = 15,
+  OP_TYPE_BOOL = 20,
+  OP_TYPE_INT = 21,
+  OP_TYPE_FLOAT = 22,
+  OP_TYPE_VECTOR = 23,
+  OP_TYPE_MATRIX = 24,
+  OP_TYPE_IMAGE = 25,
+  OP_TYPE_SAMPLER = 26,
+  OP_TYPE_SAMPLED_IMAGE = 27,
+  OP_TYPE_ARRAY = 28,
+  OP_TYPE_RUNTIME_ARRAY = 29,
+  OP_TYPE_STRUCT = 30,
+  OP_TYPE_POINTER = 32,
+  OP_CONSTANT = 43,
+  OP_VARIABLE = 59,
+  OP_DECORATE = 71,
+  OP_MEMBER_DECORATE = 72,
+};
+
+enum {
+  DECORATION_BLOCK = 2,
+  DECORATION_BUFFER_BLOCK = 3,
+  DECORATION_ARRAY_STRIDE = 6,
+  DECORATION_MATRIX_STRIDE = 7,
+  DECORATION_BUILT_IN = 11,
+  DECORATION_LOCATION = 30,
+  DECORATION_BINDING = 33,
+  DECORATION_DESCRIPTOR_SET = 34,
+  DECORATION_OFFSET = 35,
+};
+
+enum {
+  STORAGE_UNIFORM_CONSTANT = 0,
+  STORAGE_INPUT = 1,
+  STORAGE_UNIFORM = 2,
+  STORAGE_PUSH_CONSTANT = 9,
+  STORAGE_STORAGE_BUFFER = 12,
+};
+
+#define IMAGE_DIM_BUFFER 5
+
+// Everything known about one result id. Field meaning depends on the opcode.
+typedef struct {
+  uint16_t opcode;
+  uint32_t type;  // pointee, element, component or column type; a variable's pointer type
+  uint32_t storage;  // pointers and variables
+  uint32_t count;  // vector/matrix size, int/float width, image Sampled, array length id
+  uint32_t dim;  // images
+  uint32_t value;  // 32-bit constants
+  uint32_t members;  // structs: word index of the first member id
+  uint32_t member_count;
+  uint32_t set;
+  uint32_t binding;
+  uint32_t location;
+  uint32_t array_stride;
+  bool is_signed;
+  bool block;
+  bool buffer_block;
+  bool builtin;
+  bool has_binding;
+  bool has_location;
+} SpirvId;
+
+typedef struct {
+  const uint32_t* words;
+  size_t word_count;
+  SpirvId* ids;
+  uint32_t bound;
+} Reflector;
+
+// Looks up a member decoration by scanning the stream; modules are small and this only
+// runs for push constant blocks.
+static bool member_decoration(const Reflector* r, uint32_t struct_id, uint32_t member, uint32_t decoration,
+                              uint32_t* value) {
+  for (size_t i = SPIRV_HEADER_WORDS; i < r->word_count;) {
+    uint32_t length = r->words[i] >> 16;
+    if (length == 0) break;
+    if ((r->words[i] & 0xffff) == OP_MEMBER_DECORATE && length >= 5 && r->words[i + 1] == struct_id &&
+        r->words[i + 2] == member && r->words[i + 3] == decoration) {
+      *value = r->words[i + 4];
+      return true;
+    }
+    i += length;
+  }
+  return false;
+}
+
+static uint32_t type_size(const Reflector* r, uint32_t id, uint32_t matrix_stride, uint32_t depth) {
+  if (id >= r->bound || depth > 16) return 0;
+  const SpirvId* type = &r->ids[id];
+  switch (type->opcode) {
+    case OP_TYPE_BOOL:
+      return 4;
+    case OP_TYPE_INT:
+    case OP_TYPE_FLOAT:
+      return type->count / 8;
+    case OP_TYPE_VECTOR:
+      return type->count * type_size(r, type->type, 0, depth + 1);
+    case OP_TYPE_MATRIX:
+      return type->count * (matrix_stride ? matrix_stride : type_size(r, type->type, 0, depth + 1));
+    case OP_TYPE_ARRAY: {
+      uint32_t length = type->count < r->bound ? r->ids[type->count].value : 0;
+      uint32_t stride = type->array_stride ? type->array_stride : type_size(r, type->type, matrix_stride, depth + 1);
+      return length * stride;
+    }
+    case OP_TYPE_STRUCT: {
+      uint32_t size = 0;
+      for (uint32_t m = 0; m < type->member_count; ++m) {
+        uint32_t offset = 0, stride = 0;
+        member_decoration(r, id, m, DECORATION_OFFSET, &offset);
+        member_decoration(r, id, m, DECORATION_MATRIX_STRIDE, &stride);
+        uint32_t member_size = type_size(r, r->words[type->members + m], stride, depth + 1);
+        if (offset + member_size > size) size = offset + member_size;
+      }
+      return size;
+    }
+    default:
+      return 0;  // runtime arrays and opaque types take no fixed space
+  }
+}
+
+// Strips arrays off a descriptor's type, returning the element type and the array size.
+static uint32_t descriptor_element(const Reflector* r, uint32_t type, uint32_t* count) {
+  *count = 1;
+  while (type < r->bound) {
+    const SpirvId* t = &r->ids[type];
+    if (t->opcode == OP_TYPE_ARRAY) {
+      *count *= t->count < r->bound ? r->ids[t->count].value : 1;
+    } else if (t->opcode == OP_TYPE_RUNTIME_ARRAY) {
+      *count = 0;
+    } else {
+      break;
+    }
+    type = t->type;
+  }
+  return type;
+}
+
+static bool descriptor_type(const Reflector* r, uint32_t storage, uint32_t type, VkDescriptorType* out) {
+  if (type >= r->bound) return false;
+  const SpirvId* t = &r->ids[type];
+  if (storage == STORAGE_STORAGE_BUFFER) {
+    *out = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    return true;
+  }
+  if (storage == STORAGE_UNIFORM) {
+    // Pre-1.3 SPIR-V marks storage buffers as Uniform + BufferBlock.
+    *out = t->buffer_block ? VK_DESCRIPTOR_TYPE_STORAGE_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    return true;
+  }
+  if (storage != STORAGE_UNIFORM_CONSTANT) return false;
+  switch (t->opcode) {
+    case OP_TYPE_SAMPLER:
+      *out = VK_DESCRIPTOR_TYPE_SAMPLER;
+      return true;
+    case OP_TYPE_SAMPLED_IMAGE:
+      *out = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+      return true;
+    case OP_TYPE_IMAGE:
+      if (t->dim == IMAGE_DIM_BUFFER) {
+        *out = t->count == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+      } else {
+        *out = t->count == 2 ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+      }
+      return true;
+    default:
+      return false;
+  }
+}
+
+static VkFormat input_format(const Reflector* r, uint32_t type) {
+  if (type >= r->bound) return VK_FORMAT_UNDEFINED;
+  uint32_t components = 1;
+  if (r->ids[type].opcode == OP_TYPE_VECTOR) {
+    components = r->ids[type].count;
+    type = r->ids[type].type;
+  }
+  if (type >= r->bound || components < 1 || components > 4 || r->ids[type].count != 32) return VK_FORMAT_UNDEFINED;
+
+  static const VkFormat floats[] = {VK_FORMAT_R32_SFLOAT, VK_FORMAT_R32G32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT,
+                                    VK_FORMAT_R32G32B32A32_SFLOAT};
+  static const VkFormat sints[] = {VK_FORMAT_R32_SINT, VK_FORMAT_R32G32_SINT, VK_FORMAT_R32G32B32_SINT,
+                                   VK_FORMAT_R32G32B32A32_SINT};
+  static const VkFormat uints[] = {VK_FORMAT_R32_UINT, VK_FORMAT_R32G32_UINT, VK_FORMAT_R32G32B32_UINT,
+                                   VK_FORMAT_R32G32B32A32_UINT};
+  const SpirvId* scalar = &r->ids[type];
+  if (scalar->opcode == OP_TYPE_FLOAT) return floats[components - 1];
+  if (scalar->opcode == OP_TYPE_INT) return scalar->is_signed ? sints[components - 1] : uints[components - 1];
+  return VK_FORMAT_UNDEFINED;
+}
+
+static VkShaderStageFlagBits execution_stage(uint32_t model) {
+  switch (model) {
+    case 0: return VK_SHADER_STAGE_VERTEX_BIT;
+    case 1: return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+    case 2: return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+    case 3: return VK_SHADER_STAGE_GEOMETRY_BIT;
+    case 4: return VK_SHADER_STAGE_FRAGMENT_BIT;
+    case 5: return VK_SHADER_STAGE_COMPUTE_BIT;
+    default: return 0;
+  }
+}
+
+// First pass: record types, constants, variables and decorations per id.
+static bool parse(Reflector* r, VkShaderStageFlagBits* stage) {
+  *stage = 0;
+  for (size_t i = SPIRV_HEADER_WORDS; i < r->word_count;) {
+    const uint32_t* op = &r->words[i];
+    uint32_t length = op[0] >> 16;
+    uint32_t opcode = op[0] & 0xffff;
+    if (length == 0 || i + length > r->word_count) return false;
+
+    if (opcode == OP_ENTRY_POINT && length >= 3) {
+      if (*stage == 0) *stage = execution_stage(op[1]);
+    } else if (opcode == OP_DECORATE && length >= 3) {
+      if (op[1] >= r->bound) return false;
+      SpirvId* target = &r->ids[op[1]];
+      uint32_t literal = length >= 4 ? op[3] : 0;
+      switch (op[2]) {
+        case DECORATION_BLOCK: target->block = true; break;
+        case DECORATION_BUFFER_BLOCK: target->buffer_block = true; break;
+        case DECORATION_ARRAY_STRIDE: target->array_stride = literal; break;
+        case DECORATION_BUILT_IN: target->builtin = true; break;
+        case DECORATION_LOCATION: target->location = literal; target->has_location = true; break;
+        case DECORATION_BINDING: target->binding = literal; target->has_binding = true; break;
+        case DECORATION_DESCRIPTOR_SET: target->set = literal; break;
+        default: break;
+      }
+    } else if (opcode == OP_MEMBER_DECORATE && length >= 4) {
+      // A block whose members are builtins (gl_PerVertex) is not a user interface.
+      if (op[1] >= r->bound) return false;
+      if (op[3] == DECORATION_BUILT_IN) r->ids[op[1]].builtin = true;
+    } else if (opcode >= OP_TYPE_BOOL && opcode <= OP_TYPE_POINTER && length >= 2) {
+      if (op[1] >= r->bound) return false;
+      SpirvId* type = &r->ids[op[1]];
+      type->opcode = (uint16_t)opcode;
+      switch (opcode) {
+        case OP_TYPE_INT:
+          if (length >= 4) { type->count = op[2]; type->is_signed = op[3] != 0; }
+          break;
+        case OP_TYPE_FLOAT:
+          if (length >= 3) type->count = op[2];
+          break;
+        case OP_TYPE_VECTOR:
+        case OP_TYPE_MATRIX:
+        case OP_TYPE_ARRAY:
+          if (length >= 4) { type->type = op[2]; type->count = op[3]; }
+          break;
+        case OP_TYPE_IMAGE:
+          if (length >= 9) { type->type = op[2]; type->dim = op[3]; type->count = op[7]; }
+          break;
+        case OP_TYPE_SAMPLED_IMAGE:
+        case OP_TYPE_RUNTIME_ARRAY:
+          if (length >= 3) type->type = op[2];
+          break;
+        case OP_TYPE_STRUCT:
+          type->members = (uint32_t)i + 2;
+          type->member_count = length - 2;
+          break;
+        case OP_TYPE_POINTER:
+          if (length >= 4) { type->storage = op[2]; type->type = op[3]; }
+          break;
+        default:
+          break;
+      }
+    } else if (opcode == OP_CONSTANT && length >= 4) {
+      if (op[2] >= r->bound) return false;
+      r->ids[op[2]].opcode = OP_CONSTANT;
+      r->ids[op[2]].value = op[3];
+    } else if (opcode == OP_VARIABLE && length >= 4) {
+      if (op[2] >= r->bound) return false;
+      r->ids[op[2]].opcode = OP_VARIABLE;
+      r->ids[op[2]].type = op[1];
+      r->ids[op[2]].storage = op[3];
+    }
+    i += length;
+  }
+  return *stage != 0;
+}
+
+static int compare_bindings(const void* a, const void* b) {
+  const SpirvBinding* x = a;
+  const SpirvBinding* y = b;
+  if (x->set != y->set) return x->set < y->set ? -1 : 1;
+  return x->binding < y->binding ? -1 : x->binding > y->binding;
+}
+
+// Second pass over the variables: descriptors, push constants and vertex inputs.
+static bool collect(const Reflector* r, SpirvReflection* reflection) {
+  for (uint32_t id = 0; id < r->bound; ++id) {
+    const SpirvId* var = &r->ids[id];
+    if (var->opcode != OP_VARIABLE || var->type >= r->bound) continue;
+    uint32_t pointee = r->ids[var->type].type;
+    if (pointee >= r->bound) continue;
+
+    if (var->storage == STORAGE_PUSH_CONSTANT) {
+      reflection->push_constant_size = type_size(r, pointee, 0, 0);
+    } else if (var->storage == STORAGE_INPUT) {
+      if (reflection->stage != VK_SHADER_STAGE_VERTEX_BIT || var->builtin || r->ids[pointee].builtin ||
+          !var->has_location) {
+        continue;
+      }
+      if (reflection->input_count == SPIRV_MAX_INPUTS) return false;
+      reflection->inputs[reflection->input_count++] = (SpirvInput){
+          .location = var->location, .format = input_format(r, pointee)};
+    } else if (var->has_binding) {
+      uint32_t count;
+      uint32_t element = descriptor_element(r, pointee, &count);
+      VkDescriptorType type;
+      if (!descriptor_type(r, var->storage, element, &type)) continue;
+      if (reflection->binding_count == SPIRV_MAX_BINDINGS) return false;
+      reflection->bindings[reflection->binding_count++] = (SpirvBinding){
+          .set = var->set, .binding = var->binding, .type = type, .count = count};
+    }
+  }
+  qsort(reflection->bindings, reflection->binding_count, sizeof(*reflection->bindings), compare_bindings);
+  return true;
+}
+
+bool spirv_reflect(const uint32_t* words, size_t word_count, SpirvReflection* reflection) {
+  memset(reflection, 0, sizeof(*reflection));
+  if (word_count < SPIRV_HEADER_WORDS || words[0] != SPIRV_MAGIC || words[3] == 0) return false;
+
+  Reflector r = {.words = words, .word_count = word_count, .bound = words[3]};
+  r.ids = calloc(r.bound, sizeof(*r.ids));
+  if (!r.ids) return false;
+
+  bool ok = parse(&r, &reflection->stage) && collect(&r, reflection);
+  free(r.ids);
+  if (!ok) memset(reflection, 0, sizeof(*reflection));
+  return ok;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+
+#define SPIRV_MAX_BINDINGS 32
+#define SPIRV_MAX_INPUTS 16
+
+typedef struct {
+  uint32_t set;
+  uint32_t binding;
+  VkDescriptorType type;
+  uint32_t count;  // array size; 0 for runtime-sized (bindless) arrays
+} SpirvBinding;
+
+typedef struct {
+  uint32_t location;
+  VkFormat format;
+} SpirvInput;
+
+// What one shader stage needs from its pipeline layout and vertex input state. Uniform
+// blocks are reported as VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; whether they are bound with
+// dynamic offsets is up to the layout.
+typedef struct {
+  VkShaderStageFlagBits stage;
+  SpirvBinding bindings[SPIRV_MAX_BINDINGS];  // sorted by set, then binding
+  uint32_t binding_count;
+  uint32_t push_constant_size;  // bytes, 0 without a push constant block
+  SpirvInput inputs[SPIRV_MAX_INPUTS];  // vertex stage only, builtins excluded
+  uint32_t input_count;
+} SpirvReflection;
+
+// Parses a SPIR-V module with a single entry point. Returns false on malformed words
+// or when the module needs more bindings or inputs than fit.
+bool spirv_reflect(const uint32_t* words, size_t word_count, SpirvReflection* reflection);
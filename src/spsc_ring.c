@@ -0,0 +1,50 @@
+#include "spsc_ring.h"
+#include <stdlib.h>
+#include <string.h>
+#include "base.h"
+
+bool spsc_ring_init(SpscRing* ring, size_t slot_size, uint32_t capacity) {
+  if (capacity == 0 || (capacity & (capacity - 1)) != 0) return false;
+
+  // Pad slots to a cache line so producer and consumer never share one.
+  size_t stride = ALIGN_FORWARD(slot_size, (size_t)CACHE_LINE_SIZE);
+  ring->slots = aligned_alloc(CACHE_LINE_SIZE, stride * capacity);
+  if (!ring->slots) return false;
+  memset(ring->slots, 0, stride * capacity);
+
+  ring->slot_size = stride;
+  ring->capacity = capacity;
+  atomic_init(&ring->head, 0);
+  atomic_init(&ring->tail, 0);
+  return true;
+}
+
+void spsc_ring_destroy(SpscRing* ring) {
+  free(ring->slots);
+  ring->slots = NULL;
+  ring->capacity = 0;
+}
+
+void* spsc_ring_acquire_write(SpscRing* ring) {
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+  if (head - tail == ring->capacity) return NULL;
+  return ring->slots + (size_t)(head & (ring->capacity - 1)) * ring->slot_size;
+}
+
+void spsc_ring_commit_write(SpscRing* ring) {
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+  atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
+
+void* spsc_ring_acquire_read(SpscRing* ring) {
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+  if (head == tail) return NULL;
+  return ring->slots + (size_t)(tail & (ring->capacity - 1)) * ring->slot_size;
+}
+
+void spsc_ring_release_read(SpscRing* ring) {
+  uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+  atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdalign.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_LINE_SIZE 64
+
+// Single-producer/single-consumer ring of fixed-size slots. Slots are filled and
+// consumed in place, so a producer writes directly into the memory the consumer reads.
+typedef struct {
+  uint8_t* slots;
+  size_t slot_size;
+  uint32_t capacity;
+  alignas(CACHE_LINE_SIZE) atomic_uint head;  // next slot to write, owned by the producer
+  alignas(CACHE_LINE_SIZE) atomic_uint tail;  // next slot to read, owned by the consumer
+} SpscRing;
+
+// capacity must be a power of two.
+bool spsc_ring_init(SpscRing* ring, size_t slot_size, uint32_t capacity);
+void spsc_ring_destroy(SpscRing* ring);
+
+// Producer side. Returns NULL when the ring is full.
+void* spsc_ring_acquire_write(SpscRing* ring);
+void spsc_ring_commit_write(SpscRing* ring);
+
+// Consumer side. Returns NULL when the ring is empty.
+void* spsc_ring_acquire_read(SpscRing* ring);
+void spsc_ring_release_read(SpscRing* ring);
@@ -0,0 +1,629 @@
+#include "texture.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bc_decode.h"
+
+// ASTC block footprints in VkFormat order, each as a UNORM/SRGB pair.
+static const uint8_t astc_blocks[][2] = {
+    {4, 4}, {5, 4}, {5, 5}, {6, 5}, {6, 6}, {8, 5}, {8, 6}, {8, 8}, {10, 5}, {10, 6}, {10, 8}, {10, 10}, {12, 10}, {12, 12}};
+
+bool texture_format_block(VkFormat format, uint32_t* block_width, uint32_t* block_height, uint32_t* block_bytes) {
+  *block_width = 1;
+  *block_height = 1;
+  switch (format) {
+    case VK_FORMAT_R8_UNORM:
+      *block_bytes = 1;
+      return true;
+    case VK_FORMAT_R8G8_UNORM:
+      *block_bytes = 2;
+      return true;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+      *block_bytes = 4;
+      return true;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+      *block_bytes = 8;
+      return true;
+    default:
+      break;
+  }
+
+  *block_width = 4;
+  *block_height = 4;
+  if (format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && format <= VK_FORMAT_BC1_RGBA_SRGB_BLOCK) {
+    *block_bytes = 8;
+    return true;
+  }
+  if (format == VK_FORMAT_BC4_UNORM_BLOCK || format == VK_FORMAT_BC4_SNORM_BLOCK) {
+    *block_bytes = 8;
+    return true;
+  }
+  if (format >= VK_FORMAT_BC2_UNORM_BLOCK && format <= VK_FORMAT_BC7_SRGB_BLOCK) {
+    *block_bytes = 16;
+    return true;
+  }
+  if (format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK) {
+    const uint8_t* block = astc_blocks[(format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
+    *block_width = block[0];
+    *block_height = block[1];
+    *block_bytes = 16;
+    return true;
+  }
+  return false;
+}
+
+VkDeviceSize texture_level_size(VkFormat format, uint32_t width, uint32_t height) {
+  uint32_t block_width, block_height, block_bytes;
+  if (!texture_format_block(format, &block_width, &block_height, &block_bytes)) return 0;
+  VkDeviceSize blocks_x = (width + block_width - 1) / block_width;
+  VkDeviceSize blocks_y = (height + block_height - 1) / block_height;
+  return blocks_x * blocks_y * block_bytes;
+}
+
+bool texture_format_supported(VkContext* ctx, VkFormat format, VkFormatFeatureFlags features) {
+  VkFormatProperties properties;
+  vkGetPhysicalDeviceFormatProperties(ctx->physical_device, format, &properties);
+  return (properties.optimalTilingFeatures & features) == features;
+}
+
+typedef enum {
+  MIP_GENERATE_NONE,
+  MIP_GENERATE_BLIT,
+  MIP_GENERATE_COMPUTE,
+} MipGenerateMode;
+
+// Mirrors the push constant block in shaders/mip_downsample.comp.
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  uint32_t source;
+  uint32_t source_level;
+  uint32_t target;
+} MipPushConstants;
+
+// Per-level storage views for the compute downsampler, alive until the upload finishes.
+typedef struct {
+  VkImageView views[TEXTURE_MAX_MIP_LEVELS];
+  uint32_t handles[TEXTURE_MAX_MIP_LEVELS];
+  uint32_t source;
+} MipTargets;
+
+static uint32_t full_mip_count(uint32_t width, uint32_t height) {
+  uint32_t levels = 1;
+  while ((MAX(width, height) >> levels) > 0 && levels < TEXTURE_MAX_MIP_LEVELS) levels++;
+  return levels;
+}
+
+static MipGenerateMode choose_mip_mode(VkContext* ctx, VkFormat format) {
+  VkFormatFeatureFlags blit = VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_BLIT_SRC_BIT |
+                              VK_FORMAT_FEATURE_BLIT_DST_BIT;
+  if (texture_format_supported(ctx, format, blit)) return MIP_GENERATE_BLIT;
+
+  if (!ctx->has_bindless || !ctx->has_storage_write_without_format ||
+      !texture_format_supported(ctx, format, VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+    return MIP_GENERATE_NONE;
+  }
+  if (ctx->mip_downsample_pipeline == VK_NULL_HANDLE &&
+      vk_create_compute_pipeline(ctx, "shaders/mip_downsample.comp.spv", ctx->pipeline_layout,
+                                 &ctx->mip_downsample_pipeline) != VK_SUCCESS) {
+    return MIP_GENERATE_NONE;
+  }
+  return MIP_GENERATE_COMPUTE;
+}
+
+static VkResult create_image(VkContext* ctx, const TextureDesc* desc, uint32_t mip_levels, VkImageUsageFlags usage,
+                             Texture* texture) {
+  VkImageCreateInfo image_info = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+      .imageType = VK_IMAGE_TYPE_2D,
+      .format = desc->format,
+      .extent = {desc->width, desc->height, 1},
+      .mipLevels = mip_levels,
+      .arrayLayers = 1,
+      .samples = VK_SAMPLE_COUNT_1_BIT,
+      .tiling = VK_IMAGE_TILING_OPTIMAL,
+      .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | usage,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED};
+  VkResult res = vkCreateImage(ctx->device, &image_info, NULL, &texture->image);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create texture image!\n");
+    return res;
+  }
+
+  VkMemoryRequirements reqs;
+  vkGetImageMemoryRequirements(ctx->device, texture->image, &reqs);
+  VkMemoryAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = reqs.size,
+      .memoryTypeIndex = vk_find_memory_type(ctx, reqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)};
+  if (alloc_info.memoryTypeIndex == UINT32_MAX) {
+    fprintf(stderr, "Failed to find a memory type for texture!\n");
+    return VK_ERROR_FEATURE_NOT_PRESENT;
+  }
+  if ((res = vk_allocate_memory(ctx, &alloc_info, &texture->memory)) != VK_SUCCESS) {
+    fprintf(stderr, "Failed to allocate texture memory!\n");
+    return res;
+  }
+  VK_RETURN(vkBindImageMemory(ctx->device, texture->image, texture->memory, 0));
+
+  VkImageViewCreateInfo view_info = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+      .image = texture->image,
+      .viewType = VK_IMAGE_VIEW_TYPE_2D,
+      .format = desc->format,
+      .subresourceRange = {
+          .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+          .levelCount = mip_levels,
+          .layerCount = 1}};
+  res = vkCreateImageView(ctx->device, &view_info, NULL, &texture->view);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create texture image view!\n");
+  }
+  return res;
+}
+
+static VkImageMemoryBarrier level_barrier(const Texture* texture, uint32_t base_level, uint32_t level_count) {
+  return (VkImageMemoryBarrier){
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = texture->image,
+      .subresourceRange = {
+          .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+          .baseMipLevel = base_level,
+          .levelCount = level_count,
+          .layerCount = 1}};
+}
+
+// Copies the provided levels; every level of the image is left in TRANSFER_DST_OPTIMAL.
+static void record_upload(VkCommandBuffer cmd, const TextureDesc* desc, const Texture* texture, VkBuffer staging) {
+  VkImageMemoryBarrier barrier = level_barrier(texture, 0, texture->mip_levels);
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL,
+                       1, &barrier);
+
+  VkBufferImageCopy regions[TEXTURE_MAX_MIP_LEVELS];
+  for (uint32_t level = 0; level < desc->mip_levels; ++level) {
+    regions[level] = (VkBufferImageCopy){
+        .bufferOffset = desc->level_offsets[level],
+        .imageSubresource = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel = level,
+            .layerCount = 1},
+        .imageExtent = {MAX(desc->width >> level, 1u), MAX(desc->height >> level, 1u), 1}};
+  }
+  vkCmdCopyBufferToImage(cmd, staging, texture->image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, desc->mip_levels, regions);
+}
+
+static void record_finish_upload(VkCommandBuffer cmd, const Texture* texture) {
+  VkImageMemoryBarrier barrier = level_barrier(texture, 0, texture->mip_levels);
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0,
+                       NULL, 1, &barrier);
+}
+
+// Each level is blitted from the one above it, so one barrier per level turns the
+// previous level into a blit source; a final call releases the whole chain.
+static void record_blit_mips(VkCommandBuffer cmd, const Texture* texture) {
+  for (uint32_t level = 1; level < texture->mip_levels; ++level) {
+    VkImageMemoryBarrier barrier = level_barrier(texture, level - 1, 1);
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL,
+                         1, &barrier);
+
+    VkImageBlit blit = {
+        .srcSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level - 1, .layerCount = 1},
+        .srcOffsets = {{0, 0, 0},
+                       {(int32_t)MAX(texture->width >> (level - 1), 1u), (int32_t)MAX(texture->height >> (level - 1), 1u), 1}},
+        .dstSubresource = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT, .mipLevel = level, .layerCount = 1},
+        .dstOffsets = {{0, 0, 0},
+                       {(int32_t)MAX(texture->width >> level, 1u), (int32_t)MAX(texture->height >> level, 1u), 1}}};
+    vkCmdBlitImage(cmd, texture->image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture->image,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+  }
+
+  uint32_t last = texture->mip_levels - 1;
+  VkImageMemoryBarrier barriers[2];
+  barriers[0] = level_barrier(texture, 0, last);
+  barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  barriers[1] = level_barrier(texture, last, 1);
+  barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0,
+                       NULL, 2, barriers);
+}
+
+static void destroy_mip_targets(VkContext* ctx, MipTargets* targets) {
+  bindless_remove_image(&ctx->bindless, targets->source);
+  for (uint32_t level = 0; level < TEXTURE_MAX_MIP_LEVELS; ++level) {
+    bindless_remove_storage_image(&ctx->bindless, targets->handles[level]);
+    if (targets->views[level] != VK_NULL_HANDLE) vkDestroyImageView(ctx->device, targets->views[level], NULL);
+  }
+  atomic_fetch_add_explicit(&ctx->destroyed_resources, 1, memory_order_relaxed);
+}
+
+static VkResult create_mip_targets(VkContext* ctx, const Texture* texture, MipTargets* targets) {
+  memset(targets, 0, sizeof(*targets));
+  for (uint32_t level = 0; level < TEXTURE_MAX_MIP_LEVELS; ++level) targets->handles[level] = BINDLESS_INVALID_HANDLE;
+
+  // The source is read with texelFetch while the chain sits in GENERAL.
+  targets->source = bindless_add_image(&ctx->bindless, texture->view, VK_IMAGE_LAYOUT_GENERAL);
+  if (targets->source == BINDLESS_INVALID_HANDLE) return VK_ERROR_TOO_MANY_OBJECTS;
+
+  for (uint32_t level = 1; level < texture->mip_levels; ++level) {
+    VkImageViewCreateInfo view_info = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = texture->image,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = texture->format,
+        .subresourceRange = {
+            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel = level,
+            .levelCount = 1,
+            .layerCount = 1}};
+    VK_RETURN(vkCreateImageView(ctx->device, &view_info, NULL, &targets->views[level]));
+    targets->handles[level] = bindless_add_storage_image(&ctx->bindless, targets->views[level]);
+    if (targets->handles[level] == BINDLESS_INVALID_HANDLE) return VK_ERROR_TOO_MANY_OBJECTS;
+  }
+  return VK_SUCCESS;
+}
+
+// Fallback for formats without linear blits: one 2x2 box-filter dispatch per level.
+static void record_compute_mips(VkContext* ctx, VkCommandBuffer cmd, const Texture* texture, const MipTargets* targets) {
+  VkImageMemoryBarrier barrier = level_barrier(texture, 0, texture->mip_levels);
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0, NULL,
+                       1, &barrier);
+
+  vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, ctx->mip_downsample_pipeline);
+  bindless_bind(&ctx->bindless, cmd, VK_PIPELINE_BIND_POINT_COMPUTE, ctx->pipeline_layout);
+  for (uint32_t level = 1; level < texture->mip_levels; ++level) {
+    MipPushConstants push = {
+        .width = MAX(texture->width >> level, 1u),
+        .height = MAX(texture->height >> level, 1u),
+        .source = targets->source,
+        .source_level = level - 1,
+        .target = targets->handles[level]};
+    vkCmdPushConstants(cmd, ctx->pipeline_layout, VK_SHADER_STAGE_ALL, 0, sizeof(push), &push);
+    vk_cmd_dispatch_threads(cmd, push.width, push.height, 1, 8, 8, 1);
+
+    barrier = level_barrier(texture, level, 1);
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL,
+                         0, NULL, 1, &barrier);
+  }
+
+  barrier = level_barrier(texture, 0, texture->mip_levels);
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, NULL, 0,
+                       NULL, 1, &barrier);
+}
+
+// Staging copy and mip generation state of one upload, released once it has executed.
+typedef struct {
+  VkBuffer staging;
+  VkDeviceMemory staging_memory;
+  MipGenerateMode mip_mode;
+  MipTargets targets;
+} TextureUpload;
+
+static void release_upload(VkContext* ctx, TextureUpload* upload) {
+  destroy_mip_targets(ctx, &upload->targets);
+  vk_destroy_buffer(ctx, upload->staging, upload->staging_memory);
+}
+
+// Creates the image and a filled staging buffer; on failure nothing is left behind.
+static VkResult begin_upload(VkContext* ctx, const TextureDesc* desc, Texture* texture, TextureUpload* upload) {
+  memset(texture, 0, sizeof(*texture));
+  texture->handle = BINDLESS_INVALID_HANDLE;
+  memset(upload, 0, sizeof(*upload));
+  upload->targets.source = BINDLESS_INVALID_HANDLE;
+  for (uint32_t level = 0; level < TEXTURE_MAX_MIP_LEVELS; ++level) upload->targets.handles[level] = BINDLESS_INVALID_HANDLE;
+  if (desc->mip_levels == 0 || desc->mip_levels > TEXTURE_MAX_MIP_LEVELS) {
+    fprintf(stderr, "Invalid texture mip count %u\n", desc->mip_levels);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  uint32_t mip_levels = desc->mip_levels;
+  MipGenerateMode mip_mode = MIP_GENERATE_NONE;
+  if (desc->generate_mips && desc->mip_levels == 1) {
+    mip_mode = choose_mip_mode(ctx, desc->format);
+    if (mip_mode == MIP_GENERATE_NONE) {
+      fprintf(stderr, "Warning: cannot generate mips for format %d, uploading one level\n", desc->format);
+    } else {
+      mip_levels = full_mip_count(desc->width, desc->height);
+    }
+  }
+  if (mip_levels == 1) mip_mode = MIP_GENERATE_NONE;
+  upload->mip_mode = mip_mode;
+  VkImageUsageFlags usage = mip_mode == MIP_GENERATE_BLIT      ? VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+                            : mip_mode == MIP_GENERATE_COMPUTE ? VK_IMAGE_USAGE_STORAGE_BIT
+                                                               : 0;
+
+  VK_RETURN(vk_create_buffer(ctx, desc->size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                             &upload->staging, &upload->staging_memory));
+  void* mapped;
+  VkResult res = vkMapMemory(ctx->device, upload->staging_memory, 0, desc->size, 0, &mapped);
+  if (res != VK_SUCCESS) goto fail;
+  memcpy(mapped, desc->data, desc->size);
+  vkUnmapMemory(ctx->device, upload->staging_memory);
+
+  if ((res = create_image(ctx, desc, mip_levels, usage, texture)) != VK_SUCCESS) goto fail;
+  texture->format = desc->format;
+  texture->width = desc->width;
+  texture->height = desc->height;
+  texture->mip_levels = mip_levels;
+  if (mip_mode == MIP_GENERATE_COMPUTE && (res = create_mip_targets(ctx, texture, &upload->targets)) != VK_SUCCESS) {
+    goto fail;
+  }
+  return VK_SUCCESS;
+
+fail:
+  release_upload(ctx, upload);
+  texture_destroy(ctx, texture);
+  return res;
+}
+
+static void record_texture_upload(VkContext* ctx, VkCommandBuffer cmd, const TextureDesc* desc, const Texture* texture,
+                                  const TextureUpload* upload) {
+  record_upload(cmd, desc, texture, upload->staging);
+  switch (upload->mip_mode) {
+    case MIP_GENERATE_NONE:
+      record_finish_upload(cmd, texture);
+      break;
+    case MIP_GENERATE_BLIT:
+      record_blit_mips(cmd, texture);
+      break;
+    case MIP_GENERATE_COMPUTE:
+      record_compute_mips(ctx, cmd, texture, &upload->targets);
+      break;
+  }
+}
+
+static void add_bindless_handle(VkContext* ctx, Texture* texture) {
+  if (ctx->has_bindless) {
+    texture->handle = bindless_add_image(&ctx->bindless, texture->view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  }
+}
+
+VkResult texture_create(VkContext* ctx, const TextureDesc* desc, Texture* texture) {
+  TextureUpload upload;
+  VK_RETURN(begin_upload(ctx, desc, texture, &upload));
+  VkCommandBuffer cmd;
+  VkResult res = vk_begin_single_time_commands(ctx, &cmd);
+  if (res == VK_SUCCESS) {
+    record_texture_upload(ctx, cmd, desc, texture, &upload);
+    res = vk_end_single_time_commands(ctx, cmd);
+  }
+  release_upload(ctx, &upload);
+  if (res != VK_SUCCESS) {
+    texture_destroy(ctx, texture);
+    return res;
+  }
+  add_bindless_handle(ctx, texture);
+  return VK_SUCCESS;
+}
+
+typedef struct {
+  VkContext* ctx;
+  TextureUpload upload;
+} RetiredUpload;
+
+static void destroy_retired_upload(void* user_data) {
+  RetiredUpload* retired = user_data;
+  release_upload(retired->ctx, &retired->upload);
+  free(retired);
+}
+
+VkResult texture_create_recorded(VkContext* ctx, const TextureDesc* desc, VkCommandBuffer cmd, Texture* texture) {
+  RetiredUpload* retired = malloc(sizeof(*retired));
+  if (!retired) return VK_ERROR_OUT_OF_HOST_MEMORY;
+  VkResult res = begin_upload(ctx, desc, texture, &retired->upload);
+  if (res != VK_SUCCESS) {
+    free(retired);
+    return res;
+  }
+  record_texture_upload(ctx, cmd, desc, texture, &retired->upload);
+  retired->ctx = ctx;
+  vk_defer_call(ctx, destroy_retired_upload, retired);
+  add_bindless_handle(ctx, texture);
+  return VK_SUCCESS;
+}
+
+void texture_destroy(VkContext* ctx, Texture* texture) {
+  bindless_remove_image(&ctx->bindless, texture->handle);
+  if (texture->view != VK_NULL_HANDLE) vkDestroyImageView(ctx->device, texture->view, NULL);
+  atomic_fetch_add_explicit(&ctx->destroyed_resources, 1, memory_order_relaxed);
+  if (texture->image != VK_NULL_HANDLE) vkDestroyImage(ctx->device, texture->image, NULL);
+  vk_free_memory(ctx, texture->memory);
+  memset(texture, 0, sizeof(*texture));
+  texture->handle = BINDLESS_INVALID_HANDLE;
+}
+
+void texture_destroy_deferred(VkContext* ctx, Texture* texture) {
+  vk_defer_remove_bindless_image(ctx, texture->handle);
+  vk_defer_destroy_image(ctx, texture->image, texture->view, texture->memory);
+  memset(texture, 0, sizeof(*texture));
+  texture->handle = BINDLESS_INVALID_HANDLE;
+}
+
+static const uint8_t ktx2_identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+typedef struct {
+  uint8_t identifier[12];
+  uint32_t vk_format;
+  uint32_t type_size;
+  uint32_t pixel_width;
+  uint32_t pixel_height;
+  uint32_t pixel_depth;
+  uint32_t layer_count;
+  uint32_t face_count;
+  uint32_t level_count;
+  uint32_t supercompression_scheme;
+  uint32_t dfd_byte_offset;
+  uint32_t dfd_byte_length;
+  uint32_t kvd_byte_offset;
+  uint32_t kvd_byte_length;
+  uint64_t sgd_byte_offset;
+  uint64_t sgd_byte_length;
+} Ktx2Header;
+
+typedef struct {
+  uint64_t byte_offset;
+  uint64_t byte_length;
+  uint64_t uncompressed_byte_length;
+} Ktx2Level;
+
+static uint8_t* read_file(const char* path, size_t* size) {
+  FILE* file = fopen(path, "rb");
+  if (!file) return NULL;
+  fseek(file, 0, SEEK_END);
+  long length = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  uint8_t* data = length > 0 ? malloc((size_t)length) : NULL;
+  if (data && fread(data, (size_t)length, 1, file) != 1) {
+    free(data);
+    data = NULL;
+  }
+  fclose(file);
+  *size = (size_t)length;
+  return data;
+}
+
+// Decodes every level into one tightly packed RGBA8 buffer.
+static uint8_t* transcode_levels(TextureDesc* desc, const uint8_t* file, const Ktx2Level* levels) {
+  VkFormat decoded_format = bc_decode_format(desc->format);
+  VkDeviceSize total = 0;
+  for (uint32_t level = 0; level < desc->mip_levels; ++level) {
+    total += texture_level_size(decoded_format, MAX(desc->width >> level, 1u), MAX(desc->height >> level, 1u));
+  }
+
+  uint8_t* pixels = malloc(total);
+  if (!pixels) return NULL;
+  VkDeviceSize offset = 0;
+  for (uint32_t level = 0; level < desc->mip_levels; ++level) {
+    uint32_t width = MAX(desc->width >> level, 1u);
+    uint32_t height = MAX(desc->height >> level, 1u);
+    bc_decode_image(desc->format, file + levels[level].byte_offset, width, height, pixels + offset);
+    desc->level_offsets[level] = offset;
+    offset += texture_level_size(decoded_format, width, height);
+  }
+  desc->format = decoded_format;
+  desc->data = pixels;
+  desc->size = total;
+  return pixels;
+}
+
+VkResult texture_load_ktx2(VkContext* ctx, const char* path, Texture* texture) {
+  return texture_load_ktx2_lod(ctx, path, 0, texture);
+}
+
+VkResult texture_load_ktx2_lod(VkContext* ctx, const char* path, uint32_t first_level, Texture* texture) {
+  memset(texture, 0, sizeof(*texture));
+  texture->handle = BINDLESS_INVALID_HANDLE;
+  TextureDesc desc;
+  void* storage;
+  VK_RETURN(texture_read_ktx2(ctx, path, first_level, &desc, &storage));
+  VkResult res = texture_create(ctx, &desc, texture);
+  free(storage);
+  return res;
+}
+
+VkResult texture_read_ktx2(VkContext* ctx, const char* path, uint32_t first_level, TextureDesc* desc, void** storage) {
+  *storage = NULL;
+  size_t size = 0;
+  uint8_t* file = read_file(path, &size);
+  if (!file) {
+    fprintf(stderr, "Failed to open texture '%s'\n", path);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  VkResult res = VK_ERROR_FORMAT_NOT_SUPPORTED;
+  Ktx2Header header;
+  if (size < sizeof(header)) goto invalid;
+  memcpy(&header, file, sizeof(header));
+  if (memcmp(header.identifier, ktx2_identifier, sizeof(ktx2_identifier)) != 0) goto invalid;
+
+  if (header.pixel_depth > 1 || header.layer_count > 1 || header.face_count != 1 || header.supercompression_scheme != 0) {
+    fprintf(stderr, "Texture '%s': only plain 2D KTX2 without supercompression is supported\n", path);
+    goto fail;
+  }
+
+  // A level count of zero asks the loader to generate the chain; only the base level is stored.
+  uint32_t level_count = MAX(header.level_count, 1u);
+  bool generate_mips = header.level_count == 0;
+  if (level_count > TEXTURE_MAX_MIP_LEVELS || size < sizeof(header) + sizeof(Ktx2Level) * level_count) goto invalid;
+  Ktx2Level file_levels[TEXTURE_MAX_MIP_LEVELS];
+  memcpy(file_levels, file + sizeof(header), sizeof(Ktx2Level) * level_count);
+  // Generated chains have only the base level on disk, so they cannot be trimmed.
+  first_level = generate_mips ? 0 : MIN(first_level, level_count - 1);
+  const Ktx2Level* levels = file_levels + first_level;
+  level_count -= first_level;
+
+  *desc = (TextureDesc){
+      .width = MAX(header.pixel_width >> first_level, 1u),
+      .height = MAX(header.pixel_height >> first_level, 1u),
+      .format = (VkFormat)header.vk_format,
+      .mip_levels = level_count,
+      .generate_mips = generate_mips,
+      .data = file,
+      .size = size};
+  for (uint32_t level = 0; level < level_count; ++level) {
+    VkDeviceSize expected = texture_level_size(desc->format, MAX(desc->width >> level, 1u), MAX(desc->height >> level, 1u));
+    if (expected == 0 || levels[level].byte_length < expected || levels[level].byte_offset > size ||
+        expected > size - levels[level].byte_offset) {
+      goto invalid;
+    }
+    desc->level_offsets[level] = levels[level].byte_offset;
+  }
+
+  if (!texture_format_supported(ctx, desc->format, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) {
+    if (bc_decode_format(desc->format) == VK_FORMAT_UNDEFINED) {
+      fprintf(stderr, "Texture '%s': format %u is not supported by the device\n", path, header.vk_format);
+      goto fail;
+    }
+    fprintf(stderr, "Texture '%s': format %u not supported, decoding on the CPU\n", path, header.vk_format);
+    uint8_t* transcoded = transcode_levels(desc, file, levels);
+    free(file);
+    *storage = transcoded;
+    return transcoded ? VK_SUCCESS : VK_ERROR_OUT_OF_HOST_MEMORY;
+  }
+  *storage = file;
+  return VK_SUCCESS;
+
+invalid:
+  fprintf(stderr, "Invalid KTX2 file '%s'\n", path);
+fail:
+  free(file);
+  return res;
+}
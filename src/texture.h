@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "vk.h"
+
+#define TEXTURE_MAX_MIP_LEVELS 16
+
+typedef struct {
+  VkImage image;
+  VkDeviceMemory memory;
+  VkImageView view;
+  VkFormat format;
+  uint32_t width;
+  uint32_t height;
+  uint32_t mip_levels;
+  uint32_t handle;  // bindless image handle, BINDLESS_INVALID_HANDLE without bindless
+} Texture;
+
+// Pixel data for every mip level in one buffer, largest level first.
+typedef struct {
+  uint32_t width;
+  uint32_t height;
+  VkFormat format;
+  uint32_t mip_levels;
+  // With a single level, builds the rest of the chain on the GPU: linear blits when
+  // the format allows them, the compute downsampler otherwise.
+  bool generate_mips;
+  const void* data;
+  VkDeviceSize size;
+  VkDeviceSize level_offsets[TEXTURE_MAX_MIP_LEVELS];
+} TextureDesc;
+
+// Block footprint of a format; plain formats are 1x1 blocks. False if unknown.
+bool texture_format_block(VkFormat format, uint32_t* block_width, uint32_t* block_height, uint32_t* block_bytes);
+VkDeviceSize texture_level_size(VkFormat format, uint32_t width, uint32_t height);
+bool texture_format_supported(VkContext* ctx, VkFormat format, VkFormatFeatureFlags features);
+
+// Uploads every level through one staging buffer and leaves the image shader-readable.
+// Waits for the upload on the graphics queue.
+VkResult texture_create(VkContext* ctx, const TextureDesc* desc, Texture* texture);
+// Same, recording the upload into `cmd` instead of waiting; the texture is readable by
+// commands recorded after it. Staging memory goes to the deletion queue.
+VkResult texture_create_recorded(VkContext* ctx, const TextureDesc* desc, VkCommandBuffer cmd, Texture* texture);
+// Loads an uncompressed-container KTX2 file (supercompression is not supported). Block
+// formats the device cannot sample are decoded on the CPU where bc_decode knows them.
+VkResult texture_load_ktx2(VkContext* ctx, const char* path, Texture* texture);
+// Same, skipping the `first_level` largest mips stored in the file; for reduced residency.
+VkResult texture_load_ktx2_lod(VkContext* ctx, const char* path, uint32_t first_level, Texture* texture);
+// Parses the file into a desc for texture_create without creating anything on the device,
+// so it may run on a loader thread. desc->data points into *storage; free it after the upload.
+VkResult texture_read_ktx2(VkContext* ctx, const char* path, uint32_t first_level, TextureDesc* desc, void** storage);
+void texture_destroy(VkContext* ctx, Texture* texture);
+// Like texture_destroy, for a texture that frames in flight may still sample.
+void texture_destroy_deferred(VkContext* ctx, Texture* texture);
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct Thread Thread;
+typedef struct Mutex Mutex;
+typedef struct Semaphore Semaphore;
+
+typedef int (*ThreadFn)(void* arg);
+
+Thread* thread_create(ThreadFn fn, void* arg, const char* name);
+int thread_join(Thread* thread);
+void thread_yield(void);
+
+Mutex* mutex_create(void);
+void mutex_lock(Mutex* mutex);
+void mutex_unlock(Mutex* mutex);
+void mutex_destroy(Mutex* mutex);
+
+// Counting semaphore, used to park threads when a lock-free queue is empty or full.
+Semaphore* semaphore_create(uint32_t initial_count);
+void semaphore_wait(Semaphore* sem);
+bool semaphore_try_wait(Semaphore* sem);
+void semaphore_post(Semaphore* sem);
+void semaphore_destroy(Semaphore* sem);
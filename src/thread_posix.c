@@ -0,0 +1,124 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "thread.h"
+
+struct Thread {
+  pthread_t handle;
+  ThreadFn fn;
+  void* arg;
+  int result;
+  char name[16];
+};
+
+struct Mutex {
+  pthread_mutex_t handle;
+};
+
+struct Semaphore {
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint32_t count;
+};
+
+static void* thread_entry(void* arg) {
+  Thread* thread = arg;
+#ifdef __linux__
+  if (thread->name[0]) pthread_setname_np(pthread_self(), thread->name);
+#endif
+  thread->result = thread->fn(thread->arg);
+  return NULL;
+}
+
+Thread* thread_create(ThreadFn fn, void* arg, const char* name) {
+  Thread* thread = malloc(sizeof(*thread));
+  if (!thread) return NULL;
+  memset(thread, 0, sizeof(*thread));
+  thread->fn = fn;
+  thread->arg = arg;
+  if (name) strncpy(thread->name, name, sizeof(thread->name) - 1);
+
+  if (pthread_create(&thread->handle, NULL, thread_entry, thread) != 0) {
+    fprintf(stderr, "Failed to create thread '%s'\n", thread->name);
+    free(thread);
+    return NULL;
+  }
+  return thread;
+}
+
+int thread_join(Thread* thread) {
+  if (!thread) return 0;
+  pthread_join(thread->handle, NULL);
+  int result = thread->result;
+  free(thread);
+  return result;
+}
+
+void thread_yield(void) {
+  sched_yield();
+}
+
+Mutex* mutex_create(void) {
+  Mutex* mutex = malloc(sizeof(*mutex));
+  if (!mutex) return NULL;
+  pthread_mutex_init(&mutex->handle, NULL);
+  return mutex;
+}
+
+void mutex_lock(Mutex* mutex) {
+  pthread_mutex_lock(&mutex->handle);
+}
+
+void mutex_unlock(Mutex* mutex) {
+  pthread_mutex_unlock(&mutex->handle);
+}
+
+void mutex_destroy(Mutex* mutex) {
+  if (!mutex) return;
+  pthread_mutex_destroy(&mutex->handle);
+  free(mutex);
+}
+
+Semaphore* semaphore_create(uint32_t initial_count) {
+  Semaphore* sem = malloc(sizeof(*sem));
+  if (!sem) return NULL;
+  pthread_mutex_init(&sem->lock, NULL);
+  pthread_cond_init(&sem->cond, NULL);
+  sem->count = initial_count;
+  return sem;
+}
+
+void semaphore_wait(Semaphore* sem) {
+  pthread_mutex_lock(&sem->lock);
+  while (sem->count == 0) {
+    pthread_cond_wait(&sem->cond, &sem->lock);
+  }
+  sem->count--;
+  pthread_mutex_unlock(&sem->lock);
+}
+
+bool semaphore_try_wait(Semaphore* sem) {
+  pthread_mutex_lock(&sem->lock);
+  bool acquired = sem->count > 0;
+  if (acquired) sem->count--;
+  pthread_mutex_unlock(&sem->lock);
+  return acquired;
+}
+
+void semaphore_post(Semaphore* sem) {
+  pthread_mutex_lock(&sem->lock);
+  sem->count++;
+  pthread_cond_signal(&sem->cond);
+  pthread_mutex_unlock(&sem->lock);
+}
+
+void semaphore_destroy(Semaphore* sem) {
+  if (!sem) return;
+  pthread_cond_destroy(&sem->cond);
+  pthread_mutex_destroy(&sem->lock);
+  free(sem);
+}
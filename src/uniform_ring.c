@@ -0,0 +1,134 @@
+#include "uniform_ring.h"
+#include <stdio.h>
+#include <string.h>
+#include "base.h"
+#include "vk.h"
+
+static uint32_t find_host_memory_type(VkPhysicalDevice physical_device, uint32_t type_bits) {
+  VkMemoryPropertyFlags wanted = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  VkPhysicalDeviceMemoryProperties mem_properties;
+  vkGetPhysicalDeviceMemoryProperties(physical_device, &mem_properties);
+  // Prefer memory the GPU reads fast (resizable BAR / unified memory) when there is some.
+  for (uint32_t pass = 0; pass < 2; ++pass) {
+    VkMemoryPropertyFlags flags = pass == 0 ? wanted | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT : wanted;
+    for (uint32_t i = 0; i < mem_properties.memoryTypeCount; ++i) {
+      if ((type_bits & (1u << i)) && (mem_properties.memoryTypes[i].propertyFlags & flags) == flags) return i;
+    }
+  }
+  return UINT32_MAX;
+}
+
+static VkResult create_descriptors(UniformRing* ring) {
+  VkDescriptorSetLayoutBinding binding = {
+      .binding = 0,
+      .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+      .descriptorCount = 1,
+      .stageFlags = VK_SHADER_STAGE_ALL};
+  VkDescriptorSetLayoutCreateInfo layout_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+      .bindingCount = 1,
+      .pBindings = &binding};
+  VK_RETURN(vkCreateDescriptorSetLayout(ring->device, &layout_info, NULL, &ring->layout));
+
+  VkDescriptorPoolSize pool_size = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1};
+  VkDescriptorPoolCreateInfo pool_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+      .maxSets = 1,
+      .poolSizeCount = 1,
+      .pPoolSizes = &pool_size};
+  VK_RETURN(vkCreateDescriptorPool(ring->device, &pool_info, NULL, &ring->pool));
+
+  VkDescriptorSetAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+      .descriptorPool = ring->pool,
+      .descriptorSetCount = 1,
+      .pSetLayouts = &ring->layout};
+  VK_RETURN(vkAllocateDescriptorSets(ring->device, &alloc_info, &ring->set));
+
+  VkDescriptorBufferInfo buffer_info = {.buffer = ring->buffer, .offset = 0, .range = UNIFORM_RING_MAX_RANGE};
+  VkWriteDescriptorSet write = {
+      .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+      .dstSet = ring->set,
+      .dstBinding = 0,
+      .descriptorCount = 1,
+      .descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+      .pBufferInfo = &buffer_info};
+  vkUpdateDescriptorSets(ring->device, 1, &write, 0, NULL);
+  return VK_SUCCESS;
+}
+
+VkResult uniform_ring_init(UniformRing* ring, VkPhysicalDevice physical_device, VkDevice device, BindlessHeap* bindless) {
+  memset(ring, 0, sizeof(*ring));
+  ring->device = device;
+  ring->storage_handle = BINDLESS_INVALID_HANDLE;
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(physical_device, &properties);
+  ring->alignment = MAX(properties.limits.minUniformBufferOffsetAlignment,
+                        properties.limits.minStorageBufferOffsetAlignment);
+
+  // The tail lets a block at the very end of the last region still be bound with the full range.
+  VkDeviceSize size = (VkDeviceSize)UNIFORM_RING_FRAME_SIZE * MAX_FRAMES_IN_FLIGHT + UNIFORM_RING_MAX_RANGE;
+  VkBufferCreateInfo buffer_info = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .size = size,
+      .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+      .sharingMode = VK_SHARING_MODE_EXCLUSIVE};
+  VkResult res = vkCreateBuffer(device, &buffer_info, NULL, &ring->buffer);
+  if (res != VK_SUCCESS) goto fail;
+
+  VkMemoryRequirements requirements;
+  vkGetBufferMemoryRequirements(device, ring->buffer, &requirements);
+  VkMemoryAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = requirements.size,
+      .memoryTypeIndex = find_host_memory_type(physical_device, requirements.memoryTypeBits)};
+  if (alloc_info.memoryTypeIndex == UINT32_MAX) {
+    res = VK_ERROR_FEATURE_NOT_PRESENT;
+    goto fail;
+  }
+  if ((res = vkAllocateMemory(device, &alloc_info, NULL, &ring->memory)) != VK_SUCCESS) goto fail;
+  if ((res = vkBindBufferMemory(device, ring->buffer, ring->memory, 0)) != VK_SUCCESS) goto fail;
+  if ((res = vkMapMemory(device, ring->memory, 0, VK_WHOLE_SIZE, 0, (void**)&ring->mapped)) != VK_SUCCESS) goto fail;
+  if ((res = create_descriptors(ring)) != VK_SUCCESS) goto fail;
+
+  ring->storage_handle = bindless_add_buffer(bindless, ring->buffer, 0, size);
+  uniform_ring_begin_frame(ring, 0);
+  return VK_SUCCESS;
+
+fail:
+  fprintf(stderr, "Failed to create uniform ring!\n");
+  uniform_ring_destroy(ring, bindless);
+  return res;
+}
+
+void uniform_ring_destroy(UniformRing* ring, BindlessHeap* bindless) {
+  if (ring->device == VK_NULL_HANDLE) return;
+  bindless_remove_buffer(bindless, ring->storage_handle);
+  if (ring->pool != VK_NULL_HANDLE) vkDestroyDescriptorPool(ring->device, ring->pool, NULL);
+  if (ring->layout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(ring->device, ring->layout, NULL);
+  if (ring->buffer != VK_NULL_HANDLE) vkDestroyBuffer(ring->device, ring->buffer, NULL);
+  if (ring->memory != VK_NULL_HANDLE) vkFreeMemory(ring->device, ring->memory, NULL);
+  memset(ring, 0, sizeof(*ring));
+}
+
+void uniform_ring_begin_frame(UniformRing* ring, uint32_t frame) {
+  ring->head = (VkDeviceSize)frame * UNIFORM_RING_FRAME_SIZE;
+  ring->frame_end = ring->head + UNIFORM_RING_FRAME_SIZE;
+}
+
+void* uniform_ring_alloc(UniformRing* ring, VkDeviceSize size, uint32_t* offset) {
+  VkDeviceSize start = ALIGN_FORWARD(ring->head, ring->alignment);
+  if (!ring->mapped || start + size > ring->frame_end) {
+    *offset = UNIFORM_RING_INVALID_OFFSET;
+    return NULL;
+  }
+  ring->head = start + size;
+  *offset = (uint32_t)start;
+  return ring->mapped + start;
+}
+
+void uniform_ring_bind(UniformRing* ring, VkCommandBuffer cmd, VkPipelineBindPoint bind_point, VkPipelineLayout layout,
+                       uint32_t offset) {
+  vkCmdBindDescriptorSets(cmd, bind_point, layout, UNIFORM_RING_SET, 1, &ring->set, 1, &offset);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <vulkan/vulkan.h>
+#include "bindless.h"
+
+#define UNIFORM_RING_SET 1  // descriptor set index in the shared pipeline layout
+#define UNIFORM_RING_FRAME_SIZE (1u << 20)
+// Largest block one dynamic uniform binding can see; the spec guarantees 16 KiB.
+#define UNIFORM_RING_MAX_RANGE 16384u
+#define UNIFORM_RING_INVALID_OFFSET UINT32_MAX
+
+// Persistently mapped, host-coherent buffer split into one region per frame in flight.
+// Allocation is a pointer bump, so per-draw data costs a memcpy and a dynamic offset on
+// vkCmdBindDescriptorSets; the descriptor itself is written once at init. Shaders read
+// blocks either as the dynamic uniform buffer at set UNIFORM_RING_SET, binding 0, or
+// through storage_handle in the bindless buffer array at the returned offset.
+typedef struct {
+  VkDevice device;
+  VkBuffer buffer;
+  VkDeviceMemory memory;
+  uint8_t* mapped;
+  VkDeviceSize alignment;
+  VkDeviceSize head;
+  VkDeviceSize frame_end;
+
+  VkDescriptorSetLayout layout;
+  VkDescriptorPool pool;
+  VkDescriptorSet set;
+  uint32_t storage_handle;
+} UniformRing;
+
+VkResult uniform_ring_init(UniformRing* ring, VkPhysicalDevice physical_device, VkDevice device, BindlessHeap* bindless);
+void uniform_ring_destroy(UniformRing* ring, BindlessHeap* bindless);
+// Recycles the frame's region; its previous contents must no longer be in use on the GPU.
+void uniform_ring_begin_frame(UniformRing* ring, uint32_t frame);
+// Returns a mapped pointer and the block's offset, or NULL when the frame's region is full.
+void* uniform_ring_alloc(UniformRing* ring, VkDeviceSize size, uint32_t* offset);
+void uniform_ring_bind(UniformRing* ring, VkCommandBuffer cmd, VkPipelineBindPoint bind_point, VkPipelineLayout layout,
+                       uint32_t offset);
@@ -4,16 +4,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define CLAMP(x, a, b) (((x) < (a)) ? (a) : ((b) < (x)) ? (b) \
-                                                        : (x))
-#define COUNTOF(a) (sizeof(a) / sizeof(*(a)))
-#define ALIGN_FORWARD(x, align) (((x) + ((align) - 1)) & ~((align) - 1))
-#define VK_RETURN(expr)                  \
-  do {                                   \
-    VkResult _res = (expr);              \
-    if (_res != VK_SUCCESS) return _res; \
-  } while (0)
-
 static void log_version() {
   uint32_t api_version;
   vkEnumerateInstanceVersion(&api_version);
@@ -85,6 +75,24 @@ static bool has_validation_layer(const char* name) {
   return found;
 }
 
+static bool has_device_extension(VkPhysicalDevice device, const char* name) {
+  uint32_t count = 0;
+  if (vkEnumerateDeviceExtensionProperties(device, NULL, &count, NULL) != VK_SUCCESS) return false;
+  VkExtensionProperties* props = malloc(count * sizeof(*props));
+  if (!props) return false;
+  bool found = false;
+  if (vkEnumerateDeviceExtensionProperties(device, NULL, &count, props) == VK_SUCCESS) {
+    for (uint32_t i = 0; i < count; ++i) {
+      if (strcmp(props[i].extensionName, name) == 0) {
+        found = true;
+        break;
+      }
+    }
+  }
+  free(props);
+  return found;
+}
+
 static VkResult create_instance_sdl(VkContext* ctx) {
   uint32_t window_exts_count = 0;
   const char* const* window_exts = window_get_vulkan_required_extensions(&window_exts_count);
@@ -162,6 +170,7 @@ static VkResult create_instance_sdl(VkContext* ctx) {
     fprintf(stderr, "Failed to create vulkan instance!\n");
   }
   ctx->enable_validation = enable_validation;
+  ctx->api_version = api_version;
   free(exts);
   return res;
 }
@@ -193,8 +202,9 @@ static VkResult setup_debug_utils(VkContext* ctx) {
   return pCreate(ctx->instance, &ci, NULL, &ctx->debug_messenger);
 }
 
-static VkResult create_sdl_surface(Window* window, VkContext* ctx) {
-  if (!window_create_vulkan_surface(window, ctx->instance, NULL, &ctx->surface)) {
+static VkResult create_sdl_surface(Window* window, VkContext* ctx, VkSwapchainContext* target) {
+  target->window = window;
+  if (!window_create_vulkan_surface(window, ctx->instance, NULL, &target->surface)) {
     fprintf(stderr, "Failed to create window surface\n");
     return VK_ERROR_INITIALIZATION_FAILED;
   }
@@ -204,8 +214,10 @@ static VkResult create_sdl_surface(Window* window, VkContext* ctx) {
 typedef struct {
   uint32_t graphics_family;
   uint32_t present_family;
+  uint32_t compute_family;
   bool found_graphics_family;
   bool found_present_family;
+  bool found_compute_family;  // a compute family without graphics, for async compute
 } QueueFamilyIndices;
 
 static QueueFamilyIndices find_queue_families(VkPhysicalDevice device, VkContext* ctx) {
@@ -216,20 +228,25 @@ static QueueFamilyIndices find_queue_families(VkPhysicalDevice device, VkContext
   vkGetPhysicalDeviceQueueFamilyProperties(device, &queue_family_count, queue_families);
 
   for (uint32_t i = 0; i < queue_family_count; ++i) {
-    if (queue_families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+    VkQueueFlags flags = queue_families[i].queueFlags;
+    if ((flags & VK_QUEUE_GRAPHICS_BIT) && !result.found_graphics_family) {
       result.graphics_family = i;
       result.found_graphics_family = true;
     }
+    if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) && !result.found_compute_family) {
+      result.compute_family = i;
+      result.found_compute_family = true;
+    }
     VkBool32 present_support = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, ctx->surface, &present_support);
-    if (present_support) {
+    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, ctx->windows[0].surface, &present_support);
+    if (present_support && !result.found_present_family) {
       result.present_family = i;
       result.found_present_family = true;
     }
-
-    if (result.found_graphics_family && result.found_present_family) break;
   }
   free(queue_families);
+
+  if (!result.found_compute_family) result.compute_family = result.graphics_family;
   return result;
 }
 
@@ -241,21 +258,21 @@ typedef struct {
   uint32_t present_modes_count;
 } SwapchainSupportDetails;
 
-static SwapchainSupportDetails query_swapchain_support(VkPhysicalDevice device, VkContext* ctx) {
+static SwapchainSupportDetails query_swapchain_support(VkPhysicalDevice device, VkSurfaceKHR surface) {
   SwapchainSupportDetails details = {0};
 
-  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, ctx->surface, &details.capabilities);
+  vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &details.capabilities);
 
-  vkGetPhysicalDeviceSurfaceFormatsKHR(device, ctx->surface, &details.formats_count, NULL);
+  vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &details.formats_count, NULL);
   if (details.formats_count != 0) {
     details.formats = malloc(sizeof(*details.formats) * details.formats_count);
-    vkGetPhysicalDeviceSurfaceFormatsKHR(device, ctx->surface, &details.formats_count, details.formats);
+    vkGetPhysicalDeviceSurfaceFormatsKHR(device, surface, &details.formats_count, details.formats);
   }
 
-  vkGetPhysicalDeviceSurfacePresentModesKHR(device, ctx->surface, &details.present_modes_count, NULL);
+  vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &details.present_modes_count, NULL);
   if (details.present_modes_count != 0) {
     details.present_modes = malloc(sizeof(*details.present_modes) * details.present_modes_count);
-    vkGetPhysicalDeviceSurfacePresentModesKHR(device, ctx->surface, &details.present_modes_count, details.present_modes);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(device, surface, &details.present_modes_count, details.present_modes);
   }
 
   return details;
@@ -277,11 +294,11 @@ static bool is_device_suitable(VkPhysicalDevice device, VkContext* ctx) {
   QueueFamilyIndices queue_families = find_queue_families(device, ctx);
 
   bool swapchain_adequate = false;
-  SwapchainSupportDetails swapchain_support = query_swapchain_support(device, ctx);
+  SwapchainSupportDetails swapchain_support = query_swapchain_support(device, ctx->windows[0].surface);
   swapchain_adequate = swapchain_support.formats_count != 0 && swapchain_support.present_modes_count;
   free_swapchain_support(&swapchain_support);
 
-  return properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU &&
+  return (properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU || ctx->any_device) &&
          queue_families.found_present_family &&
          queue_families.found_graphics_family &&
          swapchain_adequate;
@@ -303,11 +320,14 @@ static VkResult pick_physical_device(VkContext* ctx) {
     return res;
   }
 
+  // A discrete GPU wins even when any_device lets the others through.
   for (uint32_t i = 0; i < device_count; ++i) {
-    if (is_device_suitable(devices[i], ctx)) {
-      ctx->physical_device = devices[i];
-      break;
-    }
+    if (!is_device_suitable(devices[i], ctx)) continue;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(devices[i], &properties);
+    bool discrete = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+    if (ctx->physical_device == VK_NULL_HANDLE || discrete) ctx->physical_device = devices[i];
+    if (discrete) break;
   }
   free(devices);
 
@@ -321,12 +341,16 @@ static VkResult pick_physical_device(VkContext* ctx) {
 static VkResult create_logical_device(VkContext* ctx) {
   QueueFamilyIndices queue_familiy_indicies = find_queue_families(ctx->physical_device, ctx);
 
-  uint32_t* unique_queue_families = malloc(sizeof(uint32_t) * 2);
+  uint32_t* unique_queue_families = malloc(sizeof(uint32_t) * 3);
   uint32_t unique_queue_family_count = 0;
   unique_queue_families[unique_queue_family_count++] = queue_familiy_indicies.graphics_family;
   if (queue_familiy_indicies.graphics_family != queue_familiy_indicies.present_family) {
     unique_queue_families[unique_queue_family_count++] = queue_familiy_indicies.present_family;
   }
+  if (queue_familiy_indicies.found_compute_family &&
+      queue_familiy_indicies.compute_family != queue_familiy_indicies.present_family) {
+    unique_queue_families[unique_queue_family_count++] = queue_familiy_indicies.compute_family;
+  }
 
   VkDeviceQueueCreateInfo* queue_create_infos = malloc(sizeof(VkDeviceQueueCreateInfo) * unique_queue_family_count);
   uint32_t queue_create_info_count = 0;
@@ -341,21 +365,89 @@ static VkResult create_logical_device(VkContext* ctx) {
     queue_create_infos[queue_create_info_count++] = queue_create_info;
   }
 
-  VkPhysicalDeviceFeatures device_features = {0};
+  // Block-compressed textures are sampled natively when the device has them. Culled
+  // draws carry their object index in firstInstance, see shaders/cull.comp.
+  VkPhysicalDeviceFeatures supported_features;
+  vkGetPhysicalDeviceFeatures(ctx->physical_device, &supported_features);
+  VkPhysicalDeviceFeatures device_features = {
+      .textureCompressionBC = supported_features.textureCompressionBC,
+      .textureCompressionASTC_LDR = supported_features.textureCompressionASTC_LDR,
+      .shaderStorageImageWriteWithoutFormat = supported_features.shaderStorageImageWriteWithoutFormat,
+      .drawIndirectFirstInstance = supported_features.drawIndirectFirstInstance};
+  ctx->has_storage_write_without_format = supported_features.shaderStorageImageWriteWithoutFormat;
+  ctx->has_draw_indirect_first_instance = supported_features.drawIndirectFirstInstance;
+  void* features_chain = NULL;
 
   const char* validation_layers[] = {"VK_LAYER_KHRONOS_validation"};
-  const char* device_extensions[] = {
-      VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  const char* device_extensions[8];
+  uint32_t device_extension_count = 0;
+  device_extensions[device_extension_count++] = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+
+  VkPhysicalDeviceProperties properties;
+  vkGetPhysicalDeviceProperties(ctx->physical_device, &properties);
+
+  VkPhysicalDeviceVulkan12Features features12 = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+  if (ctx->api_version >= VK_API_VERSION_1_2 && properties.apiVersion >= VK_API_VERSION_1_2) {
+    VkPhysicalDeviceVulkan12Features supported12 = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+    VkPhysicalDeviceFeatures2 supported = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2, .pNext = &supported12};
+    vkGetPhysicalDeviceFeatures2(ctx->physical_device, &supported);
+
+    ctx->has_bindless = bindless_enable_features(&supported12, &features12);
+    ctx->has_draw_indirect_count = supported12.drawIndirectCount;
+    features12.drawIndirectCount = supported12.drawIndirectCount;
+    ctx->has_timeline_semaphore = supported12.timelineSemaphore;
+    features12.timelineSemaphore = supported12.timelineSemaphore;
+    features12.pNext = features_chain;
+    features_chain = &features12;
+  }
+  if (!ctx->has_bindless) {
+    fprintf(stderr, "Warning: descriptor indexing not supported, bindless resources disabled\n");
+  }
+
+  VkPhysicalDeviceSynchronization2FeaturesKHR sync2_features = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR,
+      .synchronization2 = VK_TRUE};
+  if (has_device_extension(ctx->physical_device, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME)) {
+    device_extensions[device_extension_count++] = VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME;
+    sync2_features.pNext = features_chain;
+    features_chain = &sync2_features;
+    ctx->has_synchronization2 = true;
+  }
+
+  // Per-heap budget and usage, see residency.c. Queried through core 1.1 properties2.
+  if (ctx->api_version >= VK_API_VERSION_1_1 && properties.apiVersion >= VK_API_VERSION_1_1 &&
+      has_device_extension(ctx->physical_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME)) {
+    device_extensions[device_extension_count++] = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME;
+    ctx->has_memory_budget = true;
+  }
+
+  // Pipelines can then be built from separately compiled parts, see pipeline_manager.c.
+  VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT library_features = {
+      .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT};
+  if (ctx->api_version >= VK_API_VERSION_1_1 && properties.apiVersion >= VK_API_VERSION_1_1 &&
+      has_device_extension(ctx->physical_device, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+      has_device_extension(ctx->physical_device, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+    VkPhysicalDeviceFeatures2 supported = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                                           .pNext = &library_features};
+    vkGetPhysicalDeviceFeatures2(ctx->physical_device, &supported);
+    if (library_features.graphicsPipelineLibrary) {
+      device_extensions[device_extension_count++] = VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME;
+      device_extensions[device_extension_count++] = VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME;
+      library_features.pNext = features_chain;
+      features_chain = &library_features;
+      ctx->has_pipeline_library = true;
+    }
+  }
 
   VkDeviceCreateInfo create_info = {0};
   create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
   create_info.pQueueCreateInfos = queue_create_infos;
   create_info.queueCreateInfoCount = queue_create_info_count;
   create_info.pEnabledFeatures = &device_features;
-  create_info.pNext = NULL;
+  create_info.pNext = features_chain;
   create_info.ppEnabledLayerNames = validation_layers;
   create_info.enabledLayerCount = 1;
-  create_info.enabledExtensionCount = 1;
+  create_info.enabledExtensionCount = device_extension_count;
   create_info.ppEnabledExtensionNames = device_extensions;
 
   VkResult res = vkCreateDevice(ctx->physical_device, &create_info, NULL, &ctx->device);
@@ -366,18 +458,37 @@ static VkResult create_logical_device(VkContext* ctx) {
 
   vkGetDeviceQueue(ctx->device, queue_familiy_indicies.graphics_family, 0, &ctx->graphics_queue);
   vkGetDeviceQueue(ctx->device, queue_familiy_indicies.present_family, 0, &ctx->present_queue);
+  vkGetDeviceQueue(ctx->device, queue_familiy_indicies.compute_family, 0, &ctx->compute_queue);
+  ctx->graphics_family = queue_familiy_indicies.graphics_family;
+  ctx->compute_family = queue_familiy_indicies.compute_family;
+
+  // Cross-queue work is ordered with timeline semaphores, so async compute needs them.
+  ctx->has_async_compute = queue_familiy_indicies.found_compute_family && ctx->has_timeline_semaphore;
+  fprintf(stderr, "Async compute: %s\n", ctx->has_async_compute ? "dedicated queue" : "graphics queue");
+  fprintf(stderr, "Pipeline libraries: %s\n", ctx->has_pipeline_library ? "enabled" : "unsupported");
+
+  if (ctx->has_synchronization2) {
+    ctx->cmd_pipeline_barrier2 =
+        (PFN_vkCmdPipelineBarrier2KHR)vkGetDeviceProcAddr(ctx->device, "vkCmdPipelineBarrier2KHR");
+    ctx->has_synchronization2 = ctx->cmd_pipeline_barrier2 != NULL;
+  }
   free(queue_create_infos);
   free(unique_queue_families);
   return res;
 }
 
-static VkSurfaceFormatKHR choose_swap_surface_format(VkSurfaceFormatKHR* available_formats, uint32_t count) {
+// The first window picks the format; later windows must offer the same one because they
+// share the render pass. Returns VK_FORMAT_UNDEFINED in .format if they do not.
+static VkSurfaceFormatKHR choose_swap_surface_format(VkSurfaceFormatKHR* available_formats, uint32_t count,
+                                                     VkFormat required) {
+  VkFormat wanted = required != VK_FORMAT_UNDEFINED ? required : VK_FORMAT_B8G8R8A8_SRGB;
   for (uint32_t i = 0; i < count; ++i) {
     VkSurfaceFormatKHR format = available_formats[i];
-    if (format.format == VK_FORMAT_B8G8R8A8_SRGB && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
+    if (format.format == wanted && format.colorSpace == VK_COLOR_SPACE_SRGB_NONLINEAR_KHR) {
       return format;
     }
   }
+  if (required != VK_FORMAT_UNDEFINED) return (VkSurfaceFormatKHR){.format = VK_FORMAT_UNDEFINED};
   return available_formats[0];
 }
 
@@ -407,12 +518,18 @@ static VkExtent2D choose_swap_extent(Window* window, VkSurfaceCapabilitiesKHR* c
   }
 }
 
-static VkResult create_swapchain(Window* window, VkContext* ctx) {
-  SwapchainSupportDetails swapchain_support = query_swapchain_support(ctx->physical_device, ctx);
+static VkResult create_swapchain(VkContext* ctx, VkSwapchainContext* target) {
+  SwapchainSupportDetails swapchain_support = query_swapchain_support(ctx->physical_device, target->surface);
 
-  VkSurfaceFormatKHR surface_format = choose_swap_surface_format(swapchain_support.formats, swapchain_support.formats_count);
+  VkSurfaceFormatKHR surface_format = choose_swap_surface_format(swapchain_support.formats, swapchain_support.formats_count,
+                                                                 ctx->swapchain_image_format);
+  if (surface_format.format == VK_FORMAT_UNDEFINED) {
+    fprintf(stderr, "Window surface does not support the swapchain format of the first window!\n");
+    free_swapchain_support(&swapchain_support);
+    return VK_ERROR_FORMAT_NOT_SUPPORTED;
+  }
   VkPresentModeKHR present_mode = choose_swap_present_mode(swapchain_support.present_modes, swapchain_support.present_modes_count);
-  VkExtent2D extent = choose_swap_extent(window, &swapchain_support.capabilities);
+  VkExtent2D extent = choose_swap_extent(target->window, &swapchain_support.capabilities);
 
   uint32_t image_count = swapchain_support.capabilities.minImageCount + 1;
 
@@ -422,13 +539,17 @@ static VkResult create_swapchain(Window* window, VkContext* ctx) {
 
   VkSwapchainCreateInfoKHR create_info = {0};
   create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-  create_info.surface = ctx->surface;
+  create_info.surface = target->surface;
   create_info.minImageCount = image_count;
   create_info.imageFormat = surface_format.format;
   create_info.imageColorSpace = surface_format.colorSpace;
   create_info.imageExtent = extent;
   create_info.imageArrayLayers = 1;
-  create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  // The scene is rendered offscreen and blitted into the swapchain image. Captures copy
+  // the presented image back when the surface allows it.
+  create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+  target->readable = (swapchain_support.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT) != 0;
+  if (target->readable) create_info.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
   QueueFamilyIndices indices = find_queue_families(ctx->physical_device, ctx);
   uint32_t queue_family_indicies[] = {indices.graphics_family, indices.present_family};
@@ -448,31 +569,32 @@ static VkResult create_swapchain(Window* window, VkContext* ctx) {
   create_info.clipped = VK_TRUE;
   create_info.oldSwapchain = VK_NULL_HANDLE;
 
-  VkResult res = vkCreateSwapchainKHR(ctx->device, &create_info, NULL, &ctx->swapchain);
+  VkResult res = vkCreateSwapchainKHR(ctx->device, &create_info, NULL, &target->swapchain);
   if (res != VK_SUCCESS) {
     fprintf(stderr, "Failed to create swapchain!\n");
+    free_swapchain_support(&swapchain_support);
     return res;
   }
-  vkGetSwapchainImagesKHR(ctx->device, ctx->swapchain, &ctx->swapchain_images_count, NULL);
-  ctx->swapchain_images = malloc(sizeof(VkImage) * ctx->swapchain_images_count);
-  vkGetSwapchainImagesKHR(ctx->device, ctx->swapchain, &ctx->swapchain_images_count, ctx->swapchain_images);
+  vkGetSwapchainImagesKHR(ctx->device, target->swapchain, &target->images_count, NULL);
+  target->images = malloc(sizeof(VkImage) * target->images_count);
+  vkGetSwapchainImagesKHR(ctx->device, target->swapchain, &target->images_count, target->images);
 
-  fprintf(stderr, "SwapChain images count: %u\n", ctx->swapchain_images_count);
+  fprintf(stderr, "SwapChain images count: %u\n", target->images_count);
 
   ctx->swapchain_image_format = surface_format.format;
-  ctx->swapchain_extent = extent;
+  target->extent = extent;
 
   free_swapchain_support(&swapchain_support);
   return res;
 }
 
-static VkResult create_image_views(VkContext* ctx) {
-  ctx->swapchain_image_views = malloc(sizeof(VkImageView) * ctx->swapchain_images_count);
+static VkResult create_image_views(VkContext* ctx, VkSwapchainContext* target) {
+  target->image_views = calloc(target->images_count, sizeof(VkImageView));
 
-  for (uint32_t i = 0; i < ctx->swapchain_images_count; ++i) {
+  for (uint32_t i = 0; i < target->images_count; ++i) {
     VkImageViewCreateInfo create_info = {
         .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
-        .image = ctx->swapchain_images[i],
+        .image = target->images[i],
         .viewType = VK_IMAGE_VIEW_TYPE_2D,
         .format = ctx->swapchain_image_format,
         .components.r = VK_COMPONENT_SWIZZLE_IDENTITY,
@@ -485,7 +607,7 @@ static VkResult create_image_views(VkContext* ctx) {
         .subresourceRange.baseArrayLayer = 0,
         .subresourceRange.layerCount = 1,
     };
-    VkResult res = vkCreateImageView(ctx->device, &create_info, NULL, &ctx->swapchain_image_views[i]);
+    VkResult res = vkCreateImageView(ctx->device, &create_info, NULL, &target->image_views[i]);
     if (res != VK_SUCCESS) {
       return res;
     }
@@ -504,10 +626,21 @@ static VkResult create_command_pool(VkContext* ctx) {
   VkResult res = vkCreateCommandPool(ctx->device, &pool_info, NULL, &ctx->command_pool);
   if (res != VK_SUCCESS) {
     fprintf(stderr, "Failed to create command pool!\n");
+    return res;
+  }
+
+  if (ctx->has_async_compute) {
+    pool_info.queueFamilyIndex = ctx->compute_family;
+    res = vkCreateCommandPool(ctx->device, &pool_info, NULL, &ctx->compute_command_pool);
+    if (res != VK_SUCCESS) {
+      fprintf(stderr, "Failed to create compute command pool!\n");
+    }
   }
   return res;
 }
 
+// Layout transitions and dependencies around the pass are emitted by the render graph,
+// so the attachment stays in COLOR_ATTACHMENT_OPTIMAL for the whole pass.
 static VkResult create_render_pass(VkContext* ctx) {
   VkAttachmentDescription color_attachment = {
       .format = ctx->swapchain_image_format,
@@ -516,8 +649,8 @@ static VkResult create_render_pass(VkContext* ctx) {
       .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
       .stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
       .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
-      .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
-      .finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR};
+      .initialLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+      .finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
 
   VkAttachmentReference color_attachment_ref = {
       .attachment = 0,
@@ -527,21 +660,14 @@ static VkResult create_render_pass(VkContext* ctx) {
       .colorAttachmentCount = 1,
       .pColorAttachments = &color_attachment_ref};
 
-  VkSubpassDependency dependency = {
-      .srcSubpass = VK_SUBPASS_EXTERNAL,
-      .dstSubpass = 0,
-      .srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-      .srcAccessMask = 0,
-      .dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-      .dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT};
   VkRenderPassCreateInfo render_pass_info = {
       .sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
       .attachmentCount = 1,
       .pAttachments = &color_attachment,
       .subpassCount = 1,
       .pSubpasses = &subpass,
-      .dependencyCount = 1,
-      .pDependencies = &dependency};
+      .dependencyCount = 0,
+      .pDependencies = NULL};
 
   VkResult res = vkCreateRenderPass(ctx->device, &render_pass_info, NULL, &ctx->render_pass);
   if (res != VK_SUCCESS) {
@@ -550,171 +676,432 @@ static VkResult create_render_pass(VkContext* ctx) {
   return res;
 }
 
-static VkResult create_graphics_pipeline(VkContext* ctx) {
-  VkResult res = VK_SUCCESS;
-  VkShaderModule vert_shader_module, frag_shader_module;
-  if ((res = create_shader_module(ctx, "shaders/vert.spv", &vert_shader_module)) != VK_SUCCESS) {
-    fprintf(stderr, "Failed to create vertex shader module!\n");
-    return res;
+// Seeds the cache with the previous run's data. The driver checks the header against the
+// device and silently ignores data from another GPU or driver version.
+static VkResult create_pipeline_cache(VkContext* ctx) {
+  void* data = NULL;
+  size_t size = 0;
+  FILE* fp = fopen(VK_PIPELINE_CACHE_PATH, "rb");
+  if (fp) {
+    fseek(fp, 0, SEEK_END);
+    long len = ftell(fp);
+    rewind(fp);
+    data = len > 0 ? malloc((size_t)len) : NULL;
+    if (data && fread(data, 1, (size_t)len, fp) == (size_t)len) size = (size_t)len;
+    fclose(fp);
   }
-  if ((res = create_shader_module(ctx, "shaders/frag.spv", &frag_shader_module)) != VK_SUCCESS) {
-    vkDestroyShaderModule(ctx->device, vert_shader_module, NULL);
-    fprintf(stderr, "Failed to create vertex shader module!\n");
-    return res;
+
+  VkPipelineCacheCreateInfo cache_info = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+      .initialDataSize = size,
+      .pInitialData = size ? data : NULL};
+  VkResult res = vkCreatePipelineCache(ctx->device, &cache_info, NULL, &ctx->pipeline_cache);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create pipeline cache!\n");
   }
+  free(data);
+  return res;
+}
 
-  VkPipelineShaderStageCreateInfo vert_shader_stage_info = {
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-      .stage = VK_SHADER_STAGE_VERTEX_BIT,
-      .module = vert_shader_module,
-      .pName = "main"};
+static void save_pipeline_cache(VkContext* ctx) {
+  size_t size = 0;
+  if (vkGetPipelineCacheData(ctx->device, ctx->pipeline_cache, &size, NULL) != VK_SUCCESS || size == 0) return;
+  void* data = malloc(size);
+  if (!data) return;
+  if (vkGetPipelineCacheData(ctx->device, ctx->pipeline_cache, &size, data) == VK_SUCCESS) {
+    FILE* fp = fopen(VK_PIPELINE_CACHE_PATH, "wb");
+    if (fp) {
+      fwrite(data, 1, size, fp);
+      fclose(fp);
+    } else {
+      fprintf(stderr, "Warning: could not write %s\n", VK_PIPELINE_CACHE_PATH);
+    }
+  }
+  free(data);
+}
 
-  VkPipelineShaderStageCreateInfo frag_shader_stage_info = {
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-      .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-      .module = frag_shader_module,
-      .pName = "main"};
+static VkResult create_pipeline_layout(VkContext* ctx) {
+  // Every pipeline shares the bindless set at index 0, the uniform ring at index 1 and one
+  // push constant block, so the sets are bound once per command buffer and survive pipeline
+  // switches; per-draw uniform blocks only change the ring's dynamic offset.
+  VkDescriptorSetLayout set_layouts[] = {ctx->bindless.layout, ctx->uniforms.layout};
+  VkPushConstantRange push_constant_range = {
+      .stageFlags = VK_SHADER_STAGE_ALL,
+      .offset = 0,
+      .size = BINDLESS_PUSH_CONSTANT_SIZE};
+  VkPipelineLayoutCreateInfo pipeline_layout_info = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+      .setLayoutCount = ctx->has_bindless ? (uint32_t)COUNTOF(set_layouts) : 0,
+      .pSetLayouts = ctx->has_bindless ? set_layouts : NULL,
+      .pushConstantRangeCount = 1,
+      .pPushConstantRanges = &push_constant_range};
+
+  VkResult res = vkCreatePipelineLayout(ctx->device, &pipeline_layout_info, NULL, &ctx->pipeline_layout);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create pipeline layout!\n");
+  }
+  return res;
+}
+
+static VkResult create_reflected_shader_module(VkContext* ctx, const char* path, VkShaderModule* module,
+                                               SpirvReflection* reflection);
 
-  VkPipelineShaderStageCreateInfo shader_stages[] = {vert_shader_stage_info, frag_shader_stage_info};
+// Catches vertex layouts that drifted from the shader; missing attributes read undefined data.
+static void check_vertex_inputs(const GraphicsPipelineDesc* desc, const SpirvReflection* vert) {
+  for (uint32_t i = 0; i < vert->input_count; ++i) {
+    bool found = false;
+    for (uint32_t j = 0; j < desc->vertex_attribute_count && !found; ++j) {
+      found = desc->vertex_attributes[j].location == vert->inputs[i].location;
+    }
+    if (!found) {
+      fprintf(stderr, "'%s' reads vertex input location %u, which the pipeline does not provide\n", desc->vert_path,
+              vert->inputs[i].location);
+    }
+  }
+}
+
+// Everything vkCreateGraphicsPipelines reads besides shaders, layout and render pass,
+// filled in place because the create infos point at each other.
+typedef struct {
+  VkBool32 feature_values[SHADER_FEATURE_COUNT];
+  VkSpecializationMapEntry feature_entries[SHADER_FEATURE_COUNT];
+  VkSpecializationInfo specialization;
+  VkPipelineVertexInputStateCreateInfo vertex_input;
+  VkPipelineInputAssemblyStateCreateInfo input_assembly;
+  VkPipelineViewportStateCreateInfo viewport;
+  VkPipelineRasterizationStateCreateInfo rasterizer;
+  VkPipelineMultisampleStateCreateInfo multisampling;
+  VkPipelineColorBlendAttachmentState color_blend_attachment;
+  VkPipelineDepthStencilStateCreateInfo depth_stencil;
+  VkPipelineColorBlendStateCreateInfo color_blending;
+  VkDynamicState dynamic_states[2];
+  VkPipelineDynamicStateCreateInfo dynamic;
+} FixedFunctionState;
+
+static void fill_fixed_function_state(const GraphicsPipelineDesc* desc, FixedFunctionState* state) {
+  for (uint32_t i = 0; i < SHADER_FEATURE_COUNT; ++i) {
+    state->feature_values[i] = (desc->features >> i) & 1u;
+    state->feature_entries[i] = (VkSpecializationMapEntry){
+        .constantID = i, .offset = i * (uint32_t)sizeof(VkBool32), .size = sizeof(VkBool32)};
+  }
+  state->specialization = (VkSpecializationInfo){
+      .mapEntryCount = SHADER_FEATURE_COUNT,
+      .pMapEntries = state->feature_entries,
+      .dataSize = sizeof(state->feature_values),
+      .pData = state->feature_values};
 
-  VkPipelineVertexInputStateCreateInfo vertex_input_info = {
+  state->vertex_input = (VkPipelineVertexInputStateCreateInfo){
       .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-      .vertexBindingDescriptionCount = 0,
-      .pVertexBindingDescriptions = NULL,
-      .vertexAttributeDescriptionCount = 0,
-      .pVertexAttributeDescriptions = NULL};
+      .vertexBindingDescriptionCount = desc->vertex_binding_count,
+      .pVertexBindingDescriptions = desc->vertex_bindings,
+      .vertexAttributeDescriptionCount = desc->vertex_attribute_count,
+      .pVertexAttributeDescriptions = desc->vertex_attributes};
 
-  VkPipelineInputAssemblyStateCreateInfo input_assembly = {
+  state->input_assembly = (VkPipelineInputAssemblyStateCreateInfo){
       .sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
       .topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
       .primitiveRestartEnable = VK_FALSE};
 
-  VkPipelineViewportStateCreateInfo viewport_state = {
+  state->viewport = (VkPipelineViewportStateCreateInfo){
       .sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
       .viewportCount = 1,
       .scissorCount = 1};
 
-  VkPipelineRasterizationStateCreateInfo rasterizer = {
+  state->rasterizer = (VkPipelineRasterizationStateCreateInfo){
       .sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
       .depthClampEnable = VK_FALSE,
       .rasterizerDiscardEnable = VK_FALSE,
       .polygonMode = VK_POLYGON_MODE_FILL,
       .lineWidth = 1.0f,
-      .cullMode = VK_CULL_MODE_BACK_BIT,
-      .frontFace = VK_FRONT_FACE_CLOCKWISE,
+      .cullMode = desc->cull_mode,
+      .frontFace = desc->front_face,
       .depthBiasEnable = VK_FALSE};
 
-  VkPipelineMultisampleStateCreateInfo multisampling = {
+  state->multisampling = (VkPipelineMultisampleStateCreateInfo){
       .sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
       .sampleShadingEnable = VK_FALSE,
       .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT};
 
-  VkPipelineColorBlendAttachmentState color_blend_attachment = {
+  // Premultiplied alpha when blending is requested.
+  state->color_blend_attachment = (VkPipelineColorBlendAttachmentState){
       .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-      .blendEnable = VK_FALSE};
-  VkPipelineColorBlendStateCreateInfo color_blending = {
+      .blendEnable = desc->blend ? VK_TRUE : VK_FALSE,
+      .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+      .dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+      .colorBlendOp = VK_BLEND_OP_ADD,
+      .srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+      .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+      .alphaBlendOp = VK_BLEND_OP_ADD};
+  state->depth_stencil = (VkPipelineDepthStencilStateCreateInfo){
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+      .depthTestEnable = desc->depth_test ? VK_TRUE : VK_FALSE,
+      .depthWriteEnable = desc->depth_write ? VK_TRUE : VK_FALSE,
+      .depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL};
+  state->color_blending = (VkPipelineColorBlendStateCreateInfo){
       .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
       .logicOpEnable = VK_FALSE,
       .logicOp = VK_LOGIC_OP_COPY,
       .attachmentCount = 1,
-      .pAttachments = &color_blend_attachment,
+      .pAttachments = &state->color_blend_attachment,
       .blendConstants = {0.0f, 0.0f, 0.0f, 0.0f}};
 
-  VkDynamicState dynamic_states[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
-  VkPipelineDynamicStateCreateInfo dynamic_state = {
+  state->dynamic_states[0] = VK_DYNAMIC_STATE_VIEWPORT;
+  state->dynamic_states[1] = VK_DYNAMIC_STATE_SCISSOR;
+  state->dynamic = (VkPipelineDynamicStateCreateInfo){
       .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-      .dynamicStateCount = (uint32_t)COUNTOF(dynamic_states),
-      .pDynamicStates = dynamic_states};
+      .dynamicStateCount = (uint32_t)COUNTOF(state->dynamic_states),
+      .pDynamicStates = state->dynamic_states};
+}
 
-  VkPipelineLayoutCreateInfo pipeline_layout_info = {
-      .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-      .setLayoutCount = 0,
-      .pushConstantRangeCount = 0};
+static VkPipelineShaderStageCreateInfo shader_stage(VkShaderStageFlagBits stage, VkShaderModule module,
+                                                    const FixedFunctionState* state) {
+  return (VkPipelineShaderStageCreateInfo){
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+      .stage = stage,
+      .module = module,
+      .pName = "main",
+      .pSpecializationInfo = &state->specialization};
+}
 
-  res = vkCreatePipelineLayout(ctx->device, &pipeline_layout_info, NULL, &ctx->pipeline_layout);
-  if (res != VK_SUCCESS) {
-    fprintf(stderr, "Failed to create pipeline layout!\n");
-    goto cleanup;
+VkResult vk_create_graphics_pipeline(VkContext* ctx, const GraphicsPipelineDesc* desc, VkPipeline* pipeline) {
+  VkResult res = VK_SUCCESS;
+  VkShaderModule vert_shader_module, frag_shader_module;
+  SpirvReflection stages[2] = {0};
+  if ((res = create_reflected_shader_module(ctx, desc->vert_path, &vert_shader_module, &stages[0])) != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create vertex shader module!\n");
+    return res;
   }
+  if ((res = create_reflected_shader_module(ctx, desc->frag_path, &frag_shader_module, &stages[1])) != VK_SUCCESS) {
+    vkDestroyShaderModule(ctx->device, vert_shader_module, NULL);
+    fprintf(stderr, "Failed to create fragment shader module!\n");
+    return res;
+  }
+  VkPipelineLayout layout;
+  if ((res = layout_cache_get(&ctx->layouts, stages, 2, &layout)) != VK_SUCCESS) goto done;
+  check_vertex_inputs(desc, &stages[0]);
+
+  FixedFunctionState state;
+  fill_fixed_function_state(desc, &state);
+  VkPipelineShaderStageCreateInfo shader_stages[] = {
+      shader_stage(VK_SHADER_STAGE_VERTEX_BIT, vert_shader_module, &state),
+      shader_stage(VK_SHADER_STAGE_FRAGMENT_BIT, frag_shader_module, &state)};
 
   VkGraphicsPipelineCreateInfo pipeline_info = {
       .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
       .stageCount = 2,
       .pStages = shader_stages,
-      .pVertexInputState = &vertex_input_info,
-      .pInputAssemblyState = &input_assembly,
-      .pViewportState = &viewport_state,
-      .pRasterizationState = &rasterizer,
-      .pMultisampleState = &multisampling,
-      .pDepthStencilState = NULL,
-      .pColorBlendState = &color_blending,
-      .pDynamicState = &dynamic_state,
-      .layout = ctx->pipeline_layout,
-      .renderPass = ctx->render_pass,
+      .pVertexInputState = &state.vertex_input,
+      .pInputAssemblyState = &state.input_assembly,
+      .pViewportState = &state.viewport,
+      .pRasterizationState = &state.rasterizer,
+      .pMultisampleState = &state.multisampling,
+      .pDepthStencilState = desc->depth_test || desc->depth_write ? &state.depth_stencil : NULL,
+      .pColorBlendState = &state.color_blending,
+      .pDynamicState = &state.dynamic,
+      .layout = layout,
+      .renderPass = desc->render_pass != VK_NULL_HANDLE ? desc->render_pass : ctx->render_pass,
       .subpass = 0,
       .basePipelineHandle = VK_NULL_HANDLE,
       .basePipelineIndex = -1};
 
-  res = vkCreateGraphicsPipelines(ctx->device, VK_NULL_HANDLE, 1, &pipeline_info, NULL, &ctx->graphics_pipeline);
+  res = vkCreateGraphicsPipelines(ctx->device, ctx->pipeline_cache, 1, &pipeline_info, NULL, pipeline);
   if (res != VK_SUCCESS) {
     fprintf(stderr, "Failed to create graphics pipeline!\n");
   }
 
-cleanup:
+done:
   vkDestroyShaderModule(ctx->device, vert_shader_module, NULL);
   vkDestroyShaderModule(ctx->device, frag_shader_module, NULL);
   return res;
 }
 
-static VkResult create_framebuffers(VkContext* ctx) {
-  ctx->swapchain_framebuffers = malloc(sizeof(VkFramebuffer) * ctx->swapchain_images_count);
+VkResult vk_create_pipeline_part(VkContext* ctx, const GraphicsPipelineDesc* desc, PipelinePart part,
+                                 VkPipelineLayout layout, VkPipeline* library) {
+  static const VkGraphicsPipelineLibraryFlagsEXT part_flags[PIPELINE_PART_COUNT] = {
+      [PIPELINE_PART_VERTEX_INPUT] = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+      [PIPELINE_PART_PRE_RASTERIZATION] = VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+      [PIPELINE_PART_FRAGMENT] = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+      [PIPELINE_PART_OUTPUT] = VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT};
+  if (!ctx->has_pipeline_library) return VK_ERROR_FEATURE_NOT_PRESENT;
+
+  FixedFunctionState state;
+  fill_fixed_function_state(desc, &state);
+  VkGraphicsPipelineLibraryCreateInfoEXT library_info = {
+      .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+      .flags = part_flags[part]};
+  // Parts keep what link-time optimization needs, so the background relink can use it.
+  VkGraphicsPipelineCreateInfo pipeline_info = {
+      .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+      .pNext = &library_info,
+      .flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT,
+      .basePipelineIndex = -1};
+  VkRenderPass render_pass = desc->render_pass != VK_NULL_HANDLE ? desc->render_pass : ctx->render_pass;
+
+  VkShaderModule module = VK_NULL_HANDLE;
+  VkPipelineShaderStageCreateInfo stage;
+  switch (part) {
+    case PIPELINE_PART_VERTEX_INPUT:
+      pipeline_info.pVertexInputState = &state.vertex_input;
+      pipeline_info.pInputAssemblyState = &state.input_assembly;
+      break;
+    case PIPELINE_PART_PRE_RASTERIZATION:
+      VK_RETURN(create_shader_module(ctx, desc->vert_path, &module));
+      stage = shader_stage(VK_SHADER_STAGE_VERTEX_BIT, module, &state);
+      pipeline_info.stageCount = 1;
+      pipeline_info.pStages = &stage;
+      pipeline_info.pViewportState = &state.viewport;
+      pipeline_info.pRasterizationState = &state.rasterizer;
+      pipeline_info.pDynamicState = &state.dynamic;
+      pipeline_info.layout = layout;
+      pipeline_info.renderPass = render_pass;
+      break;
+    case PIPELINE_PART_FRAGMENT:
+      VK_RETURN(create_shader_module(ctx, desc->frag_path, &module));
+      stage = shader_stage(VK_SHADER_STAGE_FRAGMENT_BIT, module, &state);
+      pipeline_info.stageCount = 1;
+      pipeline_info.pStages = &stage;
+      pipeline_info.pMultisampleState = &state.multisampling;
+      pipeline_info.pDepthStencilState = desc->depth_test || desc->depth_write ? &state.depth_stencil : NULL;
+      pipeline_info.layout = layout;
+      pipeline_info.renderPass = render_pass;
+      break;
+    case PIPELINE_PART_OUTPUT:
+      pipeline_info.pMultisampleState = &state.multisampling;
+      pipeline_info.pColorBlendState = &state.color_blending;
+      pipeline_info.renderPass = render_pass;
+      break;
+    default:
+      return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  VkResult res = vkCreateGraphicsPipelines(ctx->device, ctx->pipeline_cache, 1, &pipeline_info, NULL, library);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create pipeline library part %d!\n", (int)part);
+  }
+  if (module != VK_NULL_HANDLE) vkDestroyShaderModule(ctx->device, module, NULL);
+  return res;
+}
+
+VkResult vk_link_graphics_pipeline(VkContext* ctx, const VkPipeline parts[PIPELINE_PART_COUNT], VkPipelineLayout layout,
+                                   bool optimize, VkPipeline* pipeline) {
+  VkPipelineLibraryCreateInfoKHR library_info = {
+      .sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+      .libraryCount = PIPELINE_PART_COUNT,
+      .pLibraries = parts};
+  VkGraphicsPipelineCreateInfo pipeline_info = {
+      .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+      .pNext = &library_info,
+      .flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0,
+      .layout = layout,
+      .basePipelineIndex = -1};
+  VkResult res = vkCreateGraphicsPipelines(ctx->device, ctx->pipeline_cache, 1, &pipeline_info, NULL, pipeline);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to link graphics pipeline!\n");
+  }
+  return res;
+}
+
+static VkResult create_graphics_pipeline(VkContext* ctx) {
+  VK_RETURN(create_pipeline_layout(ctx));
+  VK_RETURN(layout_cache_init(&ctx->layouts, ctx->device, ctx->pipeline_layout,
+                              ctx->has_bindless ? ctx->bindless.layout : VK_NULL_HANDLE,
+                              ctx->has_bindless ? ctx->uniforms.layout : VK_NULL_HANDLE));
+
+  // No vertex input: the vertex shader generates its triangle from gl_VertexIndex and
+  // projects it with the camera uniforms.
+  GraphicsPipelineDesc desc = {
+      .vert_path = "shaders/triangle.vert.spv",
+      .frag_path = "shaders/triangle.frag.spv",
+      .cull_mode = VK_CULL_MODE_BACK_BIT,
+      .front_face = VK_FRONT_FACE_CLOCKWISE};
+  return vk_create_graphics_pipeline(ctx, &desc, &ctx->graphics_pipeline);
+}
 
-  for (uint32_t i = 0; i < ctx->swapchain_images_count; ++i) {
-    VkImageView attachments[] = {ctx->swapchain_image_views[i]};
+static VkResult create_framebuffers(VkContext* ctx, VkSwapchainContext* target) {
+  target->framebuffers = calloc(target->images_count, sizeof(VkFramebuffer));
+
+  for (uint32_t i = 0; i < target->images_count; ++i) {
+    VkImageView attachments[] = {target->image_views[i]};
     VkFramebufferCreateInfo framebuffer_info = {
         .sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
         .renderPass = ctx->render_pass,
         .attachmentCount = 1,
         .pAttachments = attachments,
-        .width = ctx->swapchain_extent.width,
-        .height = ctx->swapchain_extent.height,
+        .width = target->extent.width,
+        .height = target->extent.height,
         .layers = 1};
 
-    VkResult res = vkCreateFramebuffer(ctx->device, &framebuffer_info, NULL, &ctx->swapchain_framebuffers[i]);
+    // Framebuffers created so far are released with the window.
+    VkResult res = vkCreateFramebuffer(ctx->device, &framebuffer_info, NULL, &target->framebuffers[i]);
     if (res != VK_SUCCESS) {
       fprintf(stderr, "Failed to create framebuffer!\n");
-      for (uint32_t j = 0; j < i; ++j) {
-        vkDestroyFramebuffer(ctx->device, ctx->swapchain_framebuffers[j], NULL);
-      }
       return res;
     }
   }
   return VK_SUCCESS;
 }
 
-static VkResult create_sync_objects(VkContext* ctx) {
+static VkResult create_window_semaphores(VkContext* ctx, VkSwapchainContext* target) {
   VkSemaphoreCreateInfo semaphore_info = {
       .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
-  VkFenceCreateInfo fence_info = {
-      .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
-      .flags = VK_FENCE_CREATE_SIGNALED_BIT};
-
-  ctx->render_finished_semaphores = malloc(sizeof(VkSemaphore) * ctx->swapchain_images_count);
 
-  for (uint32_t i = 0; i < ctx->swapchain_images_count; ++i) {
-    if (vkCreateSemaphore(ctx->device, &semaphore_info, NULL, &ctx->render_finished_semaphores[i]) != VK_SUCCESS) {
+  target->render_finished_semaphores = calloc(target->images_count, sizeof(VkSemaphore));
+  for (uint32_t i = 0; i < target->images_count; ++i) {
+    if (vkCreateSemaphore(ctx->device, &semaphore_info, NULL, &target->render_finished_semaphores[i]) != VK_SUCCESS) {
       fprintf(stderr, "Failed to create semaphores!\n");
       return VK_ERROR_INITIALIZATION_FAILED;
     }
   }
-
-  ctx->image_available_semaphores = malloc(sizeof(VkSemaphore) * MAX_FRAMES_IN_FLIGHT);
-
   for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
-    if (vkCreateSemaphore(ctx->device, &semaphore_info, NULL, &ctx->image_available_semaphores[i]) != VK_SUCCESS) {
+    if (vkCreateSemaphore(ctx->device, &semaphore_info, NULL, &target->image_available_semaphores[i]) != VK_SUCCESS) {
       fprintf(stderr, "Failed to create semaphores!\n");
       return VK_ERROR_INITIALIZATION_FAILED;
     }
+  }
+  return VK_SUCCESS;
+}
+
+// Tolerates a partially created window; the device must be idle.
+static void destroy_window(VkContext* ctx, VkSwapchainContext* target) {
+  for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
+    if (target->image_available_semaphores[i] != VK_NULL_HANDLE) {
+      vkDestroySemaphore(ctx->device, target->image_available_semaphores[i], NULL);
+    }
+  }
+  for (uint32_t i = 0; i < target->images_count; ++i) {
+    if (target->render_finished_semaphores && target->render_finished_semaphores[i] != VK_NULL_HANDLE) {
+      vkDestroySemaphore(ctx->device, target->render_finished_semaphores[i], NULL);
+    }
+    if (target->framebuffers && target->framebuffers[i] != VK_NULL_HANDLE) {
+      vkDestroyFramebuffer(ctx->device, target->framebuffers[i], NULL);
+    }
+    if (target->image_views && target->image_views[i] != VK_NULL_HANDLE) {
+      vkDestroyImageView(ctx->device, target->image_views[i], NULL);
+    }
+  }
+  if (target->image_views) atomic_fetch_add_explicit(&ctx->destroyed_resources, 1, memory_order_relaxed);
+  free(target->render_finished_semaphores);
+  free(target->framebuffers);
+  free(target->image_views);
+  free(target->images);
+
+  if (target->swapchain != VK_NULL_HANDLE) {
+    vkDestroySwapchainKHR(ctx->device, target->swapchain, NULL);
+  }
+  if (target->surface != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(ctx->instance, target->surface, NULL);
+  }
+  memset(target, 0, sizeof(*target));
+}
+
+static VkResult create_sync_objects(VkContext* ctx) {
+  VkSemaphoreCreateInfo semaphore_info = {
+      .sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+  VkFenceCreateInfo fence_info = {
+      .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+      .flags = VK_FENCE_CREATE_SIGNALED_BIT};
+
+  for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i) {
     if (vkCreateFence(ctx->device, &fence_info, NULL,
                       &ctx->in_flight_fences[i]) != VK_SUCCESS) {
       fprintf(stderr, "Failed to create in_flight fence for frame %u\n", i);
@@ -722,6 +1109,19 @@ static VkResult create_sync_objects(VkContext* ctx) {
     }
   }
 
+  if (ctx->has_timeline_semaphore) {
+    VkSemaphoreTypeCreateInfo timeline_info = {
+        .sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO,
+        .semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE,
+        .initialValue = 0};
+    semaphore_info.pNext = &timeline_info;
+    if (vkCreateSemaphore(ctx->device, &semaphore_info, NULL, &ctx->graphics_timeline) != VK_SUCCESS ||
+        vkCreateSemaphore(ctx->device, &semaphore_info, NULL, &ctx->compute_timeline) != VK_SUCCESS) {
+      fprintf(stderr, "Failed to create timeline semaphores!\n");
+      return VK_ERROR_INITIALIZATION_FAILED;
+    }
+  }
+
   return VK_SUCCESS;
 }
 
@@ -735,21 +1135,29 @@ static VkResult create_command_buffer(VkContext* ctx) {
   VkResult res = vkAllocateCommandBuffers(ctx->device, &alloc_info, ctx->command_buffers);
   if (res != VK_SUCCESS) {
     fprintf(stderr, "Failed to create command buffer!\n");
+    return res;
+  }
+
+  if (ctx->has_async_compute) {
+    alloc_info.commandPool = ctx->compute_command_pool;
+    res = vkAllocateCommandBuffers(ctx->device, &alloc_info, ctx->compute_command_buffers);
+    if (res != VK_SUCCESS) {
+      fprintf(stderr, "Failed to create compute command buffer!\n");
+    }
   }
   return res;
 }
 
-VkResult vk_init(Window* window, VkContext* ctx) {
+VkResult vk_init(Window* window, bool any_device, VkContext* ctx) {
   memset(ctx, 0, sizeof(*ctx));
+  ctx->any_device = any_device;
   ctx->instance = VK_NULL_HANDLE;
   ctx->debug_messenger = VK_NULL_HANDLE;
-  ctx->surface = VK_NULL_HANDLE;
   ctx->physical_device = VK_NULL_HANDLE;
   ctx->device = VK_NULL_HANDLE;
   ctx->graphics_queue = VK_NULL_HANDLE;
   ctx->present_queue = VK_NULL_HANDLE;
-  ctx->swapchain = VK_NULL_HANDLE;
-  ctx->swapchain_images_count = 0;
+  ctx->window_count = 0;
   ctx->command_pool = VK_NULL_HANDLE;
   ctx->render_pass = VK_NULL_HANDLE;
   ctx->graphics_pipeline = VK_NULL_HANDLE;
@@ -761,16 +1169,23 @@ VkResult vk_init(Window* window, VkContext* ctx) {
 
   if ((res = create_instance_sdl(ctx)) != VK_SUCCESS) goto fail;
   if ((res = setup_debug_utils(ctx)) != VK_SUCCESS) goto fail;
-  if ((res = create_sdl_surface(window, ctx)) != VK_SUCCESS) goto fail;
+  // The first surface also decides which queue family presents.
+  VkSwapchainContext* primary = &ctx->windows[ctx->window_count++];
+  if ((res = create_sdl_surface(window, ctx, primary)) != VK_SUCCESS) goto fail;
   if ((res = pick_physical_device(ctx)) != VK_SUCCESS) goto fail;
   if ((res = create_logical_device(ctx)) != VK_SUCCESS) goto fail;
-  if ((res = create_swapchain(window, ctx)) != VK_SUCCESS) goto fail;
-  if ((res = create_image_views(ctx)) != VK_SUCCESS) goto fail;
+  if ((res = create_swapchain(ctx, primary)) != VK_SUCCESS) goto fail;
+  if ((res = create_image_views(ctx, primary)) != VK_SUCCESS) goto fail;
   if ((res = create_command_pool(ctx)) != VK_SUCCESS) goto fail;
   if ((res = create_render_pass(ctx)) != VK_SUCCESS) goto fail;
-  if ((res = create_framebuffers(ctx)) != VK_SUCCESS) goto fail;
+  if ((res = create_pipeline_cache(ctx)) != VK_SUCCESS) goto fail;
+  if ((res = create_framebuffers(ctx, primary)) != VK_SUCCESS) goto fail;
+  if (ctx->has_bindless && (res = bindless_init(&ctx->bindless, ctx->physical_device, ctx->device)) != VK_SUCCESS) goto fail;
+  if (ctx->has_bindless && (res = uniform_ring_init(&ctx->uniforms, ctx->physical_device, ctx->device, &ctx->bindless)) != VK_SUCCESS) goto fail;
+  if ((res = deletion_queue_init(&ctx->deletions, ctx->device, &ctx->bindless, &ctx->memory_allocations_live)) != VK_SUCCESS) goto fail;
   if ((res = create_graphics_pipeline(ctx)) != VK_SUCCESS) goto fail;
   if ((res = create_sync_objects(ctx)) != VK_SUCCESS) goto fail;
+  if ((res = create_window_semaphores(ctx, primary)) != VK_SUCCESS) goto fail;
   if ((res = create_command_buffer(ctx)) != VK_SUCCESS) goto fail;
 
   return res;
@@ -780,70 +1195,103 @@ fail:
   return res;
 }
 
-void vk_cleanup(VkContext* ctx) {
-  uint32_t images_count = ctx->swapchain_images_count;
+VkResult vk_add_window(VkContext* ctx, Window* window) {
+  if (ctx->window_count >= VK_MAX_WINDOWS) {
+    fprintf(stderr, "Too many windows (max %d)\n", VK_MAX_WINDOWS);
+    return VK_ERROR_TOO_MANY_OBJECTS;
+  }
+
+  VkSwapchainContext* target = &ctx->windows[ctx->window_count];
+  VkResult res = create_sdl_surface(window, ctx, target);
+  if (res != VK_SUCCESS) goto fail;
+
+  // All windows present from the queue picked for the first one, in a single call.
+  uint32_t present_family = find_queue_families(ctx->physical_device, ctx).present_family;
+  VkBool32 present_support = VK_FALSE;
+  vkGetPhysicalDeviceSurfaceSupportKHR(ctx->physical_device, present_family, target->surface, &present_support);
+  if (!present_support) {
+    fprintf(stderr, "Window surface cannot be presented from the device's present queue!\n");
+    res = VK_ERROR_INCOMPATIBLE_DISPLAY_KHR;
+    goto fail;
+  }
+
+  if ((res = create_swapchain(ctx, target)) != VK_SUCCESS) goto fail;
+  if ((res = create_image_views(ctx, target)) != VK_SUCCESS) goto fail;
+  if ((res = create_framebuffers(ctx, target)) != VK_SUCCESS) goto fail;
+  if ((res = create_window_semaphores(ctx, target)) != VK_SUCCESS) goto fail;
+
+  ctx->window_count++;
+  return VK_SUCCESS;
+
+fail:
+  destroy_window(ctx, target);
+  return res;
+}
 
+void vk_cleanup(VkContext* ctx) {
   if (ctx->device != VK_NULL_HANDLE) {
     vkDeviceWaitIdle(ctx->device);
   }
+  // Before the bindless heap goes: deferred entries may still hold handles into it.
+  deletion_queue_destroy(&ctx->deletions);
+
+  for (uint32_t i = 0; i < ctx->window_count; ++i) {
+    destroy_window(ctx, &ctx->windows[i]);
+  }
+  ctx->window_count = 0;
 
   for (uint32_t j = 0; j < MAX_FRAMES_IN_FLIGHT; ++j) {
-    if (ctx->image_available_semaphores[j] != VK_NULL_HANDLE) {
-      vkDestroySemaphore(ctx->device, ctx->image_available_semaphores[j], NULL);
-      ctx->image_available_semaphores[j] = VK_NULL_HANDLE;
-    }
     if (ctx->in_flight_fences[j] != VK_NULL_HANDLE) {
       vkDestroyFence(ctx->device, ctx->in_flight_fences[j], NULL);
       ctx->in_flight_fences[j] = VK_NULL_HANDLE;
     }
   }
 
-  for (uint32_t i = 0; i < images_count; ++i) {
-    if (ctx->render_finished_semaphores[i] != VK_NULL_HANDLE) {
-      vkDestroySemaphore(ctx->device, ctx->render_finished_semaphores[i], NULL);
-      ctx->render_finished_semaphores[i] = VK_NULL_HANDLE;
-    }
+  if (ctx->graphics_timeline != VK_NULL_HANDLE) {
+    vkDestroySemaphore(ctx->device, ctx->graphics_timeline, NULL);
+    ctx->graphics_timeline = VK_NULL_HANDLE;
   }
-
-  if (ctx->swapchain_framebuffers) {
-    for (uint32_t i = 0; i < ctx->swapchain_images_count; ++i) {
-      vkDestroyFramebuffer(ctx->device, ctx->swapchain_framebuffers[i], NULL);
-    }
-    free(ctx->swapchain_framebuffers);
-    ctx->swapchain_framebuffers = NULL;
+  if (ctx->compute_timeline != VK_NULL_HANDLE) {
+    vkDestroySemaphore(ctx->device, ctx->compute_timeline, NULL);
+    ctx->compute_timeline = VK_NULL_HANDLE;
   }
 
+  if (ctx->mip_downsample_pipeline != VK_NULL_HANDLE) {
+    vkDestroyPipeline(ctx->device, ctx->mip_downsample_pipeline, NULL);
+    ctx->mip_downsample_pipeline = VK_NULL_HANDLE;
+  }
   if (ctx->graphics_pipeline != VK_NULL_HANDLE) {
     vkDestroyPipeline(ctx->device, ctx->graphics_pipeline, NULL);
     ctx->graphics_pipeline = VK_NULL_HANDLE;
   }
 
+  if (ctx->pipeline_cache != VK_NULL_HANDLE) {
+    save_pipeline_cache(ctx);
+    vkDestroyPipelineCache(ctx->device, ctx->pipeline_cache, NULL);
+    ctx->pipeline_cache = VK_NULL_HANDLE;
+  }
+
+  layout_cache_destroy(&ctx->layouts);
   if (ctx->pipeline_layout != VK_NULL_HANDLE) {
     vkDestroyPipelineLayout(ctx->device, ctx->pipeline_layout, NULL);
     ctx->pipeline_layout = VK_NULL_HANDLE;
   }
 
+  uniform_ring_destroy(&ctx->uniforms, &ctx->bindless);
+  bindless_destroy(&ctx->bindless);
+
   if (ctx->render_pass != VK_NULL_HANDLE) {
     vkDestroyRenderPass(ctx->device, ctx->render_pass, NULL);
     ctx->render_pass = VK_NULL_HANDLE;
   }
 
-  if (ctx->swapchain_image_views) {
-    for (uint32_t i = 0; i < ctx->swapchain_images_count; ++i) {
-      vkDestroyImageView(ctx->device, ctx->swapchain_image_views[i], NULL);
-    }
-    free(ctx->swapchain_image_views);
-    ctx->swapchain_image_views = NULL;
-  }
-
   if (ctx->command_pool != VK_NULL_HANDLE) {
     vkDestroyCommandPool(ctx->device, ctx->command_pool, NULL);
     ctx->command_pool = VK_NULL_HANDLE;
   }
-
-  if (ctx->swapchain != VK_NULL_HANDLE) {
-    vkDestroySwapchainKHR(ctx->device, ctx->swapchain, NULL);
-    ctx->swapchain = VK_NULL_HANDLE;
+  if (ctx->compute_command_pool != VK_NULL_HANDLE) {
+    vkDestroyCommandPool(ctx->device, ctx->compute_command_pool, NULL);
+    ctx->compute_command_pool = VK_NULL_HANDLE;
   }
 
   if (ctx->device != VK_NULL_HANDLE) {
@@ -851,10 +1299,7 @@ void vk_cleanup(VkContext* ctx) {
     ctx->device = VK_NULL_HANDLE;
     ctx->graphics_queue = VK_NULL_HANDLE;
     ctx->present_queue = VK_NULL_HANDLE;
-  }
-  if (ctx->surface != VK_NULL_HANDLE) {
-    vkDestroySurfaceKHR(ctx->instance, ctx->surface, NULL);
-    ctx->surface = VK_NULL_HANDLE;
+    ctx->compute_queue = VK_NULL_HANDLE;
   }
   if (ctx->debug_messenger != VK_NULL_HANDLE) {
     PFN_vkDestroyDebugUtilsMessengerEXT pDestroy =
@@ -872,8 +1317,287 @@ void vk_cleanup(VkContext* ctx) {
   }
 }
 
-VkResult create_shader_module(VkContext* ctx, const char* path, VkShaderModule* module) {
+uint32_t vk_find_memory_type(VkContext* ctx, uint32_t type_bits, VkMemoryPropertyFlags properties) {
+  VkPhysicalDeviceMemoryProperties mem_properties;
+  vkGetPhysicalDeviceMemoryProperties(ctx->physical_device, &mem_properties);
+  for (uint32_t i = 0; i < mem_properties.memoryTypeCount; ++i) {
+    if ((type_bits & (1u << i)) && (mem_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+      return i;
+    }
+  }
+  return UINT32_MAX;
+}
+
+VkResult vk_allocate_memory(VkContext* ctx, const VkMemoryAllocateInfo* info, VkDeviceMemory* memory) {
+  VK_RETURN(vkAllocateMemory(ctx->device, info, NULL, memory));
+  atomic_fetch_add_explicit(&ctx->memory_allocations, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&ctx->memory_allocations_live, 1, memory_order_relaxed);
+  atomic_fetch_add_explicit(&ctx->memory_allocated_bytes, info->allocationSize, memory_order_relaxed);
+  return VK_SUCCESS;
+}
+
+void vk_free_memory(VkContext* ctx, VkDeviceMemory memory) {
+  if (memory == VK_NULL_HANDLE) return;
+  vkFreeMemory(ctx->device, memory, NULL);
+  atomic_fetch_sub_explicit(&ctx->memory_allocations_live, 1, memory_order_relaxed);
+}
+
+VkResult vk_create_buffer(VkContext* ctx, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                          VkBuffer* buffer, VkDeviceMemory* memory) {
+  // Buffers may be touched by both the graphics and the async compute queue; sharing
+  // them concurrently avoids queue family ownership transfers.
+  uint32_t families[] = {ctx->graphics_family, ctx->compute_family};
+  bool shared = ctx->has_async_compute && ctx->graphics_family != ctx->compute_family;
+  VkBufferCreateInfo buffer_info = {
+      .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+      .size = size,
+      .usage = usage,
+      .sharingMode = shared ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,
+      .queueFamilyIndexCount = shared ? 2 : 0,
+      .pQueueFamilyIndices = shared ? families : NULL};
+  VkResult res = vkCreateBuffer(ctx->device, &buffer_info, NULL, buffer);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create buffer!\n");
+    return res;
+  }
+
+  VkMemoryRequirements reqs;
+  vkGetBufferMemoryRequirements(ctx->device, *buffer, &reqs);
+  VkMemoryAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+      .allocationSize = reqs.size,
+      .memoryTypeIndex = vk_find_memory_type(ctx, reqs.memoryTypeBits, properties)};
+  if (alloc_info.memoryTypeIndex == UINT32_MAX) {
+    fprintf(stderr, "Failed to find a memory type for buffer!\n");
+    res = VK_ERROR_FEATURE_NOT_PRESENT;
+    goto fail;
+  }
+  if ((res = vk_allocate_memory(ctx, &alloc_info, memory)) != VK_SUCCESS) {
+    fprintf(stderr, "Failed to allocate buffer memory!\n");
+    goto fail;
+  }
+  if ((res = vkBindBufferMemory(ctx->device, *buffer, *memory, 0)) != VK_SUCCESS) {
+    vk_free_memory(ctx, *memory);
+    goto fail;
+  }
+  return VK_SUCCESS;
+
+fail:
+  vkDestroyBuffer(ctx->device, *buffer, NULL);
+  *buffer = VK_NULL_HANDLE;
+  *memory = VK_NULL_HANDLE;
+  return res;
+}
+
+void vk_destroy_buffer(VkContext* ctx, VkBuffer buffer, VkDeviceMemory memory) {
+  if (buffer != VK_NULL_HANDLE) vkDestroyBuffer(ctx->device, buffer, NULL);
+  atomic_fetch_add_explicit(&ctx->destroyed_resources, 1, memory_order_relaxed);
+  vk_free_memory(ctx, memory);
+}
+
+static void defer(VkContext* ctx, Deletion deletion) {
+  deletion.frame = ctx->frame_number;
+  deletion_queue_push(&ctx->deletions, &deletion);
+}
+
+void vk_defer_destroy_buffer(VkContext* ctx, VkBuffer buffer, VkDeviceMemory memory) {
+  atomic_fetch_add_explicit(&ctx->destroyed_resources, 1, memory_order_relaxed);
+  if (buffer != VK_NULL_HANDLE) defer(ctx, (Deletion){.type = DELETE_BUFFER, .buffer = buffer});
+  if (memory != VK_NULL_HANDLE) defer(ctx, (Deletion){.type = DELETE_MEMORY, .memory = memory});
+}
+
+void vk_defer_destroy_image(VkContext* ctx, VkImage image, VkImageView view, VkDeviceMemory memory) {
+  atomic_fetch_add_explicit(&ctx->destroyed_resources, 1, memory_order_relaxed);
+  if (view != VK_NULL_HANDLE) defer(ctx, (Deletion){.type = DELETE_IMAGE_VIEW, .image_view = view});
+  if (image != VK_NULL_HANDLE) defer(ctx, (Deletion){.type = DELETE_IMAGE, .image = image});
+  if (memory != VK_NULL_HANDLE) defer(ctx, (Deletion){.type = DELETE_MEMORY, .memory = memory});
+}
+
+void vk_defer_destroy_pipeline(VkContext* ctx, VkPipeline pipeline) {
+  if (pipeline != VK_NULL_HANDLE) defer(ctx, (Deletion){.type = DELETE_PIPELINE, .pipeline = pipeline});
+}
+
+void vk_defer_destroy_framebuffer(VkContext* ctx, VkFramebuffer framebuffer) {
+  if (framebuffer != VK_NULL_HANDLE) defer(ctx, (Deletion){.type = DELETE_FRAMEBUFFER, .framebuffer = framebuffer});
+}
+
+void vk_defer_remove_bindless_image(VkContext* ctx, uint32_t handle) {
+  if (handle != BINDLESS_INVALID_HANDLE) defer(ctx, (Deletion){.type = DELETE_BINDLESS_IMAGE, .bindless_handle = handle});
+}
+
+void vk_defer_remove_bindless_buffer(VkContext* ctx, uint32_t handle) {
+  if (handle != BINDLESS_INVALID_HANDLE) defer(ctx, (Deletion){.type = DELETE_BINDLESS_BUFFER, .bindless_handle = handle});
+}
+
+void vk_defer_call(VkContext* ctx, DeletionFn fn, void* user_data) {
+  defer(ctx, (Deletion){.type = DELETE_CALLBACK, .callback = {fn, user_data}});
+}
+
+uint64_t vk_completed_frame(VkContext* ctx) {
+  // Frame N reuses the fence of frame N - MAX_FRAMES_IN_FLIGHT, so once N has been
+  // acquired the graphics work up to that frame is done, and the graphics timeline is
+  // signaled with the frame number. Graphics does not wait on compute jobs nobody
+  // consumes, so pending compute work bounds the result on its own.
+  uint64_t completed = ctx->frame_number > MAX_FRAMES_IN_FLIGHT ? ctx->frame_number - MAX_FRAMES_IN_FLIGHT : 0;
+  uint64_t value;
+  if (ctx->has_timeline_semaphore && vkGetSemaphoreCounterValue(ctx->device, ctx->graphics_timeline, &value) == VK_SUCCESS &&
+      value > completed) {
+    completed = value;
+  }
+  if (ctx->has_async_compute && ctx->compute_submitted > 0) {
+    // Values only count up; once the last submit is done compute holds nothing back.
+    if (vkGetSemaphoreCounterValue(ctx->device, ctx->compute_timeline, &value) != VK_SUCCESS) value = 0;
+    if (value < ctx->compute_submitted) completed = MIN(completed, value);
+  }
+  return completed;
+}
+
+void vk_collect_garbage(VkContext* ctx) {
+  deletion_queue_flush(&ctx->deletions, vk_completed_frame(ctx));
+}
+
+VkResult vk_begin_single_time_commands(VkContext* ctx, VkCommandBuffer* cmd) {
+  VkCommandBufferAllocateInfo alloc_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+      .commandPool = ctx->command_pool,
+      .level = VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+      .commandBufferCount = 1};
+  VK_RETURN(vkAllocateCommandBuffers(ctx->device, &alloc_info, cmd));
+
+  VkCommandBufferBeginInfo begin_info = {
+      .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+      .flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT};
+  VkResult res = vkBeginCommandBuffer(*cmd, &begin_info);
+  if (res != VK_SUCCESS) {
+    vkFreeCommandBuffers(ctx->device, ctx->command_pool, 1, cmd);
+  }
+  return res;
+}
+
+VkResult vk_end_single_time_commands(VkContext* ctx, VkCommandBuffer cmd) {
+  VkResult res = vkEndCommandBuffer(cmd);
+  if (res == VK_SUCCESS) {
+    VkSubmitInfo submit_info = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &cmd};
+    res = vkQueueSubmit(ctx->graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
+    if (res == VK_SUCCESS) res = vkQueueWaitIdle(ctx->graphics_queue);
+  }
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to submit upload commands: %d\n", res);
+  }
+  vkFreeCommandBuffers(ctx->device, ctx->command_pool, 1, &cmd);
+  return res;
+}
+
+VkResult vk_create_buffer_with_data(VkContext* ctx, const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+                                    VkBuffer* buffer, VkDeviceMemory* memory) {
+  VkBuffer staging;
+  VkDeviceMemory staging_memory;
+  VK_RETURN(vk_create_buffer(ctx, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                             &staging, &staging_memory));
+
+  void* mapped;
+  VkResult res = vkMapMemory(ctx->device, staging_memory, 0, size, 0, &mapped);
+  if (res != VK_SUCCESS) goto done;
+  memcpy(mapped, data, size);
+  vkUnmapMemory(ctx->device, staging_memory);
+
+  res = vk_create_buffer(ctx, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                         buffer, memory);
+  if (res != VK_SUCCESS) goto done;
+
+  VkCommandBuffer cmd;
+  if ((res = vk_begin_single_time_commands(ctx, &cmd)) != VK_SUCCESS) goto fail;
+  vkCmdCopyBuffer(cmd, staging, *buffer, 1, &(VkBufferCopy){.size = size});
+  if ((res = vk_end_single_time_commands(ctx, cmd)) != VK_SUCCESS) goto fail;
+  goto done;
+
+fail:
+  vk_destroy_buffer(ctx, *buffer, *memory);
+  *buffer = VK_NULL_HANDLE;
+  *memory = VK_NULL_HANDLE;
+done:
+  vk_destroy_buffer(ctx, staging, staging_memory);
+  return res;
+}
+
+VkResult vk_create_buffer_recorded(VkContext* ctx, const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+                                   VkCommandBuffer cmd, VkBuffer* buffer, VkDeviceMemory* memory) {
+  VkBuffer staging;
+  VkDeviceMemory staging_memory;
+  VK_RETURN(vk_create_buffer(ctx, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                             &staging, &staging_memory));
+
+  void* mapped;
+  VkResult res = vkMapMemory(ctx->device, staging_memory, 0, size, 0, &mapped);
+  if (res != VK_SUCCESS) {
+    vk_destroy_buffer(ctx, staging, staging_memory);
+    return res;
+  }
+  memcpy(mapped, data, size);
+  vkUnmapMemory(ctx->device, staging_memory);
+
+  res = vk_create_buffer(ctx, size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                         buffer, memory);
+  if (res != VK_SUCCESS) {
+    vk_destroy_buffer(ctx, staging, staging_memory);
+    return res;
+  }
+  vkCmdCopyBuffer(cmd, staging, *buffer, 1, &(VkBufferCopy){.size = size});
+  VkMemoryBarrier barrier = {
+      .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .dstAccessMask = VK_ACCESS_MEMORY_READ_BIT};
+  vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0,
+                       NULL, 0, NULL);
+  vk_defer_destroy_buffer(ctx, staging, staging_memory);
+  return VK_SUCCESS;
+}
+
+VkResult vk_create_compute_pipeline(VkContext* ctx, const char* path, VkPipelineLayout layout, VkPipeline* pipeline) {
+  VkShaderModule module;
+  SpirvReflection reflection = {0};
+  VK_RETURN(create_reflected_shader_module(ctx, path, &module, &reflection));
+  if (layout == VK_NULL_HANDLE && layout_cache_get(&ctx->layouts, &reflection, 1, &layout) != VK_SUCCESS) {
+    vkDestroyShaderModule(ctx->device, module, NULL);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
+
+  VkComputePipelineCreateInfo pipeline_info = {
+      .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+      .stage = {
+          .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+          .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+          .module = module,
+          .pName = "main"},
+      .layout = layout};
+  VkResult res = vkCreateComputePipelines(ctx->device, ctx->pipeline_cache, 1, &pipeline_info, NULL, pipeline);
+  if (res != VK_SUCCESS) {
+    fprintf(stderr, "Failed to create compute pipeline '%s'!\n", path);
+  }
+  vkDestroyShaderModule(ctx->device, module, NULL);
+  return res;
+}
+
+void vk_cmd_dispatch_threads(VkCommandBuffer cmd, uint32_t threads_x, uint32_t threads_y, uint32_t threads_z,
+                             uint32_t group_x, uint32_t group_y, uint32_t group_z) {
+  uint32_t groups_x = (threads_x + group_x - 1) / group_x;
+  uint32_t groups_y = (threads_y + group_y - 1) / group_y;
+  uint32_t groups_z = (threads_z + group_z - 1) / group_z;
+  if (groups_x == 0 || groups_y == 0 || groups_z == 0) return;
+  vkCmdDispatch(cmd, groups_x, groups_y, groups_z);
+}
+
+static VkResult read_shader(const char* path, uint32_t** words, size_t* size) {
   FILE* fp = fopen(path, "rb");
+  if (!fp) {
+    fprintf(stderr, "Failed to open shader '%s'\n", path);
+    return VK_ERROR_INITIALIZATION_FAILED;
+  }
   fseek(fp, 0, SEEK_END);
   long len = ftell(fp);
   rewind(fp);
@@ -881,17 +1605,52 @@ VkResult create_shader_module(VkContext* ctx, const char* path, VkShaderModule*
   char* code = aligned_alloc(16, ALIGN_FORWARD(len + 1, 16));
   fread(code, 1, len, fp);
   code[len] = '\0';
+  fclose(fp);
+  *words = (uint32_t*)code;
+  *size = (size_t)len;
+  return VK_SUCCESS;
+}
 
+// Reflection failures are not fatal: the shader is assumed to follow pipeline_layout.
+static VkResult create_reflected_shader_module(VkContext* ctx, const char* path, VkShaderModule* module,
+                                               SpirvReflection* reflection) {
+  uint32_t* words;
+  size_t size;
+  VK_RETURN(read_shader(path, &words, &size));
+
+  if (reflection && !layout_cache_reflect(&ctx->layouts, words, size / sizeof(uint32_t), reflection)) {
+    fprintf(stderr, "Failed to reflect shader '%s', assuming the shared layout\n", path);
+  }
   VkShaderModuleCreateInfo create_info = {
       .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-      .codeSize = (size_t)len,
-      .pCode = (uint32_t*)code,
+      .codeSize = size,
+      .pCode = words,
   };
   VkResult res = vkCreateShaderModule(ctx->device, &create_info, NULL, module);
   if (res != VK_SUCCESS) {
     fprintf(stderr, "Failed to create shader module!\n");
   }
-  fclose(fp);
-  free(code);
+  free(words);
   return res;
 }
+
+VkResult create_shader_module(VkContext* ctx, const char* path, VkShaderModule* module) {
+  return create_reflected_shader_module(ctx, path, module, NULL);
+}
+
+VkResult vk_reflect_pipeline_layout(VkContext* ctx, const char* const* paths, uint32_t count, VkPipelineLayout* layout) {
+  SpirvReflection stages[2];
+  if (count > COUNTOF(stages)) return VK_ERROR_INITIALIZATION_FAILED;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t* words;
+    size_t size;
+    VK_RETURN(read_shader(paths[i], &words, &size));
+    bool reflected = layout_cache_reflect(&ctx->layouts, words, size / sizeof(uint32_t), &stages[i]);
+    free(words);
+    if (!reflected) {
+      fprintf(stderr, "Failed to reflect shader '%s'\n", paths[i]);
+      return VK_ERROR_INITIALIZATION_FAILED;
+    }
+  }
+  return layout_cache_get(&ctx->layouts, stages, count, layout);
+}
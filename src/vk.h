@@ -1,42 +1,196 @@
 #pragma once
 
+#include <stdatomic.h>
 #include <vulkan/vulkan.h>
+#include "base.h"
+#include "bindless.h"
+#include "deletion_queue.h"
+#include "layout_cache.h"
+#include "uniform_ring.h"
 #include "window.h"
 
 #define MAX_FRAMES_IN_FLIGHT 2
+#define VK_MAX_WINDOWS 4
+#define VK_PIPELINE_CACHE_PATH "pipeline_cache.bin"
 
+#define VK_RETURN(expr)                  \
+  do {                                   \
+    VkResult _res = (expr);              \
+    if (_res != VK_SUCCESS) return _res; \
+  } while (0)
+
+// Presentation state of one window. Windows share the device, queues, render pass and
+// pipelines of their VkContext; only the surface and swapchain are per window.
 typedef struct {
-  VkInstance instance;
+  Window* window;
   VkSurfaceKHR surface;
+  VkSwapchainKHR swapchain;
+  VkExtent2D extent;
+  VkImage* images;
+  uint32_t images_count;
+  VkImageView* image_views;
+  VkFramebuffer* framebuffers;
+  VkSemaphore image_available_semaphores[MAX_FRAMES_IN_FLIGHT];
+  VkSemaphore* render_finished_semaphores;  // one per image
+  uint32_t image_index;
+  bool readable;  // images have TRANSFER_SRC usage, see capture_record
+} VkSwapchainContext;
+
+typedef struct {
+  VkInstance instance;
+  uint32_t api_version;
   bool enable_validation;
   VkDebugUtilsMessengerEXT debug_messenger;
 
+  bool any_device;  // integrated, virtual and CPU devices are acceptable
   VkPhysicalDevice physical_device;
   VkDevice device;
   VkQueue graphics_queue;
   VkQueue present_queue;
+  VkQueue compute_queue;
+  uint32_t graphics_family;
+  uint32_t compute_family;
+  bool has_async_compute;
+  bool has_timeline_semaphore;
+  bool has_synchronization2;
+  PFN_vkCmdPipelineBarrier2KHR cmd_pipeline_barrier2;
+  bool has_bindless;
+  bool has_draw_indirect_count;
+  bool has_draw_indirect_first_instance;
+  bool has_storage_write_without_format;
+  bool has_memory_budget;  // VK_EXT_memory_budget
+  bool has_pipeline_library;  // VK_EXT_graphics_pipeline_library
+  BindlessHeap bindless;
+  UniformRing uniforms;  // per-frame uniforms, set 1 of pipeline_layout; needs bindless
 
-  VkSwapchainKHR swapchain;
+  // windows[0] is the window passed to vk_init. Every swapchain uses the same format
+  // so one render pass and one set of pipelines serve all of them.
+  VkSwapchainContext windows[VK_MAX_WINDOWS];
+  uint32_t window_count;
   VkFormat swapchain_image_format;
-  VkExtent2D swapchain_extent;
-  VkImage* swapchain_images;
-  uint32_t swapchain_images_count;
-  VkImageView* swapchain_image_views;
-  VkFramebuffer* swapchain_framebuffers;
 
   VkRenderPass render_pass;
+  VkPipelineCache pipeline_cache;  // loaded from and saved to VK_PIPELINE_CACHE_PATH
   VkPipelineLayout pipeline_layout;
+  LayoutCache layouts;  // reflected layouts for shaders outside pipeline_layout's conventions
   VkPipeline graphics_pipeline;
+  VkPipeline mip_downsample_pipeline;  // created on first use by texture.c
 
   VkCommandPool command_pool;
   VkCommandBuffer command_buffers[MAX_FRAMES_IN_FLIGHT];
+  VkCommandPool compute_command_pool;
+  VkCommandBuffer compute_command_buffers[MAX_FRAMES_IN_FLIGHT];
   VkFence in_flight_fences[MAX_FRAMES_IN_FLIGHT];
-  VkSemaphore* image_available_semaphores;
-  VkSemaphore* render_finished_semaphores;
+  // Signaled with frame_number when each queue finishes a frame's work.
+  VkSemaphore graphics_timeline;
+  VkSemaphore compute_timeline;
+  uint64_t compute_submitted;  // last value a compute submit signals, 0 before the first
+  uint64_t frame_number;
   uint32_t current_frame;
-  uint32_t image_index;
+  // Objects retired mid-run, destroyed by vk_collect_garbage once their frame completes.
+  DeletionQueue deletions;
+  // Buffers and image views destroyed or queued for destruction so far. A new object may
+  // get a freed handle back, so caches keyed by handles drop everything when it changes.
+  atomic_uint destroyed_resources;
+
+  // Device memory allocations made through vk_allocate_memory, for the bench and tests.
+  atomic_uint memory_allocations;  // total since vk_init
+  atomic_uint memory_allocations_live;
+  atomic_uint_fast64_t memory_allocated_bytes;  // total since vk_init
 } VkContext;
 
-VkResult vk_init(Window* window, VkContext* ctx);
+// Shader features baked into a graphics pipeline as specialization constants: bit i
+// sets the boolean constant_id i in both stages, see shaders/features.glsl. Shaders
+// that do not declare a constant ignore it.
+typedef enum {
+  SHADER_FEATURE_INSTANCING = 1u << 0,  // per-instance object data from the GPU scene
+  SHADER_FEATURE_TEXTURING = 1u << 1,
+  SHADER_FEATURE_ALPHA_TEST = 1u << 2,
+} ShaderFeatureBits;
+#define SHADER_FEATURE_COUNT 3
+
+// Fixed-function state that differs between the renderer's graphics pipelines; the
+// rest (dynamic viewport/scissor, shared layout) is common.
+typedef struct {
+  const char* vert_path;
+  const char* frag_path;
+  const VkVertexInputBindingDescription* vertex_bindings;
+  uint32_t vertex_binding_count;
+  const VkVertexInputAttributeDescription* vertex_attributes;
+  uint32_t vertex_attribute_count;
+  VkCullModeFlags cull_mode;
+  VkFrontFace front_face;
+  bool blend;
+  bool depth_test;
+  bool depth_write;
+  VkRenderPass render_pass;  // VK_NULL_HANDLE for the main render pass
+  uint32_t features;  // ShaderFeatureBits
+} GraphicsPipelineDesc;
+
+// The independently compiled parts of a graphics pipeline with
+// VK_EXT_graphics_pipeline_library. Each reads only its share of GraphicsPipelineDesc:
+// vertex input the vertex layout, pre-rasterization the vertex shader and culling,
+// fragment the fragment shader and depth state, output the blend state.
+typedef enum {
+  PIPELINE_PART_VERTEX_INPUT,
+  PIPELINE_PART_PRE_RASTERIZATION,
+  PIPELINE_PART_FRAGMENT,
+  PIPELINE_PART_OUTPUT,
+  PIPELINE_PART_COUNT,
+} PipelinePart;
+
+// Only discrete GPUs are used unless any_device is set, e.g. for software rendering in tests.
+VkResult vk_init(Window* window, bool any_device, VkContext* ctx);
+// Creates a swapchain for another window on the same device. Call before rendering starts;
+// the window is released by vk_cleanup.
+VkResult vk_add_window(VkContext* ctx, Window* window);
+uint32_t vk_find_memory_type(VkContext* ctx, uint32_t type_bits, VkMemoryPropertyFlags properties);
+// vkAllocateMemory/vkFreeMemory with allocation counting.
+VkResult vk_allocate_memory(VkContext* ctx, const VkMemoryAllocateInfo* info, VkDeviceMemory* memory);
+void vk_free_memory(VkContext* ctx, VkDeviceMemory memory);
+VkResult vk_create_buffer(VkContext* ctx, VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                          VkBuffer* buffer, VkDeviceMemory* memory);
+void vk_destroy_buffer(VkContext* ctx, VkBuffer buffer, VkDeviceMemory memory);
+// Deferred destruction: the object may be used by the frame currently being recorded
+// (ctx->frame_number) or earlier ones, and is destroyed once all of them have completed.
+// Null handles and BINDLESS_INVALID_HANDLE are ignored.
+void vk_defer_destroy_buffer(VkContext* ctx, VkBuffer buffer, VkDeviceMemory memory);
+void vk_defer_destroy_image(VkContext* ctx, VkImage image, VkImageView view, VkDeviceMemory memory);
+void vk_defer_destroy_pipeline(VkContext* ctx, VkPipeline pipeline);
+void vk_defer_destroy_framebuffer(VkContext* ctx, VkFramebuffer framebuffer);
+void vk_defer_remove_bindless_image(VkContext* ctx, uint32_t handle);
+void vk_defer_remove_bindless_buffer(VkContext* ctx, uint32_t handle);
+void vk_defer_call(VkContext* ctx, DeletionFn fn, void* user_data);
+// Highest frame number whose GPU work is known to have finished.
+uint64_t vk_completed_frame(VkContext* ctx);
+// Destroys deferred objects whose frames have completed; call once per frame after acquire.
+void vk_collect_garbage(VkContext* ctx);
+// Creates a device-local buffer and fills it through a staging copy. Blocks until the copy is done.
+VkResult vk_create_buffer_with_data(VkContext* ctx, const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+                                    VkBuffer* buffer, VkDeviceMemory* memory);
+// Same, recording the copy into `cmd` instead of waiting; the staging buffer goes to the deletion queue.
+VkResult vk_create_buffer_recorded(VkContext* ctx, const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+                                   VkCommandBuffer cmd, VkBuffer* buffer, VkDeviceMemory* memory);
+// One-off command buffer on the graphics queue for uploads; end submits and waits idle.
+VkResult vk_begin_single_time_commands(VkContext* ctx, VkCommandBuffer* cmd);
+VkResult vk_end_single_time_commands(VkContext* ctx, VkCommandBuffer cmd);
+// Graphics pipelines take their layout from SPIR-V reflection: pipeline_layout for shaders
+// that follow its conventions, otherwise a generated one (see vk_reflect_pipeline_layout).
+VkResult vk_create_graphics_pipeline(VkContext* ctx, const GraphicsPipelineDesc* desc, VkPipeline* pipeline);
+// A pipeline library for one part; the shader parts need the layout of the full pipeline
+// (vk_reflect_pipeline_layout). VK_ERROR_FEATURE_NOT_PRESENT without has_pipeline_library.
+VkResult vk_create_pipeline_part(VkContext* ctx, const GraphicsPipelineDesc* desc, PipelinePart part,
+                                 VkPipelineLayout layout, VkPipeline* library);
+// Links one library per part into an executable pipeline. Without optimize this is
+// cheap enough for the render thread; with it the driver recompiles across parts.
+VkResult vk_link_graphics_pipeline(VkContext* ctx, const VkPipeline parts[PIPELINE_PART_COUNT], VkPipelineLayout layout,
+                                   bool optimize, VkPipeline* pipeline);
+// A null layout reflects one from the shader.
+VkResult vk_create_compute_pipeline(VkContext* ctx, const char* path, VkPipelineLayout layout, VkPipeline* pipeline);
+// The layout pipelines built from these SPIR-V files use, for binding sets and push constants.
+VkResult vk_reflect_pipeline_layout(VkContext* ctx, const char* const* paths, uint32_t count, VkPipelineLayout* layout);
+// Dispatches enough groups of the given local size to cover every thread.
+void vk_cmd_dispatch_threads(VkCommandBuffer cmd, uint32_t threads_x, uint32_t threads_y, uint32_t threads_z,
+                             uint32_t group_x, uint32_t group_y, uint32_t group_z);
 VkResult create_shader_module(VkContext* ctx, const char* path, VkShaderModule* module);
 void vk_cleanup(VkContext* ctx);
@@ -0,0 +1,55 @@
+// Decodes hand-built blocks with src/bc_decode.c and checks the texels against the
+// palettes the formats define.
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "bc_decode.h"
+
+// Texel t of each block below uses palette index t % 4.
+#define INDICES_0123 0xe4, 0xe4, 0xe4, 0xe4
+
+static int failures;
+
+static void expect_texel(const char* name, const uint8_t* texels, uint32_t t, uint8_t r, uint8_t g, uint8_t b,
+                         uint8_t a) {
+  const uint8_t* p = &texels[t * 4];
+  if (p[0] != r || p[1] != g || p[2] != b || p[3] != a) {
+    fprintf(stderr, "%s: texel %u is (%u, %u, %u, %u), expected (%u, %u, %u, %u)\n", name, t, p[0], p[1], p[2], p[3],
+            r, g, b, a);
+    failures++;
+  }
+}
+
+int main(void) {
+  uint8_t texels[4 * 4 * 4];
+
+  // c0 = pure blue (0x001f) > c1 = black: four colors.
+  const uint8_t four_color[8] = {0x1f, 0x00, 0x00, 0x00, INDICES_0123};
+  bc_decode_image(VK_FORMAT_BC1_RGB_UNORM_BLOCK, four_color, 4, 4, texels);
+  expect_texel("BC1 four-color", texels, 0, 0, 0, 255, 255);
+  expect_texel("BC1 four-color", texels, 1, 0, 0, 0, 255);
+  expect_texel("BC1 four-color", texels, 2, 0, 0, 170, 255);
+  expect_texel("BC1 four-color", texels, 3, 0, 0, 85, 255);
+
+  // c0 = black <= c1 = pure blue: three colors plus black, in every BC1 format.
+  const uint8_t three_color[8] = {0x00, 0x00, 0x1f, 0x00, INDICES_0123};
+  bc_decode_image(VK_FORMAT_BC1_RGB_UNORM_BLOCK, three_color, 4, 4, texels);
+  expect_texel("BC1 RGB three-color", texels, 0, 0, 0, 0, 255);
+  expect_texel("BC1 RGB three-color", texels, 1, 0, 0, 255, 255);
+  expect_texel("BC1 RGB three-color", texels, 2, 0, 0, 127, 255);
+  expect_texel("BC1 RGB three-color", texels, 3, 0, 0, 0, 255);
+  bc_decode_image(VK_FORMAT_BC1_RGBA_UNORM_BLOCK, three_color, 4, 4, texels);
+  expect_texel("BC1 RGBA three-color", texels, 2, 0, 0, 127, 255);
+  expect_texel("BC1 RGBA three-color", texels, 3, 0, 0, 0, 0);
+
+  // The same color block inside BC3 stays four-color; alpha endpoints 255/255 are opaque.
+  const uint8_t bc3[16] = {0xff, 0xff, 0, 0, 0, 0, 0, 0, 0x00, 0x00, 0x1f, 0x00, INDICES_0123};
+  bc_decode_image(VK_FORMAT_BC3_UNORM_BLOCK, bc3, 4, 4, texels);
+  expect_texel("BC3 color", texels, 2, 0, 0, 85, 255);
+  expect_texel("BC3 color", texels, 3, 0, 0, 170, 255);
+
+  if (failures) return 1;
+  printf("bc_decode: all blocks decode as specified\n");
+  return 0;
+}
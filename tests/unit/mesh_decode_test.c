@@ -0,0 +1,108 @@
+// Decodes a mesh written by tools/mesh_convert the way the GPU does and checks every
+// vertex against the source OBJ, centered on its bounding box like the converter does.
+//
+//   build/mesh_decode_test input.obj output.mesh
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "mesh_format.h"
+
+#define MAX_OBJ_POSITIONS 1024
+
+static uint32_t load_obj_positions(const char* path, float positions[][3]) {
+  FILE* file = fopen(path, "r");
+  if (!file) return 0;
+  char line[256];
+  uint32_t count = 0;
+  while (fgets(line, sizeof(line), file) && count < MAX_OBJ_POSITIONS) {
+    float* p = positions[count];
+    if (sscanf(line, "v %f %f %f", &p[0], &p[1], &p[2]) == 3) count++;
+  }
+  fclose(file);
+  return count;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s input.obj output.mesh\n", argv[0]);
+    return 1;
+  }
+
+  static float expected[MAX_OBJ_POSITIONS][3];
+  uint32_t expected_count = load_obj_positions(argv[1], expected);
+  if (expected_count == 0) {
+    fprintf(stderr, "No positions in '%s'\n", argv[1]);
+    return 1;
+  }
+  float min[3] = {INFINITY, INFINITY, INFINITY};
+  float max[3] = {-INFINITY, -INFINITY, -INFINITY};
+  for (uint32_t i = 0; i < expected_count; ++i) {
+    for (uint32_t c = 0; c < 3; ++c) {
+      min[c] = fminf(min[c], expected[i][c]);
+      max[c] = fmaxf(max[c], expected[i][c]);
+    }
+  }
+  float tolerance = 0.0f;
+  for (uint32_t i = 0; i < expected_count; ++i) {
+    for (uint32_t c = 0; c < 3; ++c) expected[i][c] -= (min[c] + max[c]) * 0.5f;
+  }
+  for (uint32_t c = 0; c < 3; ++c) tolerance = fmaxf(tolerance, (max[c] - min[c]) / 65535.0f);
+
+  FILE* file = fopen(argv[2], "rb");
+  if (!file) {
+    fprintf(stderr, "Failed to open '%s'\n", argv[2]);
+    return 1;
+  }
+  MeshFileHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != MESH_FILE_MAGIC ||
+      header.version != MESH_FILE_VERSION) {
+    fprintf(stderr, "'%s' is not a version %u mesh\n", argv[2], MESH_FILE_VERSION);
+    fclose(file);
+    return 1;
+  }
+
+  int status = 0;
+  bool* hit = calloc(expected_count, sizeof(bool));
+  for (uint32_t i = 0; i < header.vertex_count && status == 0; ++i) {
+    MeshVertex vertex;
+    if (fread(&vertex, sizeof(vertex), 1, file) != 1) {
+      fprintf(stderr, "Truncated vertex data\n");
+      status = 1;
+      break;
+    }
+    // R16G16B16A16_UNORM fetch, then shaders/mesh.vert.
+    float decoded[3];
+    for (uint32_t c = 0; c < 3; ++c) {
+      decoded[c] = header.position_offset[c] + (float)vertex.position[c] / 65535.0f * header.position_scale[c];
+    }
+    if (sqrtf(decoded[0] * decoded[0] + decoded[1] * decoded[1] + decoded[2] * decoded[2]) > header.radius + tolerance) {
+      fprintf(stderr, "Vertex %u outside the bounding sphere\n", i);
+      status = 1;
+    }
+    bool found = false;
+    for (uint32_t j = 0; j < expected_count; ++j) {
+      if (fabsf(decoded[0] - expected[j][0]) <= tolerance && fabsf(decoded[1] - expected[j][1]) <= tolerance &&
+          fabsf(decoded[2] - expected[j][2]) <= tolerance) {
+        hit[j] = found = true;
+      }
+    }
+    if (!found) {
+      fprintf(stderr, "Vertex %u decodes to (%g, %g, %g), not a source position\n", i, decoded[0], decoded[1],
+              decoded[2]);
+      status = 1;
+    }
+  }
+  for (uint32_t j = 0; j < expected_count && status == 0; ++j) {
+    if (!hit[j]) {
+      fprintf(stderr, "Source position %u is missing\n", j);
+      status = 1;
+    }
+  }
+  free(hit);
+  fclose(file);
+  if (status == 0) printf("%s: %u vertices decode to their source positions\n", argv[2], header.vertex_count);
+  return status;
+}
@@ -0,0 +1,376 @@
+// Converts a Wavefront OBJ into the renderer's binary mesh format (src/mesh_format.h):
+// triangulates, welds identical vertices, reorders for the vertex cache, overdraw and
+// vertex fetch, then quantizes the attributes.
+//
+//   build/mesh_convert input.obj output.mesh
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "base.h"
+#include "mesh_format.h"
+#include "mesh_optimize.h"
+
+typedef struct {
+  float* data;
+  uint32_t count;
+  uint32_t capacity;
+} FloatArray;
+
+typedef struct {
+  float position[3];
+  float normal[3];
+  float uv[2];
+} Vertex;
+
+typedef struct {
+  int32_t keys[3];  // position, uv, normal; -1 when absent
+  uint32_t vertex;
+  bool used;
+} WeldEntry;
+
+typedef struct {
+  FloatArray positions;
+  FloatArray uvs;
+  FloatArray normals;
+  Vertex* vertices;
+  uint32_t vertex_count;
+  uint32_t vertex_capacity;
+  uint32_t* indices;
+  uint32_t index_count;
+  uint32_t index_capacity;
+  WeldEntry* weld;
+  uint32_t weld_capacity;
+} ObjMesh;
+
+static void push_floats(FloatArray* array, const float* values, uint32_t count) {
+  if (array->count + count > array->capacity) {
+    array->capacity = MAX(array->capacity * 2, array->count + count + 64);
+    array->data = realloc(array->data, sizeof(float) * array->capacity);
+  }
+  memcpy(&array->data[array->count], values, sizeof(float) * count);
+  array->count += count;
+}
+
+static void push_index(ObjMesh* mesh, uint32_t index) {
+  if (mesh->index_count == mesh->index_capacity) {
+    mesh->index_capacity = MAX(mesh->index_capacity * 2, 1024);
+    mesh->indices = realloc(mesh->indices, sizeof(uint32_t) * mesh->index_capacity);
+  }
+  mesh->indices[mesh->index_count++] = index;
+}
+
+static uint32_t hash_keys(const int32_t keys[3]) {
+  uint32_t h = 2166136261u;
+  for (int i = 0; i < 3; ++i) {
+    h = (h ^ (uint32_t)keys[i]) * 16777619u;
+  }
+  return h;
+}
+
+static void grow_weld(ObjMesh* mesh);
+
+// Returns the welded vertex for a position/uv/normal triple, creating it on first use.
+static uint32_t weld_vertex(ObjMesh* mesh, const int32_t keys[3]) {
+  if ((mesh->vertex_count + 1) * 2 > mesh->weld_capacity) grow_weld(mesh);
+
+  uint32_t mask = mesh->weld_capacity - 1;
+  for (uint32_t slot = hash_keys(keys) & mask;; slot = (slot + 1) & mask) {
+    WeldEntry* entry = &mesh->weld[slot];
+    if (entry->used) {
+      if (memcmp(entry->keys, keys, sizeof(entry->keys)) == 0) return entry->vertex;
+      continue;
+    }
+
+    if (mesh->vertex_count == mesh->vertex_capacity) {
+      mesh->vertex_capacity = MAX(mesh->vertex_capacity * 2, 1024);
+      mesh->vertices = realloc(mesh->vertices, sizeof(Vertex) * mesh->vertex_capacity);
+    }
+    Vertex* v = &mesh->vertices[mesh->vertex_count];
+    memset(v, 0, sizeof(*v));
+    memcpy(v->position, &mesh->positions.data[keys[0] * 3], sizeof(v->position));
+    if (keys[1] >= 0) memcpy(v->uv, &mesh->uvs.data[keys[1] * 2], sizeof(v->uv));
+    if (keys[2] >= 0) memcpy(v->normal, &mesh->normals.data[keys[2] * 3], sizeof(v->normal));
+
+    entry->used = true;
+    memcpy(entry->keys, keys, sizeof(entry->keys));
+    entry->vertex = mesh->vertex_count;
+    return mesh->vertex_count++;
+  }
+}
+
+static void grow_weld(ObjMesh* mesh) {
+  WeldEntry* old = mesh->weld;
+  uint32_t old_capacity = mesh->weld_capacity;
+  mesh->weld_capacity = MAX(old_capacity * 2, 4096);
+  mesh->weld = calloc(mesh->weld_capacity, sizeof(WeldEntry));
+
+  uint32_t mask = mesh->weld_capacity - 1;
+  for (uint32_t i = 0; i < old_capacity; ++i) {
+    if (!old[i].used) continue;
+    uint32_t slot = hash_keys(old[i].keys) & mask;
+    while (mesh->weld[slot].used) slot = (slot + 1) & mask;
+    mesh->weld[slot] = old[i];
+  }
+  free(old);
+}
+
+// OBJ indices are 1-based, negative ones count back from the end.
+static int32_t resolve_index(long index, uint32_t count) {
+  if (index > 0 && (uint32_t)index <= count) return (int32_t)(index - 1);
+  if (index < 0 && (uint32_t)-index <= count) return (int32_t)(count + index);
+  return -1;
+}
+
+static bool parse_face_vertex(ObjMesh* mesh, char** cursor, int32_t keys[3]) {
+  char* s = *cursor;
+  while (*s == ' ' || *s == '\t') s++;
+  if (*s == '\0' || *s == '\n' || *s == '\r') return false;
+
+  long values[3] = {0, 0, 0};
+  for (int i = 0; i < 3; ++i) {
+    if (*s != '/') values[i] = strtol(s, &s, 10);
+    if (*s != '/') break;
+    s++;
+  }
+  while (*s && *s != ' ' && *s != '\t' && *s != '\n' && *s != '\r') s++;
+  *cursor = s;
+
+  keys[0] = resolve_index(values[0], mesh->positions.count / 3);
+  keys[1] = values[1] ? resolve_index(values[1], mesh->uvs.count / 2) : -1;
+  keys[2] = values[2] ? resolve_index(values[2], mesh->normals.count / 3) : -1;
+  return keys[0] >= 0;
+}
+
+static bool load_obj(const char* path, ObjMesh* mesh) {
+  FILE* file = fopen(path, "r");
+  if (!file) {
+    fprintf(stderr, "Failed to open '%s'\n", path);
+    return false;
+  }
+
+  char line[1024];
+  uint32_t line_number = 0;
+  while (fgets(line, sizeof(line), file)) {
+    line_number++;
+    float v[3] = {0};
+    if (strncmp(line, "v ", 2) == 0) {
+      sscanf(line + 2, "%f %f %f", &v[0], &v[1], &v[2]);
+      push_floats(&mesh->positions, v, 3);
+    } else if (strncmp(line, "vt ", 3) == 0) {
+      sscanf(line + 3, "%f %f", &v[0], &v[1]);
+      v[1] = 1.0f - v[1];  // OBJ has v pointing up, Vulkan samples top-down
+      push_floats(&mesh->uvs, v, 2);
+    } else if (strncmp(line, "vn ", 3) == 0) {
+      sscanf(line + 3, "%f %f %f", &v[0], &v[1], &v[2]);
+      push_floats(&mesh->normals, v, 3);
+    } else if (strncmp(line, "f ", 2) == 0) {
+      char* cursor = line + 2;
+      int32_t keys[3];
+      uint32_t first = 0, previous = 0, count = 0;
+      while (parse_face_vertex(mesh, &cursor, keys)) {
+        uint32_t vertex = weld_vertex(mesh, keys);
+        // Fan triangulation for polygons.
+        if (count >= 2) {
+          push_index(mesh, first);
+          push_index(mesh, previous);
+          push_index(mesh, vertex);
+        }
+        if (count == 0) first = vertex;
+        previous = vertex;
+        count++;
+      }
+      if (count < 3) fprintf(stderr, "%s:%u: skipping degenerate face\n", path, line_number);
+    }
+  }
+  fclose(file);
+  return mesh->index_count > 0;
+}
+
+static void compute_missing_normals(ObjMesh* mesh) {
+  bool missing = false;
+  for (uint32_t i = 0; i < mesh->vertex_count && !missing; ++i) {
+    const float* n = mesh->vertices[i].normal;
+    missing = n[0] == 0.0f && n[1] == 0.0f && n[2] == 0.0f;
+  }
+  if (!missing) return;
+
+  // Area-weighted face normals accumulated on vertices that have none.
+  float* accum = calloc(mesh->vertex_count * 3, sizeof(float));
+  for (uint32_t t = 0; t < mesh->index_count; t += 3) {
+    const float* p0 = mesh->vertices[mesh->indices[t]].position;
+    const float* p1 = mesh->vertices[mesh->indices[t + 1]].position;
+    const float* p2 = mesh->vertices[mesh->indices[t + 2]].position;
+    float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+    float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+    float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+    for (uint32_t k = 0; k < 3; ++k) {
+      for (uint32_t c = 0; c < 3; ++c) accum[mesh->indices[t + k] * 3 + c] += n[c];
+    }
+  }
+  for (uint32_t i = 0; i < mesh->vertex_count; ++i) {
+    float* n = mesh->vertices[i].normal;
+    if (n[0] != 0.0f || n[1] != 0.0f || n[2] != 0.0f) continue;
+    memcpy(n, &accum[i * 3], sizeof(float) * 3);
+  }
+  free(accum);
+}
+
+static uint16_t quantize_unorm16(float v) {
+  return (uint16_t)lrintf(CLAMP(v, 0.0f, 1.0f) * 65535.0f);
+}
+
+static int16_t quantize_snorm16(float v) {
+  return (int16_t)lrintf(CLAMP(v, -1.0f, 1.0f) * 32767.0f);
+}
+
+static uint16_t float_to_half(float value) {
+  union {
+    float f;
+    uint32_t u;
+  } bits = {.f = value};
+  uint32_t sign = (bits.u >> 16) & 0x8000u;
+  int32_t exponent = (int32_t)((bits.u >> 23) & 0xffu) - 127 + 15;
+  uint32_t mantissa = bits.u & 0x7fffffu;
+
+  if (exponent <= 0) return (uint16_t)sign;  // flush denormals to zero
+  if (exponent >= 31) return (uint16_t)(sign | 0x7c00u);
+  uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+  // Round to nearest; a carry into the exponent is still the correct result.
+  if (mantissa & 0x1000u) half++;
+  return (uint16_t)half;
+}
+
+// Maps a unit vector onto the octahedron and unfolds it into the [-1, 1] square.
+static void encode_octahedral(const float normal[3], int16_t out[2]) {
+  float length = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+  if (length == 0.0f) {
+    out[0] = out[1] = 0;
+    return;
+  }
+  float x = normal[0] / length;
+  float y = normal[1] / length;
+  if (normal[2] < 0.0f) {
+    float ox = x;
+    x = (1.0f - fabsf(y)) * (ox >= 0.0f ? 1.0f : -1.0f);
+    y = (1.0f - fabsf(ox)) * (y >= 0.0f ? 1.0f : -1.0f);
+  }
+  out[0] = quantize_snorm16(x);
+  out[1] = quantize_snorm16(y);
+}
+
+static bool write_mesh(const char* path, const ObjMesh* mesh) {
+  float min[3] = {INFINITY, INFINITY, INFINITY};
+  float max[3] = {-INFINITY, -INFINITY, -INFINITY};
+  for (uint32_t i = 0; i < mesh->vertex_count; ++i) {
+    for (uint32_t c = 0; c < 3; ++c) {
+      min[c] = MIN(min[c], mesh->vertices[i].position[c]);
+      max[c] = MAX(max[c], mesh->vertices[i].position[c]);
+    }
+  }
+
+  // Positions are stored relative to the bounding sphere center so instances can be
+  // placed by their GpuObject center without another transform.
+  MeshFileHeader header = {
+      .magic = MESH_FILE_MAGIC,
+      .version = MESH_FILE_VERSION,
+      .vertex_count = mesh->vertex_count,
+      .index_count = mesh->index_count,
+      .index_size = mesh->vertex_count <= UINT16_MAX + 1 ? 2 : 4};
+  float center[3];
+  float extent[3];
+  for (uint32_t c = 0; c < 3; ++c) {
+    center[c] = (min[c] + max[c]) * 0.5f;
+    extent[c] = max[c] - min[c];
+    header.position_offset[c] = min[c] - center[c];
+    header.position_scale[c] = extent[c];
+  }
+  for (uint32_t i = 0; i < mesh->vertex_count; ++i) {
+    const float* p = mesh->vertices[i].position;
+    float d[3] = {p[0] - center[0], p[1] - center[1], p[2] - center[2]};
+    header.radius = MAX(header.radius, sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+  }
+
+  FILE* file = fopen(path, "wb");
+  if (!file) {
+    fprintf(stderr, "Failed to create '%s'\n", path);
+    return false;
+  }
+  fwrite(&header, sizeof(header), 1, file);
+
+  for (uint32_t i = 0; i < mesh->vertex_count; ++i) {
+    const Vertex* v = &mesh->vertices[i];
+    MeshVertex out = {0};
+    for (uint32_t c = 0; c < 3; ++c) {
+      out.position[c] = extent[c] > 0.0f ? quantize_unorm16((v->position[c] - min[c]) / extent[c]) : 0;
+    }
+    encode_octahedral(v->normal, out.normal);
+    out.uv[0] = float_to_half(v->uv[0]);
+    out.uv[1] = float_to_half(v->uv[1]);
+    fwrite(&out, sizeof(out), 1, file);
+  }
+
+  for (uint32_t i = 0; i < mesh->index_count; ++i) {
+    if (header.index_size == 2) {
+      uint16_t index = (uint16_t)mesh->indices[i];
+      fwrite(&index, sizeof(index), 1, file);
+    } else {
+      fwrite(&mesh->indices[i], sizeof(uint32_t), 1, file);
+    }
+  }
+
+  bool ok = ferror(file) == 0;
+  fclose(file);
+  if (!ok) fprintf(stderr, "Failed to write '%s'\n", path);
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s input.obj output.mesh\n", argv[0]);
+    return 1;
+  }
+
+  ObjMesh mesh = {0};
+  if (!load_obj(argv[1], &mesh)) {
+    fprintf(stderr, "No triangles in '%s'\n", argv[1]);
+    return 1;
+  }
+  compute_missing_normals(&mesh);
+
+  float acmr_before = mesh_analyze_acmr(mesh.indices, mesh.index_count, mesh.vertex_count, 16);
+
+  float* positions = malloc(sizeof(float) * 3 * mesh.vertex_count);
+  for (uint32_t i = 0; i < mesh.vertex_count; ++i) {
+    memcpy(&positions[i * 3], mesh.vertices[i].position, sizeof(float) * 3);
+  }
+  mesh_optimize_vertex_cache(mesh.indices, mesh.index_count, mesh.vertex_count);
+  mesh_optimize_overdraw(mesh.indices, mesh.index_count, positions, mesh.vertex_count, 16);
+  free(positions);
+
+  uint32_t* remap = malloc(sizeof(uint32_t) * mesh.vertex_count);
+  uint32_t used = mesh_optimize_vertex_fetch(remap, mesh.indices, mesh.index_count, mesh.vertex_count);
+  Vertex* reordered = malloc(sizeof(Vertex) * MAX(used, 1));
+  for (uint32_t i = 0; i < mesh.vertex_count; ++i) {
+    if (remap[i] != UINT32_MAX) reordered[remap[i]] = mesh.vertices[i];
+  }
+  free(remap);
+  free(mesh.vertices);
+  mesh.vertices = reordered;
+  mesh.vertex_count = used;
+
+  float acmr_after = mesh_analyze_acmr(mesh.indices, mesh.index_count, mesh.vertex_count, 16);
+  printf("%s: %u vertices, %u triangles, ACMR %.3f -> %.3f, %zu bytes per vertex\n", argv[2], mesh.vertex_count,
+         mesh.index_count / 3, acmr_before, acmr_after, sizeof(MeshVertex));
+
+  bool ok = write_mesh(argv[2], &mesh);
+  free(mesh.positions.data);
+  free(mesh.uvs.data);
+  free(mesh.normals.data);
+  free(mesh.vertices);
+  free(mesh.indices);
+  free(mesh.weld);
+  return ok ? 0 : 1;
+}
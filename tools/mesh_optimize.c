@@ -0,0 +1,263 @@
+#include "mesh_optimize.h"
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CACHE_DECAY_POWER 1.5f
+#define LAST_TRIANGLE_SCORE 0.75f
+#define VALENCE_BOOST_SCALE 2.0f
+#define VALENCE_BOOST_POWER 0.5f
+
+typedef struct {
+  int32_t cache_position;
+  float score;
+  uint32_t active_count;  // triangles not yet emitted
+  uint32_t first_triangle;  // offset into the adjacency array
+} CacheVertex;
+
+static float vertex_score(const CacheVertex* v) {
+  if (v->active_count == 0) return -1.0f;
+
+  float score = 0.0f;
+  if (v->cache_position >= 0) {
+    if (v->cache_position < 3) {
+      // The last triangle's vertices are penalized so strips do not turn back on themselves.
+      score = LAST_TRIANGLE_SCORE;
+    } else {
+      float scaler = 1.0f / (MESH_OPTIMIZE_CACHE_SIZE - 3);
+      score = powf(1.0f - (float)(v->cache_position - 3) * scaler, CACHE_DECAY_POWER);
+    }
+  }
+  // Favor vertices with few remaining triangles so they leave the cache for good.
+  score += VALENCE_BOOST_SCALE * powf((float)v->active_count, -VALENCE_BOOST_POWER);
+  return score;
+}
+
+void mesh_optimize_vertex_cache(uint32_t* indices, uint32_t index_count, uint32_t vertex_count) {
+  uint32_t triangle_count = index_count / 3;
+  if (triangle_count == 0) return;
+
+  CacheVertex* vertices = calloc(vertex_count, sizeof(CacheVertex));
+  uint32_t* adjacency = malloc(sizeof(uint32_t) * index_count);
+  uint32_t* fill = calloc(vertex_count, sizeof(uint32_t));
+  float* triangle_scores = malloc(sizeof(float) * triangle_count);
+  bool* emitted = calloc(triangle_count, sizeof(bool));
+  uint32_t* output = malloc(sizeof(uint32_t) * index_count);
+
+  for (uint32_t i = 0; i < index_count; ++i) vertices[indices[i]].active_count++;
+  uint32_t offset = 0;
+  for (uint32_t v = 0; v < vertex_count; ++v) {
+    vertices[v].first_triangle = offset;
+    vertices[v].cache_position = -1;
+    offset += vertices[v].active_count;
+  }
+  for (uint32_t t = 0; t < triangle_count; ++t) {
+    for (uint32_t k = 0; k < 3; ++k) {
+      uint32_t v = indices[t * 3 + k];
+      adjacency[vertices[v].first_triangle + fill[v]++] = t;
+    }
+  }
+  for (uint32_t v = 0; v < vertex_count; ++v) vertices[v].score = vertex_score(&vertices[v]);
+  for (uint32_t t = 0; t < triangle_count; ++t) {
+    triangle_scores[t] = vertices[indices[t * 3]].score + vertices[indices[t * 3 + 1]].score +
+                         vertices[indices[t * 3 + 2]].score;
+  }
+
+  // Three extra slots hold the vertices pushed out by the newest triangle.
+  uint32_t cache[MESH_OPTIMIZE_CACHE_SIZE + 3];
+  uint32_t cache_count = 0;
+  uint32_t scan_cursor = 0;
+  uint32_t best = UINT32_MAX;
+
+  for (uint32_t out = 0; out < triangle_count; ++out) {
+    if (best == UINT32_MAX) {
+      // Nothing in the cache has triangles left; restart from the first pending triangle.
+      float best_score = -1.0f;
+      while (scan_cursor < triangle_count && emitted[scan_cursor]) scan_cursor++;
+      for (uint32_t t = scan_cursor; t < triangle_count; ++t) {
+        if (!emitted[t] && triangle_scores[t] > best_score) {
+          best_score = triangle_scores[t];
+          best = t;
+        }
+      }
+    }
+
+    uint32_t* tri = &indices[best * 3];
+    memcpy(&output[out * 3], tri, sizeof(uint32_t) * 3);
+    emitted[best] = true;
+
+    // Remove the triangle from its vertices' pending lists.
+    for (uint32_t k = 0; k < 3; ++k) {
+      CacheVertex* v = &vertices[tri[k]];
+      uint32_t* list = &adjacency[v->first_triangle];
+      for (uint32_t i = 0; i < v->active_count; ++i) {
+        if (list[i] == best) {
+          list[i] = list[v->active_count - 1];
+          break;
+        }
+      }
+      v->active_count--;
+    }
+
+    // Move the triangle's vertices to the front of the LRU cache.
+    uint32_t new_cache[MESH_OPTIMIZE_CACHE_SIZE + 3];
+    uint32_t new_count = 0;
+    for (uint32_t k = 0; k < 3; ++k) new_cache[new_count++] = tri[k];
+    for (uint32_t i = 0; i < cache_count; ++i) {
+      uint32_t v = cache[i];
+      if (v != tri[0] && v != tri[1] && v != tri[2]) new_cache[new_count++] = v;
+    }
+
+    cache_count = 0;
+    for (uint32_t i = 0; i < new_count; ++i) {
+      CacheVertex* v = &vertices[new_cache[i]];
+      if (i < MESH_OPTIMIZE_CACHE_SIZE) {
+        v->cache_position = (int32_t)i;
+        cache[cache_count++] = new_cache[i];
+      } else {
+        v->cache_position = -1;
+      }
+      v->score = vertex_score(v);
+    }
+
+    // Only triangles touching the cache changed score; pick the best of them.
+    best = UINT32_MAX;
+    float best_score = -1.0f;
+    for (uint32_t i = 0; i < new_count; ++i) {
+      CacheVertex* v = &vertices[new_cache[i]];
+      for (uint32_t j = 0; j < v->active_count; ++j) {
+        uint32_t t = adjacency[v->first_triangle + j];
+        float score = vertices[indices[t * 3]].score + vertices[indices[t * 3 + 1]].score +
+                      vertices[indices[t * 3 + 2]].score;
+        triangle_scores[t] = score;
+        if (score > best_score) {
+          best_score = score;
+          best = t;
+        }
+      }
+    }
+  }
+
+  memcpy(indices, output, sizeof(uint32_t) * index_count);
+  free(output);
+  free(emitted);
+  free(triangle_scores);
+  free(fill);
+  free(adjacency);
+  free(vertices);
+}
+
+typedef struct {
+  uint32_t first_triangle;
+  uint32_t triangle_count;
+  float sort_key;
+} Cluster;
+
+static int compare_clusters(const void* a, const void* b) {
+  const Cluster* ca = a;
+  const Cluster* cb = b;
+  if (ca->sort_key != cb->sort_key) return ca->sort_key > cb->sort_key ? -1 : 1;
+  return ca->first_triangle < cb->first_triangle ? -1 : 1;
+}
+
+void mesh_optimize_overdraw(uint32_t* indices, uint32_t index_count, const float* positions, uint32_t vertex_count,
+                            uint32_t cache_size) {
+  uint32_t triangle_count = index_count / 3;
+  if (triangle_count == 0) return;
+
+  // Cluster boundaries go where a FIFO cache would miss all three vertices anyway.
+  uint32_t* timestamps = calloc(vertex_count, sizeof(uint32_t));
+  Cluster* clusters = malloc(sizeof(Cluster) * triangle_count);
+  uint32_t cluster_count = 0;
+  uint32_t time = cache_size + 1;
+  for (uint32_t t = 0; t < triangle_count; ++t) {
+    uint32_t misses = 0;
+    for (uint32_t k = 0; k < 3; ++k) {
+      uint32_t v = indices[t * 3 + k];
+      if (time - timestamps[v] > cache_size) {
+        timestamps[v] = time++;
+        misses++;
+      }
+    }
+    if (misses == 3 || cluster_count == 0) {
+      clusters[cluster_count++] = (Cluster){.first_triangle = t};
+    }
+    clusters[cluster_count - 1].triangle_count++;
+  }
+
+  float mesh_centroid[3] = {0};
+  for (uint32_t i = 0; i < index_count; ++i) {
+    for (uint32_t c = 0; c < 3; ++c) mesh_centroid[c] += positions[indices[i] * 3 + c];
+  }
+  for (uint32_t c = 0; c < 3; ++c) mesh_centroid[c] /= (float)index_count;
+
+  // Clusters facing away from the mesh center are likely occluders; draw them first.
+  for (uint32_t i = 0; i < cluster_count; ++i) {
+    Cluster* cluster = &clusters[i];
+    float centroid[3] = {0};
+    float normal[3] = {0};
+    float area_sum = 0.0f;
+    for (uint32_t t = cluster->first_triangle; t < cluster->first_triangle + cluster->triangle_count; ++t) {
+      const float* p0 = &positions[indices[t * 3] * 3];
+      const float* p1 = &positions[indices[t * 3 + 1] * 3];
+      const float* p2 = &positions[indices[t * 3 + 2] * 3];
+      float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      float n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+      float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+      for (uint32_t c = 0; c < 3; ++c) {
+        centroid[c] += (p0[c] + p1[c] + p2[c]) * (area / 3.0f);
+        normal[c] += n[c];
+      }
+      area_sum += area;
+    }
+    float normal_length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+    cluster->sort_key = 0.0f;
+    if (area_sum > 0.0f && normal_length > 0.0f) {
+      for (uint32_t c = 0; c < 3; ++c) {
+        cluster->sort_key += (centroid[c] / area_sum - mesh_centroid[c]) * (normal[c] / normal_length);
+      }
+    }
+  }
+  qsort(clusters, cluster_count, sizeof(Cluster), compare_clusters);
+
+  uint32_t* output = malloc(sizeof(uint32_t) * index_count);
+  uint32_t written = 0;
+  for (uint32_t i = 0; i < cluster_count; ++i) {
+    uint32_t count = clusters[i].triangle_count * 3;
+    memcpy(&output[written], &indices[clusters[i].first_triangle * 3], sizeof(uint32_t) * count);
+    written += count;
+  }
+  memcpy(indices, output, sizeof(uint32_t) * index_count);
+
+  free(output);
+  free(clusters);
+  free(timestamps);
+}
+
+uint32_t mesh_optimize_vertex_fetch(uint32_t* remap, uint32_t* indices, uint32_t index_count, uint32_t vertex_count) {
+  memset(remap, 0xff, sizeof(uint32_t) * vertex_count);
+  uint32_t next = 0;
+  for (uint32_t i = 0; i < index_count; ++i) {
+    uint32_t* slot = &remap[indices[i]];
+    if (*slot == UINT32_MAX) *slot = next++;
+    indices[i] = *slot;
+  }
+  return next;
+}
+
+float mesh_analyze_acmr(const uint32_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size) {
+  if (index_count < 3) return 0.0f;
+  uint32_t* timestamps = calloc(vertex_count, sizeof(uint32_t));
+  uint32_t time = cache_size + 1;
+  uint32_t misses = 0;
+  for (uint32_t i = 0; i < index_count; ++i) {
+    if (time - timestamps[indices[i]] > cache_size) {
+      timestamps[indices[i]] = time++;
+      misses++;
+    }
+  }
+  free(timestamps);
+  return (float)misses / (float)(index_count / 3);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+#define MESH_OPTIMIZE_CACHE_SIZE 32
+
+// Reorders triangles for the post-transform vertex cache (Forsyth, "Linear-Speed
+// Vertex Cache Optimisation").
+void mesh_optimize_vertex_cache(uint32_t* indices, uint32_t index_count, uint32_t vertex_count);
+
+// Splits a cache-optimized index buffer into clusters at points where the cache is
+// cold anyway, then sorts clusters so outward-facing ones draw first, which cuts
+// overdraw without undoing most of the cache ordering (Sander et al., "Fast
+// Triangle Reordering for Vertex Locality and Reduced Overdraw").
+void mesh_optimize_overdraw(uint32_t* indices, uint32_t index_count, const float* positions, uint32_t vertex_count,
+                            uint32_t cache_size);
+
+// Renumbers vertices in first-use order so vertex fetch walks memory linearly.
+// Fills remap[old] = new (UINT32_MAX for unused) and returns the used vertex count.
+uint32_t mesh_optimize_vertex_fetch(uint32_t* remap, uint32_t* indices, uint32_t index_count, uint32_t vertex_count);
+
+// Average cache misses per triangle for a FIFO cache, 0.5 is ideal and 3 is worst.
+float mesh_analyze_acmr(const uint32_t* indices, uint32_t index_count, uint32_t vertex_count, uint32_t cache_size);
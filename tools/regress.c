@@ -0,0 +1,139 @@
+// Checks a `main --bench` run against stored references for `make test`.
+//
+//   build/regress image golden.png actual.png [threshold] [max_fraction]
+//     Fails when more than max_fraction of the pixels differ perceptually by more than
+//     threshold (0..1, YIQ distance as in pixelmatch). Defaults: 0.1 and 0.001.
+//   build/regress stats baseline.txt actual.txt [time_tolerance] [memory_tolerance]
+//     Fails when a timing (*_ms) or memory (memory_*) value grows past the baseline by
+//     more than its relative tolerance. Defaults: 0.15 and 0.0.
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stb_image.h>
+
+#define MAX_STATS 32
+#define MAX_STAT_NAME 64
+// Largest possible YIQ delta between two colors, from pixelmatch.
+#define MAX_YIQ_DELTA 35215.0
+
+typedef struct {
+  char names[MAX_STATS][MAX_STAT_NAME];
+  double values[MAX_STATS];
+  uint32_t count;
+} Stats;
+
+// Squared YIQ distance with the luma term weighted highest; alpha is ignored.
+static double color_delta(const uint8_t* a, const uint8_t* b) {
+  double r1 = a[0], g1 = a[1], b1 = a[2];
+  double r2 = b[0], g2 = b[1], b2 = b[2];
+  double y = (r1 - r2) * 0.29889531 + (g1 - g2) * 0.58662247 + (b1 - b2) * 0.11448223;
+  double i = (r1 - r2) * 0.59597799 - (g1 - g2) * 0.27417610 - (b1 - b2) * 0.32180189;
+  double q = (r1 - r2) * 0.21147017 - (g1 - g2) * 0.52261711 + (b1 - b2) * 0.31114694;
+  return 0.5053 * y * y + 0.299 * i * i + 0.1957 * q * q;
+}
+
+static int compare_images(const char* golden_path, const char* actual_path, double threshold, double max_fraction) {
+  int gw, gh, aw, ah, channels;
+  uint8_t* golden = stbi_load(golden_path, &gw, &gh, &channels, 4);
+  if (!golden) {
+    fprintf(stderr, "No golden image '%s', run `make test-update` to create it\n", golden_path);
+    return 1;
+  }
+  uint8_t* actual = stbi_load(actual_path, &aw, &ah, &channels, 4);
+  if (!actual) {
+    fprintf(stderr, "Failed to load '%s'\n", actual_path);
+    stbi_image_free(golden);
+    return 1;
+  }
+
+  int status = 0;
+  if (gw != aw || gh != ah) {
+    fprintf(stderr, "%s: size %dx%d, golden is %dx%d\n", actual_path, aw, ah, gw, gh);
+    status = 1;
+  } else {
+    double max_delta = MAX_YIQ_DELTA * threshold * threshold;
+    uint64_t pixels = (uint64_t)gw * gh;
+    uint64_t mismatched = 0;
+    for (uint64_t p = 0; p < pixels; ++p) {
+      if (color_delta(golden + p * 4, actual + p * 4) > max_delta) mismatched++;
+    }
+    double fraction = (double)mismatched / (double)pixels;
+    printf("%s: %llu of %llu pixels differ (%.4f%%)\n", actual_path, (unsigned long long)mismatched,
+           (unsigned long long)pixels, fraction * 100.0);
+    if (fraction > max_fraction) status = 1;
+  }
+  stbi_image_free(golden);
+  stbi_image_free(actual);
+  return status;
+}
+
+static bool load_stats(const char* path, Stats* stats) {
+  FILE* fp = fopen(path, "r");
+  if (!fp) return false;
+  stats->count = 0;
+  char name[MAX_STAT_NAME];
+  double value;
+  while (stats->count < MAX_STATS && fscanf(fp, "%63s %lf", name, &value) == 2) {
+    strcpy(stats->names[stats->count], name);
+    stats->values[stats->count++] = value;
+  }
+  fclose(fp);
+  return true;
+}
+
+static int compare_stats(const char* baseline_path, const char* actual_path, double time_tolerance,
+                         double memory_tolerance) {
+  Stats baseline, actual;
+  if (!load_stats(baseline_path, &baseline)) {
+    fprintf(stderr, "No baseline '%s', run `make test-update` to create it\n", baseline_path);
+    return 1;
+  }
+  if (!load_stats(actual_path, &actual)) {
+    fprintf(stderr, "Failed to load '%s'\n", actual_path);
+    return 1;
+  }
+
+  int status = 0;
+  for (uint32_t i = 0; i < actual.count; ++i) {
+    const char* name = actual.names[i];
+    double tolerance;
+    if (strncmp(name, "memory_", 7) == 0) {
+      tolerance = memory_tolerance;
+    } else if (strlen(name) > 3 && strcmp(name + strlen(name) - 3, "_ms") == 0) {
+      tolerance = time_tolerance;
+    } else {
+      continue;
+    }
+
+    uint32_t b = 0;
+    while (b < baseline.count && strcmp(baseline.names[b], name) != 0) b++;
+    if (b == baseline.count) {
+      printf("  %-24s %12.4f (no baseline)\n", name, actual.values[i]);
+      continue;
+    }
+    double limit = baseline.values[b] * (1.0 + tolerance);
+    bool regressed = actual.values[i] > limit;
+    printf("  %-24s %12.4f baseline %12.4f%s\n", name, actual.values[i], baseline.values[b],
+           regressed ? "  REGRESSED" : "");
+    if (regressed) status = 1;
+  }
+  return status;
+}
+
+int main(int argc, char** argv) {
+  if (argc >= 4 && strcmp(argv[1], "image") == 0) {
+    double threshold = argc > 4 ? atof(argv[4]) : 0.1;
+    double max_fraction = argc > 5 ? atof(argv[5]) : 0.001;
+    return compare_images(argv[2], argv[3], threshold, max_fraction);
+  }
+  if (argc >= 4 && strcmp(argv[1], "stats") == 0) {
+    double time_tolerance = argc > 4 ? atof(argv[4]) : 0.15;
+    double memory_tolerance = argc > 5 ? atof(argv[5]) : 0.0;
+    return compare_stats(argv[2], argv[3], time_tolerance, memory_tolerance);
+  }
+  fprintf(stderr, "usage: %s image golden.png actual.png [threshold] [max_fraction]\n", argv[0]);
+  fprintf(stderr, "       %s stats baseline.txt actual.txt [time_tolerance] [memory_tolerance]\n", argv[0]);
+  return 2;
+}